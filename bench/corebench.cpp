@@ -0,0 +1,313 @@
+// 核心热点路径的基准测试，输入为 bench/fixtures 中录制的接口数据（与 melody-mockserver 共用）。
+//
+// 运行：melody_bench -o result.xml,xml   （或 csv / junitxml，便于版本间对比）
+// 无显示环境下需设置 QT_QPA_PLATFORM=offscreen（ctest 已设置）
+#include <QtTest>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtMath>
+#include <vector>
+#include "core/equalizer.h"
+#include "core/gainramp.h"
+#include "core/libraryindex.h"
+#include "core/loudnessanalyzer.h"
+#include "core/lyricparser.h"
+#include "core/playlistmanager.h"
+#include "core/silencedetector.h"
+#include "core/songparser.h"
+#include "core/waveform.h"
+#include "ui/coverpalette.h"
+#include "ui/flowingbackground.h"
+
+static const int kLargePlaylistSize = 100000;
+
+static QByteArray readFixture(const QString &name)
+{
+    QFile file(QStringLiteral(MELODY_FIXTURE_DIR "/") + name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qFatal("missing fixture %s", qPrintable(file.fileName()));
+    }
+    return file.readAll();
+}
+
+class CoreBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void parseLyrics();
+    void extractPaletteColors();
+    void parseNetEaseSearch();
+    void parseBilibiliSearch();
+    void playlistNext_data();
+    void playlistNext();
+    void playlistPrevious();
+    void flowingBackgroundPaint_data();
+    void flowingBackgroundPaint();
+    void crossfadeMix();
+    void equalizerBlock_data();
+    void equalizerBlock();
+    void loudnessAnalyze();
+    void waveformBuild();
+    void silenceDetect();
+    void libraryQuery_data();
+    void libraryQuery();
+
+private:
+    QString lyricText;
+    QImage cover;
+    QByteArray neteaseSearch;
+    QByteArray bilibiliSearch;
+    QVector<Song> largePlaylist;
+    LibraryIndex largeLibrary;
+};
+
+void CoreBench::initTestCase()
+{
+    lyricText = QJsonDocument::fromJson(readFixture("api/song/lyric.json"))
+                    .object()["lrc"].toObject()["lyric"].toString();
+    QVERIFY(!lyricText.isEmpty());
+
+    QVERIFY(cover.loadFromData(readFixture("cover.png")));
+
+    neteaseSearch = readFixture("api/search/get.json");
+    bilibiliSearch = readFixture("x/web-interface/search/all.json");
+
+    const QVector<Song> songs = SongParser::parseNetEaseSearch(QJsonDocument::fromJson(neteaseSearch));
+    QVERIFY(!songs.isEmpty());
+    largePlaylist.reserve(kLargePlaylistSize);
+    for (int i = 0; i < kLargePlaylistSize; ++i) {
+        Song song = songs[i % songs.size()];
+        song.id = i;
+        largePlaylist.append(song);
+    }
+
+    // 10 万首的本地曲库：标签取自搜索结果，路径各不相同
+    for (int i = 0; i < kLargePlaylistSize; ++i) {
+        const Song &song = songs[i % songs.size()];
+        LibraryIndex::Track track;
+        track.path = QString("/music/%1/%2.mp3").arg(i / 1000).arg(i);
+        track.title = song.name;
+        track.artist = song.artist;
+        track.album = song.album;
+        track.duration = song.duration;
+        largeLibrary.addTrack(track, LibraryIndex::termsFor(track));
+    }
+    QCOMPARE(largeLibrary.trackCount(), kLargePlaylistSize);
+}
+
+void CoreBench::parseLyrics()
+{
+    QMap<qint64, QString> lyrics;
+    QBENCHMARK {
+        lyrics = LyricParser::parse(lyricText);
+    }
+    QVERIFY(lyrics.size() > 10);
+}
+
+void CoreBench::extractPaletteColors()
+{
+    QVector<QColor> colors;
+    QBENCHMARK {
+        colors = CoverPalette::extractColors(cover, 3);
+    }
+    QCOMPARE(colors.size(), 3);
+}
+
+// JSON 解码与 Song 转换一起计时，与客户端收到响应后的实际路径一致
+void CoreBench::parseNetEaseSearch()
+{
+    QVector<Song> songs;
+    QBENCHMARK {
+        songs = SongParser::parseNetEaseSearch(QJsonDocument::fromJson(neteaseSearch));
+    }
+    QVERIFY(!songs.isEmpty());
+}
+
+void CoreBench::parseBilibiliSearch()
+{
+    QVector<Song> songs;
+    QBENCHMARK {
+        songs = SongParser::parseBilibiliSearch(QJsonDocument::fromJson(bilibiliSearch));
+    }
+    QVERIFY(!songs.isEmpty());
+}
+
+void CoreBench::playlistNext_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("sequential") << int(PlaylistManager::Sequential);
+    QTest::newRow("random") << int(PlaylistManager::Random);
+}
+
+void CoreBench::playlistNext()
+{
+    QFETCH(int, mode);
+    PlaylistManager playlist;
+    playlist.addSongs(largePlaylist);
+    playlist.setPlayMode(PlaylistManager::PlayMode(mode));
+    playlist.setCurrentIndex(0);
+
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            playlist.getNextSong(false);
+        }
+    }
+}
+
+void CoreBench::playlistPrevious()
+{
+    PlaylistManager playlist;
+    playlist.addSongs(largePlaylist);
+    playlist.setCurrentIndex(kLargePlaylistSize / 2);
+
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            playlist.getPreviousSong();
+        }
+    }
+}
+
+void CoreBench::flowingBackgroundPaint_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("800x600") << QSize(800, 600);
+    QTest::newRow("1920x1080") << QSize(1920, 1080);
+}
+
+void CoreBench::flowingBackgroundPaint()
+{
+    QFETCH(QSize, size);
+    FlowingBackground background;
+    background.resize(size);
+    background.setColors(CoverPalette::extractColors(cover, 3));
+
+    QImage frame(size, QImage::Format_ARGB32_Premultiplied);
+    qreal offset = 0;
+    QBENCHMARK {
+        background.setTimeOffset(offset += 0.016);
+        background.render(&frame);
+    }
+}
+
+void CoreBench::crossfadeMix()
+{
+    // 1 秒 48 kHz 立体声，相当于 PCM 引擎交叉淡化期间每秒的混音量
+    const qint64 frames = 48000;
+    std::vector<float> from(frames * 2, 0.5f);
+    std::vector<float> to(frames * 2, -0.25f);
+    std::vector<float> out(frames * 2);
+
+    QBENCHMARK {
+        GainRamp::crossfade(out.data(), from.data(), to.data(), frames, 2, 0, frames);
+    }
+}
+
+void CoreBench::equalizerBlock_data()
+{
+    QTest::addColumn<QString>("preset");
+    QTest::newRow("flat") << QString("平坦");   // 全部为 0：直接返回
+    QTest::newRow("rock") << QString("摇滚");   // 10 段全部启用，最慢的情况
+}
+
+void CoreBench::equalizerBlock()
+{
+    // 一次声卡回调的量：10ms 48 kHz 立体声（480 帧）。单次结果乘以 100 即每秒音频的处理时间
+    QFETCH(QString, preset);
+    const qint64 frames = 480;
+    std::vector<float> samples(frames * 2);
+    for (qint64 i = 0; i < frames; ++i) {
+        samples[i * 2] = samples[i * 2 + 1] = 0.1f * float(qSin(2 * M_PI * 997 * i / 48000.0));
+    }
+    Equalizer equalizer(48000);
+    equalizer.setGains(Equalizer::presetGains(preset));
+    // 先让增益平滑到位，测的是稳定状态
+    for (int i = 0; i < 100; ++i) equalizer.process(samples.data(), frames, 2);
+
+    QBENCHMARK {
+        equalizer.process(samples.data(), frames, 2);
+    }
+}
+
+void CoreBench::loudnessAnalyze()
+{
+    // 10 秒 48 kHz 立体声：K 计权滤波与分块均方
+    const qint64 frames = 48000 * 10;
+    std::vector<float> samples(frames * 2);
+    for (qint64 i = 0; i < frames; ++i) {
+        samples[i * 2] = samples[i * 2 + 1] = 0.1f * float(qSin(2 * M_PI * 997 * i / 48000.0));
+    }
+
+    QBENCHMARK {
+        LoudnessAnalyzer analyzer(48000, 2);
+        analyzer.process(samples.data(), frames);
+        QVERIFY(qAbs(analyzer.integratedLoudness() + 20.0) < 0.1);
+    }
+}
+
+void CoreBench::waveformBuild()
+{
+    // 4 分钟 48 kHz 立体声，相当于后台分析一首歌时波形部分的计算量（不含解码）
+    const qint64 frames = 48000 * 240;
+    std::vector<float> samples(frames * 2);
+    for (qint64 i = 0; i < frames; ++i) {
+        samples[i * 2] = samples[i * 2 + 1] = 0.5f * float(qSin(2 * M_PI * 440 * i / 48000.0));
+    }
+
+    QBENCHMARK {
+        WaveformBuilder builder(48000, 2);
+        builder.process(samples.data(), frames);
+        const Waveform waveform = builder.result();
+        QCOMPARE(waveform.bucketCount(), int(WaveformBuilder::kBucketCount));
+        QVERIFY(qAbs(waveform.rms[0] - 0.5f / float(M_SQRT2)) < 0.01f);
+    }
+}
+
+void CoreBench::silenceDetect()
+{
+    // 4 分钟 48 kHz 立体声，首尾各 5 秒静音：静音部分需要比较每个采样，是最慢的情况
+    const qint64 frames = 48000 * 240;
+    const qint64 silentFrames = 48000 * 5;
+    std::vector<float> samples(frames * 2, 0.0f);
+    for (qint64 i = silentFrames; i < frames - silentFrames; ++i) {
+        samples[i * 2] = samples[i * 2 + 1] = 0.5f * float(qSin(2 * M_PI * 440 * i / 48000.0));
+    }
+
+    QBENCHMARK {
+        SilenceDetector detector(48000, 2);
+        detector.process(samples.data(), frames);
+        const TrimPoints trim = detector.trimPoints();
+        QVERIFY(qAbs(trim.startMs - 4800) <= 10);
+        QVERIFY(qAbs(trim.endMs - 235200) <= 10);
+    }
+}
+
+void CoreBench::libraryQuery_data()
+{
+    const Song &song = largePlaylist.first();
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<bool>("hit");
+    QTest::newRow("title") << song.name << true;
+    QTest::newRow("title+artist") << song.name + " " + song.artist << true;
+    QTest::newRow("prefix") << song.artist.left(1) << true; // 最宽的前缀，候选最多
+    QTest::newRow("miss") << QString("zzqxj") << false;
+}
+
+void CoreBench::libraryQuery()
+{
+    // 与界面的本地搜索相同的上限
+    QFETCH(QString, query);
+    QFETCH(bool, hit);
+    QVector<int> ids;
+    QBENCHMARK {
+        ids = largeLibrary.search(query, 200);
+    }
+    QCOMPARE(!ids.isEmpty(), hit);
+}
+
+QTEST_MAIN(CoreBench)
+#include "corebench.moc"
@@ -0,0 +1,165 @@
+// 在 melody-mockserver 上运行的端到端场景：客户端真实的下载路径对接本地回放的接口，
+// 验证边下边播，以及传输中断后从镜像断点续传。
+//
+// 由 ctest 运行（cmake -DMELODY_BUILD_BENCH=ON），每个场景启动一个独立的模拟服务器进程
+#include <QtTest>
+#include <QBuffer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QProcess>
+#include <memory>
+#include "core/apimanager.h"
+#include "core/chunkedaudiobuffer.h"
+
+static const int kStartTimeoutMs = 10000;
+static const int kScenarioTimeoutMs = 30000;
+static const char kAudioPath[] = "/audio/tone.wav";
+
+class MockScenarios : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    void streamingPlayback();
+    void resumeAfterDrop();
+
+private:
+    QUrl startServer(const QStringList &arguments); // 返回服务器地址，失败时为空
+    // 与播放时相同的路径：解析 B 站音频地址，再流式下载到分块缓冲区，data 为下载到的全部内容
+    void streamBilibiliAudio(const QUrl &base, QByteArray *data);
+    QNetworkReply *get(const QUrl &url, const QByteArray &range = QByteArray()); // 等待完成后返回
+
+    std::unique_ptr<QProcess> server;
+    QNetworkAccessManager network;
+    QByteArray audio; // 数据目录中的原始音频
+};
+
+void MockScenarios::initTestCase()
+{
+    // 音质估计会写入 QSettings，与正式程序的设置分开
+    QCoreApplication::setOrganizationName("Melody");
+    QCoreApplication::setApplicationName("melody-mock-scenarios");
+
+    QFile file(QStringLiteral(MELODY_FIXTURE_DIR) + kAudioPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    audio = file.readAll();
+    QVERIFY(audio.size() > 20000);
+}
+
+void MockScenarios::cleanup()
+{
+    if (!server) return;
+    server->kill();
+    server->waitForFinished();
+    server.reset();
+}
+
+QUrl MockScenarios::startServer(const QStringList &arguments)
+{
+    server = std::make_unique<QProcess>();
+    server->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    server->start(QStringLiteral(MELODY_MOCKSERVER_PATH),
+                  QStringList { "--port", "0", "--fixtures", MELODY_FIXTURE_DIR } + arguments);
+    if (!server->waitForStarted(kStartTimeoutMs)) return QUrl();
+    // 首行输出实际监听的地址
+    while (!server->canReadLine()) {
+        if (!server->waitForReadyRead(kStartTimeoutMs)) return QUrl();
+    }
+    return QUrl(QString::fromLatin1(server->readLine()).trimmed());
+}
+
+QNetworkReply *MockScenarios::get(const QUrl &url, const QByteArray &range)
+{
+    QNetworkRequest request(url);
+    if (!range.isEmpty()) request.setRawHeader("Range", range);
+    QNetworkReply *reply = network.get(request);
+    reply->setParent(this);
+    if (!reply->isFinished()) QSignalSpy(reply, &QNetworkReply::finished).wait(kScenarioTimeoutMs);
+    return reply;
+}
+
+void MockScenarios::streamBilibiliAudio(const QUrl &base, QByteArray *data)
+{
+    ApiEndpoints endpoints;
+    endpoints.netease = endpoints.songUrl = endpoints.bilibili = base;
+    ApiManager api(endpoints);
+    QSignalSpy urlReady(&api, &ApiManager::bilibiliAudioUrlReady);
+    QSignalSpy streamReady(&api, &ApiManager::bilibiliAudioStreamReady);
+    QSignalSpy streamFinished(&api, &ApiManager::bilibiliAudioStreamFinished);
+    QSignalSpy errors(&api, &ApiManager::error);
+
+    api.getBilibiliAudioUrl("BV1mock411", 1);
+    QVERIFY(urlReady.wait(kScenarioTimeoutMs));
+    const QUrl url = urlReady.first().first().toUrl();
+    QCOMPARE(url.path(), QString(kAudioPath));
+
+    api.streamBilibiliAudio(url);
+    QVERIFY(streamFinished.wait(kScenarioTimeoutMs));
+    QVERIFY2(errors.isEmpty(), qPrintable(errors.isEmpty() ? QString() : errors.first().first().toString()));
+    QCOMPARE(streamReady.size(), 1);
+
+    // 缓冲区交给接收方后由接收方释放
+    std::unique_ptr<ChunkedAudioBuffer> buffer(qvariant_cast<ChunkedAudioBuffer *>(streamFinished.first().first()));
+    QCOMPARE(qvariant_cast<ChunkedAudioBuffer *>(streamReady.first().first()), buffer.get());
+    QVERIFY(buffer->isFinished());
+
+    QBuffer out(data);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    QVERIFY(buffer->snapshot().writeTo(&out));
+}
+
+void MockScenarios::streamingPlayback()
+{
+    // 限速后音频分多次到达，缓冲区逐块追加
+    const QUrl base = startServer({ "--bandwidth", "32k" });
+    QVERIFY(base.isValid());
+
+    QByteArray data;
+    streamBilibiliAudio(base, &data);
+    if (QTest::currentTestFailed()) return;
+    QCOMPARE(data.size(), audio.size());
+    QVERIFY(data == audio);
+}
+
+void MockScenarios::resumeAfterDrop()
+{
+    // 每第二个音频请求在 20000 字节后断开：先用一次 Range 请求占掉第一次，
+    // 播放时的下载被中断，随后从镜像地址续传剩余部分
+    const QUrl base = startServer({ "--drop", QString("20000:%1:2").arg(kAudioPath) });
+    QVERIFY(base.isValid());
+
+    QUrl audioUrl(base);
+    audioUrl.setPath(kAudioPath);
+    const qint64 tailStart = audio.size() - 1000;
+    QNetworkReply *range = get(audioUrl, "bytes=" + QByteArray::number(tailStart) + "-");
+    QCOMPARE(range->error(), QNetworkReply::NoError);
+    QCOMPARE(range->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 206);
+    QCOMPARE(range->rawHeader("Content-Range"),
+             QString("bytes %1-%2/%3").arg(tailStart).arg(audio.size() - 1).arg(audio.size()).toLatin1());
+    QVERIFY(range->readAll() == audio.mid(tailStart));
+
+    QByteArray data;
+    streamBilibiliAudio(base, &data);
+    if (QTest::currentTestFailed()) return;
+    QCOMPARE(data.size(), audio.size());
+    QVERIFY(data == audio);
+
+    // 续传而不是重新下载：共三次音频请求，注入一次中断
+    QUrl statsUrl(base);
+    statsUrl.setPath("/_mock/stats");
+    QNetworkReply *reply = get(statsUrl);
+    QCOMPARE(reply->error(), QNetworkReply::NoError);
+    const QJsonObject stats = QJsonDocument::fromJson(reply->readAll()).object();
+    QCOMPARE(stats["faultsInjected"].toInt(), 1);
+    QCOMPARE(stats["requests"].toObject()[kAudioPath].toInt(), 3);
+    QVERIFY(stats["bytesSent"].toInteger() < 2 * audio.size());
+}
+
+QTEST_GUILESS_MAIN(MockScenarios)
+#include "mockscenarios.moc"
@@ -0,0 +1,537 @@
+#include "cliplayer.h"
+#include "core/apimanager.h"
+#include "core/audioengine.h"
+#include "core/chunkedaudiobuffer.h"
+#include "core/metrics.h"
+#include "core/locallibrary.h"
+#include "core/networkpolicy.h"
+#include "core/songparser.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUrl>
+
+static QString sourceName(SearchSource source)
+{
+    switch (source) {
+    case SearchSource::Bilibili: return "bilibili";
+    case SearchSource::Local: return "local";
+    default: return "netease";
+    }
+}
+
+static QJsonObject songToJson(const Song &song)
+{
+    QJsonObject obj;
+    obj["source"] = sourceName(song.source);
+    obj["name"] = song.name;
+    obj["artist"] = song.artist;
+    if (!song.album.isEmpty()) obj["album"] = song.album;
+    if (song.duration > 0) obj["duration"] = song.duration;
+    if (song.source == SearchSource::NetEase) obj["id"] = song.id;
+    if (song.source == SearchSource::Bilibili) obj["bvid"] = song.bvid;
+    if (song.source == SearchSource::Local) obj["path"] = song.filePath;
+    return obj;
+}
+
+static QString songLine(const Song &song)
+{
+    QString text = song.artist.isEmpty() ? song.name : QString("%1 - %2").arg(song.name, song.artist);
+    if (song.duration > 0) {
+        text += QString(" (%1:%2)").arg(song.duration / 60).arg(song.duration % 60, 2, 10, QChar('0'));
+    }
+    return QString("[%1] %2").arg(sourceName(song.source), text);
+}
+
+CliPlayer::CliPlayer(QObject *parent)
+    : QObject(parent), out(stdout)
+{
+    apiManager = new ApiManager(this);
+    playlistManager = new PlaylistManager(this);
+
+    audioEngine = AudioEngine::create(AudioEngine::configuredEngine(), this);
+    audioEngine->setVolume(0.5);
+
+    sleepTimer = new QTimer(this);
+    sleepTimer->setSingleShot(true);
+    connect(sleepTimer, &QTimer::timeout, this, [this]() {
+        if (waiting == Waiting::Sleep) resumeCommands();
+    });
+
+    connect(apiManager, &ApiManager::searchFinished, this, &CliPlayer::onSearchFinished);
+    connect(apiManager, &ApiManager::bilibiliSearchFinished, this, &CliPlayer::onBilibiliSearchFinished);
+    connect(apiManager, &ApiManager::searchFailed, this, &CliPlayer::onSearchFailed);
+    connect(apiManager, &ApiManager::bilibiliSearchFailed, this, &CliPlayer::onSearchFailed);
+    connect(apiManager, &ApiManager::bilibiliVideoInfoFinished, this, &CliPlayer::onBilibiliVideoInfoFinished);
+    connect(apiManager, &ApiManager::songUrlReady, this, [this](const QUrl &url) {
+        audioEngine->setSource(url);
+        audioEngine->play();
+    });
+    connect(apiManager, &ApiManager::bilibiliAudioStreamReady, this, [this](ChunkedAudioBuffer *buffer) {
+        buffer->setParent(this);
+        if (currentAudioBuffer) currentAudioBuffer->deleteLater();
+        currentAudioBuffer = buffer;
+        audioEngine->setSourceDevice(buffer);
+        audioEngine->play();
+    });
+    connect(apiManager, &ApiManager::error, this, [this](const QString &errorString) {
+        fail(errorString);
+        // 正在解析播放地址的曲目无法播放，不会再有 EndOfMedia
+        if (trackTimer.isValid()) skipFailedTrack();
+    });
+
+    connect(audioEngine, &AudioEngine::mediaStatusChanged, this, &CliPlayer::onMediaStatusChanged);
+    connect(audioEngine, &AudioEngine::playbackStateChanged, this, [this](QMediaPlayer::PlaybackState state) {
+        if (state == QMediaPlayer::PlayingState && trackTimer.isValid()) {
+            lastStartupMs = trackTimer.elapsed();
+            trackTimer.invalidate();
+            Metrics::observe("time_to_first_audio_ms", lastStartupMs, { { "source", sourceName(currentSong.source) } });
+            out << "playing " << songLine(currentSong) << " (started in " << lastStartupMs << " ms)" << Qt::endl;
+        }
+    });
+    connect(audioEngine, &AudioEngine::errorOccurred, this, [this](QMediaPlayer::Error, const QString &errorString) {
+        fail("playback error: " + errorString);
+        skipFailedTrack();
+    });
+}
+
+void CliPlayer::setJsonOutput(bool enabled)
+{
+    jsonOutput = enabled;
+}
+
+void CliPlayer::setSearchSource(SearchSource source)
+{
+    searchSource = source;
+}
+
+void CliPlayer::enqueueCommands(const QString &line)
+{
+    for (const QString &part : line.split(';', Qt::SkipEmptyParts)) {
+        const QString command = part.trimmed();
+        if (!command.isEmpty() && !command.startsWith('#')) {
+            pendingCommands.append(command);
+        }
+    }
+    if (waiting == Waiting::None) {
+        processCommands();
+    }
+}
+
+void CliPlayer::setInputClosed()
+{
+    inputClosed = true;
+    maybeFinish();
+}
+
+void CliPlayer::processCommands()
+{
+    while (waiting == Waiting::None && !pendingCommands.isEmpty()) {
+        execute(pendingCommands.takeFirst());
+    }
+    maybeFinish();
+}
+
+void CliPlayer::resumeCommands()
+{
+    waiting = Waiting::None;
+    // 在事件循环中继续，避免在信号处理函数内部递归执行后续命令
+    QTimer::singleShot(0, this, &CliPlayer::processCommands);
+}
+
+void CliPlayer::maybeFinish()
+{
+    if (!inputClosed || waiting != Waiting::None || !pendingCommands.isEmpty()) return;
+    // 输入结束后仍在播放：继续播放，直到队列结束或收到信号
+    if (audioEngine->playbackState() == QMediaPlayer::PlayingState) return;
+    emit finished(errors > 0 ? 1 : 0);
+}
+
+void CliPlayer::fail(const QString &message)
+{
+    errors++;
+    QTextStream err(stderr);
+    err << "error: " << message << Qt::endl;
+    if (waiting == Waiting::Search) {
+        resumeCommands();
+    }
+}
+
+void CliPlayer::skipFailedTrack()
+{
+    trackTimer.invalidate();
+    // 长时间测试中单曲失败不应中断，继续下一首；没有下一首时结束 wait
+    if (playlistManager->songs().size() > 1) {
+        playSong(playlistManager->getNextSong());
+    } else if (waiting == Waiting::TrackEnd) {
+        resumeCommands();
+    }
+}
+
+bool CliPlayer::execute(const QString &command)
+{
+    const QString verb = command.section(' ', 0, 0).toLower();
+    const QString arg = command.section(' ', 1).trimmed();
+
+    if (verb == "search") {
+        if (arg.isEmpty()) { fail("usage: search <keywords>"); return true; }
+        search(arg);
+        return waiting == Waiting::None;
+    }
+    if (verb == "source") {
+        if (arg == "netease") searchSource = SearchSource::NetEase;
+        else if (arg == "bilibili") searchSource = SearchSource::Bilibili;
+        else if (arg == "local") searchSource = SearchSource::Local;
+        else fail("usage: source netease|bilibili|local");
+        return true;
+    }
+    if (verb == "results") {
+        printResults();
+        return true;
+    }
+    if (verb == "enqueue") {
+        QVector<Song> songs;
+        if (arg.isEmpty() || arg == "all") {
+            songs = searchResults;
+        } else {
+            for (const QString &token : arg.split(' ', Qt::SkipEmptyParts)) {
+                int n = token.toInt();
+                if (n < 1 || n > searchResults.size()) { fail("no search result #" + token); return true; }
+                songs.append(searchResults[n - 1]);
+            }
+        }
+        playlistManager->appendSongs(songs);
+        out << "queued " << songs.size() << " (queue size " << playlistManager->songs().size() << ")" << Qt::endl;
+        return true;
+    }
+    if (verb == "clear") {
+        playlistManager->addSongs({});
+        return true;
+    }
+    if (verb == "queue") {
+        printQueue();
+        return true;
+    }
+    if (verb == "play") {
+        play(arg.isEmpty() ? 0 : arg.toInt());
+        return true;
+    }
+    if (verb == "pause") { audioEngine->pause(); return true; }
+    if (verb == "resume") { audioEngine->play(); return true; }
+    if (verb == "stop") { audioEngine->stop(); return true; }
+    if (verb == "next") { playSong(playlistManager->getNextSong(false)); return true; }
+    if (verb == "prev") { playSong(playlistManager->getPreviousSong()); return true; }
+    if (verb == "seek") {
+        audioEngine->setPosition(qint64(arg.toDouble() * 1000));
+        return true;
+    }
+    if (verb == "volume") {
+        audioEngine->setVolume(qBound(0, arg.toInt(), 100) / 100.0);
+        return true;
+    }
+    if (verb == "mode") {
+        if (arg == "sequential") playlistManager->setPlayMode(PlaylistManager::Sequential);
+        else if (arg == "loop") playlistManager->setPlayMode(PlaylistManager::LoopOne);
+        else if (arg == "random") playlistManager->setPlayMode(PlaylistManager::Random);
+        else fail("usage: mode sequential|loop|random");
+        return true;
+    }
+    if (verb == "status") {
+        printStatus();
+        return true;
+    }
+    if (verb == "wait") {
+        // 等待当前歌曲播放结束
+        if (audioEngine->playbackState() == QMediaPlayer::StoppedState && !trackTimer.isValid()) return true;
+        waiting = Waiting::TrackEnd;
+        return false;
+    }
+    if (verb == "sleep") {
+        waiting = Waiting::Sleep;
+        sleepTimer->start(qMax(0, int(arg.toDouble() * 1000)));
+        return false;
+    }
+    if (verb == "metrics") {
+        // 无参数时打印，否则写入文件（.json 为 JSON，其余为 Prometheus 文本）
+        if (arg.isEmpty()) {
+            out << (jsonOutput ? QJsonDocument(Metrics::toJson()).toJson(QJsonDocument::Compact) : Metrics::toPrometheus());
+            out.flush();
+            return true;
+        }
+        QString errorMessage;
+        if (!Metrics::exportTo(arg, &errorMessage)) fail("metrics export: " + errorMessage);
+        return true;
+    }
+    if (verb == "help") {
+        printHelp();
+        return true;
+    }
+    if (verb == "quit" || verb == "exit") {
+        pendingCommands.clear();
+        emit finished(arg.isEmpty() ? (errors > 0 ? 1 : 0) : arg.toInt());
+        return true;
+    }
+
+    fail("unknown command: " + verb + " (try 'help')");
+    return true;
+}
+
+void CliPlayer::search(const QString &keywords)
+{
+    searchTimer.start();
+    if (searchSource == SearchSource::Local) {
+        if (!localLibrary) {
+            QStringList folders = QSettings().value("library/folders").toStringList();
+            if (folders.isEmpty()) {
+                folders = QStandardPaths::standardLocations(QStandardPaths::MusicLocation);
+            }
+            localLibrary = new LocalLibrary(this);
+            connect(localLibrary, &LocalLibrary::scanFinished, this, [this](int trackCount) {
+                if (pendingLocalQuery.isEmpty()) return;
+                out << "local library: " << trackCount << " tracks" << Qt::endl;
+                searchResults = localLibrary->search(pendingLocalQuery);
+                pendingLocalQuery.clear();
+                printResults();
+                resumeCommands();
+            });
+            localLibrary->setFolders(folders);
+        }
+        if (localLibrary->isScanning()) {
+            pendingLocalQuery = keywords;
+            waiting = Waiting::Search;
+            return;
+        }
+        searchResults = localLibrary->search(keywords);
+        printResults();
+        return;
+    }
+
+    waiting = Waiting::Search;
+    if (searchSource == SearchSource::Bilibili) {
+        apiManager->searchBilibiliVideos(keywords);
+    } else {
+        apiManager->searchSongs(keywords);
+    }
+}
+
+void CliPlayer::onSearchFinished(const QJsonDocument &json)
+{
+    searchResults = SongParser::parseNetEaseSearch(json);
+    printResults();
+    if (waiting == Waiting::Search) resumeCommands();
+}
+
+void CliPlayer::onBilibiliSearchFinished(const QJsonDocument &json)
+{
+    QString errorMessage;
+    searchResults = SongParser::parseBilibiliSearch(json, nullptr, &errorMessage);
+    if (!errorMessage.isEmpty()) {
+        fail("bilibili search: " + errorMessage);
+        return;
+    }
+    printResults();
+    if (waiting == Waiting::Search) resumeCommands();
+}
+
+void CliPlayer::onSearchFailed(const QString &errorString)
+{
+    fail("search failed: " + errorString);
+}
+
+void CliPlayer::play(int index)
+{
+    if (playlistManager->isEmpty()) {
+        // 队列为空时直接播放搜索结果
+        if (searchResults.isEmpty()) { fail("queue is empty"); return; }
+        playlistManager->appendSongs(searchResults);
+    }
+    if (index > 0) {
+        if (index > playlistManager->songs().size()) { fail("no queue entry #" + QString::number(index)); return; }
+        playlistManager->setCurrentIndex(index - 1);
+    } else if (audioEngine->playbackState() == QMediaPlayer::PausedState) {
+        audioEngine->play();
+        return;
+    } else if (playlistManager->getCurrentIndex() < 0) {
+        playlistManager->setCurrentIndex(0);
+    }
+    playSong(playlistManager->getCurrentSong());
+}
+
+void CliPlayer::playSong(const Song &song)
+{
+    if (song.name.isEmpty() && song.id == -1) return;
+
+    audioEngine->stop();
+    apiManager->abortBilibiliAudioDownloads();
+    if (currentAudioBuffer) {
+        currentAudioBuffer->deleteLater();
+        currentAudioBuffer = nullptr;
+    }
+    currentSong = song;
+    trackTimer.start();
+    out << "loading " << songLine(song) << Qt::endl;
+
+    if (song.source == SearchSource::Local) {
+        audioEngine->setSource(QUrl::fromLocalFile(song.filePath));
+        audioEngine->play();
+    } else if (song.source == SearchSource::Bilibili) {
+        apiManager->getBilibiliVideoInfo(song.bvid);
+    } else {
+        apiManager->getSongUrl(song.id);
+    }
+}
+
+void CliPlayer::onBilibiliVideoInfoFinished(const QJsonDocument &json)
+{
+    const QJsonObject root = json.object();
+    if (root.value("code").toInt() != 0) {
+        fail("bilibili video info: " + root.value("message").toString());
+        if (trackTimer.isValid()) skipFailedTrack();
+        return;
+    }
+    const QJsonObject data = root.value("data").toObject();
+    const QString bvid = data.value("bvid").toString();
+    if (bvid != currentSong.bvid) return; // 已切换到其他歌曲
+    currentSong.cid = data.value("cid").toVariant().toLongLong();
+    apiManager->getBilibiliAudioUrl(bvid, currentSong.cid);
+}
+
+void CliPlayer::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
+{
+    if (status == QMediaPlayer::StalledMedia) {
+        Metrics::increment("playback_stalls_total", { { "reason", "buffering" } });
+    }
+    if (status != QMediaPlayer::EndOfMedia) return;
+
+    out << "finished " << songLine(currentSong) << Qt::endl;
+    if (waiting == Waiting::TrackEnd) {
+        resumeCommands();
+    }
+
+    // 顺序播放到末尾后停止；其他模式由播放列表决定下一首
+    const bool atEnd = playlistManager->getPlayMode() == PlaylistManager::Sequential
+                    && playlistManager->getCurrentIndex() >= playlistManager->songs().size() - 1;
+    if (!atEnd) {
+        playSong(playlistManager->getNextSong());
+    } else {
+        maybeFinish();
+    }
+}
+
+void CliPlayer::printResults() const
+{
+    if (jsonOutput) {
+        QJsonArray array;
+        for (const Song &song : searchResults) array.append(songToJson(song));
+        QJsonObject obj;
+        obj["results"] = array;
+        obj["elapsedMs"] = searchTimer.isValid() ? searchTimer.elapsed() : -1;
+        out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << Qt::endl;
+        return;
+    }
+    out << searchResults.size() << " results";
+    if (searchTimer.isValid()) out << " in " << searchTimer.elapsed() << " ms";
+    out << Qt::endl;
+    for (int i = 0; i < searchResults.size(); ++i) {
+        out << QString("%1. ").arg(i + 1, 3) << songLine(searchResults[i]) << Qt::endl;
+    }
+}
+
+void CliPlayer::printQueue() const
+{
+    const QVector<Song> &songs = playlistManager->songs();
+    if (jsonOutput) {
+        QJsonArray array;
+        for (const Song &song : songs) array.append(songToJson(song));
+        QJsonObject obj;
+        obj["queue"] = array;
+        obj["index"] = playlistManager->getCurrentIndex();
+        out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << Qt::endl;
+        return;
+    }
+    for (int i = 0; i < songs.size(); ++i) {
+        const char *marker = (i == playlistManager->getCurrentIndex()) ? " > " : "   ";
+        out << marker << QString("%1. ").arg(i + 1, 3) << songLine(songs[i]) << Qt::endl;
+    }
+}
+
+void CliPlayer::printStatus() const
+{
+    QString state;
+    switch (audioEngine->playbackState()) {
+    case QMediaPlayer::PlayingState: state = "playing"; break;
+    case QMediaPlayer::PausedState: state = "paused"; break;
+    default: state = trackTimer.isValid() ? "loading" : "stopped"; break;
+    }
+    static const char *modes[] = { "sequential", "loop", "random" };
+
+    QJsonObject status;
+    status["state"] = state;
+    if (!currentSong.name.isEmpty()) status["song"] = songToJson(currentSong);
+    status["positionMs"] = audioEngine->position();
+    status["durationMs"] = audioEngine->duration();
+    status["index"] = playlistManager->getCurrentIndex();
+    status["queueSize"] = playlistManager->songs().size();
+    status["volume"] = qRound(audioEngine->volume() * 100);
+    status["engine"] = audioEngine->name();
+    status["underruns"] = audioEngine->underrunCount();
+    status["mode"] = modes[playlistManager->getPlayMode()];
+    status["lastStartupMs"] = lastStartupMs;
+    status["errors"] = errors;
+
+    QJsonObject network;
+    const auto stats = apiManager->networkPolicy()->hostStats();
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        QJsonObject host;
+        host["requests"] = it->requests;
+        host["reusedConnections"] = it->reusedConnections;
+        host["http2Requests"] = it->http2Requests;
+        host["avgTtfbMs"] = it->requests > 0 ? double(it->ttfbMsSum) / it->requests : 0.0;
+        host["avgTotalMs"] = it->requests > 0 ? double(it->totalMsSum) / it->requests : 0.0;
+        host["bytes"] = it->bytes;
+        network[it.key()] = host;
+    }
+    status["network"] = network;
+
+    if (jsonOutput) {
+        out << QJsonDocument(status).toJson(QJsonDocument::Compact) << Qt::endl;
+        return;
+    }
+
+    out << state;
+    if (!currentSong.name.isEmpty()) out << " " << songLine(currentSong);
+    out << QString(" %1/%2 s").arg(audioEngine->position() / 1000).arg(audioEngine->duration() / 1000)
+        << " | queue " << (playlistManager->getCurrentIndex() + 1) << "/" << playlistManager->songs().size()
+        << " | volume " << status["volume"].toInt() << " | " << modes[playlistManager->getPlayMode()];
+    if (lastStartupMs >= 0) out << " | last start " << lastStartupMs << " ms";
+    if (errors > 0) out << " | errors " << errors;
+    out << " | engine " << audioEngine->name();
+    if (audioEngine->underrunCount() > 0) out << " (underruns " << audioEngine->underrunCount() << ")";
+    out << Qt::endl;
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) {
+        if (it->requests == 0) continue;
+        out << "  " << it.key() << ": " << it->requests << " requests, avg ttfb "
+            << (it->ttfbMsSum / it->requests) << " ms, reused " << it->reusedConnections << Qt::endl;
+    }
+}
+
+void CliPlayer::printHelp() const
+{
+    out << "commands (separate several with ';'):\n"
+           "  search <keywords>         search the current source\n"
+           "  source netease|bilibili|local\n"
+           "  results                   show the last search results\n"
+           "  enqueue [all|n ...]       append search results to the queue\n"
+           "  queue | clear             show or clear the queue\n"
+           "  play [n]                  play queue entry n (default: current/first)\n"
+           "  pause | resume | stop | next | prev\n"
+           "  seek <seconds> | volume <0-100> | mode sequential|loop|random\n"
+           "  status                    playback, queue and network statistics\n"
+           "  metrics [file]            print metrics, or export them (.json or Prometheus text)\n"
+           "  wait                      wait until the current track ends\n"
+           "  sleep <seconds>\n"
+           "  quit [code]" << Qt::endl;
+}
@@ -0,0 +1,87 @@
+#ifndef CLIPLAYER_H
+#define CLIPLAYER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QMediaPlayer>
+#include <QStringList>
+#include <QTextStream>
+#include "core/playlistmanager.h"
+
+class ApiManager;
+class ChunkedAudioBuffer;
+class LocalLibrary;
+class AudioEngine;
+class QTimer;
+
+// 无界面播放器：按行执行命令（search / enqueue / play / status ...），
+// 用于服务器上的长时间稳定性测试和性能测试。
+// 搜索和等待类命令是异步的，完成后才执行下一条命令，脚本执行顺序确定
+class CliPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CliPlayer(QObject *parent = nullptr);
+
+    void setJsonOutput(bool enabled);
+    void setSearchSource(SearchSource source);
+
+    // 追加待执行的命令（多条命令可用 ';' 分隔）
+    void enqueueCommands(const QString &line);
+    // 输入已结束：所有命令执行完且队列播放完毕后退出
+    void setInputClosed();
+
+signals:
+    void finished(int exitCode);
+
+private:
+    void processCommands();
+    bool execute(const QString &command); // 返回 false 表示命令异步进行中
+    void resumeCommands();
+
+    void search(const QString &keywords);
+    void play(int index);
+    void playSong(const Song &song);
+    void printResults() const;
+    void printQueue() const;
+    void printStatus() const;
+    void printHelp() const;
+    void fail(const QString &message);
+    void skipFailedTrack(); // 当前曲目无法播放：播放下一首，或结束等待中的 wait
+    void maybeFinish();
+
+    void onSearchFinished(const QJsonDocument &json);
+    void onBilibiliSearchFinished(const QJsonDocument &json);
+    void onSearchFailed(const QString &errorString);
+    void onBilibiliVideoInfoFinished(const QJsonDocument &json);
+    void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
+
+    enum class Waiting { None, Search, TrackEnd, Sleep };
+
+    ApiManager *apiManager;
+    PlaylistManager *playlistManager;
+    LocalLibrary *localLibrary = nullptr;
+    AudioEngine *audioEngine;
+    QTimer *sleepTimer;
+
+    SearchSource searchSource = SearchSource::NetEase;
+    QVector<Song> searchResults;
+    QString pendingLocalQuery; // 曲库扫描完成后执行的本地搜索
+    Song currentSong;
+    ChunkedAudioBuffer *currentAudioBuffer = nullptr; // Bilibili 音频流
+
+    QStringList pendingCommands;
+    Waiting waiting = Waiting::None;
+    bool inputClosed = false;
+    bool jsonOutput = false;
+    int errors = 0;
+
+    QElapsedTimer searchTimer;   // 搜索耗时
+    QElapsedTimer trackTimer;    // 从请求播放到开始播放的耗时
+    qint64 lastStartupMs = -1;
+
+    mutable QTextStream out;
+};
+
+#endif // CLIPLAYER_H
@@ -0,0 +1,64 @@
+#include "cliplayer.h"
+#include "stdinreader.h"
+#include "core/logging.h"
+#include "core/metrics.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+int main(int argc, char *argv[])
+{
+    Logging::install();
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("Melody");
+    app.setApplicationName("Melody");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Melody headless player. Commands are read from -e and then from stdin; "
+                                     "run 'help' for the command list.");
+    parser.addHelpOption();
+    QCommandLineOption execOption({"e", "exec"}, "Commands to run first, separated by ';'.", "commands");
+    QCommandLineOption sourceOption({"s", "source"}, "Search source: netease, bilibili or local.", "source", "netease");
+    QCommandLineOption jsonOption("json", "Print results, queue and status as JSON lines.");
+    QCommandLineOption noStdinOption("no-stdin", "Do not read commands from stdin.");
+    QCommandLineOption apiBaseOption("api-base", "Send all API requests to this base URL (e.g. melody-mockserver).", "url");
+    QCommandLineOption metricsOption("metrics-out", "Write metrics on exit (.json, otherwise Prometheus text).", "file");
+    QCommandLineOption engineOption("engine", "Audio engine: mediaplayer or pcm.", "name");
+    parser.addOptions({ execOption, sourceOption, jsonOption, noStdinOption, apiBaseOption, metricsOption, engineOption });
+    parser.process(app);
+
+    if (parser.isSet(apiBaseOption)) {
+        qputenv("MELODY_API_BASE", parser.value(apiBaseOption).toUtf8());
+    }
+    if (parser.isSet(engineOption)) {
+        qputenv("MELODY_AUDIO_ENGINE", parser.value(engineOption).toUtf8());
+    }
+
+    CliPlayer player;
+    player.setJsonOutput(parser.isSet(jsonOption));
+    const QString source = parser.value(sourceOption);
+    player.setSearchSource(source == "bilibili" ? SearchSource::Bilibili
+                         : source == "local" ? SearchSource::Local : SearchSource::NetEase);
+    QObject::connect(&player, &CliPlayer::finished, &app, &QCoreApplication::exit);
+
+    if (parser.isSet(execOption)) {
+        player.enqueueCommands(parser.value(execOption));
+    }
+
+    // 标准输入逐行在主线程执行；reader 在 player 之后声明，先于 player 析构（停止读取）
+    StdinReader stdinReader;
+    if (parser.isSet(noStdinOption)) {
+        player.setInputClosed();
+    } else {
+        QObject::connect(&stdinReader, &StdinReader::lineRead, &player, &CliPlayer::enqueueCommands);
+        QObject::connect(&stdinReader, &StdinReader::closed, &player, &CliPlayer::setInputClosed);
+        stdinReader.start();
+    }
+
+    const int code = app.exec();
+    if (parser.isSet(metricsOption)) {
+        Metrics::exportTo(parser.value(metricsOption));
+    }
+    Logging::shutdown();
+    return code;
+}
@@ -0,0 +1,98 @@
+#include "stdinreader.h"
+
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QThread>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+StdinReader::StdinReader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+#ifdef Q_OS_WIN
+
+StdinReader::~StdinReader()
+{
+    if (!thread) return;
+    thread->requestInterruption();
+    // 线程可能阻塞在 ReadFile 上：取消后读取失败，循环随之结束
+    if (threadHandle) {
+        CancelSynchronousIo(static_cast<HANDLE>(threadHandle));
+    }
+    thread->wait();
+    delete thread;
+    if (threadHandle) CloseHandle(static_cast<HANDLE>(threadHandle));
+}
+
+void StdinReader::start()
+{
+    if (thread) return;
+    // 在主线程取得读取线程的句柄前不能开始读取，否则析构时无法取消
+    HANDLE ready = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    thread = QThread::create([this, ready]() {
+        HANDLE self = nullptr;
+        DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &self, 0, FALSE,
+                        DUPLICATE_SAME_ACCESS);
+        threadHandle = self;
+        SetEvent(ready);
+
+        QTextStream in(stdin);
+        QString line;
+        while (!QThread::currentThread()->isInterruptionRequested() && in.readLineInto(&line)) {
+            emit lineRead(line); // 跨线程，排队到主线程
+        }
+        if (!QThread::currentThread()->isInterruptionRequested()) emit closed();
+    });
+    thread->start();
+    WaitForSingleObject(ready, INFINITE);
+    CloseHandle(ready);
+}
+
+#else
+
+StdinReader::~StdinReader()
+{
+}
+
+void StdinReader::start()
+{
+    if (notifier) return;
+    notifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &StdinReader::onReadable);
+}
+
+void StdinReader::onReadable()
+{
+    char buffer[4096];
+    const ssize_t count = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (count < 0 && (errno == EINTR || errno == EAGAIN)) return;
+
+    if (count > 0) {
+        pending.append(buffer, count);
+        qsizetype newline;
+        while ((newline = pending.indexOf('\n')) >= 0) {
+            QByteArray line = pending.left(newline);
+            pending.remove(0, newline + 1);
+            if (line.endsWith('\r')) line.chop(1);
+            emit lineRead(QString::fromUtf8(line));
+        }
+        return;
+    }
+
+    // 输入结束（或出错）：最后一行可能没有换行符
+    notifier->setEnabled(false);
+    if (!pending.isEmpty()) {
+        emit lineRead(QString::fromUtf8(pending));
+        pending.clear();
+    }
+    emit closed();
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef STDINREADER_H
+#define STDINREADER_H
+
+#include <QByteArray>
+#include <QObject>
+
+class QSocketNotifier;
+class QThread;
+
+// 按行读取标准输入，lineRead / closed 总在主线程发出。
+// Unix 上用 QSocketNotifier 在主线程中读取；Windows 的控制台和管道不支持，
+// 改用阻塞读取的线程，析构时取消阻塞中的读取并等待线程退出
+class StdinReader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StdinReader(QObject *parent = nullptr);
+    ~StdinReader();
+
+    void start();
+
+signals:
+    void lineRead(const QString &line);
+    void closed(); // 标准输入结束
+
+private:
+#ifdef Q_OS_WIN
+    QThread *thread = nullptr;
+    void *threadHandle = nullptr; // 读取线程的句柄，用于 CancelSynchronousIo
+#else
+    void onReadable();
+
+    QSocketNotifier *notifier = nullptr;
+    QByteArray pending; // 尚未遇到换行的部分
+#endif
+};
+
+#endif // STDINREADER_H
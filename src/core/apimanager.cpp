@@ -1,17 +1,100 @@
 #include "apimanager.h"
+#include "networkpolicy.h"
+#include "logging.h"
+#include "chunkedaudiobuffer.h"
 #include <QNetworkReply>
 #include <QUrl>
 #include <QUrlQuery>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QDebug>
-#include <QTemporaryFile>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QStringList>
+#include <QSettings>
+#include <algorithm>
+
+// 单次详情请求携带的最大歌曲数
+static const int kMaxDetailBatchSize = 200;
+// 音频流缓冲到这个大小后开始播放（约 8 秒 256kbps 音频）
+static const qint64 kAudioPrebufferBytes = 256 * 1024;
+
+ApiEndpoints ApiEndpoints::fromSettings()
+{
+    ApiEndpoints endpoints;
+    const QString base = qEnvironmentVariable("MELODY_API_BASE");
+    if (!base.isEmpty()) {
+        endpoints.netease = endpoints.songUrl = endpoints.bilibili = QUrl(base);
+        return endpoints;
+    }
+    QSettings settings;
+    endpoints.netease = settings.value("api/netease", endpoints.netease).toUrl();
+    endpoints.songUrl = settings.value("api/songUrl", endpoints.songUrl).toUrl();
+    endpoints.bilibili = settings.value("api/bilibili", endpoints.bilibili).toUrl();
+    return endpoints;
+}
+
+QUrl ApiEndpoints::url(const QUrl &base, const QString &path) const
+{
+    QUrl url(base);
+    QString prefix = base.path();
+    if (prefix.endsWith('/')) prefix.chop(1);
+    url.setPath(prefix + path);
+    return url;
+}
 
 ApiManager::ApiManager(QObject *parent)
-    : QObject{parent}
+    : ApiManager(ApiEndpoints::fromSettings(), parent)
+{
+}
+
+ApiManager::ApiManager(const ApiEndpoints &endpoints, QObject *parent)
+    : QObject{parent}, endpoints(endpoints)
 {
     manager = new QNetworkAccessManager(this);
+    policy = new NetworkPolicy(manager, this);
+    policy->setCoreEndpoints({ endpoints.netease, endpoints.songUrl, endpoints.bilibili });
+    policy->warmUp();
+
+    // Bilibili 接口按主机限流：412/429 时退避重试而不是直接报错
+    scheduler = new RequestScheduler(this);
+    scheduler->setRateLimit(endpoints.bilibili.host(), 2.0, 4);
+    connect(scheduler, &RequestScheduler::rateLimited, this, [this](const QString &host, int delayMs) {
+        if (host == this->endpoints.bilibili.host()) {
+            emit bilibiliRateLimited(delayMs);
+        }
+    });
+
+    // 用较大的下载测量吞吐量，作为音质选择依据
+    connect(policy, &NetworkPolicy::requestTimed, this, [this](const RequestTiming &timing) {
+        if (timing.transferMs > 0) {
+            qualitySelector.addThroughputSample(timing.bytes, timing.transferMs);
+        }
+    });
+
+    detailBatchTimer = new QTimer(this);
+    detailBatchTimer->setSingleShot(true);
+    detailBatchTimer->setInterval(0); // 下一轮事件循环发出，合并同一轮内的所有请求
+    connect(detailBatchTimer, &QTimer::timeout, this, &ApiManager::flushSongDetailBatch);
+}
+
+const ApiEndpoints &ApiManager::apiEndpoints() const
+{
+    return endpoints;
+}
+
+NetworkPolicy *ApiManager::networkPolicy() const
+{
+    return policy;
+}
+
+QNetworkReply *ApiManager::sendGet(QNetworkRequest &request)
+{
+    policy->prepare(request);
+    QNetworkReply *reply = manager->get(request);
+    policy->track(reply);
+    return reply;
 }
 
 void ApiManager::setBilibiliHeaders(QNetworkRequest &request)
@@ -25,7 +108,7 @@ void ApiManager::setBilibiliHeaders(QNetworkRequest &request)
 
 void ApiManager::searchSongs(const QString &keywords, int limit, int offset)
 {
-    QUrl url("https://music.163.com/api/search/get");
+    QUrl url = endpoints.url(endpoints.netease, "/api/search/get");
     QUrlQuery query;
     query.addQueryItem("s", keywords);
     query.addQueryItem("type", "1");
@@ -33,14 +116,38 @@ void ApiManager::searchSongs(const QString &keywords, int limit, int offset)
     query.addQueryItem("offset", QString::number(offset));
     url.setQuery(query);
 
+    if (searchReply) {
+        searchReply->abort();
+    }
+
     QNetworkRequest request(url);
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
+    searchReply = reply;
     connect(reply, &QNetworkReply::finished, this, [this, reply](){ onSearchReplyFinished(reply); });
 }
 
+void ApiManager::cancelSearches()
+{
+    if (searchReply) {
+        searchReply->abort();
+    }
+    cancelBilibiliSearch();
+}
+
+void ApiManager::cancelBilibiliSearch()
+{
+    if (bilibiliSearchJob) {
+        scheduler->cancel(bilibiliSearchJob);
+        bilibiliSearchJob = 0;
+    }
+    if (bilibiliSearchReply) {
+        bilibiliSearchReply->abort();
+    }
+}
+
 void ApiManager::getLyric(qint64 songId)
 {
-    QUrl url("https://music.163.com/api/song/lyric");
+    QUrl url = endpoints.url(endpoints.netease, "/api/song/lyric");
     QUrlQuery query;
     query.addQueryItem("os", "pc");
     query.addQueryItem("id", QString::number(songId));
@@ -49,45 +156,94 @@ void ApiManager::getLyric(qint64 songId)
     url.setQuery(query);
 
     QNetworkRequest request(url);
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
     connect(reply, &QNetworkReply::finished, this, [this, reply](){ onLyricReplyFinished(reply); });
 }
 
 void ApiManager::getSongDetail(qint64 songId)
 {
-    QUrl url("https://music.163.com/api/song/detail");
-    QUrlQuery query;
-    query.addQueryItem("ids", QString("[%1]").arg(songId));
-    url.setQuery(query);
+    getSongDetails({songId});
+}
 
-    QNetworkRequest request(url);
-    QNetworkReply *reply = manager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply](){ onSongDetailReplyFinished(reply); });
+void ApiManager::getSongDetails(const QList<qint64> &songIds)
+{
+    for (qint64 id : songIds) {
+        if (id > 0 && !pendingDetailSet.contains(id)) {
+            pendingDetailSet.insert(id);
+            pendingDetailIds.append(id);
+        }
+    }
+    if (!pendingDetailIds.isEmpty() && !detailBatchTimer->isActive()) {
+        detailBatchTimer->start();
+    }
+}
+
+void ApiManager::flushSongDetailBatch()
+{
+    while (!pendingDetailIds.isEmpty()) {
+        QStringList ids;
+        int count = qMin(pendingDetailIds.size(), kMaxDetailBatchSize);
+        for (int i = 0; i < count; ++i) {
+            ids.append(QString::number(pendingDetailIds.takeFirst()));
+        }
+
+        QUrl url = endpoints.url(endpoints.netease, "/api/song/detail");
+        QUrlQuery query;
+        query.addQueryItem("ids", QString("[%1]").arg(ids.join(',')));
+        url.setQuery(query);
+
+        QNetworkRequest request(url);
+        QNetworkReply *reply = sendGet(request);
+        connect(reply, &QNetworkReply::finished, this, [this, reply](){ onSongDetailReplyFinished(reply); });
+    }
+    pendingDetailSet.clear();
 }
 
 void ApiManager::downloadImage(const QUrl &url)
 {
     QNetworkRequest request(url);
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
     connect(reply, &QNetworkReply::finished, this, [this, reply](){ onImageReplyFinished(reply); });
 }
 
 void ApiManager::getSongUrl(qint64 songId)
 {
-    QUrl url("https://musicbox-web-api.mu-jie.cc/wyy/mp3");
+    QUrl url = endpoints.url(endpoints.songUrl, "/wyy/mp3");
     QUrlQuery query;
     query.addQueryItem("rid", QString::number(songId));
     url.setQuery(query);
 
     QNetworkRequest request(url);
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
     connect(reply, &QNetworkReply::finished, this, [this, reply](){ onSongUrlReplyFinished(reply); });
 }
 
+void ApiManager::prefetchSongUrl(qint64 songId)
+{
+    QUrl url = endpoints.url(endpoints.songUrl, "/wyy/mp3");
+    QUrlQuery query;
+    query.addQueryItem("rid", QString::number(songId));
+    url.setQuery(query);
+
+    QNetworkRequest request(url);
+    request.setPriority(QNetworkRequest::LowPriority);
+    QNetworkReply *reply = sendGet(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, songId]() {
+        // 预取失败不提示，切歌时照常解析
+        const QString onlineUrl = QString::fromUtf8(reply->readAll()).trimmed();
+        if (reply->error() == QNetworkReply::NoError && !onlineUrl.isEmpty()) {
+            emit songUrlPrefetched(songId, QUrl(onlineUrl));
+        }
+        reply->deleteLater();
+    });
+}
+
 void ApiManager::onSearchReplyFinished(QNetworkReply *reply)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        emit error(reply->errorString());
+    if (reply->error() == QNetworkReply::OperationCanceledError) {
+        // 已被新的搜索取代
+    } else if (reply->error() != QNetworkReply::NoError) {
+        emit searchFailed(reply->errorString());
     } else {
         emit searchFinished(QJsonDocument::fromJson(reply->readAll()));
     }
@@ -107,7 +263,8 @@ void ApiManager::onLyricReplyFinished(QNetworkReply *reply)
 void ApiManager::onSongDetailReplyFinished(QNetworkReply *reply)
 {
     if (reply->error() != QNetworkReply::NoError) {
-        emit error(reply->errorString());
+        qCWarning(lcNetwork) << "Song detail request failed:" << reply->errorString();
+        emit songDetailFailed(reply->errorString());
     } else {
         emit songDetailFinished(QJsonDocument::fromJson(reply->readAll()));
     }
@@ -140,47 +297,98 @@ void ApiManager::onSongUrlReplyFinished(QNetworkReply *reply)
     reply->deleteLater();
 }
 
+// playurl 接口返回的音频流（dash 各音质，或 durl 单一音质），按码率升序
+static QVector<BilibiliAudioStream> parseBilibiliStreams(const QJsonObject &data)
+{
+    QVector<BilibiliAudioStream> streams;
+
+    // dash 音频：收集各音质的主地址与镜像
+    QJsonArray audioArray = data.value("dash").toObject().value("audio").toArray();
+    for (const QJsonValue &val : audioArray) {
+        QJsonObject audio = val.toObject();
+        BilibiliAudioStream stream;
+        stream.id = audio.value("id").toInt();
+        stream.bandwidth = audio.value("bandwidth").toVariant().toLongLong();
+        QString baseUrl = audio.value("baseUrl").toString();
+        if (baseUrl.isEmpty()) baseUrl = audio.value("base_url").toString();
+        if (!baseUrl.isEmpty()) stream.urls.append(QUrl(baseUrl));
+        QJsonArray backups = audio.value("backupUrl").toArray();
+        if (backups.isEmpty()) backups = audio.value("backup_url").toArray();
+        for (const QJsonValue &backup : backups) {
+            stream.urls.append(QUrl(backup.toString()));
+        }
+        if (!stream.urls.isEmpty()) {
+            streams.append(stream);
+        }
+    }
+
+    // 备用：durl（无码率信息，视为单一音质）
+    if (streams.isEmpty()) {
+        for (const QJsonValue &val : data.value("durl").toArray()) {
+            QJsonObject durl = val.toObject();
+            BilibiliAudioStream stream;
+            stream.urls.append(QUrl(durl.value("url").toString()));
+            for (const QJsonValue &backup : durl.value("backup_url").toArray()) {
+                stream.urls.append(QUrl(backup.toString()));
+            }
+            streams.append(stream);
+            break;
+        }
+    }
+
+    std::sort(streams.begin(), streams.end(),
+              [](const BilibiliAudioStream &a, const BilibiliAudioStream &b) {
+        return a.bandwidth != b.bandwidth ? a.bandwidth < b.bandwidth : a.id < b.id;
+    });
+    return streams;
+}
+
 // ==================== Bilibili API Implementation ====================
 
 void ApiManager::searchBilibiliVideos(const QString &keywords, int page)
 {
     // 使用备用的搜索API端点，更稳定
-    QUrl url("https://api.bilibili.com/x/web-interface/search/all");
+    QUrl url = endpoints.url(endpoints.bilibili, "/x/web-interface/search/all");
     QUrlQuery query;
     query.addQueryItem("keyword", keywords);
     query.addQueryItem("page", QString::number(page));
     query.addQueryItem("pagesize", "20");
     url.setQuery(query);
 
-    qDebug() << "Bilibili search URL:" << url.toString();
-
-    QNetworkRequest request(url);
-    setBilibiliHeaders(request);
+    qCDebug(lcBilibili) << "Search" << url.toString();
 
-    QNetworkReply *reply = manager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply](){ onBilibiliSearchReplyFinished(reply); });
+    cancelBilibiliSearch();
+    bilibiliSearchJob = scheduler->submit(url.host(), RequestScheduler::Search, [this, url]() {
+        QNetworkRequest request(url);
+        setBilibiliHeaders(request);
+        QNetworkReply *reply = sendGet(request);
+        bilibiliSearchReply = reply;
+        return reply;
+    }, [this](QNetworkReply *reply) { onBilibiliSearchReplyFinished(reply); });
 }
 
-void ApiManager::getBilibiliVideoInfo(const QString &bvid)
+void ApiManager::getBilibiliVideoInfo(const QString &bvid, RequestScheduler::Priority priority)
 {
-    QUrl url(QString("https://api.bilibili.com/x/web-interface/view?bvid=%1").arg(bvid));
-
-    QNetworkRequest request(url);
-    setBilibiliHeaders(request);
-
-    QNetworkReply *reply = manager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply](){ onBilibiliVideoInfoReplyFinished(reply); });
+    QUrl url = endpoints.url(endpoints.bilibili, "/x/web-interface/view");
+    url.setQuery(QString("bvid=%1").arg(bvid));
+
+    scheduler->submit(url.host(), priority, [this, url]() {
+        QNetworkRequest request(url);
+        setBilibiliHeaders(request);
+        return sendGet(request);
+    }, [this](QNetworkReply *reply) { onBilibiliVideoInfoReplyFinished(reply); });
 }
 
-void ApiManager::getBilibiliAudioUrl(const QString &bvid, qint64 cid)
+void ApiManager::getBilibiliAudioUrl(const QString &bvid, qint64 cid, RequestScheduler::Priority priority)
 {
-    QUrl url(QString("https://api.bilibili.com/x/player/playurl?bvid=%1&cid=%2&fnval=16").arg(bvid).arg(cid));
-
-    QNetworkRequest request(url);
-    setBilibiliHeaders(request);
-
-    QNetworkReply *reply = manager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply](){ onBilibiliAudioUrlReplyFinished(reply); });
+    QUrl url = endpoints.url(endpoints.bilibili, "/x/player/playurl");
+    url.setQuery(QString("bvid=%1&cid=%2&fnval=16").arg(bvid).arg(cid));
+
+    scheduler->submit(url.host(), priority, [this, url]() {
+        QNetworkRequest request(url);
+        setBilibiliHeaders(request);
+        return sendGet(request);
+    }, [this](QNetworkReply *reply) { onBilibiliAudioUrlReplyFinished(reply); });
 }
 
 void ApiManager::downloadBilibiliImage(const QUrl &url)
@@ -188,33 +396,46 @@ void ApiManager::downloadBilibiliImage(const QUrl &url)
     QNetworkRequest request(url);
     setBilibiliHeaders(request);
 
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
     connect(reply, &QNetworkReply::finished, this, [this, reply](){ onBilibiliImageReplyFinished(reply); });
 }
 
 void ApiManager::downloadBilibiliAudio(const QUrl &url)
 {
-    // 使用流式下载到临时文件，实现边下边播
+    // 流式下载到分块缓冲区，实现边下边播
     streamBilibiliAudio(url);
 }
 
+void ApiManager::downloadBilibiliAudioUpgrade(const QUrl &url)
+{
+    streamBilibiliAudio(url, new ChunkedAudioBuffer(), false, true);
+}
+
 void ApiManager::onBilibiliSearchReplyFinished(QNetworkReply *reply)
 {
-    if (reply->error() != QNetworkReply::NoError) {
+    if (!reply) {
+        bilibiliSearchJob = 0;
+        emit bilibiliSearchFailed("Bilibili搜索失败: 无法发出请求");
+        return;
+    }
+    if (reply == bilibiliSearchReply) {
+        bilibiliSearchJob = 0;
+    }
+    if (reply->error() == QNetworkReply::OperationCanceledError) {
+        // 已被新的搜索取代
+    } else if (reply->error() != QNetworkReply::NoError) {
         int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        qDebug() << "Bilibili search network error:" << reply->errorString();
-        qDebug() << "HTTP status code:" << httpStatus;
+        qCWarning(lcBilibili) << "Search failed: HTTP" << httpStatus << reply->errorString();
 
         // 如果是412错误（Precondition Failed），可能是被限制了
         if (httpStatus == 412) {
-            emit error("Bilibili搜索被限制，请稍后再试");
+            emit bilibiliSearchFailed("Bilibili搜索被限制，请稍后再试");
         } else {
-            emit error("Bilibili搜索失败: " + reply->errorString());
+            emit bilibiliSearchFailed("Bilibili搜索失败: " + reply->errorString());
         }
     } else {
         QByteArray data = reply->readAll();
-        qDebug() << "Bilibili search response size:" << data.size();
-        qDebug() << "Bilibili search response preview:" << data.left(500);
+        qCDebug(lcBilibili) << "Search response:" << data.size() << "bytes";
         emit bilibiliSearchFinished(QJsonDocument::fromJson(data));
     }
     reply->deleteLater();
@@ -222,6 +443,10 @@ void ApiManager::onBilibiliSearchReplyFinished(QNetworkReply *reply)
 
 void ApiManager::onBilibiliVideoInfoReplyFinished(QNetworkReply *reply)
 {
+    if (!reply) {
+        emit error("获取Bilibili视频信息失败: 无法发出请求");
+        return;
+    }
     if (reply->error() != QNetworkReply::NoError) {
         emit error("获取Bilibili视频信息失败: " + reply->errorString());
     } else {
@@ -232,6 +457,10 @@ void ApiManager::onBilibiliVideoInfoReplyFinished(QNetworkReply *reply)
 
 void ApiManager::onBilibiliAudioUrlReplyFinished(QNetworkReply *reply)
 {
+    if (!reply) {
+        emit error("获取Bilibili音频地址失败: 无法发出请求");
+        return;
+    }
     if (reply->error() != QNetworkReply::NoError) {
         emit error("获取Bilibili音频地址失败: " + reply->errorString());
     } else {
@@ -244,50 +473,13 @@ void ApiManager::onBilibiliAudioUrlReplyFinished(QNetworkReply *reply)
             return;
         }
 
-        QJsonObject data = rootObj.value("data").toObject();
-        QUrl audioUrl;
-        QString backupUrl;
-
-        // 尝试获取dash音频
-        if (data.contains("dash")) {
-            QJsonObject dash = data.value("dash").toObject();
-            QJsonArray audioArray = dash.value("audio").toArray();
-            if (!audioArray.isEmpty()) {
-                // 选择最高音质的音频
-                int bestId = 0;
-                QString bestUrl;
-                for (const QJsonValue &val : audioArray) {
-                    QJsonObject audio = val.toObject();
-                    int id = audio.value("id").toInt();
-                    if (id > bestId) {
-                        bestId = id;
-                        bestUrl = audio.value("baseUrl").toString();
-                    }
-                }
-                if (!bestUrl.isEmpty()) {
-                    audioUrl = QUrl(bestUrl);
-                }
-                // 保存备用URL
-                if (!audioArray.isEmpty()) {
-                    backupUrl = audioArray.first().toObject().value("baseUrl").toString();
-                }
-            }
-        }
-
-        // 备用：获取durl
-        if (audioUrl.isEmpty() && data.contains("durl")) {
-            QJsonArray durlArray = data.value("durl").toArray();
-            if (!durlArray.isEmpty()) {
-                audioUrl = QUrl(durlArray.first().toObject().value("url").toString());
-            }
-        }
-
-        if (!audioUrl.isEmpty()) {
-            qDebug() << "Bilibili audio URL ready:" << audioUrl.toString().left(100) << "...";
-            emit bilibiliAudioUrlReady(audioUrl);
-        } else if (!backupUrl.isEmpty()) {
-            qDebug() << "Using backup Bilibili audio URL";
-            emit bilibiliAudioUrlReady(QUrl(backupUrl));
+        bilibiliStreams = parseBilibiliStreams(rootObj.value("data").toObject());
+        bilibiliStreamIndex = qualitySelector.selectIndex(bilibiliStreams);
+        if (bilibiliStreamIndex >= 0) {
+            const BilibiliAudioStream &stream = bilibiliStreams[bilibiliStreamIndex];
+            qCInfo(lcBilibili) << "Audio stream selected:" << stream.id << stream.bandwidth
+                     << "bps, throughput estimate:" << qualitySelector.estimatedThroughput() << "B/s";
+            emit bilibiliAudioUrlReady(stream.urls.first());
         } else {
             emit error("无法获取Bilibili音频地址");
         }
@@ -295,6 +487,48 @@ void ApiManager::onBilibiliAudioUrlReplyFinished(QNetworkReply *reply)
     reply->deleteLater();
 }
 
+QUrl ApiManager::bilibiliAudioUpgradeUrl() const
+{
+    if (bilibiliStreamIndex < 0) return QUrl();
+
+    int index = qualitySelector.upgradeIndex(bilibiliStreams, bilibiliStreamIndex);
+    if (index == bilibiliStreamIndex) return QUrl();
+
+    qCInfo(lcBilibili) << "Audio upgrade:" << bilibiliStreams[bilibiliStreamIndex].id
+             << "->" << bilibiliStreams[index].id;
+    return bilibiliStreams[index].urls.first();
+}
+
+QUrl ApiManager::bilibiliFallbackUrl(const QUrl &failedUrl) const
+{
+    for (int i = 0; i < bilibiliStreams.size(); ++i) {
+        const QList<QUrl> &urls = bilibiliStreams[i].urls;
+        int pos = urls.indexOf(failedUrl);
+        if (pos < 0) continue;
+        // 优先同音质的镜像，镜像用尽后降一档音质
+        if (pos + 1 < urls.size()) return urls[pos + 1];
+        if (i > 0) return bilibiliStreams[i - 1].urls.first();
+        break;
+    }
+    return QUrl();
+}
+
+bool ApiManager::isSameBilibiliStream(const QUrl &a, const QUrl &b) const
+{
+    for (const BilibiliAudioStream &stream : bilibiliStreams) {
+        if (stream.urls.contains(a)) return stream.urls.contains(b);
+    }
+    return false;
+}
+
+int ApiManager::bilibiliStreamIndexOf(const QUrl &url) const
+{
+    for (int i = 0; i < bilibiliStreams.size(); ++i) {
+        if (bilibiliStreams[i].urls.contains(url)) return i;
+    }
+    return -1;
+}
+
 void ApiManager::onBilibiliImageReplyFinished(QNetworkReply *reply)
 {
     if (reply->error() != QNetworkReply::NoError) {
@@ -305,60 +539,202 @@ void ApiManager::onBilibiliImageReplyFinished(QNetworkReply *reply)
     reply->deleteLater();
 }
 
-void ApiManager::onBilibiliAudioDownloadFinished(QNetworkReply *reply)
+void ApiManager::streamBilibiliAudio(const QUrl &url)
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        emit error("下载Bilibili音频失败: " + reply->errorString());
-    } else {
-        QByteArray audioData = reply->readAll();
-        if (!audioData.isEmpty()) {
-            emit bilibiliAudioDataReady(audioData);
-        } else {
-            emit error("Bilibili音频数据为空");
-        }
-    }
-    reply->deleteLater();
+    streamBilibiliAudio(url, new ChunkedAudioBuffer(), false);
 }
 
-void ApiManager::streamBilibiliAudio(const QUrl &url)
+void ApiManager::streamBilibiliAudio(const QUrl &url, ChunkedAudioBuffer *buffer, bool announced, bool upgrade)
 {
     QNetworkRequest request(url);
     setBilibiliHeaders(request);
+    const qint64 resumeFrom = buffer->bufferedBytes();
+    if (resumeFrom > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(resumeFrom) + "-");
+    }
 
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = sendGet(request);
+    audioDownloads.append(reply);
+
+    // 接收方释放缓冲区（切歌、音质切换）时停止下载
+    QPointer<ChunkedAudioBuffer> target(buffer);
+    connect(buffer, &QObject::destroyed, reply, &QNetworkReply::abort);
+
+    auto isAnnounced = QSharedPointer<bool>::create(announced);
+    auto skipBytes = QSharedPointer<qint64>::create(0);
+    QElapsedTimer started;
+    started.start();
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [reply, target, resumeFrom, skipBytes]() {
+        if (!target) return;
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (resumeFrom > 0 && status != 206) {
+            *skipBytes = resumeFrom; // 镜像不支持 Range，丢弃已缓冲的部分
+        }
+        if (length > 0) {
+            target->setExpectedSize(status == 206 ? resumeFrom + length : length);
+        }
+    });
 
-    // 创建临时文件
-    QTemporaryFile *tempFile = new QTemporaryFile();
-    if (!tempFile->open()) {
-        emit error("无法创建临时文件用于音频下载");
-        tempFile->deleteLater();
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply, target, isAnnounced, skipBytes, resumeFrom, started]() {
+        if (!target) return;
+        QByteArray data = reply->readAll();
+        if (*skipBytes > 0) {
+            const qint64 skipped = qMin<qint64>(*skipBytes, data.size());
+            data.remove(0, skipped);
+            *skipBytes -= skipped;
+        }
+        target->append(data);
+        if (!*isAnnounced && target->bufferedBytes() >= kAudioPrebufferBytes) {
+            *isAnnounced = true;
+            // 预缓冲的速度计入吞吐量估计，接收方据此决定是否立即开始音质升级，不必等整首下载完
+            if (started.elapsed() > 0) {
+                qualitySelector.addThroughputSample(target->bufferedBytes() - resumeFrom, started.elapsed());
+            }
+            emit bilibiliAudioStreamReady(target);
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, url, reply, target, isAnnounced, upgrade]() {
+        audioDownloads.removeAll(reply);
         reply->deleteLater();
-        return;
-    }
+        if (!target) {
+            return; // 接收方已释放缓冲区
+        }
 
-    // 连接下载进度信号
-    connect(reply, &QNetworkReply::downloadProgress, this, [reply, tempFile](qint64 bytesReceived, qint64 bytesTotal) {
-        Q_UNUSED(bytesTotal)
-        // 将接收到的数据写入临时文件
-        tempFile->write(reply->readAll());
+        if (reply->error() == QNetworkReply::OperationCanceledError) {
+            // 切歌取消，不提示错误；已交给接收方的缓冲区由接收方释放
+            if (!*isAnnounced) target->deleteLater();
+        } else if (reply->error() != QNetworkReply::NoError) {
+            QUrl fallback = bilibiliFallbackUrl(url);
+            if (!fallback.isEmpty() && (target->bufferedBytes() == 0 || isSameBilibiliStream(url, fallback))) {
+                qCWarning(lcBilibili) << "Audio download failed, resuming from mirror:" << fallback.host()
+                                      << "at" << target->bufferedBytes();
+                streamBilibiliAudio(fallback, target, *isAnnounced, upgrade);
+            } else if (!fallback.isEmpty() && !*isAnnounced && !upgrade) {
+                // 降级到其他音质，已缓冲的数据不能复用
+                qCWarning(lcBilibili) << "Audio download failed, retrying lower quality:" << fallback.host();
+                target->deleteLater();
+                streamBilibiliAudio(fallback);
+            } else {
+                target->fail();
+                if (!*isAnnounced) target->deleteLater();
+                if (upgrade) {
+                    emit bilibiliAudioUpgradeFailed(reply->errorString());
+                } else {
+                    emit error("流式下载Bilibili音频失败: " + reply->errorString());
+                }
+            }
+        } else {
+            target->finish();
+            qCDebug(lcBilibili) << "Audio stream complete:" << target->bufferedBytes() << "bytes,"
+                                << target->spilledBytes() << "spilled to disk";
+            // 升级下载完成才切换到新的音频流（镜像失败时可能下载的是别的音质，按实际地址记录）
+            if (upgrade) {
+                const int index = bilibiliStreamIndexOf(url);
+                if (index >= 0) bilibiliStreamIndex = index;
+            }
+            if (!*isAnnounced) {
+                *isAnnounced = true;
+                emit bilibiliAudioStreamReady(target);
+            }
+            emit bilibiliAudioStreamFinished(target);
+        }
     });
+}
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, tempFile]() {
+void ApiManager::resolveDownloadUrl(const QString &jobId, qint64 songId)
+{
+    QUrl url = endpoints.url(endpoints.songUrl, "/wyy/mp3");
+    QUrlQuery query;
+    query.addQueryItem("rid", QString::number(songId));
+    url.setQuery(query);
+
+    QNetworkRequest request(url);
+    request.setPriority(QNetworkRequest::LowPriority);
+    QNetworkReply *reply = sendGet(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, jobId]() {
+        const QString onlineUrl = QString::fromUtf8(reply->readAll()).trimmed();
         if (reply->error() != QNetworkReply::NoError) {
-            emit error("流式下载Bilibili音频失败: " + reply->errorString());
-            tempFile->deleteLater();
+            emit downloadUrlFailed(jobId, reply->errorString());
+        } else if (onlineUrl.isEmpty()) {
+            emit downloadUrlFailed(jobId, "无法解析歌曲链接");
         } else {
-            // 写入剩余数据
-            tempFile->write(reply->readAll());
-            tempFile->flush();
-
-            // 发送临时文件路径
-            emit bilibiliAudioFileReady(tempFile->fileName());
+            emit downloadUrlResolved(jobId, QUrl(onlineUrl));
+        }
+        reply->deleteLater();
+    });
+}
 
-            // 文件将由接收方管理，不要立即删除
-            tempFile->setAutoRemove(false);
-            tempFile->deleteLater();
+void ApiManager::resolveBilibiliDownloadUrl(const QString &jobId, const QString &bvid)
+{
+    // 两步都走限流调度器的预取优先级，不占用播放请求的额度
+    QUrl infoUrl = endpoints.url(endpoints.bilibili, "/x/web-interface/view");
+    infoUrl.setQuery(QString("bvid=%1").arg(bvid));
+
+    scheduler->submit(infoUrl.host(), RequestScheduler::Prefetch, [this, infoUrl]() {
+        QNetworkRequest request(infoUrl);
+        setBilibiliHeaders(request);
+        return sendGet(request);
+    }, [this, jobId, bvid](QNetworkReply *reply) {
+        if (!reply) {
+            emit downloadUrlFailed(jobId, "获取Bilibili视频信息失败");
+            return;
         }
         reply->deleteLater();
+        const QJsonObject root = QJsonDocument::fromJson(reply->readAll()).object();
+        const qint64 cid = root.value("data").toObject().value("cid").toVariant().toLongLong();
+        if (reply->error() != QNetworkReply::NoError || root.value("code").toInt() != 0 || cid <= 0) {
+            emit downloadUrlFailed(jobId, "获取Bilibili视频信息失败");
+            return;
+        }
+
+        QUrl playUrl = endpoints.url(endpoints.bilibili, "/x/player/playurl");
+        playUrl.setQuery(QString("bvid=%1&cid=%2&fnval=16").arg(bvid).arg(cid));
+        scheduler->submit(playUrl.host(), RequestScheduler::Prefetch, [this, playUrl]() {
+            QNetworkRequest request(playUrl);
+            setBilibiliHeaders(request);
+            return sendGet(request);
+        }, [this, jobId](QNetworkReply *reply) {
+            if (!reply) {
+                emit downloadUrlFailed(jobId, "获取Bilibili音频地址失败");
+                return;
+            }
+            reply->deleteLater();
+            const QJsonObject root = QJsonDocument::fromJson(reply->readAll()).object();
+            if (reply->error() != QNetworkReply::NoError || root.value("code").toInt() != 0) {
+                emit downloadUrlFailed(jobId, "获取Bilibili音频地址失败");
+                return;
+            }
+            // 离线下载不受实时带宽限制，直接取最高音质
+            const QVector<BilibiliAudioStream> streams = parseBilibiliStreams(root.value("data").toObject());
+            if (streams.isEmpty()) {
+                emit downloadUrlFailed(jobId, "无法获取Bilibili音频地址");
+            } else {
+                emit downloadUrlResolved(jobId, streams.last().urls.first());
+            }
+        });
     });
 }
+
+QNetworkReply *ApiManager::requestAudio(const QUrl &url, qint64 offset, bool bilibili)
+{
+    QNetworkRequest request(url);
+    if (bilibili) setBilibiliHeaders(request);
+    request.setPriority(QNetworkRequest::LowPriority);
+    if (offset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(offset) + "-");
+    }
+    return sendGet(request);
+}
+
+void ApiManager::abortBilibiliAudioDownloads()
+{
+    const QList<QPointer<QNetworkReply>> downloads = audioDownloads;
+    for (const QPointer<QNetworkReply> &reply : downloads) {
+        if (reply) {
+            reply->abort();
+        }
+    }
+}
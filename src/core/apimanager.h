@@ -7,6 +7,16 @@
 #include <QJsonDocument>
 #include <QNetworkReply>
 #include <QUrl>
+#include <QList>
+#include <QSet>
+#include <QVector>
+#include <QPointer>
+#include "audioqualityselector.h"
+#include "requestscheduler.h"
+
+class QTimer;
+class NetworkPolicy;
+class ChunkedAudioBuffer;
 
 // Bilibili视频信息结构体
 struct BilibiliVideo {
@@ -18,43 +28,92 @@ struct BilibiliVideo {
     int duration;     // 时长（秒）
 };
 
+// 各平台接口的根地址。默认为公网地址；离线性能测试时可指向本地模拟服务器：
+// 环境变量 MELODY_API_BASE 覆盖全部接口，QSettings 的 api/netease、api/songUrl、
+// api/bilibili 分别覆盖单个平台
+struct ApiEndpoints {
+    QUrl netease = QUrl("https://music.163.com");
+    QUrl songUrl = QUrl("https://musicbox-web-api.mu-jie.cc");
+    QUrl bilibili = QUrl("https://api.bilibili.com");
+
+    static ApiEndpoints fromSettings();
+    QUrl url(const QUrl &base, const QString &path) const; // 在根地址后拼接接口路径
+};
+
 class ApiManager : public QObject
 {
     Q_OBJECT
 public:
     explicit ApiManager(QObject *parent = nullptr);
+    ApiManager(const ApiEndpoints &endpoints, QObject *parent = nullptr);
+
+    const ApiEndpoints &apiEndpoints() const;
 
-    // 网易云音乐API
+    NetworkPolicy *networkPolicy() const; // 网络策略与请求耗时统计
+
+    // 网易云音乐API（新的搜索会取消尚未完成的上一次搜索）
     void searchSongs(const QString &keywords, int limit = 15, int offset = 0);
     void getLyric(qint64 songId);
     void getSongDetail(qint64 songId);
+    void getSongDetails(const QList<qint64> &songIds); // 批量详情：同一事件循环内的请求合并为一次
     void downloadImage(const QUrl &url);
     void getSongUrl(qint64 songId);
+    void prefetchSongUrl(qint64 songId); // 提前解析下一首的播放地址，低优先级，不触发播放
 
     // Bilibili API
     void searchBilibiliVideos(const QString &keywords, int page = 1);
-    void getBilibiliVideoInfo(const QString &bvid);
-    void getBilibiliAudioUrl(const QString &bvid, qint64 cid);
+    void getBilibiliVideoInfo(const QString &bvid, RequestScheduler::Priority priority = RequestScheduler::Playback);
+    void getBilibiliAudioUrl(const QString &bvid, qint64 cid, RequestScheduler::Priority priority = RequestScheduler::Playback);
     void downloadBilibiliImage(const QUrl &url);
     void downloadBilibiliAudio(const QUrl &url);
-    void streamBilibiliAudio(const QUrl &url); // 新增：流式下载到临时文件
+    // 后台下载更高音质的版本：失败时只发出 bilibiliAudioUpgradeFailed，不降级也不报错
+    void downloadBilibiliAudioUpgrade(const QUrl &url);
+    void streamBilibiliAudio(const QUrl &url); // 流式下载到分块缓冲区，预缓冲后即可播放
+    void abortBilibiliAudioDownloads();        // 切歌时取消进行中的音频下载
+
+    void cancelSearches(); // 取消进行中和排队中的搜索，被取消的搜索不发出任何信号
+
+    // 离线下载：解析音频地址，不影响当前播放，结果通过 downloadUrlResolved / downloadUrlFailed 返回。
+    // B 站选择最高音质；地址会过期，每次开始下载时重新解析
+    void resolveDownloadUrl(const QString &jobId, qint64 songId);
+    void resolveBilibiliDownloadUrl(const QString &jobId, const QString &bvid);
+    // 从 offset 开始请求音频（Range），调用方负责读取和释放 reply
+    QNetworkReply *requestAudio(const QUrl &url, qint64 offset, bool bilibili);
+
+    // 自适应音质：预缓冲完成后若带宽允许，返回更高音质的地址，否则返回空。
+    // 只是候选，升级下载完成后才成为当前音频流，失败时保持原音质
+    QUrl bilibiliAudioUpgradeUrl() const;
 
 signals:
     // 网易云音乐信号
     void searchFinished(const QJsonDocument &json);
     void lyricFinished(const QJsonDocument &json);
     void songDetailFinished(const QJsonDocument &json);
+    // 详情多为后台预取，失败时不发出 error（界面会弹窗），只发出此信号
+    void songDetailFailed(const QString &errorString);
     void imageDownloaded(const QByteArray &data);
     void songUrlReady(const QUrl &url);
+    void songUrlPrefetched(qint64 songId, const QUrl &url);
 
     // Bilibili信号
     void bilibiliSearchFinished(const QJsonDocument &json);
     void bilibiliVideoInfoFinished(const QJsonDocument &json);
     void bilibiliAudioUrlReady(const QUrl &url);
-    void bilibiliAudioDataReady(const QByteArray &data);
-    void bilibiliAudioFileReady(const QString &filePath); // 新增：临时文件路径信号
+    // 音频流预缓冲完成，可开始播放；缓冲区此后归接收方所有，释放缓冲区会同时停止下载
+    void bilibiliAudioStreamReady(ChunkedAudioBuffer *buffer);
+    void bilibiliAudioStreamFinished(ChunkedAudioBuffer *buffer); // 音频流下载完成
+    void bilibiliAudioUpgradeFailed(const QString &errorString);  // 音质升级下载失败，当前播放不受影响
     void bilibiliImageDownloaded(const QByteArray &data);
 
+    void bilibiliRateLimited(int retryInMs); // 被限流，请求已排队并将自动重试
+
+    void downloadUrlResolved(const QString &jobId, const QUrl &url);
+    void downloadUrlFailed(const QString &jobId, const QString &errorString);
+
+    // 搜索失败单独通知，聚合搜索时一个来源失败不影响另一个来源的结果
+    void searchFailed(const QString &errorString);
+    void bilibiliSearchFailed(const QString &errorString);
+
     void error(const QString &errorString);
 
 private slots:
@@ -69,10 +128,40 @@ private slots:
     void onBilibiliVideoInfoReplyFinished(QNetworkReply *reply);
     void onBilibiliAudioUrlReplyFinished(QNetworkReply *reply);
     void onBilibiliImageReplyFinished(QNetworkReply *reply);
-    void onBilibiliAudioDownloadFinished(QNetworkReply *reply);
 
 private:
+    ApiEndpoints endpoints;
     QNetworkAccessManager *manager;
+    NetworkPolicy *policy;
+    RequestScheduler *scheduler; // Bilibili 接口限流调度
+
+    // 所有GET请求的统一出口：套用网络策略并记录耗时
+    QNetworkReply *sendGet(QNetworkRequest &request);
+
+    // 歌曲详情批量请求
+    QList<qint64> pendingDetailIds;
+    QSet<qint64> pendingDetailSet;
+    QTimer *detailBatchTimer;
+    void flushSongDetailBatch();
+
+    // Bilibili 音频流选择
+    AudioQualitySelector qualitySelector;
+    QVector<BilibiliAudioStream> bilibiliStreams; // 当前视频的音频流（码率升序）
+    int bilibiliStreamIndex = -1;                 // 当前使用的音频流
+    QList<QPointer<QNetworkReply>> audioDownloads;
+
+    // 进行中的搜索，被新搜索取代时中止
+    QPointer<QNetworkReply> searchReply;
+    QPointer<QNetworkReply> bilibiliSearchReply;
+    quint64 bilibiliSearchJob = 0; // 调度器中排队的Bilibili搜索
+    void cancelBilibiliSearch();
+
+    QUrl bilibiliFallbackUrl(const QUrl &failedUrl) const; // 下载失败时的镜像或降级地址
+    bool isSameBilibiliStream(const QUrl &a, const QUrl &b) const; // 同一音频流的不同镜像，可断点续传
+    int bilibiliStreamIndexOf(const QUrl &url) const; // 地址所属的音频流，未找到时返回 -1
+
+    // announced 表示缓冲区已交给接收方；缓冲区已有数据时从断点续传。upgrade 为音质升级下载
+    void streamBilibiliAudio(const QUrl &url, ChunkedAudioBuffer *buffer, bool announced, bool upgrade = false);
 
     // Bilibili请求头
     void setBilibiliHeaders(QNetworkRequest &request);
@@ -0,0 +1,207 @@
+#include "audiocache.h"
+#include "logging.h"
+#include "trackanalysisservice.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+static const quint32 kMagic = 0x43414C4D; // "MLAC"
+static const quint16 kVersion = 2; // 2：增加 verifiedAt
+// 下载完成一首写入一次，批量下载时合并
+static const int kWriteDelayMs = 2000;
+
+AudioCache::AudioCache(const QString &directory, QObject *parent)
+    : QObject(parent)
+{
+    dir = directory;
+    if (dir.isEmpty()) {
+        dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/audio";
+    }
+    QDir().mkpath(dir);
+    indexPath = dir + "/index.bin";
+
+    writeTimer = new QTimer(this);
+    writeTimer->setSingleShot(true);
+    writeTimer->setInterval(kWriteDelayMs);
+    connect(writeTimer, &QTimer::timeout, this, &AudioCache::flush);
+
+    load();
+}
+
+AudioCache::~AudioCache()
+{
+    flush();
+}
+
+QString AudioCache::keyFor(const Song &song)
+{
+    if (song.source == SearchSource::Local) return QString();
+    return TrackAnalysisService::keyFor(song);
+}
+
+QString AudioCache::directory() const
+{
+    return dir;
+}
+
+QString AudioCache::partPath(const QString &key, SearchSource source) const
+{
+    // B 站 dash 音频为 m4a 容器，网易云为 mp3
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+    const QString suffix = source == SearchSource::Bilibili ? ".m4a" : ".mp3";
+    return dir + "/" + hash + suffix + ".part";
+}
+
+QString AudioCache::filePath(const QString &key) const
+{
+    auto it = index.constFind(key);
+    if (it == index.constEnd()) return QString();
+    return dir + "/" + it->fileName;
+}
+
+bool AudioCache::contains(const QString &key) const
+{
+    return index.contains(key);
+}
+
+bool AudioCache::commit(const QString &key, const QString &partPath, const QByteArray &sha256)
+{
+    if (key.isEmpty() || !partPath.endsWith(".part")) return false;
+    const QString target = partPath.left(partPath.size() - 5);
+    // rename 不覆盖已有文件；同一目录内的重命名是原子的，不会留下半个文件
+    QFile::remove(target);
+    if (!QFile::rename(partPath, target)) {
+        qCWarning(lcNetwork) << "Unable to finalize cached audio" << target;
+        return false;
+    }
+
+    Entry entry;
+    entry.fileName = QFileInfo(target).fileName();
+    entry.size = QFileInfo(target).size();
+    entry.sha256 = sha256;
+    entry.storedAt = QDateTime::currentMSecsSinceEpoch();
+    index.insert(key, entry);
+    scheduleWrite();
+    emit entryAdded(key);
+    return true;
+}
+
+void AudioCache::remove(const QString &key)
+{
+    auto it = index.find(key);
+    if (it == index.end()) return;
+    QFile::remove(dir + "/" + it->fileName);
+    index.erase(it);
+    scheduleWrite();
+    emit entryRemoved(key);
+}
+
+void AudioCache::markVerified(const QString &key)
+{
+    auto it = index.find(key);
+    if (it == index.end()) return;
+    it->verifiedAt = QDateTime::currentMSecsSinceEpoch();
+    scheduleWrite();
+}
+
+int AudioCache::compact()
+{
+    int dropped = 0;
+    for (auto it = index.begin(); it != index.end();) {
+        if (QFileInfo::exists(dir + "/" + it->fileName)) {
+            ++it;
+            continue;
+        }
+        const QString key = it.key();
+        it = index.erase(it);
+        ++dropped;
+        emit entryRemoved(key);
+    }
+    // 即使没有变化也重写一次：QSaveFile 生成紧凑的新文件，替换掉可能残留的旧格式
+    dirty = true;
+    flush();
+    return dropped;
+}
+
+QHash<QString, AudioCache::Entry> AudioCache::entries() const
+{
+    return index;
+}
+
+qint64 AudioCache::totalBytes() const
+{
+    qint64 total = 0;
+    for (const Entry &entry : index) total += entry.size;
+    return total;
+}
+
+void AudioCache::scheduleWrite()
+{
+    dirty = true;
+    writeTimer->start();
+}
+
+void AudioCache::flush()
+{
+    writeTimer->stop();
+    if (!dirty) return;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << quint32(index.size());
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        out << it.key() << it->fileName << it->size << it->sha256 << it->storedAt << it->verifiedAt;
+    }
+
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcNetwork) << "Unable to save audio cache index:" << file.errorString();
+        return;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(lcNetwork) << "Unable to save audio cache index:" << file.errorString();
+        return;
+    }
+    dirty = false;
+}
+
+void AudioCache::load()
+{
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version < 1 || version > kVersion) {
+        qCWarning(lcNetwork) << "Ignoring incompatible audio cache index" << indexPath;
+        return;
+    }
+    if (version != kVersion) dirty = true; // 下次写入时升级格式
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Entry entry;
+        in >> key >> entry.fileName >> entry.size >> entry.sha256 >> entry.storedAt;
+        if (version >= 2) in >> entry.verifiedAt;
+        if (in.status() != QDataStream::Ok) break;
+        // 文件被手动删除的条目直接丢弃
+        if (!QFileInfo::exists(dir + "/" + entry.fileName)) {
+            dirty = true;
+            continue;
+        }
+        index.insert(key, entry);
+    }
+    qCDebug(lcNetwork) << "Loaded" << index.size() << "cached audio files";
+}
@@ -0,0 +1,67 @@
+#ifndef AUDIOCACHE_H
+#define AUDIOCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include "playlistmanager.h"
+
+class QTimer;
+
+// 离线音频缓存：缓存目录下的 audio，每首曲目一个文件，文件名为键的 SHA-1。
+// 下载中的数据写入同名的 .part 文件，完成并校验后原子重命名为正式文件再登记到索引，
+// 因此索引中的文件总是完整的。索引启动时整体读入内存，修改合并后延迟写入
+class AudioCache : public QObject
+{
+    Q_OBJECT
+public:
+    struct Entry {
+        QString fileName;    // 相对缓存目录
+        qint64 size = 0;
+        QByteArray sha256;   // 完成下载时计算，用于完整性校验
+        qint64 storedAt = 0; // 毫秒时间戳
+        qint64 verifiedAt = 0; // 最近一次校验通过的时间，0 表示从未校验
+    };
+
+    explicit AudioCache(const QString &directory = QString(), QObject *parent = nullptr);
+    ~AudioCache();
+
+    // 键与 TrackAnalysisService::keyFor 相同；本地曲目不缓存，返回空
+    static QString keyFor(const Song &song);
+
+    QString directory() const;
+    // 下载中使用的临时文件，同一首曲目的续传总是写入同一个文件
+    QString partPath(const QString &key, SearchSource source) const;
+    // 已缓存的文件路径；未缓存时返回空
+    QString filePath(const QString &key) const;
+    bool contains(const QString &key) const;
+
+    // 把下载完成的 .part 文件重命名为正式文件并登记；失败时保留 .part 文件
+    bool commit(const QString &key, const QString &partPath, const QByteArray &sha256);
+    void remove(const QString &key);
+    void markVerified(const QString &key);
+    // 整理索引：丢弃文件已不存在的条目并立即重写索引文件，返回丢弃的条目数
+    int compact();
+
+    QHash<QString, Entry> entries() const;
+    qint64 totalBytes() const;
+
+    void flush(); // 立即写入尚未保存的修改
+
+signals:
+    void entryAdded(const QString &key);
+    void entryRemoved(const QString &key);
+
+private:
+    void load();
+    void scheduleWrite();
+
+    QString dir;
+    QString indexPath;
+    QHash<QString, Entry> index;
+    QTimer *writeTimer;
+    bool dirty = false;
+};
+
+#endif // AUDIOCACHE_H
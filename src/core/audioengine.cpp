@@ -0,0 +1,98 @@
+#include "audioengine.h"
+#include "mediaplayerengine.h"
+#include "pcmaudioengine.h"
+#include <QSettings>
+
+AudioEngine::AudioEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AudioEngine *AudioEngine::create(const QString &name, QObject *parent)
+{
+    if (name == "pcm") {
+        return new PcmAudioEngine(parent);
+    }
+    return new MediaPlayerEngine(parent);
+}
+
+QString AudioEngine::configuredEngine()
+{
+    const QString fromEnv = qEnvironmentVariable("MELODY_AUDIO_ENGINE");
+    if (!fromEnv.isEmpty()) {
+        return fromEnv;
+    }
+    return QSettings().value("audio/engine", "mediaplayer").toString();
+}
+
+QStringList AudioEngine::availableEngines()
+{
+    return { "mediaplayer", "pcm" };
+}
+
+bool AudioEngine::supportsGapless() const
+{
+    return false;
+}
+
+void AudioEngine::setNextSource(const QUrl &url)
+{
+    Q_UNUSED(url);
+}
+
+void AudioEngine::setCrossfadeDuration(int milliseconds)
+{
+    Q_UNUSED(milliseconds);
+}
+
+int AudioEngine::crossfadeDuration() const
+{
+    return 0;
+}
+
+qint64 AudioEngine::underrunCount() const
+{
+    return 0;
+}
+
+bool AudioEngine::measuresLoudness() const
+{
+    return false;
+}
+
+bool AudioEngine::providesSpectrum() const
+{
+    return false;
+}
+
+void AudioEngine::setSpectrumAnalyzer(SpectrumAnalyzer *analyzer)
+{
+    Q_UNUSED(analyzer);
+}
+
+bool AudioEngine::supportsEqualizer() const
+{
+    return false;
+}
+
+void AudioEngine::setEqualizerGains(const QVector<float> &gainsDb)
+{
+    Q_UNUSED(gainsDb);
+}
+
+void AudioEngine::setNormalizationGain(float gain)
+{
+    if (qFuzzyCompare(gain, normalization)) return;
+    normalization = gain;
+    setVolume(volume()); // 按新的增益重新设置输出音量
+}
+
+float AudioEngine::normalizationGain() const
+{
+    return normalization;
+}
+
+float AudioEngine::effectiveVolume(float volume) const
+{
+    return qMin(1.0f, volume * normalization);
+}
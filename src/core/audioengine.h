@@ -0,0 +1,94 @@
+#ifndef AUDIOENGINE_H
+#define AUDIOENGINE_H
+
+#include <QObject>
+#include <QAudioDevice>
+#include <QMediaPlayer>
+#include <QUrl>
+#include <QVector>
+#include "waveform.h"
+
+class QIODevice;
+class SpectrumAnalyzer;
+
+// 播放引擎接口。界面和无界面播放器只通过它控制播放，
+// 状态和错误沿用 QMediaPlayer 的枚举，便于两种实现互换：
+//   mediaplayer - QMediaPlayer + QAudioOutput（默认）
+//   pcm         - 自行解码并输出 PCM，支持采样级无缝衔接和欠载统计
+class AudioEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AudioEngine(QObject *parent = nullptr);
+
+    // 按名称创建引擎，未知名称使用默认引擎
+    static AudioEngine *create(const QString &name, QObject *parent = nullptr);
+    // 环境变量 MELODY_AUDIO_ENGINE 优先，其次 QSettings 的 audio/engine
+    static QString configuredEngine();
+    static QStringList availableEngines();
+
+    virtual QString name() const = 0;
+
+    virtual void setSource(const QUrl &url) = 0;
+    virtual void setSourceDevice(QIODevice *device, const QUrl &sourceUrl = QUrl()) = 0;
+    virtual QUrl source() const = 0;
+
+    virtual void play() = 0;
+    virtual void pause() = 0;
+    virtual void stop() = 0;
+
+    virtual qint64 position() const = 0;
+    virtual qint64 duration() const = 0;
+    virtual void setPosition(qint64 position) = 0;
+
+    virtual QMediaPlayer::PlaybackState playbackState() const = 0;
+    virtual QMediaPlayer::MediaStatus mediaStatus() const = 0;
+
+    virtual void setVolume(float volume) = 0; // 线性音量 0.0 ~ 1.0
+    virtual float volume() const = 0;
+    virtual void setAudioDevice(const QAudioDevice &device) = 0;
+    virtual QAudioDevice audioDevice() const = 0;
+
+    // 无缝衔接：当前曲目解码完后直接接上下一曲，不经过 EndOfMedia。
+    // 不支持的引擎忽略该调用，照常在曲目结束时发出 EndOfMedia
+    virtual bool supportsGapless() const;
+    virtual void setNextSource(const QUrl &url);
+    // 交叉淡化：下一曲（setNextSource）的开头与当前曲目末尾重叠的时长，0 为关闭
+    virtual void setCrossfadeDuration(int milliseconds);
+    virtual int crossfadeDuration() const;
+
+    virtual qint64 underrunCount() const; // 输出欠载（声卡取不到数据）的次数
+    virtual bool measuresLoudness() const; // 播放时测量响度和波形，发出 loudnessMeasured / waveformMeasured
+    // 把正在输出的 PCM 送给频谱分析（在声卡回调中调用 feed），nullptr 取消；不支持的引擎忽略。
+    // providesSpectrum 为 false 时分析器收不到数据，不必启动
+    virtual bool providesSpectrum() const;
+    virtual void setSpectrumAnalyzer(SpectrumAnalyzer *analyzer);
+    // 10 段均衡器（频率见 Equalizer::kFrequencies），在输出端处理，立即生效；不支持的引擎忽略
+    virtual bool supportsEqualizer() const;
+    virtual void setEqualizerGains(const QVector<float> &gainsDb);
+
+    // 响度归一化：与音量相乘后作用在输出端，立即生效，不经过解码缓冲。
+    // 乘积超过 1.0 时按 1.0 输出，音量较高时偏轻的曲目不能完全提升到目标响度
+    void setNormalizationGain(float gain);
+    float normalizationGain() const;
+
+signals:
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void playbackStateChanged(QMediaPlayer::PlaybackState state);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void errorOccurred(QMediaPlayer::Error error, const QString &errorString);
+    void nextSourceStarted(const QUrl &url); // setNextSource 设置的曲目开始播放
+    // 从头完整解码一首曲目后测得的积分响度（只有 PCM 引擎发出）；
+    // source 为 setSource / setNextSource 的地址，或 setSourceDevice 的 sourceUrl
+    void loudnessMeasured(const QUrl &source, double lufs);
+    void waveformMeasured(const QUrl &source, const Waveform &waveform); // 同上，在 loudnessMeasured 之前发出
+
+protected:
+    float effectiveVolume(float volume) const; // 音量乘以归一化增益，限制在 1.0 以内
+
+private:
+    float normalization = 1.0f;
+};
+
+#endif // AUDIOENGINE_H
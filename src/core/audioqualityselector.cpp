@@ -0,0 +1,89 @@
+#include "audioqualityselector.h"
+#include <QSettings>
+
+// 小于该大小的传输主要受往返延迟影响，不计入吞吐量
+static const qint64 kMinSampleBytes = 256 * 1024;
+// 实时播放需要的带宽余量
+static const double kHeadroom = 1.5;
+// 新样本权重
+static const double kSmoothing = 0.3;
+// 无测量数据时的保守上限：132K
+static const qint64 kDefaultBandwidth = 132 * 1000;
+// 估计值相对已保存的值变化超过该比例才写入设置，其余在退出时保存
+static const double kPersistThreshold = 0.2;
+
+AudioQualitySelector::AudioQualitySelector()
+    : throughput(-1), sampleCount(0), persistedThroughput(-1)
+{
+    // 以上次运行的估计值作为先验
+    QSettings settings;
+    throughput = settings.value("network/throughputEstimate", -1.0).toDouble();
+    persistedThroughput = throughput;
+}
+
+AudioQualitySelector::~AudioQualitySelector()
+{
+    if (throughput != persistedThroughput) persist();
+}
+
+void AudioQualitySelector::persist()
+{
+    QSettings settings;
+    settings.setValue("network/throughputEstimate", throughput);
+    persistedThroughput = throughput;
+}
+
+void AudioQualitySelector::addThroughputSample(qint64 bytes, qint64 elapsedMs)
+{
+    if (bytes < kMinSampleBytes || elapsedMs <= 0) return;
+
+    double sample = bytes * 1000.0 / elapsedMs;
+    if (throughput < 0 || sampleCount == 0) {
+        throughput = sample;
+    } else {
+        throughput = kSmoothing * sample + (1.0 - kSmoothing) * throughput;
+    }
+    sampleCount++;
+
+    if (persistedThroughput <= 0 || qAbs(throughput - persistedThroughput) > persistedThroughput * kPersistThreshold) {
+        persist();
+    }
+}
+
+qint64 AudioQualitySelector::estimatedThroughput() const
+{
+    return throughput < 0 ? -1 : static_cast<qint64>(throughput);
+}
+
+int AudioQualitySelector::bestSustainableIndex(const QVector<BilibiliAudioStream> &streams) const
+{
+    int best = 0;
+    for (int i = 0; i < streams.size(); ++i) {
+        double bytesPerSecond = streams[i].bandwidth / 8.0;
+        if (bytesPerSecond * kHeadroom <= throughput) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+int AudioQualitySelector::selectIndex(const QVector<BilibiliAudioStream> &streams) const
+{
+    if (streams.isEmpty()) return -1;
+
+    if (throughput < 0) {
+        // 没有测量数据：选择不超过默认码率的最高音质，播放稳定后再升级
+        int index = 0;
+        for (int i = 0; i < streams.size(); ++i) {
+            if (streams[i].bandwidth <= kDefaultBandwidth) index = i;
+        }
+        return index;
+    }
+    return bestSustainableIndex(streams);
+}
+
+int AudioQualitySelector::upgradeIndex(const QVector<BilibiliAudioStream> &streams, int currentIndex) const
+{
+    if (throughput < 0 || streams.isEmpty()) return currentIndex;
+    return qMax(currentIndex, bestSustainableIndex(streams));
+}
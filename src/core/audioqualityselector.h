@@ -0,0 +1,41 @@
+#ifndef AUDIOQUALITYSELECTOR_H
+#define AUDIOQUALITYSELECTOR_H
+
+#include <QList>
+#include <QUrl>
+#include <QVector>
+
+// Bilibili dash 音频流（同一音质的主地址与镜像）
+struct BilibiliAudioStream {
+    int id = 0;              // 30216=64K, 30232=132K, 30280=192K, 30250=杜比, 30251=Hi-Res
+    qint64 bandwidth = 0;    // 码率（bit/s）
+    QList<QUrl> urls;        // baseUrl 在前，backupUrl 镜像在后
+};
+
+// 根据历史下载吞吐量选择能够实时播放的最佳音质
+class AudioQualitySelector
+{
+public:
+    AudioQualitySelector();
+    ~AudioQualitySelector(); // 保存尚未写入的估计值
+
+    // 记录一次下载：字节数与传输耗时
+    void addThroughputSample(qint64 bytes, qint64 elapsedMs);
+    // 估计吞吐量（字节/秒），尚无样本时返回 -1
+    qint64 estimatedThroughput() const;
+
+    // streams 需按码率升序排列；返回初始选择的下标
+    int selectIndex(const QVector<BilibiliAudioStream> &streams) const;
+    // 预缓冲完成后是否可升级，返回更高音质的下标，不可升级时返回 currentIndex
+    int upgradeIndex(const QVector<BilibiliAudioStream> &streams, int currentIndex) const;
+
+private:
+    int bestSustainableIndex(const QVector<BilibiliAudioStream> &streams) const;
+    void persist();
+
+    double throughput; // 指数加权平均，字节/秒
+    int sampleCount;
+    double persistedThroughput; // 设置中保存的值，变化明显时才重新写入
+};
+
+#endif // AUDIOQUALITYSELECTOR_H
@@ -0,0 +1,267 @@
+#include "cachemaintenance.h"
+#include "audiocache.h"
+#include "chunkedaudiobuffer.h"
+#include "downloadmanager.h"
+#include "logging.h"
+#include "metrics.h"
+#include "trackanalysisservice.h"
+#include "waveform.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QSet>
+#include <QThread>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 条目校验通过后多久再校验一次
+static const qint64 kReverifyIntervalMs = 30LL * 24 * 3600 * 1000;
+// 每次运行最多校验的字节数，其余留到下次
+static const qint64 kMaxVerifyBytesPerRun = 1024LL * 1024 * 1024;
+// 每读取一块停顿一下，即使在没有 I/O 优先级的平台上也只占用一小部分磁盘带宽
+static const qint64 kReadChunk = 1024 * 1024;
+static const int kPauseBetweenChunksMs = 10;
+
+// 把当前线程的磁盘 I/O 调度降到空闲级别（CPU 优先级由线程池设置）
+static void enterBackgroundIo()
+{
+#if defined(Q_OS_WIN)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(Q_OS_LINUX) && defined(SYS_ioprio_set)
+    // ioprio_set(IOPRIO_WHO_PROCESS, 当前线程, IOPRIO_CLASS_IDLE)；glibc 没有封装
+    syscall(SYS_ioprio_set, 1, 0, 3 << 13);
+#endif
+}
+
+static void leaveBackgroundIo()
+{
+#if defined(Q_OS_WIN)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#endif
+}
+
+// 创建临时文件的进程是否已退出：能拿到它的锁即说明锁已过期（拿到后随即释放并删除锁文件）
+static bool tempOwnerExited(qint64 pid)
+{
+    QLockFile lock(ChunkedAudioBuffer::tempFileLockPath(pid));
+    lock.setStaleLockTime(0);
+    return lock.tryLock(0);
+}
+
+static bool removeFile(const QFileInfo &info, qint64 *bytesFreed)
+{
+    const qint64 size = info.size();
+    if (!QFile::remove(info.absoluteFilePath())) return false;
+    *bytesFreed += size;
+    return true;
+}
+
+CacheMaintenance::CacheMaintenance(AudioCache *cache, DownloadManager *downloads, QObject *parent)
+    : QObject(parent), cache(cache), downloads(downloads), sessionStart(QDateTime::currentDateTime())
+{
+    pool.setMaxThreadCount(1);
+    pool.setThreadPriority(QThread::IdlePriority);
+}
+
+CacheMaintenance::~CacheMaintenance()
+{
+    cancelled = true;
+    pool.clear();
+    pool.waitForDone();
+}
+
+bool CacheMaintenance::isRunning() const
+{
+    return running;
+}
+
+void CacheMaintenance::start()
+{
+    if (running) return;
+    running = true;
+
+    // 在主线程取索引的快照；最久未校验的优先，直到达到本次的字节数上限
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<Check> due;
+    QStringList indexedFiles;
+    const QHash<QString, AudioCache::Entry> entries = cache->entries();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        indexedFiles.append(it->fileName);
+        if (now - it->verifiedAt < kReverifyIntervalMs) continue;
+        Check check;
+        check.key = it.key();
+        check.path = cache->directory() + "/" + it->fileName;
+        check.size = it->size;
+        check.sha256 = it->sha256;
+        check.verifiedAt = it->verifiedAt;
+        due.append(check);
+    }
+    std::sort(due.begin(), due.end(), [](const Check &a, const Check &b) { return a.verifiedAt < b.verifiedAt; });
+
+    QVector<Check> checks;
+    qint64 budget = kMaxVerifyBytesPerRun;
+    for (const Check &check : std::as_const(due)) {
+        if (budget <= 0) break;
+        checks.append(check);
+        budget -= check.size;
+    }
+
+    const QString audioDir = cache->directory();
+    pool.start([this, checks, audioDir, indexedFiles]() {
+        QElapsedTimer timer;
+        timer.start();
+        enterBackgroundIo();
+        Result result;
+        run(checks, audioDir, indexedFiles, result);
+        leaveBackgroundIo();
+        if (cancelled.load()) return;
+        const qint64 elapsed = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, result, elapsed]() {
+            apply(result, elapsed);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CacheMaintenance::run(const QVector<Check> &checks, const QString &audioDir,
+                           const QStringList &indexedFiles, Result &result)
+{
+    // 崩溃或被强制结束的进程留下的溢出文件和分析副本。文件名带创建者的进程号（melody-audio-<pid>-XXXXXX），
+    // 只删除创建者已退出的，同时运行的其他实例的文件不动；旧版本不带进程号的文件按修改时间判断
+    const qint64 ownPid = QCoreApplication::applicationPid();
+    QHash<qint64, bool> exited;
+    const QFileInfoList temps = QDir(QDir::tempPath()).entryInfoList({ "melody-audio-*" }, QDir::Files);
+    for (const QFileInfo &info : temps) {
+        if (cancelled.load()) return;
+        const QStringList parts = info.completeBaseName().split('-');
+        bool hasOwner = false;
+        const qint64 pid = parts.size() >= 3 ? parts[2].toLongLong(&hasOwner) : 0;
+        if (hasOwner && pid == ownPid) continue;
+        if (hasOwner && !exited.contains(pid)) exited.insert(pid, tempOwnerExited(pid)); // 过期的锁文件一并删除
+        if (info.suffix() == "lock") continue;
+
+        const bool orphan = hasOwner && parts.size() == 4 ? exited.value(pid)
+                                                          : info.lastModified() < sessionStart;
+        if (orphan && removeFile(info, &result.bytesFreed)) ++result.removed;
+    }
+
+    // 损坏的波形（下次播放时重新分析）
+    const QFileInfoList waveforms = QDir(TrackAnalysisService::waveformDirectory()).entryInfoList({ "*.wf" }, QDir::Files);
+    for (const QFileInfo &info : waveforms) {
+        if (cancelled.load()) return;
+        if (Waveform::load(info.absoluteFilePath()).isEmpty() && removeFile(info, &result.bytesFreed)) ++result.removed;
+    }
+
+    // 音频缓存目录中没有登记的文件：只列出，删除前需在主线程确认没有刚登记或正在下载
+    const QSet<QString> indexed(indexedFiles.cbegin(), indexedFiles.cend());
+    const QFileInfoList files = QDir(audioDir).entryInfoList(QDir::Files);
+    for (const QFileInfo &info : files) {
+        if (info.fileName() == "index.bin" || indexed.contains(info.fileName())) continue;
+        if (info.lastModified() < sessionStart) result.orphanCandidates.append(info.absoluteFilePath());
+    }
+
+    for (const Check &check : checks) {
+        switch (verify(check)) {
+        case Verdict::Ok:
+            result.verified.append(check.key);
+            break;
+        case Verdict::Mismatch:
+            result.corrupt.append(check);
+            break;
+        case Verdict::IoError:
+            ++result.unreadable;
+            break;
+        case Verdict::Cancelled:
+            return;
+        }
+    }
+}
+
+CacheMaintenance::Verdict CacheMaintenance::verify(const Check &check)
+{
+    if (cancelled.load()) return Verdict::Cancelled;
+    QFile file(check.path);
+    if (!file.exists() || file.size() != check.size) return Verdict::Mismatch;
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(lcNetwork) << "Unable to open cached audio for verification:" << check.path << file.errorString();
+        return Verdict::IoError;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(int(kReadChunk), Qt::Uninitialized);
+    qint64 total = 0;
+    for (;;) {
+        if (cancelled.load()) return Verdict::Cancelled;
+        const qint64 read = file.read(buffer.data(), buffer.size());
+        if (read < 0) {
+            qCWarning(lcNetwork) << "Unable to read cached audio for verification:" << check.path
+                                 << file.errorString();
+            return Verdict::IoError;
+        }
+        if (read == 0) break;
+        total += read;
+        hash.addData(QByteArray::fromRawData(buffer.constData(), int(read)));
+        QThread::msleep(kPauseBetweenChunksMs);
+    }
+    // 读到的长度不足说明读取中途出错（或文件正被改写），不当作损坏
+    if (total != check.size) return Verdict::IoError;
+    return hash.result() == check.sha256 ? Verdict::Ok : Verdict::Mismatch;
+}
+
+void CacheMaintenance::apply(const Result &result, qint64 elapsedMs)
+{
+    running = false;
+    Report report;
+    report.verified = result.verified.size();
+    report.unreadable = result.unreadable;
+    report.orphansRemoved = result.removed;
+    report.bytesFreed = result.bytesFreed;
+    report.elapsedMs = elapsedMs;
+
+    for (const QString &key : result.verified) cache->markVerified(key);
+
+    // 校验期间条目可能已被重新下载替换，只移除仍是同一份数据的
+    const QHash<QString, AudioCache::Entry> entries = cache->entries();
+    for (const Check &check : result.corrupt) {
+        auto it = entries.constFind(check.key);
+        if (it == entries.constEnd() || it->sha256 != check.sha256) continue;
+        qCWarning(lcNetwork) << "Removing corrupt cached audio" << check.key << check.path;
+        cache->remove(check.key);
+        ++report.corrupt;
+        report.bytesFreed += check.size;
+    }
+
+    QSet<QString> keep;
+    for (const AudioCache::Entry &entry : entries) keep.insert(cache->directory() + "/" + entry.fileName);
+    if (downloads) {
+        for (const DownloadManager::Job &job : downloads->jobs()) {
+            keep.insert(cache->partPath(job.key, job.song.source));
+        }
+    }
+    for (const QString &path : result.orphanCandidates) {
+        if (keep.contains(path)) continue;
+        const QFileInfo info(path);
+        if (removeFile(info, &report.bytesFreed)) ++report.orphansRemoved;
+    }
+
+    const int dropped = cache->compact();
+
+    Metrics::observe("cache_maintenance_ms", double(elapsedMs));
+    Metrics::increment("cache_verify_failures_total", {}, report.corrupt);
+    Metrics::increment("cache_orphans_removed_total", {}, report.orphansRemoved);
+    qCInfo(lcNetwork) << "Cache maintenance:" << report.verified << "verified," << report.corrupt << "corrupt,"
+                      << report.unreadable << "unreadable,"
+                      << report.orphansRemoved << "orphans removed," << dropped << "stale index entries,"
+                      << report.bytesFreed / 1024 << "KB freed in" << elapsedMs << "ms";
+    emit finished(report);
+}
@@ -0,0 +1,81 @@
+#ifndef CACHEMAINTENANCE_H
+#define CACHEMAINTENANCE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+class AudioCache;
+class DownloadManager;
+
+// 缓存维护：在空闲优先级（CPU 与磁盘 I/O）的后台线程中
+//   - 删除已退出的进程遗留的临时文件（溢出文件、分析用的音频副本），
+//   - 删除损坏的波形文件、音频缓存目录中没有登记的文件和没有对应下载任务的 .part 文件，
+//   - 重新计算音频缓存的 SHA-256，与下载完成时记录的不符（或长度不符、文件已不存在）的条目移除，
+//     读取出错的条目保留，下次运行再校验，
+//   - 最后整理音频缓存索引。
+// 校验按最久未校验的优先，每次运行有字节数上限，读取之间稍作停顿，不与播放争抢磁盘
+class CacheMaintenance : public QObject
+{
+    Q_OBJECT
+public:
+    struct Report {
+        int verified = 0;
+        int corrupt = 0;         // 校验失败并已移除的缓存条目
+        int unreadable = 0;      // 读取出错、留待下次校验的条目
+        int orphansRemoved = 0;  // 临时文件、孤立文件与损坏的波形
+        qint64 bytesFreed = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    CacheMaintenance(AudioCache *cache, DownloadManager *downloads, QObject *parent = nullptr);
+    ~CacheMaintenance(); // 取消并等待后台任务退出
+
+    void start(); // 已在运行时忽略
+    bool isRunning() const;
+
+signals:
+    void finished(const CacheMaintenance::Report &report);
+
+private:
+    struct Check {
+        QString key;
+        QString path;
+        qint64 size = 0;
+        QByteArray sha256;
+        qint64 verifiedAt = 0;
+    };
+
+    enum class Verdict {
+        Ok,
+        Mismatch, // 确认数据已损坏
+        IoError,  // 无法读取（权限、磁盘错误、被占用等），不能说明数据损坏
+        Cancelled
+    };
+
+    struct Result {
+        QStringList verified;
+        QVector<Check> corrupt;
+        int unreadable = 0;
+        QStringList orphanCandidates; // 需要回到主线程确认后再删除
+        int removed = 0;
+        qint64 bytesFreed = 0;
+    };
+
+    void run(const QVector<Check> &checks, const QString &audioDir, const QStringList &indexedFiles, Result &result);
+    Verdict verify(const Check &check);
+    void apply(const Result &result, qint64 elapsedMs);
+
+    AudioCache *cache;
+    DownloadManager *downloads;
+    QDateTime sessionStart; // 修改时间早于此的临时文件不属于本次运行
+    QThreadPool pool;
+    bool running = false;
+    std::atomic<bool> cancelled { false };
+};
+
+#endif // CACHEMAINTENANCE_H
@@ -0,0 +1,376 @@
+#include "chunkedaudiobuffer.h"
+#include "logging.h"
+#include "metrics.h"
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QLockFile>
+#include <QTemporaryFile>
+#include <QThread>
+#include <cstring>
+
+// 工作线程读取尚未下载的数据时的最长等待时间
+static const int kReadWaitMs = 10000;
+static const char kTempFilePrefix[] = "melody-audio-";
+
+// 所有音频流合计的内存与磁盘占用（播放中和后台升级的流可能同时存在）
+static QAtomicInteger<qint64> totalMemoryBytes;
+static QAtomicInteger<qint64> totalSpilledBytes;
+
+struct ChunkedAudioBuffer::ReaderScope {
+    explicit ReaderScope(ChunkedAudioBuffer *buffer) : buffer(buffer) { buffer->activeReaders++; }
+    ~ReaderScope()
+    {
+        if (--buffer->activeReaders == 0) buffer->readersDone.wakeAll();
+    }
+    ChunkedAudioBuffer *buffer;
+};
+
+ChunkedAudioBuffer::ChunkedAudioBuffer(qint64 memoryLimit, QObject *parent)
+    : QIODevice(parent), maxResidentChunks(int(qMax<qint64>(2, memoryLimit / kChunkSize)))
+{
+    // 无缓冲：数据在不断增长，QIODevice 自身的预读缓冲会读到过期的 EOF
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+ChunkedAudioBuffer::~ChunkedAudioBuffer()
+{
+    {
+        QMutexLocker locker(&mutex);
+        failed = true;
+        dataArrived.wakeAll();
+        // 播放器或解码线程可能正阻塞在 readData 的等待中：被唤醒后看到 failed 返回，
+        // 必须等它们离开后才能释放 mutex 和数据
+        while (activeReaders > 0) readersDone.wait(&mutex);
+        residentChunks = 0;
+        freeBuffers.clear();
+        spilled = 0;
+    }
+    reportMemory();
+    delete spillFile;
+}
+
+void ChunkedAudioBuffer::setExpectedSize(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    expected = bytes;
+}
+
+void ChunkedAudioBuffer::append(const QByteArray &data)
+{
+    if (data.isEmpty()) return;
+    qint64 buffered = 0;
+    qint64 total = 0;
+    {
+        QMutexLocker locker(&mutex);
+        const char *source = data.constData();
+        qint64 remaining = data.size();
+        while (remaining > 0) {
+            const int index = int(written / kChunkSize);
+            if (index == chunks.size()) {
+                makeRoom(index);
+                Chunk chunk;
+                chunk.data = takeBuffer();
+                chunks.append(chunk);
+                residentChunks++;
+            }
+            Chunk &chunk = chunks[index];
+            const qint64 count = qMin<qint64>(remaining, kChunkSize - chunk.data.size());
+            chunk.data.append(source, count);
+            chunk.lastUsed = ++useCounter;
+            source += count;
+            remaining -= count;
+            written += count;
+        }
+        buffered = written;
+        total = expected;
+        dataArrived.wakeAll();
+    }
+    reportMemory();
+    emit bufferedBytesChanged(buffered, total);
+    emit readyRead();
+}
+
+void ChunkedAudioBuffer::finish()
+{
+    QMutexLocker locker(&mutex);
+    finished = true;
+    expected = written;
+    dataArrived.wakeAll();
+}
+
+void ChunkedAudioBuffer::fail()
+{
+    QMutexLocker locker(&mutex);
+    failed = true;
+    dataArrived.wakeAll();
+}
+
+qint64 ChunkedAudioBuffer::bufferedBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return written;
+}
+
+qint64 ChunkedAudioBuffer::expectedSize() const
+{
+    QMutexLocker locker(&mutex);
+    return expected;
+}
+
+qint64 ChunkedAudioBuffer::memoryBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return qint64(residentChunks + freeBuffers.size()) * kChunkSize;
+}
+
+qint64 ChunkedAudioBuffer::spilledBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return spilled;
+}
+
+bool ChunkedAudioBuffer::isFinished() const
+{
+    QMutexLocker locker(&mutex);
+    return finished;
+}
+
+ChunkedAudioBuffer::Snapshot ChunkedAudioBuffer::snapshot() const
+{
+    QMutexLocker locker(&mutex);
+    if (!finished || failed || written == 0) return Snapshot();
+
+    Snapshot result;
+    result.size = written;
+    result.chunks.reserve(chunks.size());
+    bool needsSpill = false;
+    for (const Chunk &chunk : chunks) {
+        result.chunks.append(chunk.data);
+        if (chunk.data.isEmpty()) needsSpill = true;
+    }
+    if (needsSpill) {
+        // 换出的块可能还在 QFile 的写缓冲中，先写到磁盘再用另一个句柄打开
+        if (!spillFile || !spillFile->flush()) return Snapshot();
+        result.spillFile = std::make_shared<QFile>(spillFile->fileName());
+        if (!result.spillFile->open(QIODevice::ReadOnly)) {
+            qCWarning(lcPlayback) << "Unable to reopen audio spill file:" << result.spillFile->errorString();
+            return Snapshot();
+        }
+    }
+    return result;
+}
+
+bool ChunkedAudioBuffer::Snapshot::writeTo(QIODevice *out) const
+{
+    QByteArray scratch;
+    for (int index = 0; index < chunks.size(); ++index) {
+        const qint64 start = qint64(index) * kChunkSize;
+        const qint64 length = qMin(kChunkSize, size - start);
+        const char *data = chunks[index].constData();
+        if (chunks[index].isEmpty()) {
+            scratch.resize(length);
+            if (!spillFile || !spillFile->seek(start) || spillFile->read(scratch.data(), length) != length) {
+                return false;
+            }
+            data = scratch.constData();
+        }
+        if (out->write(data, length) != length) return false;
+    }
+    return true;
+}
+
+bool ChunkedAudioBuffer::isSequential() const
+{
+    return false;
+}
+
+qint64 ChunkedAudioBuffer::size() const
+{
+    QMutexLocker locker(&mutex);
+    return expected >= 0 ? expected : written;
+}
+
+qint64 ChunkedAudioBuffer::bytesAvailable() const
+{
+    QMutexLocker locker(&mutex);
+    return qMax<qint64>(0, written - pos());
+}
+
+bool ChunkedAudioBuffer::atEnd() const
+{
+    QMutexLocker locker(&mutex);
+    return finished && pos() >= written;
+}
+
+qint64 ChunkedAudioBuffer::readData(char *data, qint64 maxSize)
+{
+    const qint64 position = pos();
+    QMutexLocker locker(&mutex);
+    bool memoryChanged = false;
+    const qint64 result = readLocked(data, maxSize, position, &memoryChanged);
+    locker.unlock();
+    if (memoryChanged) reportMemory();
+    return result;
+}
+
+qint64 ChunkedAudioBuffer::readLocked(char *data, qint64 maxSize, qint64 position, bool *memoryChanged)
+{
+    ReaderScope scope(this);
+
+    if (position >= written && !finished && !failed && QThread::currentThread() != thread()) {
+        // 播放器工作线程读到下载进度之前：等待数据到达
+        QDeadlineTimer deadline(kReadWaitMs);
+        while (position >= written && !finished && !failed) {
+            if (!dataArrived.wait(&mutex, deadline)) break;
+        }
+    }
+    if (failed) return -1;
+    if (position >= written) return finished ? -1 : 0;
+    const int residentBefore = residentChunks;
+
+    readPosition = position;
+    qint64 copied = 0;
+    while (copied < maxSize && position + copied < written) {
+        const qint64 offset = position + copied;
+        const int index = int(offset / kChunkSize);
+        if (chunks[index].data.isEmpty() && !load(index)) {
+            break;
+        }
+        Chunk &chunk = chunks[index];
+        chunk.lastUsed = ++useCounter;
+        const qint64 inChunk = offset - qint64(index) * kChunkSize;
+        const qint64 count = qMin<qint64>(maxSize - copied, chunk.data.size() - inChunk);
+        memcpy(data + copied, chunk.data.constData() + inChunk, size_t(count));
+        copied += count;
+    }
+    *memoryChanged = residentChunks != residentBefore || spilled != reportedSpilled;
+    return copied > 0 ? copied : -1;
+}
+
+qint64 ChunkedAudioBuffer::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1; // 只读设备，数据通过 append() 写入
+}
+
+bool ChunkedAudioBuffer::makeRoom(int keepIndex)
+{
+    if (residentChunks < maxResidentChunks) return true;
+
+    // 优先换出已播放过的块（最久未用）；否则换出离播放位置最远的块，它最晚才会被读到
+    const int readIndex = int(readPosition / kChunkSize);
+    const int writeIndex = int(written / kChunkSize);
+    int victim = -1;
+    for (int i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].data.isEmpty() || i == keepIndex) continue;
+        if (i == writeIndex && !finished) continue; // 正在写入的块
+        if (i < readIndex) {
+            if (victim < 0 || victim > readIndex || chunks[i].lastUsed < chunks[victim].lastUsed) victim = i;
+        } else if (victim < 0 || (victim > readIndex && i > victim)) {
+            victim = i;
+        }
+    }
+    if (victim < 0 || !spill(victim)) {
+        return false; // 无法换出时暂时超出上限，保证数据不丢失
+    }
+
+    freeBuffers.append(std::move(chunks[victim].data));
+    freeBuffers.last().resize(0);
+    chunks[victim].data = QByteArray();
+    residentChunks--;
+    // 空闲块只保留一个，其余释放
+    while (freeBuffers.size() > 1) freeBuffers.removeLast();
+    return true;
+}
+
+bool ChunkedAudioBuffer::spill(int index)
+{
+    Chunk &chunk = chunks[index];
+    if (chunk.onDisk) return true;
+
+    if (!spillFile) {
+        spillFile = new QTemporaryFile(tempFileTemplate());
+        if (!spillFile->open()) {
+            qCWarning(lcPlayback) << "Unable to create audio spill file:" << spillFile->errorString();
+            delete spillFile;
+            spillFile = nullptr;
+            return false;
+        }
+    }
+    if (!spillFile->seek(qint64(index) * kChunkSize)
+        || spillFile->write(chunk.data) != chunk.data.size()) {
+        qCWarning(lcPlayback) << "Unable to spill audio chunk:" << spillFile->errorString();
+        return false;
+    }
+    chunk.onDisk = true;
+    spilled += chunk.data.size();
+    return true;
+}
+
+bool ChunkedAudioBuffer::load(int index)
+{
+    if (!spillFile || !chunks[index].onDisk) return false;
+    makeRoom(index);
+
+    const qint64 start = qint64(index) * kChunkSize;
+    const qint64 length = qMin(kChunkSize, written - start);
+    QByteArray data = takeBuffer();
+    data.resize(length);
+    if (!spillFile->seek(start) || spillFile->read(data.data(), length) != length) {
+        qCWarning(lcPlayback) << "Unable to read back audio chunk:" << spillFile->errorString();
+        return false;
+    }
+    chunks[index].data = data;
+    residentChunks++;
+    return true;
+}
+
+QByteArray ChunkedAudioBuffer::takeBuffer()
+{
+    if (!freeBuffers.isEmpty()) {
+        return freeBuffers.takeLast();
+    }
+    QByteArray buffer;
+    buffer.reserve(kChunkSize);
+    return buffer;
+}
+
+void ChunkedAudioBuffer::reportMemory()
+{
+    QMutexLocker locker(&mutex);
+    const qint64 memory = qint64(residentChunks + freeBuffers.size()) * kChunkSize;
+    if (memory == reportedMemory && spilled == reportedSpilled) return;
+    const qint64 memoryTotal = totalMemoryBytes.fetchAndAddRelaxed(memory - reportedMemory) + memory - reportedMemory;
+    const qint64 spilledTotal = totalSpilledBytes.fetchAndAddRelaxed(spilled - reportedSpilled) + spilled - reportedSpilled;
+    reportedMemory = memory;
+    reportedSpilled = spilled;
+    locker.unlock();
+
+    Metrics::setGauge("audio_buffer_memory_bytes", double(memoryTotal));
+    Metrics::setGauge("audio_buffer_spilled_bytes", double(spilledTotal));
+}
+
+QString ChunkedAudioBuffer::tempFileLockPath(qint64 pid)
+{
+    return QDir::tempPath() + "/" + kTempFilePrefix + QString::number(pid) + ".lock";
+}
+
+QString ChunkedAudioBuffer::tempFileTemplate()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    // 静态对象在进程退出时析构并删除锁文件；崩溃时留下的锁文件因进程已不存在而视为过期
+    static QLockFile ownerLock(tempFileLockPath(pid));
+    static const bool locked = [] {
+        ownerLock.setStaleLockTime(0); // 只按进程是否存在判断，不按时间
+        if (!ownerLock.tryLock(0)) {
+            qCWarning(lcPlayback) << "Unable to lock temporary audio files:" << ownerLock.error();
+            return false;
+        }
+        return true;
+    }();
+    Q_UNUSED(locked);
+    return QDir::tempPath() + "/" + kTempFilePrefix + QString::number(pid) + "-XXXXXX";
+}
@@ -0,0 +1,110 @@
+#ifndef CHUNKEDAUDIOBUFFER_H
+#define CHUNKEDAUDIOBUFFER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+#include <memory>
+
+class QTemporaryFile;
+
+// 边下边播的音频缓冲区：数据按固定大小的块存放，内存中的块数有上限，
+// 超出部分写入临时文件（按需读回），因此无论曲目多长，每个音频流占用的内存都是固定的。
+//
+// 作为可随机访问的 QIODevice 交给 QMediaPlayer；播放器在工作线程读取尚未下载到的
+// 数据时会等待，GUI 线程读取时立即返回
+class ChunkedAudioBuffer : public QIODevice
+{
+    Q_OBJECT
+public:
+    static constexpr qint64 kChunkSize = 256 * 1024;
+    static constexpr qint64 kDefaultMemoryLimit = 4 * 1024 * 1024;
+
+    explicit ChunkedAudioBuffer(qint64 memoryLimit = kDefaultMemoryLimit, QObject *parent = nullptr);
+    ~ChunkedAudioBuffer() override; // 唤醒等待中的读取并等它们全部返回后才释放
+
+    // 写入端（下载）
+    void setExpectedSize(qint64 bytes); // Content-Length 已知时设置，播放器据此得到总长度
+    void append(const QByteArray &data);
+    void finish();                      // 数据已完整
+    void fail();                        // 下载失败：等待中的读取返回错误
+
+    qint64 bufferedBytes() const;       // 已下载的字节数
+    qint64 expectedSize() const;        // 未知时为 -1
+    qint64 memoryBytes() const;         // 当前占用的内存
+    qint64 spilledBytes() const;        // 已写入临时文件的字节数
+    bool isFinished() const;
+
+    // 已下载数据的只读快照：内存中的块隐式共享，换出的块通过独立的文件句柄读取，
+    // 因此可以交给其他线程使用，不受缓冲区之后换出或析构的影响
+    struct Snapshot {
+        QVector<QByteArray> chunks;       // 为空表示块在临时文件中
+        std::shared_ptr<QFile> spillFile;
+        qint64 size = 0;
+
+        bool isValid() const { return size > 0; }
+        bool writeTo(QIODevice *out) const;
+    };
+    // 下载完成后取得全部数据的快照（供后台分析），只复制块的引用；未完成或失败时返回无效快照
+    Snapshot snapshot() const;
+
+    // 溢出文件与分析副本共用的临时文件名模板 melody-audio-<pid>-XXXXXX。
+    // 首次调用时锁定本进程的 tempFileLockPath，进程退出时释放；
+    // 缓存维护据此只删除已退出的进程留下的文件，不动同时运行的其他实例的文件
+    static QString tempFileTemplate();
+    static QString tempFileLockPath(qint64 pid);
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+signals:
+    void bufferedBytesChanged(qint64 buffered, qint64 total);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct Chunk {
+        QByteArray data;       // 为空表示不在内存中
+        bool onDisk = false;   // 临时文件中有完整副本
+        quint64 lastUsed = 0;
+    };
+
+    struct ReaderScope; // 持有 mutex 期间登记一个进行中的读取
+
+    qint64 readLocked(char *data, qint64 maxSize, qint64 position, bool *memoryChanged); // 调用方持有 mutex
+
+    bool makeRoom(int keepIndex);      // 内存已满时换出一个块
+    bool spill(int index);
+    bool load(int index);
+    QByteArray takeBuffer();
+    void reportMemory(); // 汇总所有音频流的占用并更新指标
+
+    mutable QMutex mutex;
+    QWaitCondition dataArrived;
+    QWaitCondition readersDone;
+    int activeReaders = 0;     // 正在 readData 中的线程数，析构时等待归零
+    QVector<Chunk> chunks;
+    QVector<QByteArray> freeBuffers; // 换出后复用的块，避免反复分配
+    QTemporaryFile *spillFile = nullptr;
+
+    const int maxResidentChunks;
+    int residentChunks = 0;
+    quint64 useCounter = 0;
+    qint64 written = 0;
+    qint64 expected = -1;
+    qint64 readPosition = 0;   // 最近一次读取的位置，用于选择换出的块
+    qint64 spilled = 0;
+    qint64 reportedMemory = 0;
+    qint64 reportedSpilled = 0;
+    bool finished = false;
+    bool failed = false;
+};
+
+#endif // CHUNKEDAUDIOBUFFER_H
@@ -0,0 +1,545 @@
+#include "downloadmanager.h"
+#include "apimanager.h"
+#include "audiocache.h"
+#include "logging.h"
+#include "metrics.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+static const quint32 kMagic = 0x51444C4D; // "MLDQ"
+static const quint16 kVersion = 1;
+static const int kDefaultConcurrency = 2;
+static const int kMaxConcurrency = 4;
+// 启动后稍等再恢复上次未完成的下载，不与首屏和起播抢网络
+static const int kStartDelayMs = 3000;
+// 令牌桶的补充间隔；桶容量为一秒的配额
+static const int kRefillIntervalMs = 100;
+// 每次从 reply 读取的上限
+static const qint64 kReadChunk = 64 * 1024;
+// 限速时 reply 的缓冲上限：缓冲满后 Qt 停止从套接字读取，由 TCP 流控把速度压下来
+static const qint64 kLimitedReadBuffer = 256 * 1024;
+static const int kProgressIntervalMs = 250;
+static const int kMaxAttempts = 3;
+static const int kRetryBaseMs = 2000;
+static const int kWriteDelayMs = 2000;
+
+DownloadManager::DownloadManager(ApiManager *api, AudioCache *cache, const QString &filePath, QObject *parent)
+    : QObject(parent), api(api), cache(cache), concurrency(kDefaultConcurrency)
+{
+    path = filePath;
+    if (path.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        path = dir + "/downloads.bin";
+    }
+    clock.start();
+
+    hashPool.setMaxThreadCount(1);
+    hashPool.setThreadPriority(QThread::LowPriority);
+
+    refillTimer = new QTimer(this);
+    refillTimer->setInterval(kRefillIntervalMs);
+    connect(refillTimer, &QTimer::timeout, this, &DownloadManager::refillTokens);
+
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(kWriteDelayMs);
+    connect(saveTimer, &QTimer::timeout, this, &DownloadManager::save);
+
+    connect(api, &ApiManager::downloadUrlResolved, this, &DownloadManager::onUrlResolved);
+    connect(api, &ApiManager::downloadUrlFailed, this, &DownloadManager::onUrlFailed);
+
+    load();
+    if (!queue.isEmpty()) {
+        QTimer::singleShot(kStartDelayMs, this, &DownloadManager::schedule);
+    }
+}
+
+DownloadManager::~DownloadManager()
+{
+    const QStringList keys = transfers.keys();
+    for (const QString &key : keys) abortTransfer(key);
+    hashPool.clear();
+    hashPool.waitForDone();
+    save();
+}
+
+int DownloadManager::enqueue(const QVector<Song> &songs)
+{
+    int added = 0;
+    for (const Song &song : songs) {
+        const QString key = AudioCache::keyFor(song);
+        if (key.isEmpty() || cache->contains(key) || contains(key)) continue;
+        Job job;
+        job.key = key;
+        job.song = song;
+        job.received = QFileInfo(partPath(job)).size(); // 以前取消后又留下的部分可以续传
+        queue.append(job);
+        emit jobAdded(key);
+        ++added;
+    }
+    if (added > 0) {
+        qCInfo(lcNetwork) << "Queued" << added << "downloads";
+        scheduleSave();
+        schedule();
+    }
+    return added;
+}
+
+void DownloadManager::pause(const QString &key)
+{
+    Job *job = findJob(key);
+    if (!job || job->state == State::Paused || job->state == State::Completed || verifying.contains(key)) return;
+    abortTransfer(key);
+    retryAfter.remove(key);
+    setState(*job, State::Paused);
+    schedule();
+}
+
+void DownloadManager::resume(const QString &key)
+{
+    Job *job = findJob(key);
+    if (!job || (job->state != State::Paused && job->state != State::Failed)) return;
+    attempts.remove(key);
+    setState(*job, State::Queued);
+    schedule();
+}
+
+void DownloadManager::cancel(const QString &key)
+{
+    if (verifying.contains(key)) return; // 校验线程正在读 .part 文件
+    for (int i = 0; i < queue.size(); ++i) {
+        if (queue[i].key != key) continue;
+        abortTransfer(key);
+        QFile::remove(partPath(queue[i]));
+        queue.removeAt(i);
+        attempts.remove(key);
+        retryAfter.remove(key);
+        emit jobRemoved(key);
+        scheduleSave();
+        schedule();
+        return;
+    }
+}
+
+void DownloadManager::pauseAll()
+{
+    for (const Job &job : std::as_const(queue)) {
+        if (job.state != State::Failed) pause(job.key);
+    }
+}
+
+void DownloadManager::resumeAll()
+{
+    for (const Job &job : std::as_const(queue)) resume(job.key);
+}
+
+QVector<DownloadManager::Job> DownloadManager::jobs() const
+{
+    return queue;
+}
+
+bool DownloadManager::contains(const QString &key) const
+{
+    for (const Job &job : queue) {
+        if (job.key == key) return true;
+    }
+    return false;
+}
+
+int DownloadManager::maxConcurrent() const
+{
+    return concurrency;
+}
+
+void DownloadManager::setMaxConcurrent(int count)
+{
+    concurrency = qBound(1, count, kMaxConcurrency);
+    schedule(); // 调小时不中断已开始的下载，完成后自然收敛
+}
+
+qint64 DownloadManager::bandwidthLimit() const
+{
+    return limit;
+}
+
+void DownloadManager::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    limit = qMax<qint64>(0, bytesPerSecond);
+    tokens = qMin(tokens, limit);
+    for (const Transfer &transfer : std::as_const(transfers)) {
+        if (transfer.reply) transfer.reply->setReadBufferSize(limit > 0 ? kLimitedReadBuffer : 0);
+    }
+    if (limit > 0) {
+        refillTimer->start();
+    } else {
+        refillTimer->stop();
+        // 取消限速：读出积压在缓冲中的数据
+        const QStringList keys = transfers.keys();
+        for (const QString &key : keys) drain(key);
+    }
+}
+
+DownloadManager::Job *DownloadManager::findJob(const QString &key)
+{
+    for (Job &job : queue) {
+        if (job.key == key) return &job;
+    }
+    return nullptr;
+}
+
+void DownloadManager::setState(Job &job, State state, const QString &error)
+{
+    job.state = state;
+    job.error = error;
+    emit jobStateChanged(job.key, state);
+    scheduleSave();
+}
+
+int DownloadManager::activeCount() const
+{
+    int count = 0;
+    for (const Job &job : queue) {
+        if (job.state == State::Resolving || job.state == State::Downloading) ++count;
+    }
+    return count;
+}
+
+void DownloadManager::schedule()
+{
+    int active = activeCount();
+    qint64 nextRetry = -1;
+    for (int i = 0; i < queue.size() && active < concurrency; ++i) {
+        Job &job = queue[i];
+        if (job.state != State::Queued) continue;
+        const qint64 notBefore = retryAfter.value(job.key, 0);
+        if (notBefore > clock.elapsed()) {
+            const qint64 wait = notBefore - clock.elapsed();
+            nextRetry = nextRetry < 0 ? wait : qMin(nextRetry, wait);
+            continue;
+        }
+        retryAfter.remove(job.key);
+        start(job);
+        ++active;
+    }
+    if (nextRetry >= 0 && active < concurrency) {
+        QTimer::singleShot(int(nextRetry), this, &DownloadManager::schedule);
+    }
+}
+
+void DownloadManager::start(Job &job)
+{
+    setState(job, State::Resolving);
+    if (job.song.source == SearchSource::Bilibili) {
+        api->resolveBilibiliDownloadUrl(job.key, job.song.bvid);
+    } else {
+        api->resolveDownloadUrl(job.key, job.song.id);
+    }
+}
+
+void DownloadManager::onUrlResolved(const QString &key, const QUrl &url)
+{
+    Job *job = findJob(key);
+    if (!job || job->state != State::Resolving) return; // 解析期间被暂停或取消
+
+    Transfer transfer;
+    transfer.file = new QFile(partPath(*job));
+    if (!transfer.file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(lcNetwork) << "Unable to open" << transfer.file->fileName() << transfer.file->errorString();
+        delete transfer.file;
+        setState(*job, State::Failed, "无法写入缓存目录");
+        schedule();
+        return;
+    }
+    transfer.offset = transfer.file->size();
+    job->received = transfer.offset;
+
+    QNetworkReply *reply = api->requestAudio(url, transfer.offset, job->song.source == SearchSource::Bilibili);
+    if (limit > 0) reply->setReadBufferSize(kLimitedReadBuffer);
+    transfer.reply = reply;
+    transfers.insert(key, transfer);
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, key]() { onMetaDataChanged(key); });
+    connect(reply, &QNetworkReply::readyRead, this, [this, key]() { drain(key); });
+    connect(reply, &QNetworkReply::finished, this, [this, key]() {
+        auto it = transfers.find(key);
+        if (it == transfers.end()) return;
+        it->finished = true;
+        drain(key);
+    });
+
+    if (transfer.offset > 0) {
+        qCInfo(lcNetwork) << "Resuming download" << key << "from" << transfer.offset;
+    }
+    setState(*job, State::Downloading);
+}
+
+void DownloadManager::onUrlFailed(const QString &key, const QString &errorString)
+{
+    Job *job = findJob(key);
+    if (!job || job->state != State::Resolving) return;
+    retryOrFail(*job, errorString);
+}
+
+void DownloadManager::onMetaDataChanged(const QString &key)
+{
+    auto it = transfers.find(key);
+    Job *job = findJob(key);
+    if (it == transfers.end() || !job || !it->reply) return;
+
+    QNetworkReply *reply = it->reply;
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 206) {
+        // Content-Range: bytes <起点>-<终点>/<总长>
+        static const QRegularExpression rangePattern("bytes\\s+\\d+-\\d+/(\\d+)");
+        const QRegularExpressionMatch match = rangePattern.match(QString::fromLatin1(reply->rawHeader("Content-Range")));
+        job->total = match.hasMatch() ? match.captured(1).toLongLong() : 0;
+    } else if (status == 200) {
+        // 服务器不支持 Range：从头开始，丢弃已下载的部分
+        if (it->offset > 0) {
+            qCInfo(lcNetwork) << "Server ignored Range for" << key << "- restarting";
+            it->file->resize(0);
+            it->offset = 0;
+            job->received = 0;
+        }
+        job->total = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    }
+}
+
+void DownloadManager::drain(const QString &key)
+{
+    auto it = transfers.find(key);
+    Job *job = findJob(key);
+    if (it == transfers.end() || !job) return;
+    QNetworkReply *reply = it->reply;
+    if (!reply) return;
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // 错误响应的正文不写入文件
+    while (status < 400 && reply->bytesAvailable() > 0) {
+        const qint64 allowance = limit > 0 ? qMin(tokens, kReadChunk) : kReadChunk;
+        if (allowance <= 0) break; // 等下一次补充令牌
+        const QByteArray data = reply->read(allowance);
+        if (data.isEmpty()) break;
+        if (it->file->write(data) != data.size()) {
+            qCWarning(lcNetwork) << "Unable to write" << it->file->fileName() << it->file->errorString();
+            abortTransfer(key);
+            setState(*job, State::Failed, "写入缓存失败");
+            schedule();
+            return;
+        }
+        if (limit > 0) tokens -= data.size();
+        job->received += data.size();
+        Metrics::increment("download_bytes_total", {}, data.size());
+    }
+
+    const bool done = it->finished && (status >= 400 || reply->bytesAvailable() == 0);
+    if (done || it->lastProgressMs < 0 || clock.elapsed() - it->lastProgressMs >= kProgressIntervalMs) {
+        it->lastProgressMs = clock.elapsed();
+        emit jobProgress(key, job->received, job->total);
+    }
+    if (done) finishTransfer(key);
+}
+
+void DownloadManager::finishTransfer(const QString &key)
+{
+    Transfer transfer = transfers.take(key);
+    QNetworkReply *reply = transfer.reply;
+    const bool flushed = transfer.file->flush();
+    transfer.file->close();
+    const QString fileError = transfer.file->errorString();
+    delete transfer.file;
+    Job *job = findJob(key);
+    if (!reply || !job) return;
+    reply->deleteLater();
+
+    if (!flushed) {
+        qCWarning(lcNetwork) << "Unable to write" << partPath(*job) << fileError;
+        setState(*job, State::Failed, "写入缓存失败");
+        schedule();
+        return;
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError) {
+        if (status == 416) {
+            // Content-Range: bytes */<总长>。本地部分已经完整（例如上次在校验时退出）：直接校验并登记
+            static const QRegularExpression totalPattern("bytes\\s+\\*/(\\d+)");
+            const QRegularExpressionMatch match = totalPattern.match(QString::fromLatin1(reply->rawHeader("Content-Range")));
+            const qint64 total = match.hasMatch() ? match.captured(1).toLongLong() : -1;
+            if (transfer.offset > 0 && total == transfer.offset) {
+                qCInfo(lcNetwork) << "Download" << key << "was already complete";
+                job->total = total;
+                job->received = total;
+                verifyAndCommit(key, partPath(*job));
+                return;
+            }
+            // 本地部分与服务器上的文件对不上（例如音频被替换），丢弃后从头下载
+            QFile::remove(partPath(*job));
+        }
+        retryOrFail(*job, reply->errorString());
+        return;
+    }
+    if (job->total > 0 && job->received != job->total) {
+        retryOrFail(*job, "下载不完整");
+        return;
+    }
+    verifyAndCommit(key, partPath(*job));
+}
+
+void DownloadManager::retryOrFail(Job &job, const QString &errorString)
+{
+    const int attempt = ++attempts[job.key];
+    qCWarning(lcNetwork) << "Download" << job.key << "failed (attempt" << attempt << "):" << errorString;
+    if (attempt < kMaxAttempts) {
+        // 已下载的部分保留，重试时续传
+        retryAfter.insert(job.key, clock.elapsed() + (qint64(kRetryBaseMs) << (attempt - 1)));
+        setState(job, State::Queued, errorString);
+    } else {
+        Metrics::increment("downloads_total", { { "result", "failed" } });
+        setState(job, State::Failed, errorString);
+    }
+    schedule();
+}
+
+void DownloadManager::abortTransfer(const QString &key)
+{
+    auto it = transfers.find(key);
+    if (it == transfers.end()) return;
+    Transfer transfer = *it;
+    transfers.erase(it);
+    if (transfer.reply) {
+        disconnect(transfer.reply, nullptr, this, nullptr);
+        transfer.reply->abort();
+        transfer.reply->deleteLater();
+    }
+    // 已写入的数据保留在 .part 文件中，文件长度即续传起点
+    transfer.file->close();
+    delete transfer.file;
+}
+
+void DownloadManager::verifyAndCommit(const QString &key, const QString &partPath)
+{
+    verifying.insert(key);
+    hashPool.start([this, key, partPath]() {
+        QByteArray digest;
+        QFile file(partPath);
+        if (file.open(QIODevice::ReadOnly)) {
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            if (hash.addData(&file)) digest = hash.result();
+        }
+        QMetaObject::invokeMethod(this, [this, key, partPath, digest]() {
+            verifying.remove(key);
+            Job *job = findJob(key);
+            if (!job || job->state != State::Downloading) return;
+            if (digest.isEmpty() || !cache->commit(key, partPath, digest)) {
+                qCWarning(lcNetwork) << "Unable to commit download" << key << partPath;
+                setState(*job, State::Failed, "写入缓存失败");
+                schedule();
+                return;
+            }
+            Metrics::increment("downloads_total", { { "result", "completed" } });
+            qCInfo(lcNetwork) << "Downloaded" << key << job->received << "bytes";
+            setState(*job, State::Completed);
+            for (int i = 0; i < queue.size(); ++i) {
+                if (queue[i].key == key) {
+                    queue.removeAt(i);
+                    break;
+                }
+            }
+            attempts.remove(key);
+            emit jobRemoved(key);
+            scheduleSave();
+            schedule();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DownloadManager::refillTokens()
+{
+    tokens = qMin(limit, tokens + limit * kRefillIntervalMs / 1000);
+    const QStringList keys = transfers.keys();
+    if (keys.isEmpty()) return;
+    // 每次从不同的下载开始读，配额在各个下载间轮转
+    drainCursor = (drainCursor + 1) % keys.size();
+    for (int i = 0; i < keys.size() && tokens > 0; ++i) {
+        drain(keys[(drainCursor + i) % keys.size()]);
+    }
+}
+
+QString DownloadManager::partPath(const Job &job) const
+{
+    return cache->partPath(job.key, job.song.source);
+}
+
+void DownloadManager::scheduleSave()
+{
+    saveTimer->start();
+}
+
+void DownloadManager::save()
+{
+    saveTimer->stop();
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << quint32(queue.size());
+    for (const Job &job : std::as_const(queue)) {
+        // 进行中的任务下次启动时重新排队，已下载的长度从 .part 文件得到
+        State state = job.state;
+        if (state == State::Resolving || state == State::Downloading) state = State::Queued;
+        out << job.key;
+        out << job.song;
+        out << quint8(state) << job.total << job.error;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcNetwork) << "Unable to save download queue:" << file.errorString();
+        return;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(lcNetwork) << "Unable to save download queue:" << file.errorString();
+    }
+}
+
+void DownloadManager::load()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion) {
+        qCWarning(lcNetwork) << "Ignoring incompatible download queue" << path;
+        return;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Job job;
+        quint8 state = 0;
+        in >> job.key;
+        in >> job.song;
+        in >> state >> job.total >> job.error;
+        if (in.status() != QDataStream::Ok) break;
+        if (job.key.isEmpty() || cache->contains(job.key) || contains(job.key)) continue;
+        job.state = state <= quint8(State::Failed) ? static_cast<State>(state) : State::Queued;
+        if (job.state == State::Completed) continue;
+        job.received = QFileInfo(partPath(job)).size();
+        queue.append(job);
+    }
+    qCDebug(lcNetwork) << "Loaded" << queue.size() << "pending downloads";
+}
@@ -0,0 +1,120 @@
+#ifndef DOWNLOADMANAGER_H
+#define DOWNLOADMANAGER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QPointer>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVector>
+#include "playlistmanager.h"
+
+class ApiManager;
+class AudioCache;
+class QFile;
+class QNetworkReply;
+class QTimer;
+
+// 离线下载管理：持久化的下载队列，同时进行的下载数有上限，可限制总带宽。
+// 数据写入音频缓存的 .part 文件，中断（包括退出程序）后用 HTTP Range 从已下载的位置续传；
+// 下载完成后校验长度、计算 SHA-256，再由 AudioCache 原子重命名并登记。
+// 音频地址会过期，每次开始或续传时都重新解析
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+public:
+    enum class State : quint8 {
+        Queued,      // 等待空闲的下载槽
+        Resolving,   // 正在解析音频地址
+        Downloading,
+        Paused,
+        Completed,   // 已写入缓存，随即从队列移除
+        Failed       // 重试次数用完，可手动恢复
+    };
+    Q_ENUM(State)
+
+    struct Job {
+        QString key;          // 音频缓存键，同时作为任务标识
+        Song song;
+        State state = State::Queued;
+        qint64 received = 0;  // 已写入 .part 文件的字节数
+        qint64 total = 0;     // 0 表示未知
+        QString error;
+    };
+
+    DownloadManager(ApiManager *api, AudioCache *cache, const QString &filePath = QString(), QObject *parent = nullptr);
+    ~DownloadManager(); // 中止进行中的下载（.part 文件保留，下次启动续传）并保存队列
+
+    // 加入队列；本地曲目、已缓存和已在队列中的曲目忽略，返回实际加入的数量
+    int enqueue(const QVector<Song> &songs);
+    // 暂停和取消对正在校验（下载已完成）的任务无效，校验很快结束
+    void pause(const QString &key);
+    void resume(const QString &key); // 也用于重试失败的任务
+    void cancel(const QString &key); // 移出队列并删除 .part 文件
+    void pauseAll();
+    void resumeAll();
+
+    QVector<Job> jobs() const;
+    bool contains(const QString &key) const;
+
+    int maxConcurrent() const;
+    void setMaxConcurrent(int count);
+    qint64 bandwidthLimit() const;
+    void setBandwidthLimit(qint64 bytesPerSecond); // 0 表示不限制
+
+signals:
+    void jobAdded(const QString &key);
+    void jobStateChanged(const QString &key, DownloadManager::State state);
+    void jobProgress(const QString &key, qint64 received, qint64 total);
+    void jobRemoved(const QString &key);
+
+private:
+    struct Transfer {
+        QPointer<QNetworkReply> reply;
+        QFile *file = nullptr;
+        qint64 offset = 0;      // 续传的起点
+        bool finished = false;  // 网络已结束，缓冲中可能还有被限速的数据
+        qint64 lastProgressMs = -1;
+    };
+
+    Job *findJob(const QString &key);
+    void setState(Job &job, State state, const QString &error = QString());
+    void schedule();           // 在空闲的下载槽中开始排队的任务
+    int activeCount() const;
+    void start(Job &job);
+    void onUrlResolved(const QString &key, const QUrl &url);
+    void onUrlFailed(const QString &key, const QString &errorString);
+    void onMetaDataChanged(const QString &key);
+    void drain(const QString &key); // 按带宽配额从 reply 读取并写入文件
+    void finishTransfer(const QString &key);
+    void retryOrFail(Job &job, const QString &errorString);
+    void abortTransfer(const QString &key);
+    void verifyAndCommit(const QString &key, const QString &partPath);
+    void refillTokens();
+    QString partPath(const Job &job) const;
+
+    void scheduleSave();
+    void save();
+    void load();
+
+    ApiManager *api;
+    AudioCache *cache;
+    QString path;
+    QVector<Job> queue;                  // 按加入顺序
+    QHash<QString, Transfer> transfers;  // 正在下载的任务
+    QHash<QString, int> attempts;        // 本次运行中连续失败的次数
+    QHash<QString, qint64> retryAfter;   // 失败后等待重试的任务 -> 可以重新开始的时间（clock）
+    QSet<QString> verifying;             // 下载完成、正在计算 SHA-256 的任务
+    int concurrency;
+    qint64 limit = 0;
+    qint64 tokens = 0;                   // 令牌桶：当前可读取的字节数
+    int drainCursor = 0;                 // 轮流从各个下载读取，限速时不偏向第一个
+    QTimer *refillTimer;
+    QTimer *saveTimer;
+    QElapsedTimer clock;
+    QThreadPool hashPool;                // 完成后在后台计算 SHA-256
+};
+
+#endif // DOWNLOADMANAGER_H
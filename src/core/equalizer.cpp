@@ -0,0 +1,214 @@
+#include "equalizer.h"
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+const float Equalizer::kFrequencies[Equalizer::kBandCount] = {
+    31.25f, 62.5f, 125, 250, 500, 1000, 2000, 4000, 8000, 16000
+};
+
+// 倍频程带宽对应的 Q
+static const double kBandQ = 1.41;
+// 平滑步长（帧）与时间常数：调节增益后约 0.1 秒到位
+static const int kStepFrames = 64;
+static const double kSmoothingSeconds = 0.02;
+// 与目标相差小于该值时直接到位
+static const float kSnapDb = 0.01f;
+
+struct EqualizerPreset {
+    const char *name;
+    float gains[Equalizer::kBandCount];
+};
+
+static const EqualizerPreset kPresets[] = {
+    { "平坦", { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } },
+    { "流行", { -1, 1, 3, 4, 3, 0, -1, -1, 1, 2 } },
+    { "摇滚", { 5, 4, 2, -1, -2, -1, 2, 4, 5, 5 } },
+    { "古典", { 4, 3, 2, 1, -1, -1, 0, 2, 3, 4 } },
+    { "爵士", { 3, 2, 1, 2, -1, -1, 0, 1, 2, 3 } },
+    { "电子", { 5, 4, 1, 0, -2, 1, 0, 1, 4, 5 } },
+    { "低音增强", { 6, 5, 4, 2, 0, 0, 0, 0, 0, 0 } },
+    { "高音增强", { 0, 0, 0, 0, 0, 1, 3, 5, 6, 6 } },
+    { "人声", { -2, -2, -1, 1, 3, 4, 3, 1, 0, -1 } },
+};
+
+static double flushDenormal(double value)
+{
+    return std::fabs(value) < 1e-30 ? 0.0 : value;
+}
+
+Equalizer::Equalizer(int sampleRate)
+    : pendingSampleRate(qMax(1, sampleRate)), sampleRate(0)
+{
+    for (auto &gain : targetGain) gain.store(0.0f);
+}
+
+void Equalizer::setGain(int band, float gainDb)
+{
+    if (band < 0 || band >= kBandCount) return;
+    targetGain[band].store(qBound(-kMaxGainDb, gainDb, kMaxGainDb), std::memory_order_relaxed);
+    version.fetch_add(1, std::memory_order_release);
+}
+
+void Equalizer::setGains(const QVector<float> &gainsDb)
+{
+    for (int band = 0; band < kBandCount; ++band) {
+        const float gain = band < gainsDb.size() ? gainsDb[band] : 0.0f;
+        targetGain[band].store(qBound(-kMaxGainDb, gain, kMaxGainDb), std::memory_order_relaxed);
+    }
+    version.fetch_add(1, std::memory_order_release);
+}
+
+float Equalizer::gain(int band) const
+{
+    return band >= 0 && band < kBandCount ? targetGain[band].load(std::memory_order_relaxed) : 0.0f;
+}
+
+void Equalizer::setSampleRate(int sampleRate)
+{
+    pendingSampleRate.store(qMax(1, sampleRate));
+}
+
+QStringList Equalizer::presetNames()
+{
+    QStringList names;
+    for (const EqualizerPreset &preset : kPresets) names.append(QString::fromUtf8(preset.name));
+    return names;
+}
+
+QVector<float> Equalizer::presetGains(const QString &name)
+{
+    for (const EqualizerPreset &preset : kPresets) {
+        if (name == QString::fromUtf8(preset.name)) {
+            return QVector<float>(preset.gains, preset.gains + kBandCount);
+        }
+    }
+    return QVector<float>(kBandCount, 0.0f);
+}
+
+void Equalizer::process(float *samples, qint64 frames, int channels)
+{
+    if (channels != 2) return;
+
+    const int rate = pendingSampleRate.load(std::memory_order_relaxed);
+    if (rate != sampleRate) {
+        sampleRate = rate;
+        smoothing = 1.0 - std::exp(-kStepFrames / (kSmoothingSeconds * sampleRate));
+        std::memset(state, 0, sizeof(state));
+        for (int band = 0; band < kBandCount; ++band) updateCoefficients(band);
+    }
+    const unsigned seen = version.load(std::memory_order_acquire);
+    if (seen != seenVersion) {
+        seenVersion = seen;
+        for (int band = 0; band < kBandCount; ++band) {
+            blockTarget[band] = targetGain[band].load(std::memory_order_relaxed);
+        }
+        ramping = true;
+    }
+    if (!ramping && activeCount == 0) return;
+
+    while (frames > 0) {
+        const qint64 count = qMin<qint64>(frames, kStepFrames);
+        if (ramping) stepGains();
+        if (activeCount > 0) processBlock(samples, count);
+        samples += count * 2;
+        frames -= count;
+    }
+}
+
+void Equalizer::stepGains()
+{
+    ramping = false;
+    float maxGain = 0;
+    activeCount = 0;
+    for (int band = 0; band < kBandCount; ++band) {
+        const float diff = blockTarget[band] - currentGain[band];
+        if (diff != 0) {
+            if (std::fabs(diff) < kSnapDb) {
+                currentGain[band] = blockTarget[band];
+            } else {
+                currentGain[band] += float(diff * smoothing);
+                ramping = true;
+            }
+            updateCoefficients(band);
+        }
+        if (currentGain[band] != 0) {
+            activeBands[activeCount++] = band;
+            maxGain = qMax(maxGain, currentGain[band]);
+        } else {
+            // 跳过的频段下次启用时从零状态开始
+            std::memset(state[band], 0, sizeof(state[band]));
+        }
+    }
+    preamp = std::pow(10.0, -maxGain / 20.0);
+}
+
+void Equalizer::updateCoefficients(int band)
+{
+    Coefficients &c = coefficients[band];
+    const double frequency = kFrequencies[band];
+    // 中心频率接近奈奎斯特频率时（低采样率）不处理该频段
+    if (currentGain[band] == 0 || frequency >= sampleRate * 0.45) {
+        c = Coefficients();
+        return;
+    }
+    const double a = std::pow(10.0, currentGain[band] / 40.0);
+    const double w0 = 2.0 * M_PI * frequency / sampleRate;
+    const double alpha = std::sin(w0) / (2.0 * kBandQ);
+    const double cosW0 = std::cos(w0);
+    const double a0 = 1.0 + alpha / a;
+    c.b0 = (1.0 + alpha * a) / a0;
+    c.b1 = -2.0 * cosW0 / a0;
+    c.b2 = (1.0 - alpha * a) / a0;
+    c.a1 = c.b1;
+    c.a2 = (1.0 - alpha / a) / a0;
+}
+
+void Equalizer::processBlock(float *samples, qint64 frames)
+{
+    const qint64 count = frames * 2;
+    for (qint64 i = 0; i < count; ++i) scratch[i] = samples[i];
+
+    // 逐段处理整块：系数和状态在整块内留在寄存器中。左右声道在同一个 SSE2 寄存器里并行
+    for (int k = 0; k < activeCount; ++k) {
+        const int band = activeBands[k];
+        const Coefficients &c = coefficients[band];
+        double *s = state[band];
+#ifdef MELODY_HAVE_SSE2
+        const __m128d b0 = _mm_set1_pd(c.b0);
+        const __m128d b1 = _mm_set1_pd(c.b1);
+        const __m128d b2 = _mm_set1_pd(c.b2);
+        const __m128d a1 = _mm_set1_pd(c.a1);
+        const __m128d a2 = _mm_set1_pd(c.a2);
+        __m128d s1 = _mm_load_pd(s);
+        __m128d s2 = _mm_load_pd(s + 2);
+        for (qint64 i = 0; i < count; i += 2) {
+            const __m128d x = _mm_load_pd(scratch + i);
+            const __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), s1);
+            s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, x), _mm_mul_pd(a1, y)), s2);
+            s2 = _mm_sub_pd(_mm_mul_pd(b2, x), _mm_mul_pd(a2, y));
+            _mm_store_pd(scratch + i, y);
+        }
+        _mm_store_pd(s, s1);
+        _mm_store_pd(s + 2, s2);
+#else
+        for (qint64 i = 0; i < count; i += 2) {
+            for (int ch = 0; ch < 2; ++ch) {
+                const double x = scratch[i + ch];
+                const double y = c.b0 * x + s[ch];
+                s[ch] = c.b1 * x - c.a1 * y + s[2 + ch];
+                s[2 + ch] = c.b2 * x - c.a2 * y;
+                scratch[i + ch] = y;
+            }
+        }
+#endif
+        for (int j = 0; j < 4; ++j) s[j] = flushDenormal(s[j]);
+    }
+
+    for (qint64 i = 0; i < count; ++i) samples[i] = float(scratch[i] * preamp);
+}
@@ -0,0 +1,64 @@
+#ifndef EQUALIZER_H
+#define EQUALIZER_H
+
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+// 10 段参数均衡器：每段一个峰值滤波器（RBJ 公式），中心频率按倍频程分布，串联处理。
+// 界面线程通过 setGain / setGains 修改增益（只写原子变量，不加锁）；
+// 声卡回调线程在 process 中读取，每 64 帧把当前增益向目标平滑一步并重算变化的系数，
+// 调节时没有爆音。增益为 0 的频段直接跳过，全部为 0 时不做任何处理
+class Equalizer
+{
+public:
+    static constexpr int kBandCount = 10;
+    static const float kFrequencies[kBandCount];
+    static constexpr float kMaxGainDb = 12.0f;
+
+    explicit Equalizer(int sampleRate = 48000);
+
+    // 界面线程
+    void setGain(int band, float gainDb);
+    void setGains(const QVector<float> &gainsDb); // 不足 kBandCount 个的部分视为 0
+    float gain(int band) const;
+    void setSampleRate(int sampleRate); // 下一次 process 时生效，滤波状态清零
+
+    // 声卡回调线程：原地处理交错排列的立体声 float 采样（其他声道数不处理）
+    void process(float *samples, qint64 frames, int channels);
+
+    // 预设：名称与各频段增益（dB）；名称未知时返回全 0
+    static QStringList presetNames();
+    static QVector<float> presetGains(const QString &name);
+
+private:
+    struct Coefficients {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    void stepGains();
+    void updateCoefficients(int band);
+    void processBlock(float *samples, qint64 frames);
+
+    // 界面线程写、声卡线程读
+    std::atomic<float> targetGain[kBandCount];
+    std::atomic<int> pendingSampleRate;
+    std::atomic<unsigned> version { 0 };
+
+    // 以下只在声卡回调线程中使用
+    int sampleRate;
+    unsigned seenVersion = ~0u;
+    float currentGain[kBandCount] = {};
+    float blockTarget[kBandCount] = {};
+    bool ramping = false;
+    double smoothing = 0;             // 每个平滑步长向目标靠近的比例
+    double preamp = 1.0;              // 按最大提升量预先衰减，提升频段时不削波
+    Coefficients coefficients[kBandCount];
+    int activeBands[kBandCount] = {}; // 需要处理的频段（增益不为 0）
+    int activeCount = 0;
+    // 每段两个声道的转置直接 II 型状态：s1L s1R s2L s2R
+    alignas(16) double state[kBandCount][4] = {};
+    alignas(16) double scratch[2 * 64] = {}; // 一个平滑步长的采样，双精度串联处理
+};
+
+#endif // EQUALIZER_H
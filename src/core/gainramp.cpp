@@ -0,0 +1,60 @@
+#include "gainramp.h"
+#include <QtMath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+// 等功率曲线按块做线性插值：块内是线性增益渐变，可以向量化
+static const qint64 kRampBlockFrames = 64;
+
+// 线性增益渐变混音，立体声时每次处理两帧（4 个采样）
+static void mixRamp(float *out, const float *from, const float *to, qint64 frames, int channels,
+                    float outGain, float outStep, float inGain, float inStep)
+{
+    qint64 i = 0;
+#ifdef MELODY_HAVE_SSE2
+    if (channels == 2) {
+        __m128 gOut = _mm_setr_ps(outGain, outGain, outGain + outStep, outGain + outStep);
+        __m128 gIn = _mm_setr_ps(inGain, inGain, inGain + inStep, inGain + inStep);
+        const __m128 dOut = _mm_set1_ps(2 * outStep);
+        const __m128 dIn = _mm_set1_ps(2 * inStep);
+        for (; i + 2 <= frames; i += 2) {
+            const __m128 a = _mm_loadu_ps(from + i * 2);
+            const __m128 b = _mm_loadu_ps(to + i * 2);
+            _mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_mul_ps(a, gOut), _mm_mul_ps(b, gIn)));
+            gOut = _mm_add_ps(gOut, dOut);
+            gIn = _mm_add_ps(gIn, dIn);
+        }
+    }
+#endif
+    for (; i < frames; ++i) {
+        const float go = outGain + outStep * float(i);
+        const float gi = inGain + inStep * float(i);
+        for (int c = 0; c < channels; ++c) {
+            const qint64 k = i * channels + c;
+            out[k] = from[k] * go + to[k] * gi;
+        }
+    }
+}
+
+void GainRamp::crossfade(float *out, const float *from, const float *to, qint64 frames, int channels,
+                         qint64 position, qint64 length)
+{
+    if (length <= 0) return;
+    qint64 done = 0;
+    while (done < frames) {
+        const qint64 n = qMin(kRampBlockFrames, frames - done);
+        const double t0 = double(position + done) / double(length);
+        const double t1 = double(position + done + n) / double(length);
+        const float out0 = float(qCos(t0 * M_PI_2));
+        const float out1 = float(qCos(t1 * M_PI_2));
+        const float in0 = float(qSin(t0 * M_PI_2));
+        const float in1 = float(qSin(t1 * M_PI_2));
+        const qint64 offset = done * channels;
+        mixRamp(out + offset, from + offset, to + offset, n, channels,
+                out0, (out1 - out0) / float(n), in0, (in1 - in0) / float(n));
+        done += n;
+    }
+}
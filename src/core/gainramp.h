@@ -0,0 +1,16 @@
+#ifndef GAINRAMP_H
+#define GAINRAMP_H
+
+#include <QtGlobal>
+
+// 交错排列的 float 采样的增益渐变（淡入淡出、交叉淡化）
+namespace GainRamp {
+
+// 交叉淡化：out = from * 淡出增益 + to * 淡入增益，增益按等功率曲线变化。
+// position / length 为本段在整个淡化过程中的起点和总长度（帧），可分多次调用
+void crossfade(float *out, const float *from, const float *to, qint64 frames, int channels,
+               qint64 position, qint64 length);
+
+} // namespace GainRamp
+
+#endif // GAINRAMP_H
@@ -0,0 +1,215 @@
+#include "libraryindex.h"
+#include "pinyin.h"
+#include <algorithm>
+
+// 删除留下的占位超过该比例时重建索引
+static const double kCompactRatio = 0.25;
+static const int kCompactMinRemoved = 1024;
+
+void LibraryIndex::tokenize(const QString &text, QStringList &terms)
+{
+    QString word;
+    for (QChar ch : text) {
+        if (Pinyin::isHan(ch)) {
+            if (!word.isEmpty()) { terms.append(word); word.clear(); }
+            terms.append(QString(ch));
+        } else if (ch.isLetterOrNumber()) {
+            word.append(ch.toLower());
+        } else if (!word.isEmpty()) {
+            terms.append(word);
+            word.clear();
+        }
+    }
+    if (!word.isEmpty()) terms.append(word);
+}
+
+QStringList LibraryIndex::termsFor(const Track &track)
+{
+    QStringList terms;
+    tokenize(track.title, terms);
+    tokenize(track.artist, terms);
+    tokenize(track.album, terms);
+
+    // 拼音首字母整体作为一个词项，前缀匹配即可覆盖 "z"、"zj"、"zjl"
+    for (const QString &text : {track.title, track.artist}) {
+        bool hasHan = std::any_of(text.cbegin(), text.cend(), Pinyin::isHan);
+        if (hasHan) {
+            QString initials = Pinyin::initials(text);
+            if (!initials.isEmpty()) terms.append(initials);
+        }
+    }
+    terms.removeDuplicates();
+    return terms;
+}
+
+int LibraryIndex::addTrack(const Track &track, const QStringList &terms)
+{
+    removeTrack(track.path);
+
+    const int id = tracks.size();
+    tracks.append(track);
+    tracks.last().removed = false;
+    pathToId.insert(track.path, id);
+
+    for (const QString &term : terms) {
+        auto it = postings.find(term);
+        if (it == postings.end()) {
+            it = postings.insert(term, QVector<quint32>());
+            termsDirty = true;
+        }
+        it->append(id);
+    }
+    return id;
+}
+
+void LibraryIndex::removeTrack(const QString &path)
+{
+    auto it = pathToId.find(path);
+    if (it == pathToId.end()) return;
+    const quint32 id = it.value();
+    pathToId.erase(it);
+
+    // 从倒排表中删除：重新扫描会反复替换修改过的文件，只做标记时词项表只增不减
+    for (const QString &term : termsFor(tracks[id])) {
+        auto posting = postings.find(term);
+        if (posting == postings.end()) continue;
+        auto pos = std::lower_bound(posting->begin(), posting->end(), id);
+        if (pos != posting->end() && *pos == id) posting->erase(pos);
+        if (posting->isEmpty()) {
+            postings.erase(posting);
+            termsDirty = true;
+        }
+    }
+    // 文档ID不变，只留一个空占位；占位过多时整体重建
+    tracks[id] = Track();
+    tracks[id].removed = true;
+    removedCount++;
+
+    if (removedCount >= kCompactMinRemoved && removedCount > tracks.size() * kCompactRatio) {
+        compact();
+    }
+}
+
+void LibraryIndex::clear()
+{
+    tracks.clear();
+    pathToId.clear();
+    postings.clear();
+    sortedTerms.clear();
+    termsDirty = false;
+    removedCount = 0;
+}
+
+void LibraryIndex::compact()
+{
+    QVector<Track> live;
+    live.reserve(trackCount());
+    for (const Track &track : tracks) {
+        if (!track.removed) live.append(track);
+    }
+    clear();
+    for (const Track &track : live) {
+        addTrack(track, termsFor(track));
+    }
+}
+
+const LibraryIndex::Track *LibraryIndex::findTrack(const QString &path) const
+{
+    auto it = pathToId.constFind(path);
+    return it == pathToId.constEnd() ? nullptr : &tracks[it.value()];
+}
+
+QStringList LibraryIndex::pathsUnder(const QString &dir, bool recursive) const
+{
+    QStringList paths;
+    const QString prefix = dir.endsWith('/') ? dir : dir + '/';
+    for (auto it = pathToId.constBegin(); it != pathToId.constEnd(); ++it) {
+        const QString &path = it.key();
+        if (!path.startsWith(prefix)) continue;
+        if (!recursive && path.indexOf('/', prefix.size()) >= 0) continue;
+        paths.append(path);
+    }
+    return paths;
+}
+
+QVector<quint32> LibraryIndex::candidatesFor(const QString &term, bool prefix) const
+{
+    if (!prefix) {
+        return postings.value(term);
+    }
+
+    if (termsDirty) {
+        sortedTerms.clear();
+        sortedTerms.reserve(postings.size());
+        for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+            sortedTerms.push_back(it.key());
+        }
+        std::sort(sortedTerms.begin(), sortedTerms.end());
+        termsDirty = false;
+    }
+
+    QVector<quint32> result;
+    int matchedTerms = 0;
+    for (auto it = std::lower_bound(sortedTerms.begin(), sortedTerms.end(), term);
+         it != sortedTerms.end() && it->startsWith(term); ++it) {
+        result += postings.value(*it);
+        matchedTerms++;
+    }
+    if (matchedTerms > 1) {
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
+}
+
+QVector<int> LibraryIndex::search(const QString &query, int limit) const
+{
+    QVector<int> ids;
+    QStringList queryTerms;
+    tokenize(query, queryTerms);
+    queryTerms.removeDuplicates();
+    if (queryTerms.isEmpty()) return ids;
+
+    // 各词项的候选集，从小到大求交集
+    QVector<QVector<quint32>> lists;
+    for (const QString &term : queryTerms) {
+        bool han = term.size() == 1 && Pinyin::isHan(term.at(0));
+        QVector<quint32> candidates = candidatesFor(term, !han);
+        if (candidates.isEmpty()) return ids;
+        lists.append(candidates);
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<quint32> &a, const QVector<quint32> &b) {
+        return a.size() < b.size();
+    });
+
+    QVector<quint32> matched = lists.first();
+    for (int i = 1; i < lists.size() && !matched.isEmpty(); ++i) {
+        QVector<quint32> next;
+        std::set_intersection(matched.cbegin(), matched.cend(), lists[i].cbegin(), lists[i].cend(),
+                              std::back_inserter(next));
+        matched = next;
+    }
+
+    // 相关度：标题包含完整查询 > 标题前缀 > 歌手包含
+    const QString needle = query.trimmed().toLower();
+    QVector<QPair<int, int>> scored;
+    scored.reserve(matched.size());
+    for (quint32 id : matched) {
+        const Track &t = tracks[id];
+        if (t.removed) continue;
+        int score = 0;
+        const QString title = t.title.toLower();
+        if (title.startsWith(needle)) score += 6;
+        else if (title.contains(needle)) score += 4;
+        if (t.artist.contains(needle, Qt::CaseInsensitive)) score += 1;
+        scored.append(qMakePair(-score, int(id)));
+    }
+    int count = qMin(limit, int(scored.size()));
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end());
+
+    ids.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ids.append(scored[i].second);
+    }
+    return ids;
+}
@@ -0,0 +1,57 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+
+// 本地曲库倒排索引
+// 词项：拉丁字母/数字按单词切分并转小写，汉字按单字切分，另加标题、歌手的拼音首字母。
+// 查询时拉丁词项按前缀匹配，汉字词项精确匹配，多个词项取交集。
+class LibraryIndex
+{
+public:
+    struct Track {
+        QString path;
+        QString title;
+        QString artist;
+        QString album;
+        int duration = 0;
+        qint64 modified = 0; // 文件修改时间（毫秒），用于增量扫描
+        qint64 size = 0;
+        bool removed = false;
+    };
+
+    // 计算曲目的索引词项；只依赖参数，可在扫描线程中调用
+    static QStringList termsFor(const Track &track);
+
+    // 添加曲目（同路径的旧记录会被替换），返回文档ID
+    int addTrack(const Track &track, const QStringList &terms);
+    void removeTrack(const QString &path);
+    void clear();
+
+    // 查询，返回按相关度排序的文档ID
+    QVector<int> search(const QString &query, int limit) const;
+
+    const Track &track(int id) const { return tracks[id]; }
+    int trackCount() const { return tracks.size() - removedCount; }
+    bool contains(const QString &path) const { return pathToId.contains(path); }
+    const Track *findTrack(const QString &path) const;
+    QStringList pathsUnder(const QString &dir, bool recursive) const;
+
+private:
+    static void tokenize(const QString &text, QStringList &terms);
+    QVector<quint32> candidatesFor(const QString &term, bool prefix) const;
+    void compact();
+
+    QVector<Track> tracks;
+    QHash<QString, int> pathToId;
+    QHash<QString, QVector<quint32>> postings; // 词项 -> 文档ID（升序）
+    mutable std::vector<QString> sortedTerms;  // 用于前缀查找，按需重建
+    mutable bool termsDirty = false;
+    int removedCount = 0;
+};
+
+#endif // LIBRARYINDEX_H
@@ -0,0 +1,263 @@
+#include "locallibrary.h"
+#include "logging.h"
+#include "tagreader.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// 支持的音频格式
+static const QStringList kAudioFilters = {
+    "*.mp3", "*.flac", "*.m4a", "*.aac", "*.ogg", "*.opus", "*.wav", "*.wma", "*.ape"
+};
+
+// 文件系统事件合并窗口，批量拷贝文件时避免反复重扫
+static const int kRescanDelayMs = 500;
+
+LocalLibrary::LocalLibrary(QObject *parent)
+    : QObject(parent), cancelled(false), pendingScans(0)
+{
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &LocalLibrary::onDirectoryChanged);
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(kRescanDelayMs);
+    connect(rescanTimer, &QTimer::timeout, this, &LocalLibrary::flushDirtyDirectories);
+
+    // 扫描以磁盘IO为主，两个低优先级线程足够且不影响播放
+    pool.setMaxThreadCount(2);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    pool.setThreadPriority(QThread::LowPriority);
+#endif
+}
+
+LocalLibrary::~LocalLibrary()
+{
+    cancelled = true;
+    pool.waitForDone();
+}
+
+void LocalLibrary::setFolders(const QStringList &folders)
+{
+    if (!watcher->directories().isEmpty()) {
+        watcher->removePaths(watcher->directories());
+    }
+    index.clear();
+    dirtyDirectories.clear();
+    rootFolders.clear();
+
+    for (const QString &folder : folders) {
+        QString path = QDir::cleanPath(QDir(folder).absolutePath());
+        if (QDir(path).exists() && !rootFolders.contains(path)) {
+            rootFolders.append(path);
+            startScan(path, true);
+        }
+    }
+}
+
+void LocalLibrary::addFolder(const QString &folder)
+{
+    const QString path = QDir::cleanPath(QDir(folder).absolutePath());
+    if (!QDir(path).exists() || rootFolders.contains(path)) return;
+
+    // 已在某个曲库目录之下：曲目已索引，子目录也已监视
+    bool covered = false;
+    for (const QString &root : std::as_const(rootFolders)) {
+        if (path.startsWith(root + '/')) {
+            covered = true;
+            break;
+        }
+    }
+    rootFolders.append(path);
+    if (!covered) startScan(path, true);
+}
+
+QStringList LocalLibrary::folders() const
+{
+    return rootFolders;
+}
+
+int LocalLibrary::trackCount() const
+{
+    return index.trackCount();
+}
+
+bool LocalLibrary::isScanning() const
+{
+    return pendingScans > 0;
+}
+
+QVector<Song> LocalLibrary::search(const QString &query, int limit) const
+{
+    QVector<Song> songs;
+    const QVector<int> ids = index.search(query, limit);
+    songs.reserve(ids.size());
+    for (int id : ids) {
+        const LibraryIndex::Track &track = index.track(id);
+        Song song;
+        song.name = track.title;
+        song.artist = track.artist;
+        song.album = track.album;
+        song.duration = track.duration;
+        song.filePath = track.path;
+        song.source = SearchSource::Local;
+        songs.append(song);
+    }
+    return songs;
+}
+
+void LocalLibrary::startScan(const QString &dir, bool recursive)
+{
+    // 把已索引文件的修改时间和大小交给扫描线程，未变化的文件不再读取标签
+    QHash<QString, QPair<qint64, qint64>> known;
+    for (const QString &path : index.pathsUnder(dir, recursive)) {
+        if (const LibraryIndex::Track *track = index.findTrack(path)) {
+            known.insert(path, qMakePair(track->modified, track->size));
+        }
+    }
+
+    pendingScans++;
+    pool.start([this, dir, recursive, known]() {
+        ScanResult result = scan(dir, recursive, known, cancelled);
+        if (cancelled) return;
+        QMetaObject::invokeMethod(this, [this, result]() { applyScanResult(result); }, Qt::QueuedConnection);
+    });
+}
+
+LocalLibrary::ScanResult LocalLibrary::scan(const QString &dir, bool recursive,
+                                            const QHash<QString, QPair<qint64, qint64>> &known,
+                                            const std::atomic<bool> &cancelled)
+{
+    ScanResult result;
+    result.dir = dir;
+    result.recursive = recursive;
+    result.directories.append(dir);
+
+    QDirIterator dirs(dir, QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable,
+                      recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (dirs.hasNext()) {
+        result.directories.append(dirs.next());
+    }
+
+    QDirIterator files(dir, kAudioFilters, QDir::Files | QDir::Readable,
+                       recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (files.hasNext()) {
+        if (cancelled) break;
+        const QString path = files.next();
+        const QFileInfo info = files.fileInfo();
+
+        ScannedTrack scanned;
+        scanned.track.path = path;
+        scanned.track.modified = info.lastModified().toMSecsSinceEpoch();
+        scanned.track.size = info.size();
+
+        auto it = known.constFind(path);
+        if (it != known.constEnd() && it->first == scanned.track.modified && it->second == scanned.track.size) {
+            scanned.unchanged = true;
+        } else {
+            AudioTags tags = TagReader::read(path);
+            scanned.track.title = tags.title;
+            scanned.track.artist = tags.artist;
+            scanned.track.album = tags.album;
+            scanned.track.duration = tags.duration;
+            scanned.terms = LibraryIndex::termsFor(scanned.track);
+        }
+        result.tracks.append(scanned);
+    }
+    return result;
+}
+
+void LocalLibrary::applyScanResult(const ScanResult &result)
+{
+    pendingScans--;
+
+    // 目录已不属于曲库（期间修改了曲库目录）
+    bool inLibrary = false;
+    for (const QString &root : rootFolders) {
+        if (result.dir == root || result.dir.startsWith(root + '/')) {
+            inLibrary = true;
+            break;
+        }
+    }
+
+    if (inLibrary) {
+        QSet<QString> seen;
+        int updated = 0;
+        for (const ScannedTrack &scanned : result.tracks) {
+            seen.insert(scanned.track.path);
+            if (!scanned.unchanged) {
+                index.addTrack(scanned.track, scanned.terms);
+                updated++;
+            }
+        }
+
+        int removed = 0;
+        for (const QString &path : index.pathsUnder(result.dir, result.recursive)) {
+            if (!seen.contains(path)) {
+                index.removeTrack(path);
+                removed++;
+            }
+        }
+
+        const QStringList watchedList = watcher->directories();
+        const QSet<QString> watched(watchedList.cbegin(), watchedList.cend());
+        QStringList toWatch;
+        for (const QString &dir : result.directories) {
+            if (!watched.contains(dir)) {
+                toWatch.append(dir);
+                // 增量重扫时发现的新子目录需要完整扫描
+                if (!result.recursive && dir != result.dir) {
+                    startScan(dir, true);
+                }
+            }
+        }
+        if (!toWatch.isEmpty()) {
+            QStringList failed = watcher->addPaths(toWatch);
+            if (!failed.isEmpty()) {
+                qCWarning(lcLibrary) << "Unable to watch" << failed.size() << "directories";
+            }
+        }
+
+        if (updated > 0 || removed > 0) {
+            qCDebug(lcLibrary) << result.dir << "updated" << updated << "removed" << removed;
+            emit libraryChanged();
+        }
+    }
+
+    if (pendingScans == 0) {
+        emit scanFinished(index.trackCount());
+    }
+}
+
+void LocalLibrary::onDirectoryChanged(const QString &dir)
+{
+    dirtyDirectories.insert(dir);
+    rescanTimer->start();
+}
+
+void LocalLibrary::flushDirtyDirectories()
+{
+    const QSet<QString> dirs = dirtyDirectories;
+    dirtyDirectories.clear();
+
+    for (const QString &dir : dirs) {
+        if (QDir(dir).exists()) {
+            startScan(dir, false);
+            continue;
+        }
+
+        // 目录被删除：移除其下所有曲目并停止监视
+        for (const QString &path : index.pathsUnder(dir, true)) {
+            index.removeTrack(path);
+        }
+        QStringList gone;
+        for (const QString &watched : watcher->directories()) {
+            if (watched == dir || watched.startsWith(dir + '/')) gone.append(watched);
+        }
+        if (!gone.isEmpty()) watcher->removePaths(gone);
+        emit libraryChanged();
+    }
+}
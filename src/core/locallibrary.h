@@ -0,0 +1,69 @@
+#ifndef LOCALLIBRARY_H
+#define LOCALLIBRARY_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include "libraryindex.h"
+#include "playlistmanager.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// 本地曲库：后台线程扫描目录并读取标签，维护倒排索引，
+// 通过文件系统监视对变化的目录做增量重扫
+class LocalLibrary : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LocalLibrary(QObject *parent = nullptr);
+    ~LocalLibrary();
+
+    void setFolders(const QStringList &folders); // 设置曲库目录并开始扫描
+    void addFolder(const QString &folder);       // 添加一个目录，只扫描它，已有的目录不重扫
+    QStringList folders() const;
+
+    QVector<Song> search(const QString &query, int limit = 200) const;
+    int trackCount() const;
+    bool isScanning() const;
+
+signals:
+    void scanFinished(int trackCount);
+    void libraryChanged();
+
+private:
+    // 扫描线程产出的曲目及其词项
+    struct ScannedTrack {
+        LibraryIndex::Track track;
+        QStringList terms;
+        bool unchanged = false; // 与索引中的记录一致，无需更新
+    };
+    struct ScanResult {
+        QString dir;
+        bool recursive = false;
+        QVector<ScannedTrack> tracks;
+        QStringList directories; // 扫描到的所有目录，用于监视
+    };
+
+    void startScan(const QString &dir, bool recursive);
+    static ScanResult scan(const QString &dir, bool recursive,
+                           const QHash<QString, QPair<qint64, qint64>> &known,
+                           const std::atomic<bool> &cancelled);
+    void applyScanResult(const ScanResult &result);
+    void onDirectoryChanged(const QString &dir);
+    void flushDirtyDirectories();
+
+    LibraryIndex index;
+    QStringList rootFolders;
+    QFileSystemWatcher *watcher;
+    QSet<QString> dirtyDirectories;
+    QTimer *rescanTimer;
+    QThreadPool pool;
+    std::atomic<bool> cancelled;
+    int pendingScans;
+};
+
+#endif // LOCALLIBRARY_H
@@ -0,0 +1,158 @@
+#include "logging.h"
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <cstdio>
+
+Q_LOGGING_CATEGORY(lcNetwork, "melody.network", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcBilibili, "melody.bilibili", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcSearch, "melody.search", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPlayback, "melody.playback", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcSession, "melody.session", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcLibrary, "melody.library", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcStartup, "melody.startup", QtInfoMsg)
+
+// 环形缓冲区容量（条）
+static const int kRingCapacity = 4096;
+
+static const char *kMessagePattern =
+    "%{time hh:mm:ss.zzz} "
+    "%{if-debug}D%{endif}%{if-info}I%{endif}%{if-warning}W%{endif}%{if-critical}E%{endif}%{if-fatal}F%{endif} "
+    "%{category}: %{message}";
+
+namespace {
+
+struct LogSink {
+    QMutex mutex;
+    QMutex writeMutex;    // 输出端（stderr 和文件）
+    QWaitCondition wake;
+    QVector<QByteArray> ring;
+    int head = 0;         // 最旧消息的位置
+    int size = 0;
+    quint64 dropped = 0;
+    bool stopping = false;
+    QThread *writer = nullptr;
+    QFile file;
+    QtMessageHandler previousHandler = nullptr;
+};
+
+LogSink &sink()
+{
+    static LogSink instance;
+    return instance;
+}
+
+void writeLines(LogSink &s, const QVector<QByteArray> &lines, quint64 dropped)
+{
+    QMutexLocker locker(&s.writeMutex);
+    for (const QByteArray &line : lines) {
+        fwrite(line.constData(), 1, size_t(line.size()), stderr);
+        if (s.file.isOpen()) s.file.write(line);
+    }
+    if (dropped > 0) {
+        const QByteArray notice = "[log] " + QByteArray::number(dropped) + " messages dropped\n";
+        fwrite(notice.constData(), 1, size_t(notice.size()), stderr);
+        if (s.file.isOpen()) s.file.write(notice);
+    }
+    fflush(stderr);
+    if (s.file.isOpen()) s.file.flush();
+}
+
+void writerLoop()
+{
+    LogSink &s = sink();
+    QVector<QByteArray> batch;
+    batch.reserve(kRingCapacity);
+    for (;;) {
+        quint64 dropped = 0;
+        bool stopping = false;
+        {
+            QMutexLocker locker(&s.mutex);
+            while (s.size == 0 && !s.stopping) {
+                s.wake.wait(&s.mutex);
+            }
+            for (int i = 0; i < s.size; ++i) {
+                batch.append(std::move(s.ring[(s.head + i) % kRingCapacity]));
+            }
+            s.head = 0;
+            s.size = 0;
+            dropped = s.dropped;
+            s.dropped = 0;
+            stopping = s.stopping;
+        }
+        writeLines(s, batch, dropped);
+        batch.clear();
+        if (stopping) return;
+    }
+}
+
+void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    QByteArray line = qFormatLogMessage(type, context, message).toUtf8();
+    line.append('\n');
+
+    LogSink &s = sink();
+    QMutexLocker locker(&s.mutex);
+    if (!s.writer || s.stopping || type == QtFatalMsg) {
+        // 后台线程未运行，或进程即将终止：先写出缓冲区中的消息再同步输出
+        QVector<QByteArray> pending;
+        for (int i = 0; i < s.size; ++i) pending.append(s.ring[(s.head + i) % kRingCapacity]);
+        s.size = 0;
+        pending.append(line);
+        writeLines(s, pending, 0);
+        return;
+    }
+
+    if (s.size == kRingCapacity) {
+        s.head = (s.head + 1) % kRingCapacity;
+        s.size--;
+        s.dropped++;
+    }
+    s.ring[(s.head + s.size) % kRingCapacity] = std::move(line);
+    s.size++;
+    s.wake.wakeOne();
+}
+
+} // namespace
+
+void Logging::install()
+{
+    LogSink &s = sink();
+    if (s.writer) return;
+
+    qSetMessagePattern(QString::fromLatin1(kMessagePattern)); // QT_MESSAGE_PATTERN 优先
+    s.ring.resize(kRingCapacity);
+
+    const QString logFile = qEnvironmentVariable("MELODY_LOG_FILE");
+    if (!logFile.isEmpty()) {
+        s.file.setFileName(logFile);
+        if (!s.file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            fprintf(stderr, "Unable to open log file %s\n", qPrintable(logFile));
+        }
+    }
+
+    s.stopping = false;
+    s.writer = QThread::create(writerLoop);
+    s.writer->setObjectName("LogWriter");
+    s.writer->start(QThread::LowPriority);
+    s.previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+void Logging::shutdown()
+{
+    LogSink &s = sink();
+    if (!s.writer) return;
+
+    {
+        QMutexLocker locker(&s.mutex);
+        s.stopping = true;
+        s.wake.wakeOne();
+    }
+    s.writer->wait();
+    delete s.writer;
+    s.writer = nullptr;
+    qInstallMessageHandler(s.previousHandler);
+    s.file.close();
+}
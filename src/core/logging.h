@@ -0,0 +1,26 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// 日志分类。debug 级别默认关闭，qCDebug 在分类未开启时不会格式化参数；
+// 运行时开启：QT_LOGGING_RULES="melody.bilibili.debug=true"（或 "melody.*.debug=true"）
+Q_DECLARE_LOGGING_CATEGORY(lcNetwork)
+Q_DECLARE_LOGGING_CATEGORY(lcBilibili)
+Q_DECLARE_LOGGING_CATEGORY(lcSearch)
+Q_DECLARE_LOGGING_CATEGORY(lcPlayback)
+Q_DECLARE_LOGGING_CATEGORY(lcSession)
+Q_DECLARE_LOGGING_CATEGORY(lcLibrary)
+Q_DECLARE_LOGGING_CATEGORY(lcStartup)
+
+// 异步日志输出：消息在调用线程格式化后放入环形缓冲区，由后台线程写到
+// stderr 和 MELODY_LOG_FILE 指定的文件。缓冲区满时丢弃最旧的消息并记录丢弃数，
+// 调用线程不会因磁盘或终端输出而阻塞
+namespace Logging {
+
+void install();  // 在 main() 开始时调用
+void shutdown(); // 写出剩余消息并停止后台线程；之后的消息同步输出
+
+} // namespace Logging
+
+#endif // LOGGING_H
@@ -0,0 +1,192 @@
+#include "loudnessanalyzer.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+// BS.1770 的门限
+static const double kAbsoluteGateLufs = -70.0;
+static const double kRelativeGateLu = -10.0;
+// 每声道的滤波状态：输入 x1 x2、搁架输出 y1 y2（即高通输入）、高通输出 z1 z2
+static const int kStateSize = 6;
+
+static double blockLoudness(double meanSquare)
+{
+    return meanSquare > 0 ? -0.691 + 10.0 * std::log10(meanSquare) : -HUGE_VAL;
+}
+
+// 静音时 IIR 状态逐渐衰减为非规格化数，运算会慢几十倍，直接置零
+static double flushDenormal(double value)
+{
+    return std::fabs(value) < 1e-30 ? 0.0 : value;
+}
+
+LoudnessAnalyzer::LoudnessAnalyzer(int sampleRate, int channels)
+    : sampleRate(qMax(1, sampleRate)), channels(qMax(1, channels)),
+      state(size_t(this->channels) * kStateSize, 0.0),
+      stepFrames(qMax(1, this->sampleRate / 10))
+{
+    // 系数按采样率由模拟原型双线性变换得到（与 libebur128 相同），48kHz 时与规范中的数值一致
+    double f0 = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(M_PI * f0 / this->sampleRate);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+              2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(M_PI * f0 / this->sampleRate);
+    a0 = 1.0 + k / q + k * k;
+    highpass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+}
+
+void LoudnessAnalyzer::reset()
+{
+    std::fill(state.begin(), state.end(), 0.0);
+    stepFilled = 0;
+    stepEnergy = 0;
+    stepCount = 0;
+    blocks.clear();
+    processed = 0;
+}
+
+void LoudnessAnalyzer::process(const float *samples, qint64 frames)
+{
+    while (frames > 0) {
+        const qint64 count = qMin(frames, stepFrames - stepFilled);
+        if (channels == 2) {
+            filterStereo(samples, count);
+        } else {
+            filterScalar(samples, count);
+        }
+        stepFilled += count;
+        processed += count;
+        samples += count * channels;
+        frames -= count;
+        if (stepFilled == stepFrames) finishStep();
+    }
+    for (double &value : state) value = flushDenormal(value);
+}
+
+void LoudnessAnalyzer::filterScalar(const float *samples, qint64 frames)
+{
+    for (int c = 0; c < channels; ++c) {
+        double *s = state.data() + c * kStateSize;
+        double x1 = s[0], x2 = s[1], y1 = s[2], y2 = s[3], z1 = s[4], z2 = s[5];
+        double energy = 0;
+        for (qint64 i = 0; i < frames; ++i) {
+            const double x = samples[i * channels + c];
+            const double y = shelf.b0 * x + shelf.b1 * x1 + shelf.b2 * x2 - shelf.a1 * y1 - shelf.a2 * y2;
+            const double z = highpass.b0 * y + highpass.b1 * y1 + highpass.b2 * y2
+                             - highpass.a1 * z1 - highpass.a2 * z2;
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            z2 = z1; z1 = z;
+            energy += z * z;
+        }
+        s[0] = x1; s[1] = x2; s[2] = y1; s[3] = y2; s[4] = z1; s[5] = z2;
+        stepEnergy += energy;
+    }
+}
+
+// 立体声：左右声道放在同一个双精度向量的两路中同时滤波。
+// IIR 在时间上前后依赖，无法跨采样并行，但声道之间互相独立
+void LoudnessAnalyzer::filterStereo(const float *samples, qint64 frames)
+{
+#ifdef MELODY_HAVE_SSE2
+    double *l = state.data();
+    double *r = state.data() + kStateSize;
+    __m128d x1 = _mm_setr_pd(l[0], r[0]), x2 = _mm_setr_pd(l[1], r[1]);
+    __m128d y1 = _mm_setr_pd(l[2], r[2]), y2 = _mm_setr_pd(l[3], r[3]);
+    __m128d z1 = _mm_setr_pd(l[4], r[4]), z2 = _mm_setr_pd(l[5], r[5]);
+    const __m128d sb0 = _mm_set1_pd(shelf.b0), sb1 = _mm_set1_pd(shelf.b1), sb2 = _mm_set1_pd(shelf.b2);
+    const __m128d sa1 = _mm_set1_pd(shelf.a1), sa2 = _mm_set1_pd(shelf.a2);
+    const __m128d hb0 = _mm_set1_pd(highpass.b0), hb1 = _mm_set1_pd(highpass.b1);
+    const __m128d hb2 = _mm_set1_pd(highpass.b2);
+    const __m128d ha1 = _mm_set1_pd(highpass.a1), ha2 = _mm_set1_pd(highpass.a2);
+    __m128d energy = _mm_setzero_pd();
+
+    for (qint64 i = 0; i < frames; ++i) {
+        const __m128 pair = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(samples + i * 2)));
+        const __m128d x = _mm_cvtps_pd(pair);
+        const __m128d y = _mm_sub_pd(
+            _mm_add_pd(_mm_add_pd(_mm_mul_pd(sb0, x), _mm_mul_pd(sb1, x1)), _mm_mul_pd(sb2, x2)),
+            _mm_add_pd(_mm_mul_pd(sa1, y1), _mm_mul_pd(sa2, y2)));
+        const __m128d z = _mm_sub_pd(
+            _mm_add_pd(_mm_add_pd(_mm_mul_pd(hb0, y), _mm_mul_pd(hb1, y1)), _mm_mul_pd(hb2, y2)),
+            _mm_add_pd(_mm_mul_pd(ha1, z1), _mm_mul_pd(ha2, z2)));
+        x2 = x1; x1 = x;
+        y2 = y1; y1 = y;
+        z2 = z1; z1 = z;
+        energy = _mm_add_pd(energy, _mm_mul_pd(z, z));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, x1); l[0] = lanes[0]; r[0] = lanes[1];
+    _mm_storeu_pd(lanes, x2); l[1] = lanes[0]; r[1] = lanes[1];
+    _mm_storeu_pd(lanes, y1); l[2] = lanes[0]; r[2] = lanes[1];
+    _mm_storeu_pd(lanes, y2); l[3] = lanes[0]; r[3] = lanes[1];
+    _mm_storeu_pd(lanes, z1); l[4] = lanes[0]; r[4] = lanes[1];
+    _mm_storeu_pd(lanes, z2); l[5] = lanes[0]; r[5] = lanes[1];
+    _mm_storeu_pd(lanes, energy);
+    stepEnergy += lanes[0] + lanes[1];
+#else
+    filterScalar(samples, frames);
+#endif
+}
+
+void LoudnessAnalyzer::finishStep()
+{
+    steps[stepCount % 4] = stepEnergy / double(stepFrames);
+    ++stepCount;
+    stepEnergy = 0;
+    stepFilled = 0;
+    if (stepCount < 4) return;
+
+    const double meanSquare = (steps[0] + steps[1] + steps[2] + steps[3]) / 4.0;
+    if (blockLoudness(meanSquare) > kAbsoluteGateLufs) {
+        blocks.push_back(meanSquare);
+    }
+}
+
+qint64 LoudnessAnalyzer::framesProcessed() const
+{
+    return processed;
+}
+
+bool LoudnessAnalyzer::hasResult() const
+{
+    return !blocks.empty();
+}
+
+double LoudnessAnalyzer::integratedLoudness() const
+{
+    if (blocks.empty()) return kAbsoluteGateLufs;
+
+    double sum = 0;
+    for (double block : blocks) sum += block;
+    const double relativeGate = blockLoudness(sum / double(blocks.size())) + kRelativeGateLu;
+
+    double gatedSum = 0;
+    qint64 gatedCount = 0;
+    for (double block : blocks) {
+        if (blockLoudness(block) > relativeGate) {
+            gatedSum += block;
+            ++gatedCount;
+        }
+    }
+    return gatedCount > 0 ? blockLoudness(gatedSum / double(gatedCount)) : kAbsoluteGateLufs;
+}
+
+double LoudnessAnalyzer::gainToTarget(double lufs, double maxDb)
+{
+    return qBound(-maxDb, kTargetLufs - lufs, maxDb);
+}
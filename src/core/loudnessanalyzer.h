@@ -0,0 +1,53 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include <QtGlobal>
+#include <vector>
+
+// EBU R128 / ITU-R BS.1770 积分响度测量：K 计权滤波 -> 400ms 块（每 100ms 一块）-> 绝对门限 -70 LUFS
+// 与相对门限 -10 LU。输入为交错排列的 float 采样，可分多次送入，边播放边测量。
+// 不区分环绕声道，所有声道权重都为 1.0（播放器只输出单声道和立体声）
+class LoudnessAnalyzer
+{
+public:
+    static constexpr double kTargetLufs = -14.0; // 归一化目标响度，与主流流媒体平台一致
+
+    LoudnessAnalyzer(int sampleRate, int channels);
+
+    void reset();
+    void process(const float *samples, qint64 frames);
+
+    qint64 framesProcessed() const;
+    bool hasResult() const;             // 至少有一个块高于绝对门限
+    double integratedLoudness() const;  // LUFS；没有结果时返回 -70
+
+    // 把 lufs 调整到目标响度需要的增益（dB），限制在 [-maxDb, maxDb]
+    static double gainToTarget(double lufs, double maxDb = 12.0);
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void filterScalar(const float *samples, qint64 frames);
+    void filterStereo(const float *samples, qint64 frames);
+    void finishStep();
+
+    int sampleRate;
+    int channels;
+    Biquad shelf;    // 第一级：高频搁架
+    Biquad highpass; // 第二级：RLB 高通
+
+    // 每声道两级滤波的状态：x1 x2 y1 y2（直接 I 型）
+    std::vector<double> state;
+
+    qint64 stepFrames;      // 100ms 的帧数
+    qint64 stepFilled = 0;  // 当前 100ms 已累计的帧数
+    double stepEnergy = 0;  // 当前 100ms 各声道平方和
+    double steps[4] = {};   // 最近 4 个 100ms 的均方值，组成一个 400ms 块
+    int stepCount = 0;
+    std::vector<double> blocks; // 高于绝对门限的块的均方值
+    qint64 processed = 0;
+};
+
+#endif // LOUDNESSANALYZER_H
@@ -0,0 +1,131 @@
+#include "loudnesscache.h"
+#include "logging.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+
+static const quint32 kMagic = 0x434C4C4D; // "MLLC"
+static const quint16 kVersion = 1;
+// 每条约几十字节，上限对应的文件不到 2 MB
+static const int kMaxEntries = 50000;
+// 连续播放时每首歌结束都会写入一条，合并后再写盘
+static const int kWriteDelayMs = 5000;
+
+LoudnessCache::LoudnessCache(const QString &filePath, QObject *parent)
+    : QObject(parent)
+{
+    path = filePath;
+    if (path.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        path = dir + "/loudness.bin";
+    }
+
+    writeTimer = new QTimer(this);
+    writeTimer->setSingleShot(true);
+    writeTimer->setInterval(kWriteDelayMs);
+    connect(writeTimer, &QTimer::timeout, this, &LoudnessCache::flush);
+
+    load();
+}
+
+LoudnessCache::~LoudnessCache()
+{
+    flush();
+}
+
+bool LoudnessCache::lookup(const QString &key, double *lufs) const
+{
+    auto it = entries.constFind(key);
+    if (it == entries.constEnd()) return false;
+    if (lufs) *lufs = it->lufs;
+    return true;
+}
+
+void LoudnessCache::insert(const QString &key, double lufs)
+{
+    Entry &entry = entries[key];
+    entry.lufs = float(lufs);
+    entry.storedAt = QDateTime::currentMSecsSinceEpoch();
+    if (entries.size() > kMaxEntries) prune();
+    dirty = true;
+    writeTimer->start();
+}
+
+int LoudnessCache::size() const
+{
+    return entries.size();
+}
+
+void LoudnessCache::flush()
+{
+    writeTimer->stop();
+    if (!dirty) return;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << quint32(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        out << it.key() << it->lufs << it->storedAt;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcPlayback) << "Unable to save loudness cache:" << file.errorString();
+        return;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(lcPlayback) << "Unable to save loudness cache:" << file.errorString();
+        return;
+    }
+    dirty = false;
+}
+
+void LoudnessCache::load()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion) {
+        qCWarning(lcPlayback) << "Ignoring incompatible loudness cache" << path;
+        return;
+    }
+
+    entries.reserve(int(qMin<quint32>(count, kMaxEntries)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Entry entry;
+        in >> key >> entry.lufs >> entry.storedAt;
+        if (in.status() == QDataStream::Ok) entries.insert(key, entry);
+    }
+    qCDebug(lcPlayback) << "Loaded" << entries.size() << "loudness entries";
+}
+
+void LoudnessCache::prune()
+{
+    // 淘汰最早的十分之一，避免每次插入都排序
+    QVector<qint64> times;
+    times.reserve(entries.size());
+    for (const Entry &entry : std::as_const(entries)) times.append(entry.storedAt);
+    const int removeCount = entries.size() - kMaxEntries * 9 / 10;
+    std::nth_element(times.begin(), times.begin() + removeCount, times.end());
+    const qint64 cutoff = times[removeCount];
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->storedAt < cutoff) it = entries.erase(it);
+        else ++it;
+    }
+}
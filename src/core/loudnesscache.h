@@ -0,0 +1,40 @@
+#ifndef LOUDNESSCACHE_H
+#define LOUDNESSCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+// 曲目响度（LUFS）的持久缓存，键见 TrackAnalysisService::keyFor。
+// 启动时整体读入内存，修改合并后延迟写入；条目过多时淘汰最早写入的
+class LoudnessCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoudnessCache(const QString &filePath = QString(), QObject *parent = nullptr);
+    ~LoudnessCache();
+
+    bool lookup(const QString &key, double *lufs) const;
+    void insert(const QString &key, double lufs);
+    int size() const;
+
+    void flush(); // 立即写入尚未保存的修改
+
+private:
+    struct Entry {
+        float lufs = 0;
+        qint64 storedAt = 0; // 毫秒时间戳
+    };
+
+    void load();
+    void prune();
+
+    QString path;
+    QHash<QString, Entry> entries;
+    QTimer *writeTimer;
+    bool dirty = false;
+};
+
+#endif // LOUDNESSCACHE_H
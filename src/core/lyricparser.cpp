@@ -0,0 +1,23 @@
+#include "lyricparser.h"
+#include <QRegularExpression>
+
+QMap<qint64, QString> LyricParser::parse(const QString &lyricText)
+{
+    static const QRegularExpression re("\\[(\\d{2}):(\\d{2})\\.(\\d{2,3})\\](.*)");
+
+    QMap<qint64, QString> lyrics;
+    for (const QString &line : lyricText.split('\n')) {
+        QRegularExpressionMatch match = re.match(line);
+        if (match.hasMatch()) {
+            qint64 minutes = match.captured(1).toLongLong();
+            qint64 seconds = match.captured(2).toLongLong();
+            qint64 milliseconds = match.captured(3).toLongLong();
+            if (match.captured(3).length() == 2) { // 兼容xx.xx格式
+                milliseconds *= 10;
+            }
+            qint64 time = minutes * 60 * 1000 + seconds * 1000 + milliseconds;
+            lyrics.insert(time, match.captured(4));
+        }
+    }
+    return lyrics;
+}
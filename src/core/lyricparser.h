@@ -0,0 +1,15 @@
+#ifndef LYRICPARSER_H
+#define LYRICPARSER_H
+
+#include <QMap>
+#include <QString>
+
+// LRC 歌词解析
+namespace LyricParser {
+
+// 解析 "[mm:ss.xx]歌词" 格式的文本，返回 时间(毫秒) -> 歌词
+QMap<qint64, QString> parse(const QString &lyricText);
+
+} // namespace LyricParser
+
+#endif // LYRICPARSER_H
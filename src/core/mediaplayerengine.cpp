@@ -0,0 +1,95 @@
+#include "mediaplayerengine.h"
+#include <QAudioOutput>
+
+MediaPlayerEngine::MediaPlayerEngine(QObject *parent)
+    : AudioEngine(parent), player(new QMediaPlayer(this)), output(new QAudioOutput(this))
+{
+    player->setAudioOutput(output);
+
+    connect(player, &QMediaPlayer::positionChanged, this, &AudioEngine::positionChanged);
+    connect(player, &QMediaPlayer::durationChanged, this, &AudioEngine::durationChanged);
+    connect(player, &QMediaPlayer::playbackStateChanged, this, &AudioEngine::playbackStateChanged);
+    connect(player, &QMediaPlayer::mediaStatusChanged, this, &AudioEngine::mediaStatusChanged);
+    connect(player, &QMediaPlayer::errorOccurred, this, &AudioEngine::errorOccurred);
+}
+
+QString MediaPlayerEngine::name() const
+{
+    return "mediaplayer";
+}
+
+void MediaPlayerEngine::setSource(const QUrl &url)
+{
+    player->setSource(url);
+}
+
+void MediaPlayerEngine::setSourceDevice(QIODevice *device, const QUrl &sourceUrl)
+{
+    player->setSourceDevice(device, sourceUrl);
+}
+
+QUrl MediaPlayerEngine::source() const
+{
+    return player->source();
+}
+
+void MediaPlayerEngine::play()
+{
+    player->play();
+}
+
+void MediaPlayerEngine::pause()
+{
+    player->pause();
+}
+
+void MediaPlayerEngine::stop()
+{
+    player->stop();
+}
+
+qint64 MediaPlayerEngine::position() const
+{
+    return player->position();
+}
+
+qint64 MediaPlayerEngine::duration() const
+{
+    return player->duration();
+}
+
+void MediaPlayerEngine::setPosition(qint64 position)
+{
+    player->setPosition(position);
+}
+
+QMediaPlayer::PlaybackState MediaPlayerEngine::playbackState() const
+{
+    return player->playbackState();
+}
+
+QMediaPlayer::MediaStatus MediaPlayerEngine::mediaStatus() const
+{
+    return player->mediaStatus();
+}
+
+void MediaPlayerEngine::setVolume(float volume)
+{
+    userVolume = volume;
+    output->setVolume(effectiveVolume(volume));
+}
+
+float MediaPlayerEngine::volume() const
+{
+    return userVolume;
+}
+
+void MediaPlayerEngine::setAudioDevice(const QAudioDevice &device)
+{
+    output->setDevice(device);
+}
+
+QAudioDevice MediaPlayerEngine::audioDevice() const
+{
+    return output->device();
+}
@@ -0,0 +1,43 @@
+#ifndef MEDIAPLAYERENGINE_H
+#define MEDIAPLAYERENGINE_H
+
+#include "audioengine.h"
+
+class QAudioOutput;
+
+// 基于 QMediaPlayer 的默认引擎：解码和输出都交给 Qt Multimedia
+class MediaPlayerEngine : public AudioEngine
+{
+    Q_OBJECT
+public:
+    explicit MediaPlayerEngine(QObject *parent = nullptr);
+
+    QString name() const override;
+
+    void setSource(const QUrl &url) override;
+    void setSourceDevice(QIODevice *device, const QUrl &sourceUrl = QUrl()) override;
+    QUrl source() const override;
+
+    void play() override;
+    void pause() override;
+    void stop() override;
+
+    qint64 position() const override;
+    qint64 duration() const override;
+    void setPosition(qint64 position) override;
+
+    QMediaPlayer::PlaybackState playbackState() const override;
+    QMediaPlayer::MediaStatus mediaStatus() const override;
+
+    void setVolume(float volume) override;
+    float volume() const override;
+    void setAudioDevice(const QAudioDevice &device) override;
+    QAudioDevice audioDevice() const override;
+
+private:
+    QMediaPlayer *player;
+    QAudioOutput *output;
+    float userVolume = 1.0f; // 未乘归一化增益的音量
+};
+
+#endif // MEDIAPLAYERENGINE_H
@@ -0,0 +1,321 @@
+#include "metrics.h"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSaveFile>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+// 直方图桶上界（毫秒量级），另有 +Inf 桶
+static const double kBucketBounds[] = { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+static const int kBucketCount = int(sizeof(kBucketBounds) / sizeof(kBucketBounds[0]));
+// 每个直方图保留的最近样本数，用于计算百分位
+static const int kRecentSamples = 512;
+
+namespace {
+
+struct Histogram {
+    qint64 buckets[kBucketCount + 1] = {};
+    qint64 count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+    QVector<double> recent; // 环形缓冲
+    int next = 0;
+};
+
+struct Registry {
+    QMutex mutex;
+    QMap<QString, QMap<QString, qint64>> counters;
+    QMap<QString, QMap<QString, double>> gauges;
+    QMap<QString, QMap<QString, Histogram>> histograms;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+QString labelText(const Metrics::Labels &labels)
+{
+    QString text;
+    for (const auto &label : labels) {
+        if (!text.isEmpty()) text += ',';
+        QString value = label.second;
+        value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+        text += label.first + "=\"" + value + '"';
+    }
+    return text;
+}
+
+double percentile(QVector<double> samples, double p)
+{
+    if (samples.isEmpty()) return 0;
+    const int index = qBound(0, int(std::ceil(p * samples.size())) - 1, samples.size() - 1);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+Metrics::Summary summarize(const Histogram &histogram)
+{
+    Metrics::Summary summary;
+    summary.count = histogram.count;
+    summary.sum = histogram.sum;
+    summary.min = histogram.min;
+    summary.max = histogram.max;
+    summary.p50 = percentile(histogram.recent, 0.50);
+    summary.p95 = percentile(histogram.recent, 0.95);
+    return summary;
+}
+
+QString seriesName(const QString &name, const QString &labels, const QString &extra = QString())
+{
+    QString all = labels;
+    if (!extra.isEmpty()) {
+        if (!all.isEmpty()) all += ',';
+        all += extra;
+    }
+    return all.isEmpty() ? name : name + '{' + all + '}';
+}
+
+QString formatNumber(double value)
+{
+    return QString::number(value, 'g', 12);
+}
+
+} // namespace
+
+void Metrics::increment(const QString &name, const Labels &labels, qint64 delta)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.counters[name][labelText(labels)] += delta;
+}
+
+void Metrics::setGauge(const QString &name, double value, const Labels &labels)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.gauges[name][labelText(labels)] = value;
+}
+
+void Metrics::observe(const QString &name, double value, const Labels &labels)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Histogram &histogram = r.histograms[name][labelText(labels)];
+
+    int bucket = 0;
+    while (bucket < kBucketCount && value > kBucketBounds[bucket]) bucket++;
+    histogram.buckets[bucket]++;
+
+    histogram.min = histogram.count == 0 ? value : qMin(histogram.min, value);
+    histogram.max = histogram.count == 0 ? value : qMax(histogram.max, value);
+    histogram.count++;
+    histogram.sum += value;
+
+    if (histogram.recent.size() < kRecentSamples) {
+        histogram.recent.append(value);
+    } else {
+        histogram.recent[histogram.next] = value;
+        histogram.next = (histogram.next + 1) % kRecentSamples;
+    }
+}
+
+QMap<QString, qint64> Metrics::counters(const QString &name)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    return r.counters.value(name);
+}
+
+QMap<QString, Metrics::Summary> Metrics::histograms(const QString &name)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    QMap<QString, Summary> result;
+    const QMap<QString, Histogram> series = r.histograms.value(name);
+    for (auto it = series.constBegin(); it != series.constEnd(); ++it) {
+        result.insert(it.key(), summarize(it.value()));
+    }
+    return result;
+}
+
+Metrics::Summary Metrics::histogram(const QString &name)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    Histogram merged;
+    bool first = true;
+    for (const Histogram &histogram : r.histograms.value(name)) {
+        if (histogram.count == 0) continue;
+        merged.min = first ? histogram.min : qMin(merged.min, histogram.min);
+        merged.max = first ? histogram.max : qMax(merged.max, histogram.max);
+        merged.count += histogram.count;
+        merged.sum += histogram.sum;
+        merged.recent += histogram.recent;
+        first = false;
+    }
+    return summarize(merged);
+}
+
+double Metrics::gauge(const QString &name, const Labels &labels)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    return r.gauges.value(name).value(labelText(labels));
+}
+
+void Metrics::sampleProcessMemory()
+{
+    qint64 residentBytes = -1;
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        residentBytes = qint64(counters.WorkingSetSize);
+    }
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        residentBytes = qint64(info.resident_size);
+    }
+#elif defined(Q_OS_UNIX)
+    // /proc/self/statm 第二列为常驻页数
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            residentBytes = fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    if (residentBytes >= 0) {
+        setGauge("process_resident_bytes", double(residentBytes));
+    }
+}
+
+void Metrics::reset()
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    r.counters.clear();
+    r.gauges.clear();
+    r.histograms.clear();
+}
+
+QJsonObject Metrics::toJson()
+{
+    sampleProcessMemory();
+
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    QJsonObject counters;
+    for (auto it = r.counters.constBegin(); it != r.counters.constEnd(); ++it) {
+        QJsonObject series;
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) series[s.key()] = s.value();
+        counters[it.key()] = series;
+    }
+
+    QJsonObject gauges;
+    for (auto it = r.gauges.constBegin(); it != r.gauges.constEnd(); ++it) {
+        QJsonObject series;
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) series[s.key()] = s.value();
+        gauges[it.key()] = series;
+    }
+
+    QJsonObject histograms;
+    for (auto it = r.histograms.constBegin(); it != r.histograms.constEnd(); ++it) {
+        QJsonObject series;
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) {
+            const Summary summary = summarize(s.value());
+            QJsonArray buckets;
+            for (int i = 0; i <= kBucketCount; ++i) {
+                QJsonObject bucket;
+                bucket["le"] = i < kBucketCount ? QJsonValue(kBucketBounds[i]) : QJsonValue("+Inf");
+                bucket["count"] = s->buckets[i];
+                buckets.append(bucket);
+            }
+            QJsonObject obj;
+            obj["count"] = summary.count;
+            obj["sum"] = summary.sum;
+            obj["min"] = summary.min;
+            obj["max"] = summary.max;
+            obj["p50"] = summary.p50;
+            obj["p95"] = summary.p95;
+            obj["buckets"] = buckets;
+            series[s.key()] = obj;
+        }
+        histograms[it.key()] = series;
+    }
+
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    root["counters"] = counters;
+    root["gauges"] = gauges;
+    root["histograms"] = histograms;
+    return root;
+}
+
+QByteArray Metrics::toPrometheus()
+{
+    sampleProcessMemory();
+
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    QString text;
+
+    for (auto it = r.counters.constBegin(); it != r.counters.constEnd(); ++it) {
+        text += "# TYPE " + it.key() + " counter\n";
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) {
+            text += seriesName(it.key(), s.key()) + ' ' + QString::number(s.value()) + '\n';
+        }
+    }
+    for (auto it = r.gauges.constBegin(); it != r.gauges.constEnd(); ++it) {
+        text += "# TYPE " + it.key() + " gauge\n";
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) {
+            text += seriesName(it.key(), s.key()) + ' ' + formatNumber(s.value()) + '\n';
+        }
+    }
+    for (auto it = r.histograms.constBegin(); it != r.histograms.constEnd(); ++it) {
+        text += "# TYPE " + it.key() + " histogram\n";
+        for (auto s = it->constBegin(); s != it->constEnd(); ++s) {
+            qint64 cumulative = 0;
+            for (int i = 0; i <= kBucketCount; ++i) {
+                cumulative += s->buckets[i];
+                const QString le = i < kBucketCount ? formatNumber(kBucketBounds[i]) : QStringLiteral("+Inf");
+                text += seriesName(it.key() + "_bucket", s.key(), "le=\"" + le + '"')
+                      + ' ' + QString::number(cumulative) + '\n';
+            }
+            text += seriesName(it.key() + "_sum", s.key()) + ' ' + formatNumber(s->sum) + '\n';
+            text += seriesName(it.key() + "_count", s.key()) + ' ' + QString::number(s->count) + '\n';
+        }
+    }
+    return text.toUtf8();
+}
+
+bool Metrics::exportTo(const QString &filePath, QString *errorMessage)
+{
+    const QByteArray data = filePath.endsWith(".json", Qt::CaseInsensitive)
+                          ? QJsonDocument(toJson()).toJson(QJsonDocument::Indented)
+                          : toPrometheus();
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
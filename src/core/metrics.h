@@ -0,0 +1,47 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+
+// 进程内性能指标：计数器、瞬时值和耗时直方图，可在任意线程记录。
+// 指标可带标签，例如 http_request_ms{host="api.bilibili.com",endpoint="/x/player/playurl"}；
+// 导出为 JSON 或 Prometheus 文本格式
+class Metrics
+{
+public:
+    using Labels = QList<QPair<QString, QString>>;
+
+    struct Summary {
+        qint64 count = 0;
+        double sum = 0;
+        double min = 0;
+        double max = 0;
+        double p50 = 0; // 百分位基于最近的样本
+        double p95 = 0;
+    };
+
+    static void increment(const QString &name, const Labels &labels = {}, qint64 delta = 1);
+    static void setGauge(const QString &name, double value, const Labels &labels = {});
+    static void observe(const QString &name, double value, const Labels &labels = {});
+
+    // 按标签分组的当前值，键为标签文本（如 result="exact"，无标签时为空串）
+    static QMap<QString, qint64> counters(const QString &name);
+    static QMap<QString, Summary> histograms(const QString &name);
+    static Summary histogram(const QString &name); // 合并所有标签
+    static double gauge(const QString &name, const Labels &labels = {});
+
+    static void sampleProcessMemory(); // 更新 process_resident_bytes
+    static void reset();
+
+    static QJsonObject toJson();
+    static QByteArray toPrometheus();
+    // 扩展名为 .json 时导出 JSON，否则导出 Prometheus 文本
+    static bool exportTo(const QString &filePath, QString *errorMessage = nullptr);
+};
+
+#endif // METRICS_H
@@ -0,0 +1,209 @@
+#include "networkpolicy.h"
+#include "metrics.h"
+#include "logging.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QHostInfo>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QSettings>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+#include <QHttp1Configuration>
+#endif
+#include <memory>
+
+// 运行中记住的 CDN 主机数量上限（封面、音频分发节点会变化）
+static const int kMaxRememberedHosts = 6;
+
+// 空闲连接保活时间，避免歌曲间隔中连接被回收
+static const int kKeepAliveSeconds = 120;
+
+NetworkPolicy::NetworkPolicy(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent), manager(manager), connectionsPerHost(4)
+{
+}
+
+void NetworkPolicy::setCoreEndpoints(const QList<QUrl> &endpoints)
+{
+    coreEndpoints = endpoints;
+}
+
+bool NetworkPolicy::isCoreHost(const QString &host) const
+{
+    for (const QUrl &endpoint : coreEndpoints) {
+        if (endpoint.host() == host) return true;
+    }
+    return false;
+}
+
+QList<QUrl> NetworkPolicy::warmEndpoints() const
+{
+    QList<QUrl> endpoints;
+    bool local = false;
+    for (const QUrl &endpoint : coreEndpoints) {
+        if (!endpoints.contains(endpoint)) endpoints.append(endpoint);
+        const QHostAddress address(endpoint.host());
+        if (address.isLoopback() || endpoint.host() == QLatin1String("localhost")) local = true;
+    }
+    // 接口指向本地模拟服务器时不预热真实 CDN，测试环境可能没有外网
+    if (local) return endpoints;
+
+    QSettings settings;
+    for (const QString &host : settings.value("network/cdnHosts").toStringList()) {
+        if (!isCoreHost(host)) {
+            endpoints.append(QUrl("https://" + host));
+        }
+    }
+    return endpoints;
+}
+
+void NetworkPolicy::rememberHost(const QString &host)
+{
+    if (rememberedHosts.contains(host)) return;
+    rememberedHosts.insert(host);
+
+    if (isCoreHost(host)) return;
+
+    QSettings settings;
+    QStringList hosts = settings.value("network/cdnHosts").toStringList();
+    hosts.removeAll(host);
+    hosts.prepend(host);
+    while (hosts.size() > kMaxRememberedHosts) {
+        hosts.removeLast();
+    }
+    settings.setValue("network/cdnHosts", hosts);
+}
+
+void NetworkPolicy::warmUp()
+{
+    for (const QUrl &endpoint : warmEndpoints()) {
+        // 先单独解析一次，既测得DNS耗时，也填充 Qt 的主机缓存
+        const QString host = endpoint.host();
+        auto timer = std::make_shared<QElapsedTimer>();
+        timer->start();
+        QHostInfo::lookupHost(host, this, [this, endpoint, host, timer](const QHostInfo &info) {
+            if (info.error() != QHostInfo::NoError) {
+                qCDebug(lcNetwork) << "Warm-up DNS failed for" << host << info.errorString();
+                return;
+            }
+            stats[host].dnsMs = timer->elapsed();
+#if QT_CONFIG(ssl)
+            if (endpoint.scheme() == QLatin1String("https")) {
+                manager->connectToHostEncrypted(host, endpoint.port(443));
+                return;
+            }
+#endif
+            manager->connectToHost(host, endpoint.port(80));
+        });
+    }
+}
+
+void NetworkPolicy::prepare(QNetworkRequest &request) const
+{
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    request.setAttribute(QNetworkRequest::ConnectionCacheExpiryTimeoutSecondsAttribute, kKeepAliveSeconds);
+#endif
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    // HTTP/1.1 下限制单主机并行连接数；HTTP/2 在单连接上多路复用
+    QHttp1Configuration http1;
+    http1.setNumberOfConnectionsPerHost(connectionsPerHost);
+    request.setHttp1Configuration(http1);
+#endif
+}
+
+void NetworkPolicy::track(QNetworkReply *reply)
+{
+    struct Marks {
+        QElapsedTimer clock;
+        qint64 connectStart = -1;
+        qint64 encrypted = -1;
+        qint64 sent = -1;
+        qint64 headers = -1;
+        qint64 received = 0; // 实际收到的响应体字节数（分块传输时没有 Content-Length）
+    };
+    auto marks = std::make_shared<Marks>();
+    marks->clock.start();
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    connect(reply, &QNetworkReply::socketStartedConnecting, this, [marks]() {
+        if (marks->connectStart < 0) marks->connectStart = marks->clock.elapsed();
+    });
+    connect(reply, &QNetworkReply::requestSent, this, [marks]() {
+        if (marks->sent < 0) marks->sent = marks->clock.elapsed();
+    });
+#endif
+#if QT_CONFIG(ssl)
+    connect(reply, &QNetworkReply::encrypted, this, [marks]() {
+        if (marks->encrypted < 0) marks->encrypted = marks->clock.elapsed();
+    });
+#endif
+    connect(reply, &QNetworkReply::metaDataChanged, this, [marks]() {
+        if (marks->headers < 0) marks->headers = marks->clock.elapsed();
+    });
+    connect(reply, &QNetworkReply::downloadProgress, this, [marks](qint64 bytesReceived, qint64) {
+        marks->received = bytesReceived;
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, marks]() {
+        const qint64 finished = marks->clock.elapsed();
+
+        RequestTiming timing;
+        timing.host = reply->url().host();
+        timing.endpoint = reply->url().path();
+        timing.totalMs = finished;
+        timing.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        timing.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+        timing.bytes = marks->received;
+        timing.reusedConnection = marks->connectStart < 0;
+
+        HostStats &host = stats[timing.host];
+        timing.dnsMs = timing.reusedConnection ? -1 : host.dnsMs;
+        if (!timing.reusedConnection) {
+            qint64 connected = marks->sent >= 0 ? marks->sent : marks->encrypted;
+            if (connected >= 0) timing.connectMs = connected - marks->connectStart;
+            if (marks->encrypted >= 0) timing.tlsMs = marks->encrypted - marks->connectStart;
+        }
+        qint64 sent = marks->sent >= 0 ? marks->sent : 0;
+        if (marks->headers >= 0) {
+            timing.ttfbMs = marks->headers - sent;
+            timing.transferMs = finished - marks->headers;
+        }
+
+        host.requests++;
+        host.totalMsSum += timing.totalMs;
+        if (timing.ttfbMs >= 0) host.ttfbMsSum += timing.ttfbMs;
+        if (timing.bytes > 0) host.bytes += timing.bytes;
+        if (timing.reusedConnection) host.reusedConnections++;
+        if (timing.http2) host.http2Requests++;
+
+        // CDN 地址各不相同，只按主机统计，避免标签无限增长
+        const Metrics::Labels labels = { { "host", timing.host },
+                                         { "endpoint", isCoreHost(timing.host) ? timing.endpoint : QStringLiteral("media") } };
+        Metrics::observe("http_request_ms", timing.totalMs, labels);
+        if (timing.ttfbMs >= 0) Metrics::observe("http_ttfb_ms", timing.ttfbMs, labels);
+
+        if (reply->error() == QNetworkReply::NoError) {
+            rememberHost(timing.host);
+        } else if (reply->error() != QNetworkReply::OperationCanceledError) {
+            Metrics::increment("http_errors_total", { { "host", timing.host },
+                                                      { "status", QString::number(timing.httpStatus) } });
+        }
+        emit requestTimed(timing);
+    });
+}
+
+void NetworkPolicy::setMaxConnectionsPerHost(int count)
+{
+    connectionsPerHost = qMax(1, count);
+}
+
+int NetworkPolicy::maxConnectionsPerHost() const
+{
+    return connectionsPerHost;
+}
+
+QHash<QString, NetworkPolicy::HostStats> NetworkPolicy::hostStats() const
+{
+    return stats;
+}
@@ -0,0 +1,77 @@
+#ifndef NETWORKPOLICY_H
+#define NETWORKPOLICY_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QUrl>
+#include <QNetworkRequest>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// 单个请求各阶段耗时（毫秒，-1 表示该阶段未发生或无法单独测量）
+// Qt 不单独暴露 DNS 与 TLS 握手，新建连接时这两段都计入 connectMs；
+// dnsMs 取自预热阶段对该主机的独立解析。
+struct RequestTiming {
+    QString host;
+    QString endpoint;          // 请求路径
+    qint64 dnsMs = -1;         // DNS 解析（预热时测得）
+    qint64 connectMs = -1;     // 开始建连到请求发出（含未缓存的DNS、TCP、TLS）
+    qint64 tlsMs = -1;         // 建连开始到 TLS 握手完成
+    qint64 ttfbMs = -1;        // 请求发出到收到响应头
+    qint64 transferMs = -1;    // 响应头到传输完成
+    qint64 totalMs = 0;        // 发起到完成
+    qint64 bytes = 0;          // 实际收到的响应体字节数
+    int httpStatus = 0;
+    bool reusedConnection = false; // 复用了已有连接（未触发建连）
+    bool http2 = false;
+};
+
+// 网络策略：启动预连接、HTTP/2 与 keep-alive 配置、单主机并发上限、请求耗时统计
+class NetworkPolicy : public QObject
+{
+    Q_OBJECT
+public:
+    // 按主机聚合的统计
+    struct HostStats {
+        int requests = 0;
+        int reusedConnections = 0;
+        int http2Requests = 0;
+        qint64 dnsMs = -1;         // 最近一次预热解析耗时
+        qint64 totalMsSum = 0;
+        qint64 ttfbMsSum = 0;
+        qint64 bytes = 0;
+    };
+
+    explicit NetworkPolicy(QNetworkAccessManager *manager, QObject *parent = nullptr);
+
+    void setCoreEndpoints(const QList<QUrl> &endpoints); // 每次启动都会访问的接口地址
+    void warmUp();                                // 对常用主机预先完成 DNS + TCP + TLS
+    void prepare(QNetworkRequest &request) const; // 为请求套用 HTTP/2、keep-alive 与并发配置
+    void track(QNetworkReply *reply);             // 记录请求各阶段耗时
+
+    void setMaxConnectionsPerHost(int count);
+    int maxConnectionsPerHost() const;
+
+    QHash<QString, HostStats> hostStats() const;
+
+signals:
+    void requestTimed(const RequestTiming &timing);
+
+private:
+    QList<QUrl> warmEndpoints() const;
+    bool isCoreHost(const QString &host) const;
+    void rememberHost(const QString &host);
+
+    QNetworkAccessManager *manager;
+    QList<QUrl> coreEndpoints;
+    QHash<QString, HostStats> stats;
+    QSet<QString> rememberedHosts; // 本次运行已记录过的主机
+    int connectionsPerHost;
+};
+
+#endif // NETWORKPOLICY_H
@@ -0,0 +1,888 @@
+#include "pcmaudioengine.h"
+#include "logging.h"
+#include "metrics.h"
+#include "gainramp.h"
+#include "spectrumanalyzer.h"
+#include <QAudioDecoder>
+#include <QAudioSink>
+#include <QMediaDevices>
+#include <QTimer>
+#include <atomic>
+#include <cstring>
+
+// 环形缓冲区约 1 秒（48kHz 立体声 float），跳转和切歌时清空，不影响响应速度
+static const qint64 kRingBytes = 48000 * 2 * 4;
+// 声卡缓冲区时长，越小音量和跳转响应越快，但越容易欠载
+static const int kSinkBufferMs = 100;
+// 解码线程在缓冲区满时的重试间隔
+static const int kPumpIntervalMs = 5;
+// 下一曲预先解码的长度（交叉淡化时另加淡化时长）
+static const int kPrerollMs = 2000;
+// 界面线程刷新播放位置、检测曲目边界和播放结束的间隔
+static const int kTickIntervalMs = 50;
+
+// 声卡拉取数据的设备：只读环形缓冲区和原子计数，可在声卡回调线程中调用
+class PcmSinkDevice : public QIODevice
+{
+public:
+    PcmSinkDevice(SpscRingBuffer *ring, Equalizer *equalizer, int bytesPerFrame, QObject *parent)
+        : QIODevice(parent), ring(ring), equalizer(equalizer), bytesPerFrame(bytesPerFrame)
+    {
+        open(QIODevice::ReadOnly);
+    }
+
+    bool isSequential() const override { return true; }
+
+    void resetCounters()
+    {
+        framesPlayed.store(0);
+        primed.store(false);
+        inputEnded.store(false);
+    }
+
+    SpscRingBuffer *ring;
+    Equalizer *equalizer;
+    std::atomic<int> bytesPerFrame;
+    std::atomic<qint64> framesPlayed { 0 };
+    std::atomic<qint64> underruns { 0 };
+    std::atomic<bool> primed { false };     // 已取到过数据，此前的静音不算欠载
+    std::atomic<bool> inputEnded { false }; // 解码已结束，缓冲区取空是正常结束
+    std::atomic<SpectrumAnalyzer *> spectrum { nullptr };
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        const int frame = bytesPerFrame.load(std::memory_order_relaxed);
+        const qint64 wanted = maxSize - maxSize % frame;
+        const qint64 got = ring->read(data, wanted);
+        if (got > 0) {
+            framesPlayed.fetch_add(got / frame, std::memory_order_relaxed);
+            primed.store(true, std::memory_order_relaxed);
+            equalizer->process(reinterpret_cast<float *>(data), got / frame, frame / int(sizeof(float)));
+            if (SpectrumAnalyzer *analyzer = spectrum.load(std::memory_order_relaxed)) {
+                analyzer->feed(reinterpret_cast<const float *>(data), got / frame);
+            }
+        }
+        if (got < wanted) {
+            if (primed.load(std::memory_order_relaxed) && !inputEnded.load(std::memory_order_relaxed)) {
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            memset(data + got, 0, size_t(wanted - got));
+        }
+        // 始终返回完整长度，声卡不会因为暂时没有数据进入空闲状态
+        return wanted;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+        return -1;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// PcmDecoder（解码线程）
+// ---------------------------------------------------------------------------
+
+PcmDecoder::PcmDecoder(SpscRingBuffer *ring, const QAudioFormat &format)
+    : ring(ring), format(format)
+{
+}
+
+void PcmDecoder::start(const QUrl &url, QIODevice *device, qint64 positionMs)
+{
+    reset(generation);
+
+    if (!pumpTimer) {
+        pumpTimer = new QTimer(this);
+        pumpTimer->setInterval(kPumpIntervalMs);
+        connect(pumpTimer, &QTimer::timeout, this, &PcmDecoder::pump);
+    }
+
+    decoder = openDecoder(url, device);
+    currentUrl = url;
+    skipUntilUs = positionMs * 1000;
+    active = true;
+    if (positionMs == 0) {
+        analyzer.reset(new LoudnessAnalyzer(format.sampleRate(), format.channelCount()));
+        waveform.reset(new WaveformBuilder(format.sampleRate(), format.channelCount()));
+    }
+
+    emit trackStarted(generation, url, framesStaged, positionMs);
+    decoder->start();
+    pumpTimer->start();
+}
+
+void PcmDecoder::queueNext(const QUrl &url)
+{
+    releaseDecoder(nextDecoder);
+    nextHead.clear();
+    nextUrl = url;
+    nextDone = false;
+    nextDurationMs = 0;
+
+    // 立即打开并预先解码开头，切换时不必等待打开文件或网络
+    nextDecoder = openDecoder(url, nullptr);
+    nextDecoder->start();
+
+    if (!active && sourceDone) {
+        // 当前曲目已全部输出：直接接上
+        active = true;
+        transition();
+        pumpTimer->start();
+    }
+}
+
+void PcmDecoder::reset(quint64 newGeneration)
+{
+    generation = newGeneration;
+    releaseDecoder(decoder);
+    releaseDecoder(nextDecoder);
+    if (pumpTimer) pumpTimer->stop();
+    analyzer.reset();
+    waveform.reset();
+    currentUrl.clear();
+    nextUrl.clear();
+    nextHead.clear();
+    staged.clear();
+    stagedOffset = 0;
+    framesStaged = 0;
+    if (tail) tail->reset();
+    fadingTail.clear();
+    fadePosition = 0;
+    decodedUs = 0;
+    skipUntilUs = 0;
+    sourceDone = false;
+    nextDone = false;
+    active = false;
+    ring->reset();
+}
+
+void PcmDecoder::setFormat(const QAudioFormat &newFormat)
+{
+    const int crossfadeMs = int(crossfadeFrames * 1000 / format.sampleRate());
+    format = newFormat;
+    setCrossfade(crossfadeMs); // 按新采样率重新计算淡化长度
+}
+
+void PcmDecoder::setCrossfade(int milliseconds)
+{
+    // 正在保留的末尾先原样输出，新的长度从下一次切换开始生效
+    drainTail();
+    crossfadeFrames = qint64(milliseconds) * format.sampleRate() / 1000;
+    tail.reset(crossfadeFrames > 0
+               ? new SpscRingBuffer(format.bytesForFrames(int(crossfadeFrames)))
+               : nullptr);
+}
+
+QAudioDecoder *PcmDecoder::openDecoder(const QUrl &url, QIODevice *device)
+{
+    // 每首曲目使用新的解码器，旧解码器排队中的数据不会混进来
+    QAudioDecoder *created = new QAudioDecoder(this);
+    created->setAudioFormat(format);
+    connect(created, &QAudioDecoder::bufferReady, this, [this, created]() {
+        if (created == decoder) pump();
+        else if (created == nextDecoder) prerollNext();
+    });
+    connect(created, &QAudioDecoder::finished, this, [this, created]() {
+        if (created == decoder) {
+            sourceDone = true;
+            pump();
+        } else if (created == nextDecoder) {
+            nextDone = true;
+            prerollNext();
+        }
+    });
+    connect(created, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, [this, created]() {
+        if (created == nextDecoder) {
+            const QString message = created->errorString();
+            releaseDecoder(nextDecoder);
+            nextUrl.clear();
+            nextHead.clear();
+            drainTail();
+            emit nextFailed(generation, message);
+        } else if (created == decoder) {
+            emit decodeError(generation, created->errorString());
+        }
+    });
+    connect(created, &QAudioDecoder::durationChanged, this, [this, created](qint64 duration) {
+        if (created == decoder) emit durationChanged(generation, duration);
+        else if (created == nextDecoder) nextDurationMs = duration;
+    });
+
+    if (device) {
+        created->setSourceDevice(device);
+    } else {
+        created->setSource(url);
+    }
+    return created;
+}
+
+void PcmDecoder::releaseDecoder(QAudioDecoder *&target)
+{
+    if (!target) return;
+    target->disconnect(this);
+    target->stop();
+    target->deleteLater();
+    target = nullptr;
+}
+
+bool PcmDecoder::acceptBuffer(const QAudioBuffer &buffer)
+{
+    if (buffer.format() == format) return true;
+    emit decodeError(generation, QString("解码输出格式不受支持: %1 Hz, %2 声道")
+                         .arg(buffer.format().sampleRate()).arg(buffer.format().channelCount()));
+    releaseDecoder(decoder);
+    active = false;
+    return false;
+}
+
+void PcmDecoder::pump()
+{
+    if (!active) return;
+    const int channels = format.channelCount();
+
+    bool flushed = true;
+    while ((flushed = flushStaged())) {
+        if (!decoder || !decoder->bufferAvailable()) break;
+        const QAudioBuffer buffer = decoder->read();
+        if (!buffer.isValid()) break;
+        if (!acceptBuffer(buffer)) return;
+
+        const qint64 startUs = buffer.startTime() >= 0 ? buffer.startTime() : decodedUs;
+        decodedUs = startUs + buffer.duration();
+        const float *samples = buffer.constData<float>();
+        qint64 frames = buffer.frameCount();
+
+        // QAudioDecoder 不支持跳转：从头解码，丢弃目标位置之前的采样
+        if (skipUntilUs > 0) {
+            const qint64 skipFrames = (skipUntilUs - startUs) * format.sampleRate() / 1000000;
+            if (skipFrames >= frames) continue;
+            if (skipFrames > 0) {
+                samples += skipFrames * channels;
+                frames -= skipFrames;
+            }
+            skipUntilUs = 0;
+        }
+        if (analyzer) analyzer->process(samples, frames);
+        if (waveform) waveform->process(samples, frames);
+        stageSamples(samples, frames);
+    }
+
+    if (!flushed) return; // 环形缓冲区已满
+    if (!sourceDone || (decoder && decoder->bufferAvailable())) return;
+    finishAnalysis();
+
+    if (nextDecoder) {
+        transition();
+        pump();
+        return;
+    }
+
+    // 没有下一曲：淡出中的末尾和保留的末尾原样输出后结束
+    if (fadePosition < qint64(fadingTail.size()) / channels) {
+        const std::vector<float> silence(fadingTail.size() - size_t(fadePosition * channels), 0.0f);
+        stageSamples(silence.data(), qint64(silence.size()) / channels);
+    }
+    drainTail();
+    if (!flushStaged()) return;
+    active = false;
+    pumpTimer->stop();
+    emit finished(generation, framesStaged);
+}
+
+void PcmDecoder::prerollNext()
+{
+    if (!nextDecoder) return;
+    const int channels = format.channelCount();
+    // 预解码淡化长度加上打开下一曲所需的余量，其余留在解码器中按需读取
+    const qint64 limit = (crossfadeFrames + format.framesForDuration(kPrerollMs * 1000)) * channels;
+    while (qint64(nextHead.size()) < limit && nextDecoder->bufferAvailable()) {
+        const QAudioBuffer buffer = nextDecoder->read();
+        if (!buffer.isValid()) break;
+        if (buffer.format() != format) break;
+        const float *samples = buffer.constData<float>();
+        nextHead.insert(nextHead.end(), samples, samples + buffer.frameCount() * channels);
+    }
+}
+
+void PcmDecoder::transition()
+{
+    const int channels = format.channelCount();
+    prerollNext();
+
+    // 保留的末尾开始淡出，与下一曲开头重叠
+    fadingTail.clear();
+    fadePosition = 0;
+    if (tail && tail->readAvailable() > 0) {
+        fadingTail.resize(size_t(tail->readAvailable() / qint64(sizeof(float))));
+        tail->read(reinterpret_cast<char *>(fadingTail.data()), qint64(fadingTail.size() * sizeof(float)));
+    }
+
+    releaseDecoder(decoder);
+    decoder = nextDecoder;
+    nextDecoder = nullptr;
+    currentUrl = nextUrl;
+    nextUrl.clear();
+    sourceDone = nextDone;
+    nextDone = false;
+    decodedUs = 0;
+
+    emit trackStarted(generation, currentUrl, framesStaged, 0);
+    if (nextDurationMs > 0) emit durationChanged(generation, nextDurationMs);
+
+    std::vector<float> head;
+    head.swap(nextHead);
+    analyzer.reset(new LoudnessAnalyzer(format.sampleRate(), channels));
+    analyzer->process(head.data(), qint64(head.size()) / channels);
+    waveform.reset(new WaveformBuilder(format.sampleRate(), channels));
+    waveform->process(head.data(), qint64(head.size()) / channels);
+    stageSamples(head.data(), qint64(head.size()) / channels);
+}
+
+void PcmDecoder::stageSamples(const float *samples, qint64 frames)
+{
+    const int channels = format.channelCount();
+
+    // 上一曲末尾淡出，本曲开头淡入
+    const qint64 fadeFrames = qint64(fadingTail.size()) / channels;
+    if (fadePosition < fadeFrames && frames > 0) {
+        const qint64 count = qMin(frames, fadeFrames - fadePosition);
+        const size_t offset = staged.size();
+        staged.resize(offset + size_t(count * channels));
+        GainRamp::crossfade(staged.data() + offset, fadingTail.data() + fadePosition * channels, samples,
+                            count, channels, fadePosition, fadeFrames);
+        fadePosition += count;
+        framesStaged += count;
+        samples += count * channels;
+        frames -= count;
+        if (fadePosition >= fadeFrames) {
+            fadingTail.clear();
+            fadePosition = 0;
+        }
+    }
+    if (frames <= 0) return;
+
+    if (!holdingTail()) {
+        drainTail();
+        staged.insert(staged.end(), samples, samples + frames * channels);
+        framesStaged += frames;
+        return;
+    }
+
+    // 保留最后 crossfadeFrames 帧：放不下时先输出最早的部分
+    const qint64 bytes = frames * channels * qint64(sizeof(float));
+    const qint64 overflow = bytes - tail->writeAvailable();
+    if (overflow > 0) {
+        const qint64 evicted = qMin(overflow, tail->readAvailable());
+        const size_t offset = staged.size();
+        staged.resize(offset + size_t(evicted / qint64(sizeof(float))));
+        tail->read(reinterpret_cast<char *>(staged.data() + offset), evicted);
+        framesStaged += evicted / (channels * qint64(sizeof(float)));
+    }
+    const qint64 direct = qMax<qint64>(0, bytes - tail->writeAvailable());
+    if (direct > 0) {
+        // 单个解码块比淡化长度还长：前面的部分直接输出
+        const qint64 directFrames = direct / (channels * qint64(sizeof(float)));
+        staged.insert(staged.end(), samples, samples + directFrames * channels);
+        framesStaged += directFrames;
+        samples += directFrames * channels;
+        frames -= directFrames;
+    }
+    tail->write(reinterpret_cast<const char *>(samples), frames * channels * qint64(sizeof(float)));
+}
+
+void PcmDecoder::drainTail()
+{
+    if (!tail || tail->readAvailable() == 0) return;
+    const size_t offset = staged.size();
+    const qint64 bytes = tail->readAvailable();
+    staged.resize(offset + size_t(bytes / qint64(sizeof(float))));
+    tail->read(reinterpret_cast<char *>(staged.data() + offset), bytes);
+    framesStaged += bytes / (format.channelCount() * qint64(sizeof(float)));
+}
+
+bool PcmDecoder::flushStaged()
+{
+    const qint64 total = qint64(staged.size() * sizeof(float));
+    if (stagedOffset < total) {
+        const int bytesPerFrame = format.bytesPerFrame();
+        const qint64 space = ring->writeAvailable();
+        const qint64 count = qMin(total - stagedOffset, space - space % bytesPerFrame);
+        if (count > 0) {
+            ring->write(reinterpret_cast<const char *>(staged.data()) + stagedOffset, count);
+            stagedOffset += count;
+        }
+        if (stagedOffset < total) return false;
+    }
+    staged.clear();
+    stagedOffset = 0;
+    return true;
+}
+
+bool PcmDecoder::holdingTail() const
+{
+    return tail && nextDecoder;
+}
+
+void PcmDecoder::finishAnalysis()
+{
+    // 波形先于响度报告：界面收到响度后即丢弃该地址与曲目的对应关系
+    if (waveform && waveform->framesProcessed() > 0) {
+        emit waveformMeasured(currentUrl, waveform->result());
+    }
+    if (analyzer && analyzer->hasResult()) {
+        emit loudnessMeasured(currentUrl, analyzer->integratedLoudness());
+    }
+    analyzer.reset();
+    waveform.reset();
+}
+
+// ---------------------------------------------------------------------------
+// PcmAudioEngine（界面线程）
+// ---------------------------------------------------------------------------
+
+PcmAudioEngine::PcmAudioEngine(QObject *parent)
+    : AudioEngine(parent),
+      format(preferredFormat(QMediaDevices::defaultAudioOutput())),
+      ring(kRingBytes),
+      outputDevice(QMediaDevices::defaultAudioOutput())
+{
+    decoder = new PcmDecoder(&ring, format);
+    decoder->moveToThread(&decodeThread);
+    connect(&decodeThread, &QThread::finished, decoder, &QObject::deleteLater);
+    connect(decoder, &PcmDecoder::trackStarted, this, &PcmAudioEngine::onTrackStarted);
+    connect(decoder, &PcmDecoder::durationChanged, this, &PcmAudioEngine::onDecoderDuration);
+    connect(decoder, &PcmDecoder::finished, this, &PcmAudioEngine::onDecodeFinished);
+    connect(decoder, &PcmDecoder::decodeError, this, &PcmAudioEngine::onDecodeError);
+    connect(decoder, &PcmDecoder::nextFailed, this, &PcmAudioEngine::onNextFailed);
+    connect(decoder, &PcmDecoder::loudnessMeasured, this, &AudioEngine::loudnessMeasured);
+    connect(decoder, &PcmDecoder::waveformMeasured, this, &AudioEngine::waveformMeasured);
+    decodeThread.setObjectName("melody-pcm-decoder");
+    decodeThread.start();
+
+    equalizer.setSampleRate(format.sampleRate());
+    sinkDevice = new PcmSinkDevice(&ring, &equalizer, format.bytesPerFrame(), this);
+
+    tickTimer = new QTimer(this);
+    tickTimer->setInterval(kTickIntervalMs);
+    connect(tickTimer, &QTimer::timeout, this, &PcmAudioEngine::tick);
+}
+
+PcmAudioEngine::~PcmAudioEngine()
+{
+    stopSink();
+    decodeThread.quit();
+    decodeThread.wait();
+}
+
+QAudioFormat PcmAudioEngine::preferredFormat(const QAudioDevice &device)
+{
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::Float);
+    format.setChannelCount(2);
+    format.setChannelConfig(QAudioFormat::ChannelConfigStereo);
+    const int rate = device.isNull() ? 0 : device.preferredFormat().sampleRate();
+    format.setSampleRate(rate > 0 ? rate : 48000);
+    return format;
+}
+
+QString PcmAudioEngine::name() const
+{
+    return "pcm";
+}
+
+void PcmAudioEngine::setSource(const QUrl &url)
+{
+    openSource(url, nullptr);
+}
+
+void PcmAudioEngine::setSourceDevice(QIODevice *device, const QUrl &sourceUrl)
+{
+    openSource(sourceUrl, device);
+}
+
+void PcmAudioEngine::openSource(const QUrl &url, QIODevice *device)
+{
+    stopSink();
+    flush();
+    currentSource = url;
+    currentDevice = device;
+    needsRestart = false;
+    lastPosition = 0;
+    emit positionChanged(0);
+    emit durationChanged(0);
+    setState(QMediaPlayer::StoppedState);
+
+    if (url.isEmpty() && !device) {
+        setStatus(QMediaPlayer::NoMedia);
+        return;
+    }
+    setStatus(QMediaPlayer::LoadingMedia);
+    restartDecoding(0);
+}
+
+QUrl PcmAudioEngine::source() const
+{
+    return currentSource;
+}
+
+void PcmAudioEngine::play()
+{
+    if (currentSource.isEmpty() && !currentDevice) return;
+    if (needsRestart) {
+        needsRestart = false;
+        flush();
+        restartDecoding(0);
+    }
+    startSink();
+    setState(QMediaPlayer::PlayingState);
+}
+
+void PcmAudioEngine::pause()
+{
+    if (state != QMediaPlayer::PlayingState) return;
+    if (sink) sink->suspend();
+    setState(QMediaPlayer::PausedState);
+}
+
+void PcmAudioEngine::stop()
+{
+    if (state == QMediaPlayer::StoppedState) return;
+    stopSink();
+    flush();
+    needsRestart = true;
+    lastPosition = 0;
+    emit positionChanged(0);
+    setState(QMediaPlayer::StoppedState);
+}
+
+qint64 PcmAudioEngine::position() const
+{
+    return lastPosition;
+}
+
+qint64 PcmAudioEngine::duration() const
+{
+    if (currentBoundary < 0 || currentBoundary >= boundaries.size()) return 0;
+    return boundaries[currentBoundary].durationMs;
+}
+
+void PcmAudioEngine::setPosition(qint64 position)
+{
+    if (currentSource.isEmpty() && !currentDevice) return;
+
+    const qint64 durationMs = duration();
+    stopSink();
+    flush();
+    needsRestart = false;
+    restartDecoding(qMax<qint64>(0, position));
+    // 新边界到达前沿用已知时长
+    TrackBoundary boundary;
+    boundary.url = currentSource;
+    boundary.offsetMs = qMax<qint64>(0, position);
+    boundary.durationMs = durationMs;
+    boundaries.append(boundary);
+    currentBoundary = 0;
+
+    lastPosition = boundary.offsetMs;
+    emit positionChanged(lastPosition);
+    if (state == QMediaPlayer::PlayingState) {
+        startSink();
+    }
+}
+
+QMediaPlayer::PlaybackState PcmAudioEngine::playbackState() const
+{
+    return state;
+}
+
+QMediaPlayer::MediaStatus PcmAudioEngine::mediaStatus() const
+{
+    return status;
+}
+
+void PcmAudioEngine::setVolume(float volume)
+{
+    outputVolume = volume;
+    if (sink) sink->setVolume(effectiveVolume(volume));
+}
+
+float PcmAudioEngine::volume() const
+{
+    return outputVolume;
+}
+
+void PcmAudioEngine::setAudioDevice(const QAudioDevice &device)
+{
+    if (device == outputDevice) return;
+    outputDevice = device;
+    if (!sink) return;
+
+    // 只重建输出端，缓冲区中的采样继续播放
+    delete sink;
+    sink = nullptr;
+
+    if (!device.isNull() && !device.isFormatSupported(format)) {
+        // 新设备不支持当前采样率：按新格式从当前位置重新解码
+        format = preferredFormat(device);
+        sinkDevice->bytesPerFrame.store(format.bytesPerFrame());
+        equalizer.setSampleRate(format.sampleRate());
+        if (spectrum) spectrum->setFormat(format.sampleRate(), format.channelCount());
+        // 排在随后的清空和重新解码之前执行
+        QMetaObject::invokeMethod(decoder, [this, newFormat = format]() { decoder->setFormat(newFormat); },
+                                  Qt::QueuedConnection);
+        setPosition(lastPosition);
+    } else if (state == QMediaPlayer::PlayingState) {
+        startSink();
+    }
+}
+
+QAudioDevice PcmAudioEngine::audioDevice() const
+{
+    return outputDevice;
+}
+
+bool PcmAudioEngine::supportsGapless() const
+{
+    return true;
+}
+
+void PcmAudioEngine::setNextSource(const QUrl &url)
+{
+    if (url.isEmpty()) return;
+    nextQueued = true;
+    sinkDevice->inputEnded.store(false);
+    QMetaObject::invokeMethod(decoder, [this, url]() { decoder->queueNext(url); }, Qt::QueuedConnection);
+}
+
+void PcmAudioEngine::setCrossfadeDuration(int milliseconds)
+{
+    crossfadeMs = qMax(0, milliseconds);
+    QMetaObject::invokeMethod(decoder, [this, ms = crossfadeMs]() { decoder->setCrossfade(ms); },
+                              Qt::QueuedConnection);
+}
+
+int PcmAudioEngine::crossfadeDuration() const
+{
+    return crossfadeMs;
+}
+
+qint64 PcmAudioEngine::underrunCount() const
+{
+    return sinkDevice->underruns.load();
+}
+
+bool PcmAudioEngine::measuresLoudness() const
+{
+    return true;
+}
+
+bool PcmAudioEngine::providesSpectrum() const
+{
+    return true;
+}
+
+void PcmAudioEngine::setSpectrumAnalyzer(SpectrumAnalyzer *analyzer)
+{
+    spectrum = analyzer;
+    if (spectrum) spectrum->setFormat(format.sampleRate(), format.channelCount());
+    sinkDevice->spectrum.store(analyzer);
+}
+
+bool PcmAudioEngine::supportsEqualizer() const
+{
+    return true;
+}
+
+void PcmAudioEngine::setEqualizerGains(const QVector<float> &gainsDb)
+{
+    equalizer.setGains(gainsDb);
+}
+
+void PcmAudioEngine::onTrackStarted(quint64 generation, const QUrl &url, qint64 startFrame, qint64 offsetMs)
+{
+    if (generation != this->generation.load()) return;
+    // setPosition 预先放入的边界由解码线程的实际边界替换
+    if (boundaries.size() == 1 && currentBoundary == 0 && boundaries[0].startFrame == 0 && startFrame == 0) {
+        boundaries[0].url = url;
+        boundaries[0].offsetMs = offsetMs;
+    } else {
+        TrackBoundary boundary;
+        boundary.url = url;
+        boundary.startFrame = startFrame;
+        boundary.offsetMs = offsetMs;
+        boundaries.append(boundary);
+    }
+    if (currentBoundary < 0) {
+        currentBoundary = 0;
+        setStatus(QMediaPlayer::LoadedMedia);
+    }
+    endFrame = -1;
+    tickTimer->start();
+    if (!decoderReady) {
+        // 缓冲区已被解码线程清空，等待中的播放现在可以开始
+        decoderReady = true;
+        if (state == QMediaPlayer::PlayingState) startSink();
+    }
+}
+
+void PcmAudioEngine::onDecoderDuration(quint64 generation, qint64 duration)
+{
+    if (generation != this->generation.load() || boundaries.isEmpty() || duration <= 0) return;
+    boundaries.last().durationMs = duration;
+    if (currentBoundary == boundaries.size() - 1) {
+        emit durationChanged(duration);
+    }
+}
+
+void PcmAudioEngine::onDecodeFinished(quint64 generation, qint64 totalFrames)
+{
+    if (generation != this->generation.load()) return;
+    endFrame = totalFrames;
+    if (!nextQueued) {
+        sinkDevice->inputEnded.store(true);
+    }
+}
+
+void PcmAudioEngine::onDecodeError(quint64 generation, const QString &message)
+{
+    if (generation != this->generation.load()) return;
+    qCWarning(lcPlayback) << "PCM decode error:" << message;
+    stopSink();
+    flush();
+    setState(QMediaPlayer::StoppedState);
+    setStatus(QMediaPlayer::InvalidMedia);
+    emit errorOccurred(QMediaPlayer::ResourceError, message);
+}
+
+void PcmAudioEngine::onNextFailed(quint64 generation, const QString &message)
+{
+    if (generation != this->generation.load()) return;
+    // 下一曲打不开：当前曲目照常以 EndOfMedia 结束，由调用方按普通方式切歌
+    qCWarning(lcPlayback) << "PCM next track failed:" << message;
+    nextQueued = false;
+    if (endFrame >= 0) {
+        sinkDevice->inputEnded.store(true);
+    }
+}
+
+void PcmAudioEngine::tick()
+{
+    if (boundaries.isEmpty()) return;
+    const qint64 played = playedFrames();
+
+    // 进入下一曲：采样早已无缝接上，这里只更新对外的状态
+    while (currentBoundary + 1 < boundaries.size() && boundaries[currentBoundary + 1].startFrame <= played) {
+        currentBoundary++;
+        nextQueued = false;
+        currentSource = boundaries[currentBoundary].url;
+        currentDevice = nullptr;
+        emit nextSourceStarted(currentSource);
+        emit durationChanged(boundaries[currentBoundary].durationMs);
+    }
+
+    const TrackBoundary &boundary = boundaries[currentBoundary];
+    const qint64 position = boundary.offsetMs + framesToMs(qMax<qint64>(0, played - boundary.startFrame));
+    if (position != lastPosition) {
+        lastPosition = position;
+        emit positionChanged(position);
+    }
+
+    // 欠载：计入指标，并按 QMediaPlayer 的约定报告 StalledMedia
+    const qint64 underruns = sinkDevice->underruns.load();
+    if (underruns != reportedUnderruns) {
+        Metrics::increment("audio_underruns_total", { { "engine", name() } }, underruns - reportedUnderruns);
+        reportedUnderruns = underruns;
+        if (state == QMediaPlayer::PlayingState) setStatus(QMediaPlayer::StalledMedia);
+    } else if (ring.readAvailable() > 0 && state == QMediaPlayer::PlayingState) {
+        setStatus(QMediaPlayer::BufferedMedia);
+    }
+
+    if (endFrame >= 0 && !nextQueued && played >= endFrame && state == QMediaPlayer::PlayingState) {
+        stopSink();
+        needsRestart = true;
+        tickTimer->stop();
+        setState(QMediaPlayer::StoppedState);
+        setStatus(QMediaPlayer::EndOfMedia);
+    }
+}
+
+void PcmAudioEngine::flush()
+{
+    // 不阻塞界面线程：声卡已停止，在解码线程报告新代次的 trackStarted 之前不会再启动
+    const quint64 current = ++generation;
+    QMetaObject::invokeMethod(decoder, [this, current]() { decoder->reset(current); }, Qt::QueuedConnection);
+    decoderReady = false;
+    sinkDevice->resetCounters();
+    boundaries.clear();
+    currentBoundary = -1;
+    endFrame = -1;
+    nextQueued = false;
+}
+
+void PcmAudioEngine::restartDecoding(qint64 positionMs)
+{
+    if (currentDevice) {
+        currentDevice->seek(0);
+    }
+    const QUrl url = currentSource;
+    QIODevice *device = currentDevice;
+    const quint64 current = generation.load();
+    QMetaObject::invokeMethod(decoder, [this, url, device, positionMs, current]() {
+        // 连续跳转时排队的启动请求已过时，只解码最后一次
+        if (current != generation.load()) return;
+        decoder->start(url, device, positionMs);
+    }, Qt::QueuedConnection);
+}
+
+void PcmAudioEngine::startSink()
+{
+    if (!decoderReady) return; // 由 onTrackStarted 启动
+    if (!sink) {
+        sink = new QAudioSink(outputDevice, format, this);
+        sink->setBufferSize(format.bytesForDuration(kSinkBufferMs * 1000));
+        sink->setVolume(effectiveVolume(outputVolume));
+    }
+    if (sink->state() == QAudio::SuspendedState) {
+        sink->resume();
+    } else if (sink->state() == QAudio::StoppedState || sink->state() == QAudio::IdleState) {
+        sink->start(sinkDevice);
+    }
+    tickTimer->start();
+}
+
+void PcmAudioEngine::stopSink()
+{
+    if (sink) sink->stop();
+}
+
+void PcmAudioEngine::setState(QMediaPlayer::PlaybackState newState)
+{
+    if (state == newState) return;
+    state = newState;
+    emit playbackStateChanged(state);
+}
+
+void PcmAudioEngine::setStatus(QMediaPlayer::MediaStatus newStatus)
+{
+    if (status == newStatus) return;
+    status = newStatus;
+    emit mediaStatusChanged(status);
+}
+
+qint64 PcmAudioEngine::playedFrames() const
+{
+    qint64 frames = sinkDevice->framesPlayed.load();
+    if (sink && sink->state() == QAudio::ActiveState) {
+        // 已交给声卡但还在声卡缓冲区中的部分尚未播出
+        frames -= (sink->bufferSize() - sink->bytesFree()) / format.bytesPerFrame();
+    }
+    return qMax<qint64>(0, frames);
+}
+
+qint64 PcmAudioEngine::framesToMs(qint64 frames) const
+{
+    return frames * 1000 / format.sampleRate();
+}
@@ -0,0 +1,196 @@
+#ifndef PCMAUDIOENGINE_H
+#define PCMAUDIOENGINE_H
+
+#include "audioengine.h"
+#include "equalizer.h"
+#include "loudnessanalyzer.h"
+#include "spscringbuffer.h"
+#include "waveform.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QList>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class QAudioDecoder;
+class QAudioSink;
+class QTimer;
+class PcmSinkDevice;
+
+// 解码线程：用 QAudioDecoder 解码为引擎的 PCM 格式并写入环形缓冲区。
+// 设置下一曲后立即打开它并预先解码开头一段；当前曲目解码完后直接接着写入下一曲的采样，
+// 实现无缝衔接。开启交叉淡化时保留当前曲目末尾一段，与下一曲的开头混音后再写入。
+// 从头开始解码的曲目同时测量响度、计算波形概览，解码完毕时报告。
+// 每次 reset 带一个代次，信号都附带它，界面线程据此丢弃清空之前排队的旧信号
+class PcmDecoder : public QObject
+{
+    Q_OBJECT
+public:
+    PcmDecoder(SpscRingBuffer *ring, const QAudioFormat &format);
+
+public slots:
+    void start(const QUrl &url, QIODevice *device, qint64 positionMs);
+    void queueNext(const QUrl &url);
+    void reset(quint64 newGeneration); // 停止解码并清空环形缓冲区，调用时声卡不得在读取
+    void setFormat(const QAudioFormat &format);
+    void setCrossfade(int milliseconds);
+
+signals:
+    // 曲目的第一个采样写入环形缓冲区的位置（自上次 reset 起的帧数）
+    void trackStarted(quint64 generation, const QUrl &url, qint64 startFrame, qint64 offsetMs);
+    void durationChanged(quint64 generation, qint64 duration); // 当前曲目的时长
+    void finished(quint64 generation, qint64 totalFrames);     // 全部曲目解码完毕
+    void decodeError(quint64 generation, const QString &message);
+    void nextFailed(quint64 generation, const QString &message); // 下一曲无法打开，当前曲目照常结束
+    void loudnessMeasured(const QUrl &url, double lufs);
+    void waveformMeasured(const QUrl &url, const Waveform &waveform);
+
+private:
+    QAudioDecoder *openDecoder(const QUrl &url, QIODevice *device);
+    void releaseDecoder(QAudioDecoder *&target);
+    bool acceptBuffer(const QAudioBuffer &buffer);
+    void pump();          // 把解码结果写入环形缓冲区，空间不足时等下次定时器再写
+    void prerollNext();   // 预先解码下一曲的开头
+    void transition();    // 当前曲目解码完毕，切换到下一曲
+    void stageSamples(const float *samples, qint64 frames);
+    void drainTail();
+    bool flushStaged();   // 写入环形缓冲区，全部写完时返回 true
+    bool holdingTail() const;
+    void finishAnalysis(); // 当前曲目解码完毕：报告响度和波形
+
+    SpscRingBuffer *ring;
+    QAudioFormat format;
+    QTimer *pumpTimer = nullptr;
+    quint64 generation = 0;
+
+    QAudioDecoder *decoder = nullptr;
+    QUrl currentUrl;
+    bool sourceDone = false;
+    bool active = false;
+    qint64 skipUntilUs = 0;     // 跳转：丢弃此时间之前的采样
+    qint64 decodedUs = 0;       // 解码块没有时间戳时按帧数累计
+
+    QAudioDecoder *nextDecoder = nullptr;
+    QUrl nextUrl;
+    bool nextDone = false;
+    qint64 nextDurationMs = 0;
+    std::vector<float> nextHead; // 预先解码的下一曲开头
+
+    std::vector<float> staged;  // 待写入环形缓冲区的采样
+    qint64 stagedOffset = 0;
+    qint64 framesStaged = 0;    // 自上次 reset 起输出的帧数
+
+    // 交叉淡化
+    qint64 crossfadeFrames = 0;
+    std::unique_ptr<SpscRingBuffer> tail; // 当前曲目最后 crossfadeFrames 帧，延后输出
+    std::vector<float> fadingTail;   // 正在淡出的上一曲末尾
+    qint64 fadePosition = 0;
+
+    std::unique_ptr<LoudnessAnalyzer> analyzer; // 跳转后开始的曲目不测量
+    std::unique_ptr<WaveformBuilder> waveform;  // 同上
+};
+
+// 自行解码并输出 PCM 的播放引擎：
+// 解码线程 -> 无锁环形缓冲区 -> QAudioSink（拉模式）。
+// 声卡回调只读环形缓冲区和原子计数，不加锁；取不到数据时补静音并计一次欠载。
+// 切换输出设备只重建 QAudioSink，缓冲区中的数据保留，不会重新解码
+class PcmAudioEngine : public AudioEngine
+{
+    Q_OBJECT
+public:
+    explicit PcmAudioEngine(QObject *parent = nullptr);
+    ~PcmAudioEngine() override;
+
+    QString name() const override;
+
+    void setSource(const QUrl &url) override;
+    void setSourceDevice(QIODevice *device, const QUrl &sourceUrl = QUrl()) override;
+    QUrl source() const override;
+
+    void play() override;
+    void pause() override;
+    void stop() override;
+
+    qint64 position() const override;
+    qint64 duration() const override;
+    void setPosition(qint64 position) override;
+
+    QMediaPlayer::PlaybackState playbackState() const override;
+    QMediaPlayer::MediaStatus mediaStatus() const override;
+
+    void setVolume(float volume) override;
+    float volume() const override;
+    void setAudioDevice(const QAudioDevice &device) override;
+    QAudioDevice audioDevice() const override;
+
+    bool supportsGapless() const override;
+    void setNextSource(const QUrl &url) override;
+    void setCrossfadeDuration(int milliseconds) override;
+    int crossfadeDuration() const override;
+    qint64 underrunCount() const override;
+    bool measuresLoudness() const override;
+    bool providesSpectrum() const override;
+    void setSpectrumAnalyzer(SpectrumAnalyzer *analyzer) override;
+    bool supportsEqualizer() const override;
+    void setEqualizerGains(const QVector<float> &gainsDb) override;
+
+private slots:
+    void onTrackStarted(quint64 generation, const QUrl &url, qint64 startFrame, qint64 offsetMs);
+    void onDecoderDuration(quint64 generation, qint64 duration);
+    void onDecodeFinished(quint64 generation, qint64 totalFrames);
+    void onDecodeError(quint64 generation, const QString &message);
+    void onNextFailed(quint64 generation, const QString &message);
+    void tick();
+
+private:
+    struct TrackBoundary {
+        QUrl url;
+        qint64 startFrame = 0;
+        qint64 offsetMs = 0;
+        qint64 durationMs = 0;
+    };
+
+    static QAudioFormat preferredFormat(const QAudioDevice &device);
+
+    void openSource(const QUrl &url, QIODevice *device);
+    void flush();                           // 停止解码、清空缓冲区和曲目边界（不等待解码线程）
+    void restartDecoding(qint64 positionMs);
+    void startSink();
+    void stopSink();
+    void setState(QMediaPlayer::PlaybackState newState);
+    void setStatus(QMediaPlayer::MediaStatus newStatus);
+    qint64 playedFrames() const;            // 扣除声卡缓冲后实际播出的帧数
+    qint64 framesToMs(qint64 frames) const;
+
+    QAudioFormat format;
+    SpscRingBuffer ring;
+    QThread decodeThread;
+    PcmDecoder *decoder;
+    PcmSinkDevice *sinkDevice;
+    QAudioSink *sink = nullptr;
+    QAudioDevice outputDevice;
+    float outputVolume = 1.0f;
+    SpectrumAnalyzer *spectrum = nullptr;
+    Equalizer equalizer; // 在声卡回调中处理，界面线程只写目标增益
+    int crossfadeMs = 0;
+    QTimer *tickTimer;
+
+    QUrl currentSource;
+    QIODevice *currentDevice = nullptr;
+    QList<TrackBoundary> boundaries;
+    int currentBoundary = -1;
+    qint64 endFrame = -1;       // 解码结束时已写入的帧数
+    qint64 lastPosition = 0;
+    qint64 reportedUnderruns = 0;
+    bool nextQueued = false;
+    bool needsRestart = false;  // 停止或播放结束后再次播放需要从头解码
+    bool decoderReady = true;   // 解码线程已处理最近一次清空，此前声卡不能启动，否则会播出旧数据
+    std::atomic<quint64> generation { 0 }; // 每次清空加一；解码线程据此跳过已过时的启动请求
+
+    QMediaPlayer::PlaybackState state = QMediaPlayer::StoppedState;
+    QMediaPlayer::MediaStatus status = QMediaPlayer::NoMedia;
+};
+
+#endif // PCMAUDIOENGINE_H
@@ -0,0 +1,77 @@
+#include "pinyin.h"
+#include <QCollator>
+#include <QHash>
+#include <QLocale>
+
+namespace {
+
+// 各声母在拼音排序中的第一个汉字（i、u、v 不作声母）
+const char16_t kBoundaries[] = u"阿八嚓哒妸发旮哈讥咔垃痳拏噢妑七呥扨它穵夕丫帀";
+const char kLetters[] = "abcdefghjklmnopqrstwxyz";
+const int kBoundaryCount = 23;
+
+// QCollator 只可重入，每个线程各持一份，查询结果按字缓存
+struct Resolver {
+    QCollator collator{QLocale(QLocale::Chinese, QLocale::China)};
+    QHash<char16_t, char> cache;
+    bool usable = false;
+
+    Resolver()
+    {
+        usable = lookup(u'张') == 'z' && lookup(u'李') == 'l' && lookup(u'阿') == 'a';
+        cache.clear();
+    }
+
+    char lookup(char16_t ch)
+    {
+        auto it = cache.constFind(ch);
+        if (it != cache.constEnd()) return it.value();
+
+        // 二分查找最后一个不大于该字的边界字
+        const QString s(QChar(ch), 1);
+        int lo = 0, hi = kBoundaryCount - 1, found = -1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if (collator.compare(s, QString(QChar(kBoundaries[mid]), 1)) >= 0) {
+                found = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        char letter = found >= 0 ? kLetters[found] : 0;
+        cache.insert(ch, letter);
+        return letter;
+    }
+};
+
+Resolver &resolver()
+{
+    thread_local Resolver instance;
+    return instance;
+}
+
+} // namespace
+
+bool Pinyin::isHan(QChar ch)
+{
+    const char16_t u = ch.unicode();
+    return (u >= 0x4e00 && u <= 0x9fff) || (u >= 0x3400 && u <= 0x4dbf);
+}
+
+QString Pinyin::initials(const QString &text)
+{
+    Resolver &r = resolver();
+    QString result;
+    result.reserve(text.size());
+    for (QChar ch : text) {
+        if (isHan(ch)) {
+            if (!r.usable) return QString();
+            char letter = r.lookup(ch.unicode());
+            if (letter) result.append(QLatin1Char(letter));
+        } else if (ch.isLetterOrNumber() && ch.unicode() < 0x80) {
+            result.append(ch.toLower());
+        }
+    }
+    return result;
+}
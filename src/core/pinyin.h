@@ -0,0 +1,18 @@
+#ifndef PINYIN_H
+#define PINYIN_H
+
+#include <QString>
+
+// 汉字拼音首字母，用于本地曲库的拼音检索（如 "zjl" 匹配 "周杰伦"）。
+// 依赖系统排序规则的中文拼音序（ICU / Windows zh-CN），不可用时返回空串。
+// 可在多个线程中同时调用。
+namespace Pinyin {
+
+bool isHan(QChar ch);
+
+// 返回文本中每个汉字的拼音首字母（小写），字母与数字原样保留（转小写），其余字符忽略
+QString initials(const QString &text);
+
+} // namespace Pinyin
+
+#endif // PINYIN_H
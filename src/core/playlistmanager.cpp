@@ -1,5 +1,25 @@
 #include "playlistmanager.h"
+#include <QDataStream>
 #include <QRandomGenerator>
+#include <QHash>
+
+QDataStream &operator<<(QDataStream &out, const Song &song)
+{
+    out << song.id << song.name << song.artist << song.album << song.bvid << song.picUrl
+        << song.cid << qint32(song.duration) << song.filePath << quint8(song.source);
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, Song &song)
+{
+    qint32 duration = 0;
+    quint8 source = 0;
+    in >> song.id >> song.name >> song.artist >> song.album >> song.bvid >> song.picUrl
+       >> song.cid >> duration >> song.filePath >> source;
+    song.duration = duration;
+    song.source = source <= quint8(SearchSource::Local) ? static_cast<SearchSource>(source) : SearchSource::NetEase;
+    return in;
+}
 
 PlaylistManager::PlaylistManager(QObject *parent)
     : QObject(parent), currentIndex(-1), currentMode(Sequential)
@@ -13,6 +33,12 @@ void PlaylistManager::addSongs(const QVector<Song> &songs)
     currentIndex = -1; // 重置索引
 }
 
+// 追加歌曲到列表末尾
+void PlaylistManager::appendSongs(const QVector<Song> &songs)
+{
+    playlist += songs;
+}
+
 // 设置当前播放歌曲的索引
 void PlaylistManager::setCurrentIndex(int index)
 {
@@ -30,7 +56,7 @@ Song PlaylistManager::getNextSong(bool isAutoTriggered)
         return invalidSong; // 返回无效歌曲
     }
 
-    if (currentMode == LoopOne && isAutoTriggered) {
+    if (currentMode == LoopOne && isAutoTriggered && currentIndex >= 0) {
         // 单曲循环模式下，自动播放时索引不变
         return playlist[currentIndex];
     }
@@ -60,12 +86,8 @@ Song PlaylistManager::getPreviousSong()
         return invalidSong; // 返回无效歌曲
     }
 
-    // 随机模式下，上一曲通常表现为顺序播放的上一曲
-    if (currentMode == Random) {
-         currentIndex = (currentIndex - 1 + playlist.size()) % playlist.size();
-    } else { // Sequential or LoopOne
-        currentIndex = (currentIndex - 1 + playlist.size()) % playlist.size();
-    }
+    // 随机模式下，上一曲通常表现为顺序播放的上一曲；尚未开始播放时从最后一首开始
+    currentIndex = currentIndex <= 0 ? playlist.size() - 1 : currentIndex - 1;
     
     return playlist[currentIndex];
 }
@@ -81,6 +103,59 @@ Song PlaylistManager::getCurrentSong() const
     return invalidSong; // 返回无效歌曲
 }
 
+// 获取当前歌曲之后的若干首歌曲（按列表顺序）
+QVector<Song> PlaylistManager::upcomingSongs(int count) const
+{
+    QVector<Song> songs;
+    if (playlist.isEmpty()) {
+        return songs;
+    }
+    int n = qMin(count, playlist.size() - 1);
+    for (int i = 1; i <= n; ++i) {
+        songs.append(playlist[(qMax(currentIndex, 0) + i) % playlist.size()]);
+    }
+    return songs;
+}
+
+// 查找歌曲在列表中的位置
+int PlaylistManager::indexOf(const Song &song) const
+{
+    for (int i = 0; i < playlist.size(); ++i) {
+        const Song &candidate = playlist[i];
+        if (candidate.source != song.source) continue;
+        switch (song.source) {
+        case SearchSource::Bilibili:
+            if (candidate.bvid == song.bvid) return i;
+            break;
+        case SearchSource::Local:
+            if (candidate.filePath == song.filePath) return i;
+            break;
+        default:
+            if (candidate.id == song.id) return i;
+            break;
+        }
+    }
+    return -1;
+}
+
+// 用歌曲详情补全列表中的网易云歌曲
+void PlaylistManager::updateSongDetails(const QVector<Song> &details)
+{
+    QHash<qint64, const Song *> detailById;
+    for (const Song &detail : details) {
+        detailById.insert(detail.id, &detail);
+    }
+
+    for (Song &song : playlist) {
+        if (song.source != SearchSource::NetEase) continue;
+        const Song *detail = detailById.value(song.id, nullptr);
+        if (!detail) continue;
+        if (!detail->album.isEmpty()) song.album = detail->album;
+        if (!detail->picUrl.isEmpty()) song.picUrl = detail->picUrl;
+        if (detail->duration > 0) song.duration = detail->duration;
+    }
+}
+
 // 设置播放模式
 void PlaylistManager::setPlayMode(PlayMode mode)
 {
@@ -103,4 +178,10 @@ int PlaylistManager::getCurrentIndex() const
 bool PlaylistManager::isEmpty() const
 {
     return playlist.isEmpty();
-}
\ No newline at end of file
+}
+
+// 获取完整列表
+const QVector<Song> &PlaylistManager::songs() const
+{
+    return playlist;
+}
@@ -5,10 +5,13 @@
 #include <QVector>
 #include <QString>
 
+class QDataStream;
+
 // 搜索源类型
 enum class SearchSource {
     NetEase,    // 网易云音乐
-    Bilibili    // Bilibili
+    Bilibili,   // Bilibili
+    Local       // 本地曲库
 };
 
 // 用于存储歌曲基本信息的结构体
@@ -17,16 +20,22 @@ struct Song
     qint64 id;
     QString name;
     QString artist;
+    QString album;      // 专辑名（网易云）
     // Bilibili特有字段
     QString bvid;       // Bilibili BV号
-    QString picUrl;     // 封面图URL
+    QString picUrl;     // 封面图URL（网易云来自歌曲详情）
     qint64 cid;         // Bilibili CID
     int duration;       // 时长（秒）
+    QString filePath;   // 本地文件路径
     SearchSource source; // 来源平台
 
     Song() : id(-1), cid(-1), duration(0), source(SearchSource::NetEase) {}
 };
 
+// 会话和离线下载队列存盘共用的格式，改动字段时两处的文件版本号都要升级
+QDataStream &operator<<(QDataStream &out, const Song &song);
+QDataStream &operator>>(QDataStream &in, Song &song);
+
 class PlaylistManager : public QObject
 {
     Q_OBJECT
@@ -43,15 +52,20 @@ public:
 
     // 公共接口
     void addSongs(const QVector<Song> &songs);
+    void appendSongs(const QVector<Song> &songs); // 追加到列表末尾，不影响当前索引
     void setCurrentIndex(int index);
     void setPlayMode(PlayMode mode);
 
     Song getNextSong(bool isAutoTriggered = true); // isAutoTriggered 用于区分是自动播放下一首还是手动点击
     Song getPreviousSong();
     Song getCurrentSong() const;
+    QVector<Song> upcomingSongs(int count) const; // 顺序上即将播放的歌曲，用于预取
+    int indexOf(const Song &song) const; // 按来源与 ID（bvid、文件路径）查找，找不到返回 -1
+    void updateSongDetails(const QVector<Song> &details); // 合并批量详情（专辑、封面、时长）
     PlayMode getPlayMode() const;
     int getCurrentIndex() const;
     bool isEmpty() const;
+    const QVector<Song> &songs() const;
 
 
 private:
@@ -0,0 +1,184 @@
+#include "requestscheduler.h"
+#include "logging.h"
+#include <QNetworkReply>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QtMath>
+
+// 退避参数
+static const int kBackoffBaseMs = 1000;
+static const int kBackoffMaxMs = 60000;
+// 单个请求被限流后的最大重试次数，超过后交给调用方按失败处理
+static const int kMaxAttempts = 6;
+// 预取只能在保留这么多令牌之后使用，保证播放请求随时可发
+static const double kPrefetchReserveTokens = 1.0;
+
+RequestScheduler::RequestScheduler(QObject *parent)
+    : QObject(parent), nextId(1)
+{
+    clock.start();
+}
+
+RequestScheduler::HostState &RequestScheduler::hostState(const QString &host)
+{
+    auto it = hosts.find(host);
+    if (it == hosts.end()) {
+        it = hosts.insert(host, HostState());
+        it->lastRefill = clock.elapsed();
+    }
+    return *it;
+}
+
+void RequestScheduler::setRateLimit(const QString &host, double requestsPerSecond, int burst)
+{
+    HostState &state = hostState(host);
+    state.rate = qMax(0.0, requestsPerSecond);
+    state.burst = qMax(1, burst);
+    state.tokens = state.burst;
+    state.lastRefill = clock.elapsed();
+}
+
+quint64 RequestScheduler::submit(const QString &host, Priority priority, StartFunction start, FinishFunction finish)
+{
+    Job job;
+    job.id = nextId++;
+    job.priority = priority;
+    job.start = std::move(start);
+    job.finish = std::move(finish);
+
+    hostState(host).queues[priority].append(job);
+    pump(host);
+    return job.id;
+}
+
+void RequestScheduler::cancel(quint64 id)
+{
+    for (HostState &state : hosts) {
+        for (QList<Job> &queue : state.queues) {
+            for (int i = 0; i < queue.size(); ++i) {
+                if (queue[i].id == id) {
+                    queue.removeAt(i);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int RequestScheduler::pendingCount(const QString &host) const
+{
+    auto it = hosts.constFind(host);
+    if (it == hosts.constEnd()) return 0;
+    return it->queues[Playback].size() + it->queues[Search].size() + it->queues[Prefetch].size();
+}
+
+void RequestScheduler::refill(HostState &state)
+{
+    qint64 now = clock.elapsed();
+    if (state.rate > 0) {
+        state.tokens = qMin(state.burst, state.tokens + (now - state.lastRefill) * state.rate / 1000.0);
+    }
+    state.lastRefill = now;
+}
+
+void RequestScheduler::pump(const QString &host)
+{
+    while (true) {
+        HostState &state = hostState(host);
+        qint64 now = clock.elapsed();
+
+        if (state.backoffUntil > now) {
+            scheduleWake(host, state.backoffUntil - now);
+            return;
+        }
+
+        // 严格按优先级取队首；预取还需满足保留额度且同一时间只发一个
+        int priority = -1;
+        for (int p = Playback; p <= Prefetch; ++p) {
+            if (!state.queues[p].isEmpty()) {
+                priority = p;
+                break;
+            }
+        }
+        if (priority < 0) return;
+
+        refill(state);
+        double needed = 1.0;
+        if (priority == Prefetch) {
+            if (state.prefetchInFlight > 0) return; // 完成时会再次调度
+            needed += kPrefetchReserveTokens;
+        }
+
+        if (state.rate > 0 && state.tokens < needed) {
+            qint64 waitMs = qCeil((needed - state.tokens) * 1000.0 / state.rate);
+            scheduleWake(host, qMax<qint64>(1, waitMs));
+            return;
+        }
+
+        if (state.rate > 0) state.tokens -= 1.0;
+        Job job = state.queues[priority].takeFirst();
+        dispatch(host, job);
+    }
+}
+
+void RequestScheduler::dispatch(const QString &host, Job job)
+{
+    job.attempts++;
+    QNetworkReply *reply = job.start();
+    if (!reply) {
+        // 请求没有发出：退还令牌，下一轮事件循环再通知调用方，避免在 pump 中重入
+        HostState &state = hostState(host);
+        if (state.rate > 0) state.tokens = qMin(state.burst, state.tokens + 1.0);
+        qCWarning(lcNetwork) << "Request to" << host << "could not be started";
+        QMetaObject::invokeMethod(this, [this, host, job]() {
+            job.finish(nullptr);
+            pump(host);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    if (job.priority == Prefetch) {
+        hostState(host).prefetchInFlight++;
+    }
+
+    connect(reply, &QNetworkReply::finished, this, [this, host, job, reply]() {
+        HostState &state = hostState(host);
+        if (job.priority == Prefetch) {
+            state.prefetchInFlight--;
+        }
+
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if ((status == 412 || status == 429) && job.attempts < kMaxAttempts) {
+            // 被限流：指数退避后排回同优先级队首，而不是直接失败
+            state.backoffLevel = qMin(state.backoffLevel + 1, 16);
+            int delay = qMin(kBackoffMaxMs, kBackoffBaseMs << (state.backoffLevel - 1));
+            delay += QRandomGenerator::global()->bounded(delay / 4 + 1); // 抖动，避免多人同时重试
+            state.backoffUntil = clock.elapsed() + delay;
+            state.queues[job.priority].prepend(job);
+            qCInfo(lcNetwork) << "Rate limited by" << host << "HTTP" << status << "- retrying in" << delay << "ms";
+            reply->deleteLater();
+            emit rateLimited(host, delay);
+            pump(host);
+            return;
+        }
+
+        if (status > 0 && status < 400) {
+            state.backoffLevel = 0;
+        }
+        job.finish(reply);
+        pump(host);
+    });
+}
+
+void RequestScheduler::scheduleWake(const QString &host, qint64 delayMs)
+{
+    HostState &state = hostState(host);
+    if (!state.timer) {
+        state.timer = new QTimer(this);
+        state.timer->setSingleShot(true);
+        connect(state.timer, &QTimer::timeout, this, [this, host]() { pump(host); });
+    }
+    if (!state.timer->isActive() || state.timer->remainingTime() > delayMs) {
+        state.timer->start(static_cast<int>(delayMs));
+    }
+}
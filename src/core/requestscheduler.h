@@ -0,0 +1,79 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+#include <functional>
+
+class QNetworkReply;
+class QTimer;
+
+// 按主机限流的请求调度器：令牌桶 + 优先级队列 + 412/429 指数退避
+class RequestScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    // 数值越小优先级越高
+    enum Priority {
+        Playback = 0, // 用户正在等待的播放相关请求
+        Search = 1,   // 搜索
+        Prefetch = 2  // 预取，不得占用播放请求的额度
+    };
+    Q_ENUM(Priority)
+
+    using StartFunction = std::function<QNetworkReply *()>;
+    using FinishFunction = std::function<void(QNetworkReply *)>;
+
+    explicit RequestScheduler(QObject *parent = nullptr);
+
+    // 设置主机的速率（每秒请求数）与突发容量；未设置的主机不限流
+    void setRateLimit(const QString &host, double requestsPerSecond, int burst);
+
+    // 提交请求：start 在获得令牌时调用并返回 reply，finish 在最终完成（含重试用尽）时调用。
+    // start 未能发出请求（返回 nullptr）时按失败处理，finish 收到 nullptr
+    quint64 submit(const QString &host, Priority priority, StartFunction start, FinishFunction finish);
+    // 取消排队中的请求；已发出的请求由调用方自行 abort
+    void cancel(quint64 id);
+
+    int pendingCount(const QString &host) const;
+
+signals:
+    // 主机被限流，请求将在 delayMs 后自动重试
+    void rateLimited(const QString &host, int delayMs);
+
+private:
+    struct Job {
+        quint64 id = 0;
+        Priority priority = Search;
+        StartFunction start;
+        FinishFunction finish;
+        int attempts = 0;
+    };
+
+    struct HostState {
+        double rate = 0;          // 令牌/秒，0 表示不限流
+        double burst = 1;
+        double tokens = 1;
+        qint64 lastRefill = 0;
+        qint64 backoffUntil = 0;  // 退避结束时间（clock 毫秒）
+        int backoffLevel = 0;
+        int prefetchInFlight = 0;
+        QList<Job> queues[3];
+        QTimer *timer = nullptr;
+    };
+
+    HostState &hostState(const QString &host);
+    void refill(HostState &state);
+    void pump(const QString &host);
+    void dispatch(const QString &host, Job job);
+    void scheduleWake(const QString &host, qint64 delayMs);
+
+    QHash<QString, HostState> hosts;
+    QElapsedTimer clock;
+    quint64 nextId;
+};
+
+#endif // REQUESTSCHEDULER_H
@@ -0,0 +1,99 @@
+#include "searchcache.h"
+#include "searchmerger.h"
+#include "metrics.h"
+
+SearchCache::SearchCache(int capacity, qint64 ttlMs)
+    : capacity(qMax(1, capacity)), ttlMs(ttlMs), useCounter(0)
+{
+    clock.start();
+}
+
+QString SearchCache::keyFor(SearchSource source, const QString &normalizedQuery)
+{
+    return QString::number(static_cast<int>(source)) + ':' + normalizedQuery;
+}
+
+void SearchCache::insert(SearchSource source, const QString &query, const QVector<Song> &songs, int total)
+{
+    const QString normalized = SearchMerger::normalize(query);
+    if (normalized.isEmpty()) return;
+
+    Entry entry;
+    entry.source = source;
+    entry.query = normalized;
+    entry.songs = songs;
+    entry.total = total;
+    entry.storedAt = clock.elapsed();
+    entry.lastUsed = ++useCounter;
+    entries.insert(keyFor(source, normalized), entry);
+
+    if (entries.size() > capacity) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) oldest = it;
+        }
+        entries.erase(oldest);
+    }
+}
+
+bool SearchCache::matches(const Song &song, const QStringList &tokens)
+{
+    const QString text = SearchMerger::normalize(song.name)
+                       + SearchMerger::normalize(song.artist)
+                       + SearchMerger::normalize(song.album);
+    for (const QString &token : tokens) {
+        if (!text.contains(token)) return false;
+    }
+    return true;
+}
+
+bool SearchCache::lookup(SearchSource source, const QString &query, Result *result)
+{
+    const QString normalized = SearchMerger::normalize(query);
+    if (normalized.isEmpty()) return false;
+
+    const qint64 now = clock.elapsed();
+    auto exact = entries.find(keyFor(source, normalized));
+    if (exact != entries.end() && now - exact->storedAt <= ttlMs) {
+        exact->lastUsed = ++useCounter;
+        Metrics::increment("search_cache_lookups_total", { { "result", "exact" } });
+        result->songs = exact->songs;
+        result->total = exact->total;
+        result->exact = true;
+        return true;
+    }
+
+    // 最长的已缓存前缀："周杰" 的结果可用于 "周杰伦 晴"
+    Entry *best = nullptr;
+    for (Entry &entry : entries) {
+        if (entry.source != source || now - entry.storedAt > ttlMs) continue;
+        if (!normalized.startsWith(entry.query)) continue;
+        if (!best || entry.query.size() > best->query.size()) best = &entry;
+    }
+    if (!best) {
+        Metrics::increment("search_cache_lookups_total", { { "result", "miss" } });
+        return false;
+    }
+    best->lastUsed = ++useCounter;
+    Metrics::increment("search_cache_lookups_total", { { "result", "prefix" } });
+
+    QStringList tokens;
+    for (const QString &part : query.split(' ', Qt::SkipEmptyParts)) {
+        QString token = SearchMerger::normalize(part);
+        if (!token.isEmpty()) tokens.append(token);
+    }
+
+    result->songs.clear();
+    for (const Song &song : best->songs) {
+        if (matches(song, tokens)) result->songs.append(song);
+    }
+    // 服务端的匹配规则（别名、拼音等）与本地过滤不同，前缀结果只作临时展示
+    result->total = best->total;
+    result->exact = false;
+    return true;
+}
+
+void SearchCache::clear()
+{
+    entries.clear();
+}
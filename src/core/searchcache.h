@@ -0,0 +1,47 @@
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "playlistmanager.h"
+
+// 搜索结果的本地缓存（仅第一页），按 来源 + 规范化查询 存储，LRU 淘汰。
+// 精确命中直接复用；继续输入时用最长的已缓存前缀在本地过滤出临时结果
+class SearchCache
+{
+public:
+    struct Result {
+        QVector<Song> songs;
+        int total = 0;
+        bool exact = false; // 精确命中，可直接作为最终结果而无需请求网络
+    };
+
+    explicit SearchCache(int capacity = 64, qint64 ttlMs = 10 * 60 * 1000);
+
+    void insert(SearchSource source, const QString &query, const QVector<Song> &songs, int total);
+    bool lookup(SearchSource source, const QString &query, Result *result);
+    void clear();
+
+private:
+    struct Entry {
+        SearchSource source = SearchSource::NetEase;
+        QString query;        // 规范化查询
+        QVector<Song> songs;
+        int total = 0;
+        qint64 storedAt = 0;
+        quint64 lastUsed = 0;
+    };
+
+    static QString keyFor(SearchSource source, const QString &normalizedQuery);
+    static bool matches(const Song &song, const QStringList &tokens);
+
+    QHash<QString, Entry> entries;
+    int capacity;
+    qint64 ttlMs;
+    quint64 useCounter;
+    QElapsedTimer clock;
+};
+
+#endif // SEARCHCACHE_H
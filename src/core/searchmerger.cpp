@@ -0,0 +1,190 @@
+#include "searchmerger.h"
+#include <algorithm>
+
+// 同时出现在两个来源中的结果更可能是用户要找的歌曲
+static const int kBothSourcesBonus = 25;
+// 来源内排名每下降一位扣除的分数
+static const int kPositionPenalty = 2;
+// 超过该时长的B站视频多为合集或直播录像
+static const int kLongVideoSeconds = 15 * 60;
+// 标题过短时包含关系不可靠，不做模糊去重
+static const int kMinFuzzyTitleLength = 2;
+
+static int sourceBit(SearchSource source)
+{
+    return 1 << static_cast<int>(source);
+}
+
+QString SearchMerger::normalize(const QString &text)
+{
+    // NFKC 把全角字母、数字折叠为半角
+    const QString folded = text.normalized(QString::NormalizationForm_KC);
+    QString result;
+    result.reserve(folded.size());
+    for (QChar ch : folded) {
+        if (ch.isLetterOrNumber()) {
+            result.append(ch.toLower());
+        }
+    }
+    return result;
+}
+
+void SearchMerger::reset(const QString &query)
+{
+    normalizedQuery = normalize(query);
+    queryTokens.clear();
+    for (const QString &part : query.split(' ', Qt::SkipEmptyParts)) {
+        QString token = normalize(part);
+        if (!token.isEmpty()) queryTokens.append(token);
+    }
+    sourceResults.clear();
+    entries.clear();
+    keyIndex.clear();
+    answeredSources = 0;
+    nextOrder = 0;
+}
+
+bool SearchMerger::hasAnswered(SearchSource source) const
+{
+    return answeredSources & sourceBit(source);
+}
+
+bool SearchMerger::sameSong(const Entry &a, const Entry &b)
+{
+    if (a.title == b.title && a.artist == b.artist) return true;
+
+    // B站标题通常是 "【歌手】歌名 官方MV" 之类，UP主也不一定是歌手：
+    // 标题同时包含另一来源的歌名和歌手即视为同一首歌
+    const Entry *video = nullptr;
+    const Entry *track = nullptr;
+    if (a.song.source == SearchSource::Bilibili && b.song.source != SearchSource::Bilibili) {
+        video = &a; track = &b;
+    } else if (b.song.source == SearchSource::Bilibili && a.song.source != SearchSource::Bilibili) {
+        video = &b; track = &a;
+    } else {
+        return false;
+    }
+    if (track->title.size() < kMinFuzzyTitleLength || track->artist.isEmpty()) return false;
+    return video->title.contains(track->title)
+        && (video->title.contains(track->artist) || video->artist == track->artist);
+}
+
+int SearchMerger::findDuplicate(const Entry &entry) const
+{
+    auto it = keyIndex.constFind(entry.title + '|' + entry.artist);
+    if (it != keyIndex.constEnd()) return it.value();
+
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].song.source != entry.song.source && sameSong(entries[i], entry)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int SearchMerger::relevance(const Entry &entry, int position) const
+{
+    int score = 0;
+    if (!normalizedQuery.isEmpty()) {
+        if (entry.title == normalizedQuery) score += 100;
+        else if (entry.title.startsWith(normalizedQuery)) score += 60;
+        else if (entry.title.contains(normalizedQuery)) score += 40;
+        if (entry.artist == normalizedQuery) score += 30;
+    }
+    // "歌手 歌名" 形式的查询按词分别匹配
+    for (const QString &token : queryTokens) {
+        if (entry.title.contains(token)) score += 15;
+        else if (entry.artist.contains(token)) score += 10;
+    }
+    if (entry.song.source == SearchSource::Bilibili && entry.song.duration > kLongVideoSeconds) {
+        score -= 30;
+    }
+    score -= position * kPositionPenalty;
+    return score;
+}
+
+void SearchMerger::addResults(SearchSource source, const QVector<Song> &songs, bool provisional)
+{
+    if (!provisional) {
+        answeredSources |= sourceBit(source);
+    }
+    sourceResults.insert(static_cast<int>(source), songs);
+    rebuild();
+}
+
+void SearchMerger::rebuild()
+{
+    // 结果不多（每个来源一页），整体重建即可；固定按网易云优先的顺序合并，
+    // 与各来源返回的先后无关
+    entries.clear();
+    keyIndex.clear();
+    nextOrder = 0;
+    for (SearchSource source : { SearchSource::NetEase, SearchSource::Bilibili, SearchSource::Local }) {
+        mergeSource(source);
+    }
+}
+
+void SearchMerger::mergeSource(SearchSource source)
+{
+    const QVector<Song> songs = sourceResults.value(static_cast<int>(source));
+    for (int position = 0; position < songs.size(); ++position) {
+        Entry entry;
+        entry.song = songs[position];
+        entry.title = normalize(entry.song.name);
+        entry.artist = normalize(entry.song.artist);
+        entry.score = relevance(entry, position);
+
+        const int duplicate = findDuplicate(entry);
+        if (duplicate < 0) {
+            entry.order = nextOrder++;
+            keyIndex.insert(entry.title + '|' + entry.artist, entries.size());
+            entries.append(entry);
+            continue;
+        }
+
+        Entry &existing = entries[duplicate];
+        if (existing.song.source == source) continue; // 同一来源内的重复
+
+        // 两个来源都有：保留先合并的网易云条目（有歌词和专辑信息），取较高分并加权
+        if (!existing.inBothSources) {
+            existing.inBothSources = true;
+            existing.score = qMax(existing.score, entry.score) + kBothSourcesBonus;
+        }
+    }
+}
+
+void SearchMerger::updateSongDetails(const QVector<Song> &details)
+{
+    auto it = sourceResults.find(static_cast<int>(SearchSource::NetEase));
+    if (it == sourceResults.end()) return;
+
+    for (const Song &detail : details) {
+        for (Song &song : *it) {
+            if (song.id != detail.id) continue;
+            if (!detail.album.isEmpty()) song.album = detail.album;
+            if (!detail.picUrl.isEmpty()) song.picUrl = detail.picUrl;
+            if (detail.duration > 0) song.duration = detail.duration;
+        }
+    }
+    rebuild();
+}
+
+QVector<Song> SearchMerger::results() const
+{
+    QVector<const Entry *> ranked;
+    ranked.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        ranked.append(&entry);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const Entry *a, const Entry *b) {
+        if (a->score != b->score) return a->score > b->score;
+        return a->order < b->order;
+    });
+
+    QVector<Song> songs;
+    songs.reserve(ranked.size());
+    for (const Entry *entry : ranked) {
+        songs.append(entry->song);
+    }
+    return songs;
+}
@@ -0,0 +1,51 @@
+#ifndef SEARCHMERGER_H
+#define SEARCHMERGER_H
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+#include "playlistmanager.h"
+
+// 聚合搜索：合并各来源的结果，按标题与歌手去重并按相关度排序。
+// 各来源的结果先到先合并，每次合并后 results() 给出完整的排序结果；
+// 同一来源再次提交时替换此前的结果（如缓存的临时结果被网络结果取代）
+class SearchMerger
+{
+public:
+    void reset(const QString &query);
+    // provisional 为 true 表示临时结果（来自缓存），该来源仍视为未返回
+    void addResults(SearchSource source, const QVector<Song> &songs, bool provisional = false);
+    void updateSongDetails(const QVector<Song> &details); // 合并网易云歌曲详情（封面、专辑）
+
+    bool hasAnswered(SearchSource source) const;
+    QVector<Song> results() const;
+
+    // 去除空白和标点、统一全半角与大小写，用于比较标题和歌手
+    static QString normalize(const QString &text);
+
+private:
+    struct Entry {
+        Song song;
+        QString title;   // 规范化后的标题
+        QString artist;  // 规范化后的歌手
+        int score = 0;
+        int order = 0;   // 合并顺序，分数相同时保持来源内的原始顺序
+        bool inBothSources = false;
+    };
+
+    void rebuild();
+    void mergeSource(SearchSource source);
+    int findDuplicate(const Entry &entry) const;
+    int relevance(const Entry &entry, int position) const;
+    static bool sameSong(const Entry &a, const Entry &b);
+
+    QString normalizedQuery;
+    QStringList queryTokens;
+    QHash<int, QVector<Song>> sourceResults; // 各来源的原始结果（按来源顺序）
+    QVector<Entry> entries;
+    QHash<QString, int> keyIndex; // 规范化的 "标题|歌手" -> entries 下标
+    int answeredSources = 0;      // 已返回结果的来源（位掩码）
+    int nextOrder = 0;
+};
+
+#endif // SEARCHMERGER_H
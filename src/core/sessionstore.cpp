@@ -0,0 +1,277 @@
+#include "sessionstore.h"
+#include "logging.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtEndian>
+#include <cstring>
+
+// 文件格式（小端）：
+//   [0, 1024)  头部：魔数、版本、标志、播放设置、位置、队列段大小与校验、当前地址、头部校验
+//   [1024, ..) 队列：QDataStream 序列化的歌曲列表
+static const quint32 kMagic = 0x53534C4D; // "MLSS"
+static const quint16 kVersion = 1;
+static const int kHeaderSize = 1024;
+static const int kUrlOffset = 48;
+static const int kMaxUrlBytes = kHeaderSize - kUrlOffset - 4;
+static const int kFlagPlaying = 0x1;
+
+// 修改合并后写入的延迟；播放位置每秒变化多次，不能每次都写盘
+static const int kWriteDelayMs = 3000;
+
+static quint32 fnv1a(const char *data, qsizetype size)
+{
+    quint32 hash = 2166136261u;
+    for (qsizetype i = 0; i < size; ++i) {
+        hash ^= static_cast<quint8>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+SessionStore::SessionStore(const QString &filePath, QObject *parent)
+    : QObject(parent), headerDirty(false), queueDirty(false), savedQueueBytes(0), savedQueueChecksum(0)
+{
+    path = filePath;
+    if (path.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        path = dir + "/session.bin";
+    }
+
+    writeTimer = new QTimer(this);
+    writeTimer->setSingleShot(true);
+    writeTimer->setInterval(kWriteDelayMs);
+    connect(writeTimer, &QTimer::timeout, this, &SessionStore::flush);
+}
+
+SessionStore::~SessionStore()
+{
+    flush();
+}
+
+bool SessionStore::load(SessionState *result)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < kHeaderSize) return false;
+
+    // 映射整个文件，避免额外拷贝；解析完即解除映射
+    uchar *data = file.map(0, file.size());
+    if (!data) return false;
+    const char *bytes = reinterpret_cast<const char *>(data);
+
+    bool ok = false;
+    do {
+        if (qFromLittleEndian<quint32>(bytes) != kMagic
+            || qFromLittleEndian<quint16>(bytes + 4) != kVersion) break;
+        if (qFromLittleEndian<quint32>(bytes + kHeaderSize - 4) != fnv1a(bytes, kHeaderSize - 4)) {
+            qCWarning(lcSession) << "Session header checksum mismatch";
+            break;
+        }
+
+        const quint32 queueCount = qFromLittleEndian<quint32>(bytes + 32);
+        const quint32 queueBytes = qFromLittleEndian<quint32>(bytes + 36);
+        const quint32 queueChecksum = qFromLittleEndian<quint32>(bytes + 40);
+        if (kHeaderSize + qint64(queueBytes) > file.size()
+            || fnv1a(bytes + kHeaderSize, queueBytes) != queueChecksum) {
+            qCWarning(lcSession) << "Session queue checksum mismatch";
+            break;
+        }
+
+        state = SessionState();
+        const quint16 flags = qFromLittleEndian<quint16>(bytes + 6);
+        state.wasPlaying = flags & kFlagPlaying;
+        state.playMode = static_cast<quint8>(bytes[8]);
+        state.volume = static_cast<quint8>(bytes[9]);
+        state.currentIndex = qFromLittleEndian<qint32>(bytes + 12);
+        state.positionMs = qFromLittleEndian<qint64>(bytes + 16);
+        state.resolvedAt = qFromLittleEndian<qint64>(bytes + 24);
+        const quint16 urlLength = qMin<quint16>(qFromLittleEndian<quint16>(bytes + 44), kMaxUrlBytes);
+        state.resolvedUrl = QUrl::fromEncoded(QByteArray(bytes + kUrlOffset, urlLength));
+
+        const QByteArray queueData = QByteArray::fromRawData(bytes + kHeaderSize, queueBytes);
+        QDataStream in(queueData);
+        in.setVersion(QDataStream::Qt_6_0);
+        state.queue.reserve(queueCount);
+        for (quint32 i = 0; i < queueCount && in.status() == QDataStream::Ok; ++i) {
+            Song song;
+            in >> song;
+            state.queue.append(song);
+        }
+        if (in.status() != QDataStream::Ok) break;
+        if (state.currentIndex >= state.queue.size()) state.currentIndex = -1;
+
+        savedQueueBytes = queueBytes;
+        savedQueueChecksum = queueChecksum;
+        ok = true;
+    } while (false);
+
+    file.unmap(data);
+    if (ok) {
+        *result = state;
+    } else {
+        state = SessionState();
+    }
+    return ok;
+}
+
+void SessionStore::setQueue(const QVector<Song> &queue, int currentIndex)
+{
+    state.queue = queue;
+    state.currentIndex = currentIndex;
+    queueDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::setCurrentIndex(int index)
+{
+    if (state.currentIndex == index) return;
+    state.currentIndex = index;
+    state.positionMs = 0;
+    state.resolvedUrl.clear();
+    state.resolvedAt = 0;
+    headerDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::setPlayMode(int mode)
+{
+    if (state.playMode == mode) return;
+    state.playMode = mode;
+    headerDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::setVolume(int volume)
+{
+    if (state.volume == volume) return;
+    state.volume = volume;
+    headerDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::setPosition(qint64 positionMs, bool playing)
+{
+    if (state.positionMs == positionMs && state.wasPlaying == playing) return;
+    state.positionMs = positionMs;
+    state.wasPlaying = playing;
+    headerDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::setResolvedUrl(const QUrl &url)
+{
+    state.resolvedUrl = url;
+    state.resolvedAt = QDateTime::currentMSecsSinceEpoch();
+    headerDirty = true;
+    scheduleWrite();
+}
+
+void SessionStore::scheduleWrite()
+{
+    // 不重新计时：持续变化时也保证每个周期至少写一次
+    if (!writeTimer->isActive()) {
+        writeTimer->start();
+    }
+}
+
+void SessionStore::flush()
+{
+    writeTimer->stop();
+    if (queueDirty) {
+        // 搜索结果常被替换为相同的列表，内容未变时只需写头部
+        const QByteArray queue = encodeQueue();
+        if (quint32(queue.size()) == savedQueueBytes
+            && fnv1a(queue.constData(), queue.size()) == savedQueueChecksum) {
+            queueDirty = false;
+            headerDirty = true;
+        }
+    }
+    if (queueDirty || (headerDirty && !QFile::exists(path))) {
+        writeFull();
+    } else if (headerDirty) {
+        writeHeader();
+    }
+}
+
+QByteArray SessionStore::encodeHeader(quint32 queueBytes, quint32 queueChecksum) const
+{
+    QByteArray header(kHeaderSize, '\0');
+    char *p = header.data();
+    qToLittleEndian<quint32>(kMagic, p);
+    qToLittleEndian<quint16>(kVersion, p + 4);
+    qToLittleEndian<quint16>(state.wasPlaying ? kFlagPlaying : 0, p + 6);
+    p[8] = static_cast<char>(qBound(0, state.playMode, 255));
+    p[9] = static_cast<char>(qBound(0, state.volume, 100));
+    qToLittleEndian<qint32>(state.currentIndex, p + 12);
+    qToLittleEndian<qint64>(state.positionMs, p + 16);
+    qToLittleEndian<qint64>(state.resolvedAt, p + 24);
+    qToLittleEndian<quint32>(state.queue.size(), p + 32);
+    qToLittleEndian<quint32>(queueBytes, p + 36);
+    qToLittleEndian<quint32>(queueChecksum, p + 40);
+
+    // 超出槽位的地址不保存，启动时重新解析即可
+    const QByteArray url = state.resolvedUrl.toEncoded();
+    if (url.size() <= kMaxUrlBytes) {
+        qToLittleEndian<quint16>(url.size(), p + 44);
+        std::memcpy(p + kUrlOffset, url.constData(), url.size());
+    }
+    qToLittleEndian<quint32>(fnv1a(p, kHeaderSize - 4), p + kHeaderSize - 4);
+    return header;
+}
+
+QByteArray SessionStore::encodeQueue() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    for (const Song &song : state.queue) {
+        out << song;
+    }
+    return data;
+}
+
+bool SessionStore::writeFull()
+{
+    const QByteArray queue = encodeQueue();
+    const quint32 checksum = fnv1a(queue.constData(), queue.size());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcSession) << "Unable to save session:" << file.errorString();
+        return false;
+    }
+    file.write(encodeHeader(queue.size(), checksum));
+    file.write(queue);
+    if (!file.commit()) {
+        qCWarning(lcSession) << "Unable to save session:" << file.errorString();
+        return false;
+    }
+
+    savedQueueBytes = queue.size();
+    savedQueueChecksum = checksum;
+    queueDirty = false;
+    headerDirty = false;
+    return true;
+}
+
+bool SessionStore::writeHeader()
+{
+    // 队列未变化：只覆盖头部；写入中断时头部校验失败，下次启动放弃恢复
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite) || file.size() < kHeaderSize) {
+        return writeFull();
+    }
+    const QByteArray header = encodeHeader(savedQueueBytes, savedQueueChecksum);
+    if (file.write(header) != header.size()) {
+        qCWarning(lcSession) << "Unable to update session header:" << file.errorString();
+        return false;
+    }
+    headerDirty = false;
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QObject>
+#include <QUrl>
+#include <QVector>
+#include "playlistmanager.h"
+
+class QTimer;
+
+// 会话状态：播放队列、当前位置与播放设置
+struct SessionState {
+    QVector<Song> queue;
+    int currentIndex = -1;
+    int playMode = 0;          // PlaylistManager::PlayMode
+    int volume = 50;           // 0-100
+    qint64 positionMs = 0;
+    bool wasPlaying = false;
+    QUrl resolvedUrl;          // 当前歌曲已解析的播放地址（网易云），启动时免去一次请求
+    qint64 resolvedAt = 0;     // 解析时间（毫秒时间戳），用于判断地址是否过期
+};
+
+// 会话快照：固定大小的头部（播放设置、位置、当前地址）+ 队列。
+// 频繁变化的头部在原位置覆盖写入，只有队列变化时才整体重写文件；
+// 所有修改合并后延迟写入。启动时通过内存映射读取
+class SessionStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionStore(const QString &filePath = QString(), QObject *parent = nullptr);
+    ~SessionStore();
+
+    bool load(SessionState *state);
+
+    void setQueue(const QVector<Song> &queue, int currentIndex);
+    void setCurrentIndex(int index);
+    void setPlayMode(int mode);
+    void setVolume(int volume);
+    void setPosition(qint64 positionMs, bool playing);
+    void setResolvedUrl(const QUrl &url);
+
+    void flush(); // 立即写入尚未保存的修改
+
+private:
+    QByteArray encodeHeader(quint32 queueBytes, quint32 queueChecksum) const;
+    QByteArray encodeQueue() const;
+    bool writeFull();
+    bool writeHeader();
+    void scheduleWrite();
+
+    QString path;
+    SessionState state;
+    QTimer *writeTimer;
+    bool headerDirty;
+    bool queueDirty;
+    quint32 savedQueueBytes;    // 磁盘上队列段的大小与校验，原位写头部时沿用
+    quint32 savedQueueChecksum;
+};
+
+#endif // SESSIONSTORE_H
@@ -0,0 +1,106 @@
+#include "silencedetector.h"
+#include <QtMath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+// 判断静音的窗口长度
+static const int kWindowsPerSecond = 100;
+// 短于该值的首尾静音不裁剪（正常的歌曲开头也常有零点几秒的空白）
+static const qint64 kMinSilenceMs = 1500;
+// 裁剪时在有声部分前后保留的长度
+static const qint64 kMarginMs = 200;
+
+// 是否有采样的绝对值超过门限；找到即返回
+static bool exceeds(const float *samples, qint64 count, float threshold)
+{
+    qint64 i = 0;
+#ifdef MELODY_HAVE_SSE2
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 limit = _mm_set1_ps(threshold);
+    for (; i + 16 <= count; i += 16) {
+        // 每次比较 16 个采样，合并后只做一次分支
+        const __m128 a = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i), absMask), limit);
+        const __m128 b = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i + 4), absMask), limit);
+        const __m128 c = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i + 8), absMask), limit);
+        const __m128 d = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(samples + i + 12), absMask), limit);
+        if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d)))) return true;
+    }
+#endif
+    for (; i < count; ++i) {
+        if (qAbs(samples[i]) > threshold) return true;
+    }
+    return false;
+}
+
+SilenceDetector::SilenceDetector(int sampleRate, int channels, double thresholdDb)
+    : sampleRate(qMax(1, sampleRate)), channels(qMax(1, channels)),
+      threshold(float(qPow(10.0, thresholdDb / 20.0))),
+      windowFrames(qMax(1, this->sampleRate / kWindowsPerSecond))
+{
+}
+
+void SilenceDetector::process(const float *samples, qint64 frames)
+{
+    while (frames > 0) {
+        const qint64 count = qMin(frames, windowFrames - windowFilled);
+        // 窗口已确定有声时不必再比较剩余的采样
+        if (!windowLoud) windowLoud = exceeds(samples, count * channels, threshold);
+        windowFilled += count;
+        processed += count;
+        samples += count * channels;
+        frames -= count;
+        if (windowFilled == windowFrames) {
+            if (windowLoud) {
+                if (firstLoudWindow < 0) firstLoudWindow = windowIndex;
+                lastLoudWindow = windowIndex;
+            }
+            ++windowIndex;
+            windowFilled = 0;
+            windowLoud = false;
+        }
+    }
+}
+
+qint64 SilenceDetector::framesProcessed() const
+{
+    return processed;
+}
+
+bool SilenceDetector::hasSound() const
+{
+    return firstLoudWindow >= 0 || windowLoud;
+}
+
+qint64 SilenceDetector::durationMs() const
+{
+    return processed * 1000 / sampleRate;
+}
+
+qint64 SilenceDetector::soundStartMs() const
+{
+    if (!hasSound()) return 0;
+    const qint64 first = firstLoudWindow >= 0 ? firstLoudWindow : windowIndex;
+    return first * windowFrames * 1000 / sampleRate;
+}
+
+qint64 SilenceDetector::soundEndMs() const
+{
+    if (!hasSound()) return 0;
+    // 最后一个窗口可能不完整
+    const qint64 last = windowLoud ? windowIndex : lastLoudWindow;
+    return qMin(processed, (last + 1) * windowFrames) * 1000 / sampleRate;
+}
+
+TrimPoints SilenceDetector::trimPoints() const
+{
+    TrimPoints points;
+    if (!hasSound()) return points; // 全程静音时不裁剪，交给正常的播放结束处理
+    const qint64 start = soundStartMs();
+    const qint64 end = soundEndMs();
+    if (start >= kMinSilenceMs) points.startMs = start - kMarginMs;
+    if (durationMs() - end >= kMinSilenceMs) points.endMs = end + kMarginMs;
+    return points;
+}
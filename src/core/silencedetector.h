@@ -0,0 +1,47 @@
+#ifndef SILENCEDETECTOR_H
+#define SILENCEDETECTOR_H
+
+#include <QtGlobal>
+
+// 曲目的裁剪点（毫秒）：startMs 为 0 表示开头不裁剪，endMs 为 0 表示结尾不裁剪
+struct TrimPoints {
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+
+    bool isEmpty() const { return startMs == 0 && endMs == 0; }
+};
+
+// 首尾静音检测：把解码结果按 10ms 窗口切分，窗口内任一采样的绝对值超过门限即为有声，
+// 记录第一个和最后一个有声窗口。输入为交错排列的 float 采样，可分多次送入
+class SilenceDetector
+{
+public:
+    static constexpr double kThresholdDb = -50.0;
+
+    SilenceDetector(int sampleRate, int channels, double thresholdDb = kThresholdDb);
+
+    void process(const float *samples, qint64 frames);
+
+    qint64 framesProcessed() const;
+    bool hasSound() const;
+    qint64 durationMs() const;
+    qint64 soundStartMs() const; // 第一个有声窗口的起点；全程静音时为 0
+    qint64 soundEndMs() const;   // 最后一个有声窗口的终点；全程静音时为 0
+
+    // 只有足够长的静音才裁剪，并在有声部分前后保留一小段，避免切掉渐入渐出
+    TrimPoints trimPoints() const;
+
+private:
+    int sampleRate;
+    int channels;
+    float threshold;
+    qint64 windowFrames;
+    qint64 windowFilled = 0;
+    bool windowLoud = false;
+    qint64 windowIndex = 0;      // 当前窗口的序号
+    qint64 firstLoudWindow = -1;
+    qint64 lastLoudWindow = -1;
+    qint64 processed = 0;
+};
+
+#endif // SILENCEDETECTOR_H
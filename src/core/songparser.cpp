@@ -0,0 +1,97 @@
+#include "songparser.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QRegularExpression>
+
+namespace {
+
+// 解析网易云单曲对象，搜索结果与详情接口的字段结构一致
+Song parseNetEaseSong(const QJsonObject &songObj)
+{
+    Song song;
+    song.id = songObj["id"].toVariant().toLongLong();
+    song.name = songObj["name"].toString();
+    QJsonArray artists = songObj["artists"].toArray();
+    if (!artists.isEmpty()) {
+        song.artist = artists[0].toObject()["name"].toString();
+    }
+    QJsonObject albumObj = songObj["album"].toObject();
+    song.album = albumObj["name"].toString();
+    song.picUrl = albumObj["picUrl"].toString();
+    song.duration = songObj["duration"].toInt() / 1000; // 接口单位为毫秒
+    song.source = SearchSource::NetEase;
+    return song;
+}
+
+} // namespace
+
+QVector<Song> SongParser::parseNetEaseSearch(const QJsonDocument &json, int *total)
+{
+    QVector<Song> songs;
+    QJsonObject resultObj = json.object()["result"].toObject();
+    if (total) {
+        *total = resultObj["songCount"].toInt();
+    }
+
+    QJsonArray songsArray = resultObj["songs"].toArray();
+    songs.reserve(songsArray.size());
+    for (const QJsonValue &value : songsArray) {
+        songs.append(parseNetEaseSong(value.toObject()));
+    }
+    return songs;
+}
+
+QVector<Song> SongParser::parseSongDetails(const QJsonDocument &json)
+{
+    QVector<Song> songs;
+    QJsonArray songsArray = json.object()["songs"].toArray();
+    songs.reserve(songsArray.size());
+    for (const QJsonValue &value : songsArray) {
+        Song song = parseNetEaseSong(value.toObject());
+        if (song.id > 0) {
+            songs.append(song);
+        }
+    }
+    return songs;
+}
+
+QVector<Song> SongParser::parseBilibiliSearch(const QJsonDocument &json, int *total, QString *errorMessage)
+{
+    static const QRegularExpression htmlTag("<[^>]*>");
+
+    QVector<Song> songs;
+    QJsonObject rootObj = json.object();
+    if (total) *total = 0;
+    if (rootObj.value("code").toInt() != 0) {
+        if (errorMessage) *errorMessage = rootObj.value("message").toString();
+        return songs;
+    }
+
+    // 响应结构: data.result.video 包含视频列表
+    QJsonObject data = rootObj.value("data").toObject();
+    if (total) *total = data.value("numResults").toInt();
+    QJsonArray videosArray = data.value("result").toObject().value("video").toArray();
+    songs.reserve(videosArray.size());
+
+    for (const QJsonValue &value : videosArray) {
+        QJsonObject videoObj = value.toObject();
+
+        Song song;
+        song.bvid = videoObj["bvid"].toString();
+        song.name = videoObj["title"].toString();
+        song.name.remove(htmlTag); // 去除关键词高亮标签
+        song.artist = videoObj["author"].toString();
+        song.picUrl = videoObj["pic"].toString();
+        if (!song.picUrl.startsWith("http")) {
+            song.picUrl = "https:" + song.picUrl;
+        }
+        // 时长格式为 "m:ss" 或 "h:mm:ss"
+        for (const QString &part : videoObj["duration"].toString().split(':')) {
+            song.duration = song.duration * 60 + part.toInt();
+        }
+        song.source = SearchSource::Bilibili;
+        songs.append(song);
+    }
+    return songs;
+}
@@ -0,0 +1,23 @@
+#ifndef SONGPARSER_H
+#define SONGPARSER_H
+
+#include <QJsonDocument>
+#include <QVector>
+#include "playlistmanager.h"
+
+// 将各平台接口返回的JSON转换为Song结构体
+namespace SongParser {
+
+// 网易云搜索结果（/api/search/get），total 返回歌曲总数
+QVector<Song> parseNetEaseSearch(const QJsonDocument &json, int *total = nullptr);
+
+// 网易云歌曲详情（/api/song/detail），可能包含多首歌曲
+QVector<Song> parseSongDetails(const QJsonDocument &json);
+
+// Bilibili综合搜索（/x/web-interface/search/all）中的视频结果；
+// 接口返回错误码时结果为空，并通过 errorMessage 返回原因
+QVector<Song> parseBilibiliSearch(const QJsonDocument &json, int *total = nullptr, QString *errorMessage = nullptr);
+
+} // namespace SongParser
+
+#endif // SONGPARSER_H
@@ -0,0 +1,272 @@
+#include "spectrumanalyzer.h"
+#include "metrics.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QtMath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+// FFT 长度：48kHz 时约 21ms，频率分辨率约 47Hz，足够区分低音
+static const int kFftSize = 1024;
+static const int kHalfSize = kFftSize / 2;
+// 分析间隔，约 30 次/秒，与背景动画的可见变化速度相当
+static const int kAnalysisIntervalMs = 33;
+// 声卡回调写入的缓冲区：约 0.3 秒立体声 float，分析线程短暂停顿时不丢数据
+static const qint64 kTapBytes = 16384 * 2 * qint64(sizeof(float));
+// 频带范围（对数均分）与强度映射范围
+static const double kMinBandHz = 40.0;
+static const double kMaxBandHz = 16000.0;
+static const float kFloorDb = -60.0f;
+// 平滑：上升快、下降慢，避免闪烁
+static const float kAttack = 0.6f;
+static const float kRelease = 0.15f;
+// 节拍：低频能量超过近期平均的倍数，两拍之间的最小间隔（次数）
+static const float kBeatThreshold = 1.5f;
+static const qint64 kMinBeatTicks = 6;
+static const float kBeatDecay = 0.85f;
+static const int kDirty = 4;
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
+    : QObject(parent), worker(new QObject), timer(new QTimer(worker)), tap(kTapBytes)
+{
+    timer->setInterval(kAnalysisIntervalMs);
+    timer->setTimerType(Qt::CoarseTimer);
+    connect(timer, &QTimer::timeout, worker, [this]() { analyze(); });
+    worker->moveToThread(&thread);
+
+    halfWindow.resize(kFftSize);
+    for (int i = 0; i < kFftSize; ++i) {
+        halfWindow[i] = float(0.25 * (1.0 - qCos(2.0 * M_PI * i / (kFftSize - 1))));
+    }
+    windowed.resize(kFftSize);
+    spectrum.resize(kHalfSize + 1);
+
+    twiddles.resize(kHalfSize / 2);
+    for (int k = 0; k < kHalfSize / 2; ++k) {
+        twiddles[k] = std::polar(1.0f, float(-2.0 * M_PI * k / kHalfSize));
+    }
+    postTwiddles.resize(kHalfSize);
+    for (int k = 0; k < kHalfSize; ++k) {
+        postTwiddles[k] = std::polar(1.0f, float(-2.0 * M_PI * k / kFftSize));
+    }
+    bitReverse.resize(kHalfSize);
+    int bits = 0;
+    while ((1 << bits) < kHalfSize) ++bits;
+    for (int i = 0; i < kHalfSize; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stop();
+    delete worker;
+}
+
+void SpectrumAnalyzer::start()
+{
+    if (running.exchange(true)) return;
+    thread.start(QThread::LowPriority);
+    QMetaObject::invokeMethod(worker, [this]() { timer->start(); }, Qt::QueuedConnection);
+}
+
+void SpectrumAnalyzer::stop()
+{
+    if (!running.exchange(false)) return;
+    // 先在分析线程中停掉定时器，再让线程退出，不留任何唤醒
+    QMetaObject::invokeMethod(worker, [this]() { timer->stop(); }, Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+    current = Snapshot();
+    publish(current);
+}
+
+bool SpectrumAnalyzer::isRunning() const
+{
+    return running.load();
+}
+
+void SpectrumAnalyzer::setFormat(int rate, int channelCount)
+{
+    sampleRate.store(qMax(1, rate));
+    channels.store(qMax(1, channelCount));
+}
+
+void SpectrumAnalyzer::feed(const float *samples, qint64 frames)
+{
+    if (!running.load(std::memory_order_relaxed) || frames <= 0) return;
+    // 只写入完整的帧；缓冲区满时丢弃，分析只需要最近的数据
+    const qint64 frameBytes = channels.load(std::memory_order_relaxed) * qint64(sizeof(float));
+    const qint64 space = tap.writeAvailable();
+    const qint64 bytes = qMin(frames * frameBytes, space - space % frameBytes);
+    if (bytes > 0) tap.write(reinterpret_cast<const char *>(samples), bytes);
+}
+
+SpectrumAnalyzer::Snapshot SpectrumAnalyzer::snapshot()
+{
+    if (middle.load(std::memory_order_relaxed) & kDirty) {
+        frontSlot = middle.exchange(frontSlot, std::memory_order_acq_rel) & 3;
+    }
+    return slots[frontSlot];
+}
+
+void SpectrumAnalyzer::publish(const Snapshot &value)
+{
+    slots[backSlot] = value;
+    backSlot = middle.exchange(backSlot | kDirty, std::memory_order_acq_rel) & 3;
+}
+
+void SpectrumAnalyzer::rebuildBands(int rate)
+{
+    bandRate = rate;
+    for (int b = 0; b <= kBandCount; ++b) {
+        const double hz = kMinBandHz * qPow(kMaxBandHz / kMinBandHz, double(b) / kBandCount);
+        bandEdges[b] = qBound(1, qRound(hz * kFftSize / rate), kHalfSize);
+    }
+    // 低频处一个频点可能覆盖多个频带，保证每个频带至少一个频点
+    for (int b = 1; b <= kBandCount; ++b) {
+        bandEdges[b] = qMax(bandEdges[b], qMin(bandEdges[b - 1] + 1, kHalfSize));
+    }
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    QElapsedTimer cost;
+    cost.start();
+
+    const int ch = channels.load();
+    const int rate = sampleRate.load();
+    if (ch != historyChannels) {
+        historyChannels = ch;
+        history.assign(size_t(kFftSize) * ch, 0.0f);
+        incoming.resize(size_t(kFftSize) * ch);
+    }
+    if (rate != bandRate) rebuildBands(rate);
+
+    // 取出全部新数据，只保留最近 kFftSize 帧
+    const qint64 frameBytes = ch * qint64(sizeof(float));
+    qint64 available = tap.readAvailable();
+    available -= available % frameBytes;
+    qint64 newFrames = 0;
+    while (available > 0) {
+        const qint64 bytes = tap.read(reinterpret_cast<char *>(incoming.data()),
+                                      qMin(available, qint64(incoming.size() * sizeof(float))));
+        const qint64 frames = bytes / frameBytes;
+        const size_t shift = size_t(frames * ch);
+        std::memmove(history.data(), history.data() + shift, (history.size() - shift) * sizeof(float));
+        std::memcpy(history.data() + history.size() - shift, incoming.data(), shift * sizeof(float));
+        available -= bytes;
+        newFrames += frames;
+    }
+
+    if (newFrames == 0) {
+        // 暂停或缓冲中：逐渐归零
+        for (float &band : current.bands) band *= 1.0f - kRelease;
+        current.level *= 1.0f - kRelease;
+        current.beat *= kBeatDecay;
+        publish(current);
+        return;
+    }
+
+    // 混为单声道并加窗
+    int i = 0;
+#ifdef MELODY_HAVE_SSE2
+    if (ch == 2) {
+        const float *src = history.data();
+        for (; i + 4 <= kFftSize; i += 4) {
+            const __m128 a = _mm_loadu_ps(src + i * 2);     // L0 R0 L1 R1
+            const __m128 b = _mm_loadu_ps(src + i * 2 + 4); // L2 R2 L3 R3
+            const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(windowed.data() + i,
+                          _mm_mul_ps(_mm_add_ps(left, right), _mm_loadu_ps(halfWindow.data() + i)));
+        }
+    }
+#endif
+    const float scale = 2.0f / ch; // halfWindow 已含 0.5
+    for (; i < kFftSize; ++i) {
+        float sum = 0;
+        for (int c = 0; c < ch; ++c) sum += history[size_t(i) * ch + c];
+        windowed[i] = sum * scale * halfWindow[i];
+    }
+
+    transform();
+
+    // 满幅正弦经 Hann 窗后主瓣功率约为 1.5 * (N/4)^2，归一化到 0dB
+    const float norm = 1.0f / (1.5f * (kFftSize / 4.0f) * (kFftSize / 4.0f));
+    float bandEnergy[kBandCount];
+    float total = 0;
+    for (int b = 0; b < kBandCount; ++b) {
+        float energy = 0;
+        for (int k = bandEdges[b]; k < bandEdges[b + 1]; ++k) energy += std::norm(spectrum[k]);
+        bandEnergy[b] = energy * norm;
+        const float db = bandEnergy[b] > 0 ? 10.0f * std::log10(bandEnergy[b]) : kFloorDb;
+        const float target = qBound(0.0f, 1.0f - db / kFloorDb, 1.0f);
+        float &band = current.bands[b];
+        band += (target - band) * (target > band ? kAttack : kRelease);
+        total += band;
+    }
+    current.level = total / kBandCount;
+
+    // 节拍：低频能量相对近期平均的突增
+    const float bass = bandEnergy[0] + bandEnergy[1];
+    ++ticksSinceBeat;
+    if (bassAverage > 0 && bass > bassAverage * kBeatThreshold && ticksSinceBeat >= kMinBeatTicks) {
+        current.beat = 1.0f;
+        ticksSinceBeat = 0;
+    } else {
+        current.beat *= kBeatDecay;
+    }
+    bassAverage += (bass - bassAverage) * 0.05f;
+
+    publish(current);
+    Metrics::observe("spectrum_analysis_us", cost.nsecsElapsed() / 1e3);
+}
+
+void SpectrumAnalyzer::transform()
+{
+    // N 点实数序列看作 N/2 点复数序列（偶数下标为实部、奇数为虚部）做 FFT，再拆分
+    std::complex<float> *a = spectrum.data();
+    for (int k = 0; k < kHalfSize; ++k) {
+        const int j = bitReverse[k];
+        a[j] = std::complex<float>(windowed[2 * k], windowed[2 * k + 1]);
+    }
+    for (int len = 2; len <= kHalfSize; len <<= 1) {
+        const int half = len / 2;
+        const int step = kHalfSize / len;
+        for (int start = 0; start < kHalfSize; start += len) {
+            for (int j = 0; j < half; ++j) {
+                const std::complex<float> u = a[start + j];
+                const std::complex<float> v = a[start + j + half] * twiddles[j * step];
+                a[start + j] = u + v;
+                a[start + j + half] = u - v;
+            }
+        }
+    }
+
+    // X[k] = (Z[k] + conj(Z[M-k])) / 2 - i * W^k * (Z[k] - conj(Z[M-k])) / 2，k 与 M-k 成对计算
+    const std::complex<float> z0 = a[0];
+    a[kHalfSize] = std::complex<float>(z0.real() - z0.imag(), 0.0f);
+    a[0] = std::complex<float>(z0.real() + z0.imag(), 0.0f);
+    for (int k = 1; k <= kHalfSize / 2; ++k) {
+        const std::complex<float> zk = a[k];
+        const std::complex<float> zm = std::conj(a[kHalfSize - k]);
+        const std::complex<float> even = (zk + zm) * 0.5f;
+        const std::complex<float> odd = (zk - zm) * std::complex<float>(0.0f, -0.5f);
+        // X[M-k] 用到的是同一对数据，其偶、奇部分分别为 even、odd 的共轭
+        const std::complex<float> evenMirror = std::conj(even);
+        const std::complex<float> oddMirror = std::conj(odd);
+        a[k] = even + postTwiddles[k] * odd;
+        if (k != kHalfSize - k) {
+            a[kHalfSize - k] = evenMirror + postTwiddles[kHalfSize - k] * oddMirror;
+        }
+    }
+}
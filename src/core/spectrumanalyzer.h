@@ -0,0 +1,80 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <complex>
+#include <vector>
+#include "spscringbuffer.h"
+
+class QTimer;
+
+// 实时频谱分析：声卡回调把正在播放的 PCM 拷入无锁环形缓冲区（feed），
+// 分析线程每 33ms 取最近 1024 帧做加窗和实数 FFT，算出对数分布的频带能量与节拍强度，
+// 通过三缓冲快照发布，界面线程无锁读取。stop() 后分析线程退出，feed 直接返回
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kBandCount = 8;
+
+    struct Snapshot {
+        float bands[kBandCount] = {}; // 各频带强度 0~1，低频在前
+        float level = 0;              // 整体强度 0~1
+        float beat = 0;               // 节拍强度：低频突增时为 1，随后衰减
+    };
+
+    explicit SpectrumAnalyzer(QObject *parent = nullptr);
+    ~SpectrumAnalyzer();
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // 输出格式，引擎在创建或切换声卡格式时设置
+    void setFormat(int sampleRate, int channelCount);
+    // 声卡回调线程调用：只拷贝数据，不加锁不分配；未运行时直接返回
+    void feed(const float *samples, qint64 frames);
+
+    // 取最新的分析结果；只能由同一个线程（界面线程）调用
+    Snapshot snapshot();
+
+private:
+    void analyze();  // 分析线程
+    void publish(const Snapshot &value);
+    void rebuildBands(int sampleRate);
+    void transform(); // windowed -> spectrum（实数 FFT，结果为前 N/2 + 1 个频点）
+
+    QThread thread;
+    QObject *worker;
+    QTimer *timer;
+    std::atomic<bool> running { false };
+    std::atomic<int> sampleRate { 48000 };
+    std::atomic<int> channels { 2 };
+    SpscRingBuffer tap;
+
+    // 以下只在分析线程中使用
+    std::vector<float> history;   // 最近 kFftSize 帧，交错排列
+    std::vector<float> incoming;
+    std::vector<float> halfWindow; // Hann 窗乘 0.5（立体声混为单声道）
+    std::vector<float> windowed;
+    std::vector<std::complex<float>> spectrum;
+    std::vector<std::complex<float>> twiddles;     // N/2 点复数 FFT
+    std::vector<std::complex<float>> postTwiddles; // 由 N/2 点复数结果拆出 N 点实数结果
+    std::vector<int> bitReverse;
+    int bandEdges[kBandCount + 1] = {};
+    int bandRate = 0;
+    int historyChannels = 0;
+    Snapshot current;
+    float bassAverage = 0;
+    qint64 ticksSinceBeat = 0;
+
+    // 三缓冲：写端和读端各占一个槽，中间槽交换；middle 的第 3 位表示有新数据
+    Snapshot slots[3];
+    std::atomic<int> middle { 1 };
+    int backSlot = 0;  // 分析线程
+    int frontSlot = 2; // 界面线程
+};
+
+#endif // SPECTRUMANALYZER_H
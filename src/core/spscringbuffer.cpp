@@ -0,0 +1,61 @@
+#include "spscringbuffer.h"
+#include <cstring>
+
+SpscRingBuffer::SpscRingBuffer(qint64 capacity)
+{
+    quint64 size = 1;
+    while (size < quint64(qMax<qint64>(capacity, 2))) size <<= 1;
+    buffer.resize(size);
+    mask = size - 1;
+}
+
+qint64 SpscRingBuffer::capacity() const
+{
+    return qint64(buffer.size());
+}
+
+qint64 SpscRingBuffer::readAvailable() const
+{
+    return qint64(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire));
+}
+
+qint64 SpscRingBuffer::writeAvailable() const
+{
+    return capacity() - readAvailable();
+}
+
+qint64 SpscRingBuffer::write(const char *data, qint64 size)
+{
+    const quint64 write = writePos.load(std::memory_order_relaxed);
+    const quint64 read = readPos.load(std::memory_order_acquire);
+    const qint64 count = qMin<qint64>(size, capacity() - qint64(write - read));
+    if (count <= 0) return 0;
+
+    const quint64 offset = write & mask;
+    const qint64 first = qMin<qint64>(count, capacity() - qint64(offset));
+    memcpy(buffer.data() + offset, data, size_t(first));
+    memcpy(buffer.data(), data + first, size_t(count - first));
+    writePos.store(write + quint64(count), std::memory_order_release);
+    return count;
+}
+
+qint64 SpscRingBuffer::read(char *data, qint64 size)
+{
+    const quint64 read = readPos.load(std::memory_order_relaxed);
+    const quint64 write = writePos.load(std::memory_order_acquire);
+    const qint64 count = qMin<qint64>(size, qint64(write - read));
+    if (count <= 0) return 0;
+
+    const quint64 offset = read & mask;
+    const qint64 first = qMin<qint64>(count, capacity() - qint64(offset));
+    memcpy(data, buffer.data() + offset, size_t(first));
+    memcpy(data + first, buffer.data(), size_t(count - first));
+    readPos.store(read + quint64(count), std::memory_order_release);
+    return count;
+}
+
+void SpscRingBuffer::reset()
+{
+    readPos.store(0, std::memory_order_relaxed);
+    writePos.store(0, std::memory_order_release);
+}
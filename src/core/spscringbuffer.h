@@ -0,0 +1,34 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// 单生产者单消费者的无锁环形缓冲区（字节）。
+// 解码线程写入、声卡回调读取，两端都不加锁也不分配内存；
+// 容量向上取整为 2 的幂，读写位置单调递增，用掩码取下标
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(qint64 capacity);
+
+    qint64 capacity() const;
+    qint64 readAvailable() const;
+    qint64 writeAvailable() const;
+
+    qint64 write(const char *data, qint64 size); // 仅生产者调用，返回实际写入的字节数
+    qint64 read(char *data, qint64 size);        // 仅消费者调用，返回实际读出的字节数
+
+    // 清空缓冲区；调用时两端都必须处于空闲状态
+    void reset();
+
+private:
+    std::vector<char> buffer;
+    quint64 mask;
+    // 分开缓存行，避免读写两端互相伪共享
+    alignas(64) std::atomic<quint64> writePos { 0 };
+    alignas(64) std::atomic<quint64> readPos { 0 };
+};
+
+#endif // SPSCRINGBUFFER_H
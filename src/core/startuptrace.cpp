@@ -0,0 +1,145 @@
+#include "startuptrace.h"
+#include "logging.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    qint64 startNs;
+    qint64 endNs; // 瞬时事件为 -1
+};
+
+struct TraceState {
+    QElapsedTimer clock;
+    bool enabled = false;
+    bool finished = false;
+    QString outputPath;
+    QVector<TraceEvent> events;
+    QVector<int> openEvents; // 尚未结束的阶段（下标），支持嵌套
+};
+
+TraceState &state()
+{
+    static TraceState s;
+    return s;
+}
+
+} // namespace
+
+void StartupTrace::initialize(int argc, char *argv[])
+{
+    TraceState &s = state();
+    s.clock.start();
+
+    static const char kOption[] = "--trace-startup";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], kOption, sizeof(kOption) - 1) != 0) continue;
+        const char *rest = argv[i] + sizeof(kOption) - 1;
+        if (*rest == '=') {
+            s.outputPath = QString::fromLocal8Bit(rest + 1);
+        } else if (*rest != '\0') {
+            continue;
+        }
+        s.enabled = true;
+    }
+
+    const QByteArray env = qgetenv("MELODY_TRACE_STARTUP");
+    if (!env.isEmpty() && env != "0") {
+        s.enabled = true;
+        if (s.outputPath.isEmpty() && env != "1") {
+            s.outputPath = QString::fromLocal8Bit(env);
+        }
+    }
+    if (s.enabled && s.outputPath.isEmpty()) {
+        s.outputPath = "melody-startup-trace.json";
+    }
+    if (s.enabled) {
+        s.events.reserve(64);
+    }
+}
+
+bool StartupTrace::isEnabled()
+{
+    return state().enabled;
+}
+
+void StartupTrace::begin(const char *name)
+{
+    TraceState &s = state();
+    if (!s.enabled || s.finished) return;
+    s.openEvents.append(s.events.size());
+    s.events.append({ name, s.clock.nsecsElapsed(), 0 });
+}
+
+void StartupTrace::end()
+{
+    TraceState &s = state();
+    if (!s.enabled || s.finished || s.openEvents.isEmpty()) return;
+    s.events[s.openEvents.takeLast()].endNs = s.clock.nsecsElapsed();
+}
+
+void StartupTrace::mark(const char *name)
+{
+    TraceState &s = state();
+    if (!s.enabled || s.finished) return;
+    s.events.append({ name, s.clock.nsecsElapsed(), -1 });
+}
+
+void StartupTrace::firstPaint()
+{
+    TraceState &s = state();
+    if (s.finished || !s.clock.isValid()) return;
+
+    mark("first paint");
+    s.finished = true;
+    qCInfo(lcStartup) << "Time to first paint:" << s.clock.nsecsElapsed() / 1000000.0 << "ms";
+    if (s.enabled) {
+        write();
+    }
+}
+
+void StartupTrace::write()
+{
+    TraceState &s = state();
+    const qint64 nowNs = s.clock.nsecsElapsed();
+
+    QJsonArray traceEvents;
+    for (const TraceEvent &event : s.events) {
+        QJsonObject obj;
+        obj["name"] = QString::fromUtf8(event.name);
+        obj["cat"] = "startup";
+        obj["pid"] = 1;
+        obj["tid"] = 1;
+        obj["ts"] = event.startNs / 1000.0; // 微秒
+        if (event.endNs < 0) {
+            obj["ph"] = "i";
+            obj["s"] = "g";
+        } else {
+            // 首帧时仍未结束的阶段截断到当前时间
+            const qint64 endNs = event.endNs > 0 ? event.endNs : nowNs;
+            obj["ph"] = "X";
+            obj["dur"] = (endNs - event.startNs) / 1000.0;
+        }
+        traceEvents.append(obj);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(s.outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcStartup) << "Unable to write startup trace:" << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    qCInfo(lcStartup) << "Startup trace written to" << QFileInfo(file).absoluteFilePath();
+}
@@ -0,0 +1,38 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+// 启动耗时追踪：记录各阶段的起止时间，首帧绘制后输出 Chrome Trace 格式的
+// JSON（可在 chrome://tracing 或 Perfetto 中打开）。
+// 通过 --trace-startup[=文件] 参数或 MELODY_TRACE_STARTUP 环境变量开启；
+// 未开启时只统计首帧耗时
+class StartupTrace
+{
+public:
+    // 在 main() 最开始调用，计时从此开始
+    static void initialize(int argc, char *argv[]);
+    static bool isEnabled();
+
+    static void begin(const char *name);
+    static void end();
+    static void mark(const char *name); // 瞬时事件
+
+    // 首帧绘制完成：记录耗时并写出追踪文件（只执行一次）
+    static void firstPaint();
+
+    // 作用域内的阶段
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name) { begin(name); }
+        ~Scope() { end(); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+private:
+    static void write();
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,204 @@
+#include "tagreader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+namespace {
+
+// 单个文本帧的最大读取长度，超过的帧（如内嵌封面）直接跳过
+const quint32 kMaxTextFrameSize = 4096;
+
+quint32 syncSafe(const uchar *p)
+{
+    return (quint32(p[0] & 0x7f) << 21) | (quint32(p[1] & 0x7f) << 14) |
+           (quint32(p[2] & 0x7f) << 7) | quint32(p[3] & 0x7f);
+}
+
+// ISO-8859-1 帧在中文环境中常被写成本地编码（GBK）
+QString decodeLegacy(const QByteArray &data)
+{
+    for (char c : data) {
+        if (static_cast<uchar>(c) >= 0x80) {
+            return QString::fromLocal8Bit(data);
+        }
+    }
+    return QString::fromLatin1(data);
+}
+
+QString decodeId3Text(const QByteArray &frame)
+{
+    if (frame.isEmpty()) return QString();
+    const char encoding = frame.at(0);
+    QByteArray body = frame.mid(1);
+    QString text;
+    switch (encoding) {
+    case 1: // UTF-16 带 BOM
+    case 2: // UTF-16BE
+    {
+        bool littleEndian = false;
+        if (body.size() >= 2) {
+            uchar b0 = body.at(0), b1 = body.at(1);
+            if (b0 == 0xff && b1 == 0xfe) { littleEndian = true; body.remove(0, 2); }
+            else if (b0 == 0xfe && b1 == 0xff) { body.remove(0, 2); }
+        }
+        QVector<char16_t> units;
+        for (int i = 0; i + 1 < body.size(); i += 2) {
+            uchar lo = body.at(littleEndian ? i : i + 1);
+            uchar hi = body.at(littleEndian ? i + 1 : i);
+            char16_t unit = char16_t((hi << 8) | lo);
+            if (unit == 0) break;
+            units.append(unit);
+        }
+        text = QString::fromUtf16(units.constData(), units.size());
+        break;
+    }
+    case 3: // UTF-8
+        text = QString::fromUtf8(body.left(body.indexOf('\0') >= 0 ? body.indexOf('\0') : body.size()));
+        break;
+    default:
+        text = decodeLegacy(body.left(body.indexOf('\0') >= 0 ? body.indexOf('\0') : body.size()));
+        break;
+    }
+    return text.trimmed();
+}
+
+bool readId3v2(QFile &file, AudioTags &tags)
+{
+    QByteArray header = file.read(10);
+    if (header.size() < 10 || !header.startsWith("ID3")) return false;
+
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    const int version = h[3];
+    if (version < 3 || version > 4) return false;
+    const quint32 tagSize = syncSafe(h + 6);
+    const qint64 tagEnd = 10 + tagSize;
+
+    // 跳过扩展头
+    if (h[5] & 0x40) {
+        QByteArray ext = file.read(4);
+        if (ext.size() < 4) return false;
+        const uchar *e = reinterpret_cast<const uchar *>(ext.constData());
+        quint32 extSize = version == 4 ? syncSafe(e) : qFromBigEndian<quint32>(e) + 4;
+        file.seek(10 + extSize);
+    }
+
+    bool found = false;
+    while (file.pos() + 10 <= tagEnd) {
+        QByteArray frameHeader = file.read(10);
+        if (frameHeader.size() < 10 || frameHeader.at(0) == '\0') break; // 填充区
+        const uchar *f = reinterpret_cast<const uchar *>(frameHeader.constData());
+        const QByteArray id = frameHeader.left(4);
+        const quint32 size = version == 4 ? syncSafe(f + 4) : qFromBigEndian<quint32>(f + 4);
+        const qint64 next = file.pos() + size;
+        if (size == 0 || next > tagEnd) break;
+
+        if (size <= kMaxTextFrameSize && (id == "TIT2" || id == "TPE1" || id == "TALB" || id == "TLEN")) {
+            QString text = decodeId3Text(file.read(size));
+            if (id == "TIT2") tags.title = text;
+            else if (id == "TPE1") tags.artist = text.section(QChar('/'), 0, 0);
+            else if (id == "TALB") tags.album = text;
+            else tags.duration = text.toInt() / 1000;
+            found = true;
+        }
+        file.seek(next);
+    }
+    return found;
+}
+
+bool readId3v1(QFile &file, AudioTags &tags)
+{
+    if (file.size() < 128 || !file.seek(file.size() - 128)) return false;
+    QByteArray tag = file.read(128);
+    if (!tag.startsWith("TAG")) return false;
+
+    auto field = [&tag](int offset, int length) {
+        QByteArray raw = tag.mid(offset, length);
+        int end = raw.indexOf('\0');
+        return decodeLegacy(end >= 0 ? raw.left(end) : raw).trimmed();
+    };
+    if (tags.title.isEmpty()) tags.title = field(3, 30);
+    if (tags.artist.isEmpty()) tags.artist = field(33, 30);
+    if (tags.album.isEmpty()) tags.album = field(63, 30);
+    return !tags.title.isEmpty();
+}
+
+bool readFlac(QFile &file, AudioTags &tags)
+{
+    file.seek(0);
+    if (file.read(4) != "fLaC") return false;
+
+    bool found = false;
+    bool last = false;
+    while (!last) {
+        QByteArray blockHeader = file.read(4);
+        if (blockHeader.size() < 4) break;
+        const uchar *b = reinterpret_cast<const uchar *>(blockHeader.constData());
+        last = b[0] & 0x80;
+        const int type = b[0] & 0x7f;
+        const quint32 length = (quint32(b[1]) << 16) | (quint32(b[2]) << 8) | b[3];
+        const qint64 next = file.pos() + length;
+
+        if (type == 0 && length >= 18) { // STREAMINFO
+            QByteArray info = file.read(18);
+            const uchar *s = reinterpret_cast<const uchar *>(info.constData());
+            quint32 sampleRate = (quint32(s[10]) << 12) | (quint32(s[11]) << 4) | (s[12] >> 4);
+            quint64 totalSamples = (quint64(s[13] & 0x0f) << 32) | qFromBigEndian<quint32>(s + 14);
+            if (sampleRate > 0) tags.duration = int(totalSamples / sampleRate);
+        } else if (type == 4) { // VORBIS_COMMENT（小端）
+            QByteArray block = file.read(length);
+            const uchar *p = reinterpret_cast<const uchar *>(block.constData());
+            qint64 pos = 0;
+            auto readU32 = [&]() -> quint32 {
+                if (pos + 4 > block.size()) return 0;
+                quint32 v = qFromLittleEndian<quint32>(p + pos);
+                pos += 4;
+                return v;
+            };
+            pos += readU32(); // vendor
+            quint32 count = readU32();
+            for (quint32 i = 0; i < count && pos < block.size(); ++i) {
+                quint32 len = readU32();
+                if (pos + len > block.size()) break;
+                QString comment = QString::fromUtf8(block.constData() + pos, len);
+                pos += len;
+                QString key = comment.section(QChar('='), 0, 0).toUpper();
+                QString value = comment.section(QChar('='), 1);
+                if (key == "TITLE") tags.title = value;
+                else if (key == "ARTIST" && tags.artist.isEmpty()) tags.artist = value;
+                else if (key == "ALBUM") tags.album = value;
+            }
+            found = !tags.title.isEmpty();
+        }
+        if (!file.seek(next)) break;
+    }
+    return found;
+}
+
+} // namespace
+
+AudioTags TagReader::read(const QString &filePath)
+{
+    AudioTags tags;
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QString suffix = QFileInfo(filePath).suffix().toLower();
+        if (suffix == "flac") {
+            readFlac(file, tags);
+        } else if (!readId3v2(file, tags) || tags.title.isEmpty()) {
+            readId3v1(file, tags);
+        }
+    }
+
+    // 从文件名推断："歌手 - 歌名.mp3"
+    if (tags.title.isEmpty()) {
+        const QString baseName = QFileInfo(filePath).completeBaseName();
+        const int sep = baseName.indexOf(" - ");
+        if (sep > 0) {
+            if (tags.artist.isEmpty()) tags.artist = baseName.left(sep).trimmed();
+            tags.title = baseName.mid(sep + 3).trimmed();
+        } else {
+            tags.title = baseName;
+        }
+    }
+    return tags;
+}
@@ -0,0 +1,22 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QString>
+
+// 本地音频文件的基本标签
+struct AudioTags {
+    QString title;
+    QString artist;
+    QString album;
+    int duration = 0; // 秒，未知时为0
+};
+
+// 轻量标签读取：ID3v2/ID3v1（mp3）、Vorbis Comment（flac），
+// 均无标签时从文件名 "歌手 - 歌名" 推断。只读取文件头尾，不解码音频。
+namespace TagReader {
+
+AudioTags read(const QString &filePath);
+
+} // namespace TagReader
+
+#endif // TAGREADER_H
@@ -0,0 +1,267 @@
+#include "trackanalysisservice.h"
+#include "loudnessanalyzer.h"
+#include "loudnesscache.h"
+#include "trimcache.h"
+#include "logging.h"
+#include "metrics.h"
+#include <QAudioDecoder>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QtMath>
+#include <memory>
+
+// 分析与播放争用 CPU 和磁盘，最多同时分析两首
+static const int kMaxAnalysisThreads = 2;
+// 单首曲目的分析超时（网络地址可能卡住）
+static const int kAnalysisTimeoutMs = 5 * 60 * 1000;
+// 解码过程中检查取消的间隔
+static const int kCancelPollMs = 200;
+
+// 在线程池线程中运行：用局部事件循环驱动 QAudioDecoder，解码结果同时送入响度测量、波形计算
+// 和（trim 非空时）首尾静音检测
+static bool analyzeTrack(const QUrl &url, const std::atomic<bool> &cancelled, double *lufs, Waveform *waveform,
+                         TrimPoints *trim)
+{
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::Float);
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+
+    QAudioDecoder decoder;
+    decoder.setAudioFormat(format);
+    decoder.setSource(url);
+
+    std::unique_ptr<LoudnessAnalyzer> analyzer;
+    std::unique_ptr<WaveformBuilder> builder;
+    std::unique_ptr<SilenceDetector> silence;
+    bool failed = false;
+    QEventLoop loop;
+
+    auto drain = [&]() {
+        while (decoder.bufferAvailable()) {
+            const QAudioBuffer buffer = decoder.read();
+            if (!buffer.isValid()) break;
+            if (buffer.format().sampleFormat() != QAudioFormat::Float) {
+                failed = true;
+                loop.quit();
+                return;
+            }
+            if (!analyzer) {
+                analyzer.reset(new LoudnessAnalyzer(buffer.format().sampleRate(), buffer.format().channelCount()));
+                builder.reset(new WaveformBuilder(buffer.format().sampleRate(), buffer.format().channelCount()));
+                if (trim) silence.reset(new SilenceDetector(buffer.format().sampleRate(), buffer.format().channelCount()));
+            }
+            analyzer->process(buffer.constData<float>(), buffer.frameCount());
+            builder->process(buffer.constData<float>(), buffer.frameCount());
+            if (silence) silence->process(buffer.constData<float>(), buffer.frameCount());
+        }
+    };
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, drain);
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, [&]() {
+        if (!failed) drain();
+        loop.quit();
+    });
+    QObject::connect(&decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), &loop, [&]() {
+        qCDebug(lcPlayback) << "Track analysis failed:" << url << decoder.errorString();
+        failed = true;
+        loop.quit();
+    });
+
+    QTimer poll;
+    poll.setInterval(kCancelPollMs);
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (cancelled.load()) {
+            failed = true;
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(kAnalysisTimeoutMs, &loop, [&]() {
+        qCWarning(lcPlayback) << "Track analysis timed out:" << url;
+        failed = true;
+        loop.quit();
+    });
+
+    poll.start();
+    decoder.start();
+    loop.exec();
+    decoder.stop();
+
+    if (failed || !analyzer) return false;
+    // 整首静音时没有响度结果，但波形仍然有效
+    *lufs = analyzer->hasResult() ? analyzer->integratedLoudness() : qQNaN();
+    *waveform = builder->result();
+    if (trim) *trim = silence->trimPoints();
+    return true;
+}
+
+TrackAnalysisService::TrackAnalysisService(QObject *parent)
+    : QObject(parent),
+      cache(new LoudnessCache(QString(), this)),
+      trimCache(new TrimCache(QString(), this))
+{
+    pool.setMaxThreadCount(kMaxAnalysisThreads);
+    pool.setThreadPriority(QThread::LowPriority);
+
+    waveformDir = waveformDirectory();
+    QDir().mkpath(waveformDir);
+}
+
+TrackAnalysisService::~TrackAnalysisService()
+{
+    cancelled.store(true);
+    pool.clear();
+    pool.waitForDone();
+}
+
+QString TrackAnalysisService::keyFor(const Song &song)
+{
+    switch (song.source) {
+    case SearchSource::Bilibili:
+        return song.bvid.isEmpty() ? QString() : "bilibili:" + song.bvid;
+    case SearchSource::Local:
+        return song.filePath.isEmpty() ? QString() : "local:" + song.filePath;
+    default:
+        return song.id > 0 ? "netease:" + QString::number(song.id) : QString();
+    }
+}
+
+bool TrackAnalysisService::loudness(const QString &key, double *lufs) const
+{
+    return !key.isEmpty() && cache->lookup(key, lufs);
+}
+
+float TrackAnalysisService::normalizationGain(const QString &key) const
+{
+    double lufs = 0;
+    if (!loudness(key, &lufs)) return 1.0f;
+    return float(qPow(10.0, LoudnessAnalyzer::gainToTarget(lufs) / 20.0));
+}
+
+QString TrackAnalysisService::trimKeyFor(const QString &bvid, qint64 cid)
+{
+    return bvid.isEmpty() || cid <= 0 ? QString() : QString("bilibili:%1:%2").arg(bvid).arg(cid);
+}
+
+bool TrackAnalysisService::trimPoints(const QString &trimKey, TrimPoints *points) const
+{
+    return !trimKey.isEmpty() && trimCache->lookup(trimKey, points);
+}
+
+QString TrackAnalysisService::waveformDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/waveforms";
+}
+
+QString TrackAnalysisService::waveformPath(const QString &key) const
+{
+    // 本地路径可能很长或含有特殊字符，文件名用键的哈希
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return waveformDir + "/" + QString::fromLatin1(hash) + ".wf";
+}
+
+Waveform TrackAnalysisService::waveform(const QString &key) const
+{
+    if (key.isEmpty()) return Waveform();
+    return Waveform::load(waveformPath(key));
+}
+
+void TrackAnalysisService::analyze(const QString &key, const QUrl &url, const QString &trimKey)
+{
+    if (key.isEmpty() || url.isEmpty() || pending.contains(key)) return;
+    if (cache->lookup(key, nullptr) && QFile::exists(waveformPath(key))
+        && (trimKey.isEmpty() || trimCache->lookup(trimKey, nullptr))) {
+        return;
+    }
+    startJob(key, url, trimKey);
+}
+
+void TrackAnalysisService::analyzeDownloaded(const QString &key, const QString &trimKey,
+                                             const ChunkedAudioBuffer::Snapshot &audio)
+{
+    if (key.isEmpty() || !audio.isValid() || pending.contains(key)) return;
+    if (cache->lookup(key, nullptr) && QFile::exists(waveformPath(key))
+        && (trimKey.isEmpty() || trimCache->lookup(trimKey, nullptr))) {
+        return;
+    }
+    startJob(key, QUrl(), trimKey, audio);
+}
+
+void TrackAnalysisService::startJob(const QString &key, const QUrl &url, const QString &trimKey,
+                                    const ChunkedAudioBuffer::Snapshot &audio)
+{
+    pending.insert(key);
+    const QString path = waveformPath(key);
+
+    // 析构时先置取消标志再等待线程池，任务结束前 this 始终有效
+    pool.start([this, key, url, trimKey, audio, path]() {
+        if (cancelled.load()) return;
+        QElapsedTimer timer;
+        timer.start();
+        Result result;
+        Waveform waveform;
+        // 下载好的数据（B 站音频需要 Referer，解码器不能直接下载）先写入临时文件，任务结束时删除
+        QTemporaryFile file(ChunkedAudioBuffer::tempFileTemplate());
+        QUrl source = url;
+        bool ready = true;
+        if (audio.isValid()) {
+            ready = file.open() && audio.writeTo(&file) && file.flush();
+            if (ready) {
+                source = QUrl::fromLocalFile(file.fileName());
+            } else {
+                qCWarning(lcPlayback) << "Unable to write audio for analysis:" << file.errorString();
+            }
+            file.close();
+        }
+        if (ready) {
+            result.ok = analyzeTrack(source, cancelled, &result.lufs, &waveform,
+                                     trimKey.isEmpty() ? nullptr : &result.trim);
+        }
+        result.hasTrim = result.ok && !trimKey.isEmpty();
+        if (cancelled.load()) return;
+        // 波形文件在工作线程中写入，界面线程只在需要时读取
+        result.hasWaveform = result.ok && !waveform.isEmpty() && waveform.save(path);
+        const qint64 elapsed = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, key, trimKey, result, elapsed]() {
+            Metrics::observe("track_analysis_ms", double(elapsed));
+            finishJob(key, trimKey, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TrackAnalysisService::recordLoudness(const QString &key, double lufs)
+{
+    if (key.isEmpty()) return;
+    cache->insert(key, lufs);
+    emit loudnessReady(key, lufs);
+}
+
+void TrackAnalysisService::recordWaveform(const QString &key, const Waveform &waveform)
+{
+    if (key.isEmpty() || waveform.isEmpty()) return;
+    const QString path = waveformPath(key);
+    pool.start([this, key, waveform, path]() {
+        if (cancelled.load() || !waveform.save(path)) return;
+        QMetaObject::invokeMethod(this, [this, key]() { emit waveformReady(key); }, Qt::QueuedConnection);
+    });
+}
+
+void TrackAnalysisService::finishJob(const QString &key, const QString &trimKey, const Result &result)
+{
+    pending.remove(key);
+    Metrics::increment("track_analysis_total", { { "result", result.ok ? "ok" : "failed" } });
+    if (!result.ok) return;
+    qCDebug(lcPlayback) << "Analyzed" << key << result.lufs << "LUFS";
+    if (!qIsNaN(result.lufs)) recordLoudness(key, result.lufs);
+    if (result.hasWaveform) emit waveformReady(key);
+    if (result.hasTrim) {
+        qCDebug(lcPlayback) << "Trim points for" << trimKey << result.trim.startMs << result.trim.endMs;
+        trimCache->insert(trimKey, result.trim);
+        emit trimPointsReady(trimKey, result.trim);
+    }
+}
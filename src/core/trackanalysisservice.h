@@ -0,0 +1,76 @@
+#ifndef TRACKANALYSISSERVICE_H
+#define TRACKANALYSISSERVICE_H
+
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QUrl>
+#include <atomic>
+#include "chunkedaudiobuffer.h"
+#include "playlistmanager.h"
+#include "silencedetector.h"
+#include "waveform.h"
+
+class LoudnessCache;
+class TrimCache;
+
+// 曲目分析服务：在低优先级线程池中解码音频，一次解码同时测量响度和计算波形概览，结果存入持久缓存。
+// 播放开始时只查缓存，不等待分析，因此不增加起播延迟；
+// 尚未分析过的曲目可由 PCM 引擎在首次播放时边解码边测量响度和波形（recordLoudness / recordWaveform）。
+// B 站音频还检测首尾静音，按 bvid + cid 保存裁剪点
+class TrackAnalysisService : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrackAnalysisService(QObject *parent = nullptr);
+    ~TrackAnalysisService(); // 取消排队中的分析并等待进行中的分析退出
+
+    // 缓存键：netease:<id>、bilibili:<bvid>、local:<文件路径>；无法识别的曲目返回空
+    static QString keyFor(const Song &song);
+    // 裁剪点的缓存键：同一个 bvid 的不同分 P 音频不同
+    static QString trimKeyFor(const QString &bvid, qint64 cid);
+    static QString waveformDirectory(); // 缓存目录下的 waveforms，每首曲目一个 .wf 文件
+
+    bool loudness(const QString &key, double *lufs) const;
+    // 归一化到目标响度需要的线性增益；未分析过的曲目返回 1.0
+    float normalizationGain(const QString &key) const;
+    // 从磁盘读取波形概览（约 3 KB）；未分析过的曲目返回空波形
+    Waveform waveform(const QString &key) const;
+    bool trimPoints(const QString &trimKey, TrimPoints *points) const;
+
+    // 后台分析 url 指向的本地音频，trimKey 非空时同时检测首尾静音；结果都已缓存或正在分析的曲目忽略
+    void analyze(const QString &key, const QUrl &url, const QString &trimKey = QString());
+    // 分析已完整下载的 B 站音频（同时检测首尾静音）：在工作线程中写入临时文件后解码，完成后删除
+    void analyzeDownloaded(const QString &key, const QString &trimKey, const ChunkedAudioBuffer::Snapshot &audio);
+    void recordLoudness(const QString &key, double lufs); // 播放时测得的结果
+    void recordWaveform(const QString &key, const Waveform &waveform); // 同上，在工作线程中存盘
+
+signals:
+    void loudnessReady(const QString &key, double lufs);
+    void waveformReady(const QString &key);
+    void trimPointsReady(const QString &trimKey, const TrimPoints &points);
+
+private:
+    struct Result {
+        bool ok = false;
+        double lufs = 0;        // 整首静音时为 NaN
+        bool hasWaveform = false;
+        bool hasTrim = false;
+        TrimPoints trim;
+    };
+
+    // audio 有效时分析其中的数据，忽略 url
+    void startJob(const QString &key, const QUrl &url, const QString &trimKey,
+                  const ChunkedAudioBuffer::Snapshot &audio = ChunkedAudioBuffer::Snapshot());
+    void finishJob(const QString &key, const QString &trimKey, const Result &result);
+    QString waveformPath(const QString &key) const;
+
+    LoudnessCache *cache;
+    TrimCache *trimCache;
+    QString waveformDir; // waveformDirectory()
+    QThreadPool pool;
+    QSet<QString> pending;
+    std::atomic<bool> cancelled { false };
+};
+
+#endif // TRACKANALYSISSERVICE_H
@@ -0,0 +1,128 @@
+#include "trimcache.h"
+#include "logging.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+
+static const quint32 kMagic = 0x4D54524D; // "MRTM"
+static const quint16 kVersion = 1;
+static const int kMaxEntries = 50000;
+static const int kWriteDelayMs = 5000;
+
+TrimCache::TrimCache(const QString &filePath, QObject *parent)
+    : QObject(parent)
+{
+    path = filePath;
+    if (path.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        path = dir + "/trimpoints.bin";
+    }
+
+    writeTimer = new QTimer(this);
+    writeTimer->setSingleShot(true);
+    writeTimer->setInterval(kWriteDelayMs);
+    connect(writeTimer, &QTimer::timeout, this, &TrimCache::flush);
+
+    load();
+}
+
+TrimCache::~TrimCache()
+{
+    flush();
+}
+
+bool TrimCache::lookup(const QString &key, TrimPoints *points) const
+{
+    auto it = entries.constFind(key);
+    if (it == entries.constEnd()) return false;
+    if (points) {
+        points->startMs = it->startMs;
+        points->endMs = it->endMs;
+    }
+    return true;
+}
+
+void TrimCache::insert(const QString &key, const TrimPoints &points)
+{
+    Entry &entry = entries[key];
+    entry.startMs = qint32(points.startMs);
+    entry.endMs = qint32(points.endMs);
+    entry.storedAt = QDateTime::currentMSecsSinceEpoch();
+    if (entries.size() > kMaxEntries) prune();
+    dirty = true;
+    writeTimer->start();
+}
+
+void TrimCache::flush()
+{
+    writeTimer->stop();
+    if (!dirty) return;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << quint32(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        out << it.key() << it->startMs << it->endMs << it->storedAt;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcPlayback) << "Unable to save trim cache:" << file.errorString();
+        return;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(lcPlayback) << "Unable to save trim cache:" << file.errorString();
+        return;
+    }
+    dirty = false;
+}
+
+void TrimCache::load()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion) {
+        qCWarning(lcPlayback) << "Ignoring incompatible trim cache" << path;
+        return;
+    }
+
+    entries.reserve(int(qMin<quint32>(count, kMaxEntries)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Entry entry;
+        in >> key >> entry.startMs >> entry.endMs >> entry.storedAt;
+        if (in.status() == QDataStream::Ok) entries.insert(key, entry);
+    }
+    qCDebug(lcPlayback) << "Loaded" << entries.size() << "trim entries";
+}
+
+void TrimCache::prune()
+{
+    // 淘汰最早的十分之一
+    QVector<qint64> times;
+    times.reserve(entries.size());
+    for (const Entry &entry : std::as_const(entries)) times.append(entry.storedAt);
+    const int removeCount = entries.size() - kMaxEntries * 9 / 10;
+    std::nth_element(times.begin(), times.begin() + removeCount, times.end());
+    const qint64 cutoff = times[removeCount];
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->storedAt < cutoff) it = entries.erase(it);
+        else ++it;
+    }
+}
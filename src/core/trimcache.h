@@ -0,0 +1,41 @@
+#ifndef TRIMCACHE_H
+#define TRIMCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include "silencedetector.h"
+
+class QTimer;
+
+// 首尾静音裁剪点的持久缓存，键见 TrackAnalysisService::trimKeyFor（bvid + cid）。
+// 与 LoudnessCache 相同：启动时整体读入内存，修改合并后延迟写入；条目过多时淘汰最早写入的
+class TrimCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrimCache(const QString &filePath = QString(), QObject *parent = nullptr);
+    ~TrimCache();
+
+    bool lookup(const QString &key, TrimPoints *points) const;
+    void insert(const QString &key, const TrimPoints &points);
+
+    void flush(); // 立即写入尚未保存的修改
+
+private:
+    struct Entry {
+        qint32 startMs = 0;
+        qint32 endMs = 0;
+        qint64 storedAt = 0; // 毫秒时间戳
+    };
+
+    void load();
+    void prune();
+
+    QString path;
+    QHash<QString, Entry> entries;
+    QTimer *writeTimer;
+    bool dirty = false;
+};
+
+#endif // TRIMCACHE_H
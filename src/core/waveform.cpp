@@ -0,0 +1,206 @@
+#include "waveform.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QtMath>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MELODY_HAVE_SSE2
+#endif
+
+static const quint32 kMagic = 0x46574C4D; // "MLWF"
+static const quint16 kVersion = 1;
+// 细粒度桶初始为 10ms；桶数达到上限（偶数）时两两合并
+static const int kInitialBucketsPerSecond = 100;
+static const size_t kMaxBuckets = 16 * WaveformBuilder::kBucketCount;
+
+// 累计 count 个采样的最小值、最大值和平方和（平方和用双精度，长桶内不丢精度）
+static void accumulate(const float *samples, qint64 count, float *minimum, float *maximum, double *sumSquares)
+{
+    float lo = *minimum;
+    float hi = *maximum;
+    double sum = 0;
+    qint64 i = 0;
+#ifdef MELODY_HAVE_SSE2
+    if (count >= 4) {
+        __m128 vmin = _mm_set1_ps(lo);
+        __m128 vmax = _mm_set1_ps(hi);
+        __m128d sumLow = _mm_setzero_pd();
+        __m128d sumHigh = _mm_setzero_pd();
+        for (; i + 4 <= count; i += 4) {
+            const __m128 x = _mm_loadu_ps(samples + i);
+            vmin = _mm_min_ps(vmin, x);
+            vmax = _mm_max_ps(vmax, x);
+            const __m128 squares = _mm_mul_ps(x, x);
+            sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(squares));
+            sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(squares, squares)));
+        }
+        float mins[4];
+        float maxs[4];
+        double sums[2];
+        _mm_storeu_ps(mins, vmin);
+        _mm_storeu_ps(maxs, vmax);
+        _mm_storeu_pd(sums, _mm_add_pd(sumLow, sumHigh));
+        for (int k = 0; k < 4; ++k) {
+            lo = qMin(lo, mins[k]);
+            hi = qMax(hi, maxs[k]);
+        }
+        sum = sums[0] + sums[1];
+    }
+#endif
+    for (; i < count; ++i) {
+        const float x = samples[i];
+        lo = qMin(lo, x);
+        hi = qMax(hi, x);
+        sum += double(x) * x;
+    }
+    *minimum = lo;
+    *maximum = hi;
+    *sumSquares += sum;
+}
+
+static QByteArray quantize(const QVector<float> &values, bool isSigned)
+{
+    QByteArray bytes(values.size(), Qt::Uninitialized);
+    for (int i = 0; i < values.size(); ++i) {
+        const float v = qBound(-1.0f, values[i], 1.0f);
+        bytes[i] = isSigned ? char(qint8(qRound(v * 127.0f))) : char(quint8(qRound(qMax(0.0f, v) * 255.0f)));
+    }
+    return bytes;
+}
+
+static QVector<float> dequantize(const QByteArray &bytes, bool isSigned)
+{
+    QVector<float> values(bytes.size());
+    for (int i = 0; i < bytes.size(); ++i) {
+        values[i] = isSigned ? qint8(bytes[i]) / 127.0f : quint8(bytes[i]) / 255.0f;
+    }
+    return values;
+}
+
+bool Waveform::save(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << durationMs
+        << quantize(minimum, true) << quantize(maximum, true) << quantize(rms, false);
+    return file.commit();
+}
+
+Waveform Waveform::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return Waveform();
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 duration = 0;
+    QByteArray minimum, maximum, rms;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion) return Waveform();
+    in >> duration >> minimum >> maximum >> rms;
+    if (in.status() != QDataStream::Ok || rms.isEmpty()
+        || minimum.size() != rms.size() || maximum.size() != rms.size()) {
+        return Waveform();
+    }
+
+    Waveform waveform;
+    waveform.durationMs = duration;
+    waveform.minimum = dequantize(minimum, true);
+    waveform.maximum = dequantize(maximum, true);
+    waveform.rms = dequantize(rms, false);
+    return waveform;
+}
+
+WaveformBuilder::WaveformBuilder(int sampleRate, int channels)
+    : sampleRate(qMax(1, sampleRate)), channels(qMax(1, channels)),
+      bucketFrames(qMax(1, this->sampleRate / kInitialBucketsPerSecond))
+{
+    buckets.reserve(kMaxBuckets);
+}
+
+void WaveformBuilder::process(const float *samples, qint64 frames)
+{
+    while (frames > 0) {
+        const qint64 count = qMin(frames, bucketFrames - bucketFilled);
+        if (current.samples == 0) {
+            current.minimum = samples[0];
+            current.maximum = samples[0];
+        }
+        accumulate(samples, count * channels, &current.minimum, &current.maximum, &current.sumSquares);
+        current.samples += count * channels;
+        bucketFilled += count;
+        processed += count;
+        samples += count * channels;
+        frames -= count;
+        if (bucketFilled == bucketFrames) finishBucket();
+    }
+}
+
+qint64 WaveformBuilder::framesProcessed() const
+{
+    return processed;
+}
+
+void WaveformBuilder::finishBucket()
+{
+    buckets.push_back(current);
+    current = Bucket();
+    bucketFilled = 0;
+    if (buckets.size() == kMaxBuckets) mergePairs();
+}
+
+void WaveformBuilder::mergePairs()
+{
+    // 桶数为偶数时才合并，合并后每个桶的时长仍然相同
+    const size_t half = buckets.size() / 2;
+    for (size_t i = 0; i < half; ++i) {
+        const Bucket &a = buckets[i * 2];
+        const Bucket &b = buckets[i * 2 + 1];
+        Bucket merged;
+        merged.minimum = qMin(a.minimum, b.minimum);
+        merged.maximum = qMax(a.maximum, b.maximum);
+        merged.sumSquares = a.sumSquares + b.sumSquares;
+        merged.samples = a.samples + b.samples;
+        buckets[i] = merged;
+    }
+    buckets.resize(half);
+    bucketFrames *= 2;
+}
+
+Waveform WaveformBuilder::result() const
+{
+    std::vector<Bucket> all = buckets;
+    if (current.samples > 0) all.push_back(current);
+
+    Waveform waveform;
+    waveform.durationMs = processed * 1000 / sampleRate;
+    const int count = int(qMin<size_t>(all.size(), kBucketCount));
+    waveform.minimum.resize(count);
+    waveform.maximum.resize(count);
+    waveform.rms.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const size_t begin = all.size() * i / count;
+        const size_t end = all.size() * (i + 1) / count;
+        float lo = all[begin].minimum;
+        float hi = all[begin].maximum;
+        double sum = 0;
+        qint64 samples = 0;
+        for (size_t k = begin; k < end; ++k) {
+            lo = qMin(lo, all[k].minimum);
+            hi = qMax(hi, all[k].maximum);
+            sum += all[k].sumSquares;
+            samples += all[k].samples;
+        }
+        waveform.minimum[i] = lo;
+        waveform.maximum[i] = hi;
+        waveform.rms[i] = samples > 0 ? float(std::sqrt(sum / samples)) : 0.0f;
+    }
+    return waveform;
+}
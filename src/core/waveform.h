@@ -0,0 +1,57 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+// 曲目的波形概览：整首歌均分为若干桶，每桶记录采样的最小值、最大值和均方根（所有声道合计）。
+// 由解码结果计算一次后存盘，进度条据此绘制
+struct Waveform {
+    QVector<float> minimum;
+    QVector<float> maximum;
+    QVector<float> rms;
+    qint64 durationMs = 0;
+
+    bool isEmpty() const { return rms.isEmpty(); }
+    int bucketCount() const { return rms.size(); }
+
+    // 存盘时每个值量化为 8 位，一首歌约 3 KB
+    bool save(const QString &path) const;
+    static Waveform load(const QString &path); // 文件不存在或格式不符时返回空波形
+};
+
+// 边解码边计算波形。事先不知道曲目长度，因此先按固定时长累计细粒度的桶，
+// 桶数达到上限时两两合并，内存占用与曲目长度无关；result() 再合并为最终的桶数
+class WaveformBuilder
+{
+public:
+    static constexpr int kBucketCount = 1024; // 最终的桶数，足够铺满高分屏上的进度条
+
+    WaveformBuilder(int sampleRate, int channels);
+
+    void process(const float *samples, qint64 frames);
+    qint64 framesProcessed() const;
+    Waveform result() const;
+
+private:
+    struct Bucket {
+        float minimum = 0;
+        float maximum = 0;
+        double sumSquares = 0;
+        qint64 samples = 0;
+    };
+
+    void finishBucket();
+    void mergePairs();
+
+    int sampleRate;
+    int channels;
+    qint64 bucketFrames;     // 每个细粒度桶的帧数，合并时翻倍
+    qint64 bucketFilled = 0; // 当前桶已累计的帧数
+    Bucket current;
+    std::vector<Bucket> buckets;
+    qint64 processed = 0;
+};
+
+#endif // WAVEFORM_H
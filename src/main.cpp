@@ -1,11 +1,28 @@
 #include "ui/widget.h"
+#include "core/startuptrace.h"
+#include "core/logging.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::initialize(argc, argv);
+    Logging::install();
+
+    StartupTrace::begin("QApplication");
     QApplication a(argc, argv);
+    a.setOrganizationName("Melody");
+    a.setApplicationName("Melody");
+    StartupTrace::end();
+
+    StartupTrace::begin("Widget constructor");
     Widget w;
+    StartupTrace::end();
+
+    StartupTrace::begin("show");
     w.show();
-    return a.exec();
+    StartupTrace::end();
+    const int code = a.exec();
+    Logging::shutdown();
+    return code;
 }
@@ -0,0 +1,84 @@
+#include "mockserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+// 解析 "STATUS:PREFIX[:EVERY]" / "BYTES:PREFIX[:EVERY]"
+static bool parseRule(const QString &text, FaultRule *rule, qint64 *value)
+{
+    const QStringList parts = text.split(':');
+    if (parts.size() < 2 || parts.size() > 3) return false;
+    bool ok = false;
+    *value = parts[0].toLongLong(&ok);
+    if (!ok || !parts[1].startsWith('/')) return false;
+    rule->pathPrefix = parts[1];
+    if (parts.size() == 3) {
+        rule->every = parts[2].toInt(&ok);
+        if (!ok || rule->every < 1) return false;
+    }
+    return true;
+}
+
+// 支持 k / m 后缀，如 256k
+static qint64 parseBytes(QString text)
+{
+    qint64 scale = 1;
+    if (text.endsWith('k', Qt::CaseInsensitive)) scale = 1024;
+    if (text.endsWith('m', Qt::CaseInsensitive)) scale = 1024 * 1024;
+    if (scale > 1) text.chop(1);
+    return text.toLongLong() * scale;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local stand-in for the NetEase / Bilibili APIs. "
+                                     "Point Melody at it with MELODY_API_BASE=http://127.0.0.1:<port>.");
+    parser.addHelpOption();
+    QCommandLineOption portOption({"p", "port"}, "Port to listen on (0 picks a free port).", "port", "8765");
+    QCommandLineOption fixturesOption({"f", "fixtures"}, "Directory with recorded responses.", "dir", MELODY_MOCK_FIXTURE_DIR);
+    QCommandLineOption latencyOption("latency", "Delay before every response, in ms.", "ms", "0");
+    QCommandLineOption bandwidthOption("bandwidth", "Response body rate cap in bytes/s (k/m suffix allowed).", "rate", "0");
+    QCommandLineOption failOption("fail", "Answer requests under PREFIX with STATUS (e.g. 412), every EVERY-th request. Repeatable.",
+                                  "status:prefix[:every]");
+    QCommandLineOption dropOption("drop", "Close the connection after BYTES of body for requests under PREFIX. Repeatable.",
+                                  "bytes:prefix[:every]");
+    parser.addOptions({ portOption, fixturesOption, latencyOption, bandwidthOption, failOption, dropOption });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    MockServer server(parser.value(fixturesOption));
+    server.setLatency(parser.value(latencyOption).toInt());
+    server.setBandwidth(parseBytes(parser.value(bandwidthOption)));
+
+    for (const QString &text : parser.values(failOption)) {
+        FaultRule rule;
+        qint64 status = 0;
+        if (!parseRule(text, &rule, &status)) {
+            err << "invalid --fail rule: " << text << Qt::endl;
+            return 2;
+        }
+        rule.status = int(status);
+        server.addFault(rule);
+    }
+    for (const QString &text : parser.values(dropOption)) {
+        FaultRule rule;
+        if (!parseRule(text, &rule, &rule.dropAfter)) {
+            err << "invalid --drop rule: " << text << Qt::endl;
+            return 2;
+        }
+        server.addFault(rule);
+    }
+
+    if (!server.listen(QHostAddress::LocalHost, quint16(parser.value(portOption).toUInt()))) {
+        err << "cannot listen: " << server.errorString() << Qt::endl;
+        return 1;
+    }
+    // 首行输出实际地址，脚本可据此设置 MELODY_API_BASE
+    QTextStream(stdout) << "http://127.0.0.1:" << server.serverPort() << Qt::endl;
+
+    return app.exec();
+}
@@ -0,0 +1,337 @@
+#include "mockserver.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+// 限速发送的节拍
+static const int kPacingIntervalMs = 50;
+// 请求头的最大长度，超过视为异常请求
+static const int kMaxHeaderBytes = 64 * 1024;
+
+struct MockServer::Connection {
+    QTcpSocket *socket = nullptr;
+    QByteArray buffer;     // 已收到但尚未处理的请求数据
+    bool busy = false;     // 正在发送响应，后续请求排队
+    bool keepAlive = true;
+    QByteArray body;       // 正在发送的响应体
+    qint64 sent = 0;
+    qint64 dropAfter = -1;
+};
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 412: return "Precondition Failed";
+    case 416: return "Range Not Satisfiable";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Status";
+    }
+}
+
+static QByteArray contentTypeFor(const QString &suffix)
+{
+    static const QHash<QString, QByteArray> types = {
+        { "json", "application/json; charset=utf-8" },
+        { "txt", "text/plain; charset=utf-8" },
+        { "wav", "audio/wav" },
+        { "mp3", "audio/mpeg" },
+        { "m4a", "audio/mp4" },
+        { "m4s", "audio/mp4" },
+        { "flac", "audio/flac" },
+        { "png", "image/png" },
+        { "jpg", "image/jpeg" },
+    };
+    return types.value(suffix.toLower(), "application/octet-stream");
+}
+
+MockServer::MockServer(const QString &fixtureDir, QObject *parent)
+    : QTcpServer(parent), fixtureDir(QDir(fixtureDir).absolutePath())
+{
+}
+
+void MockServer::setLatency(int ms)
+{
+    latencyMs = qMax(0, ms);
+}
+
+void MockServer::setBandwidth(qint64 bytesPerSecond)
+{
+    bandwidth = qMax<qint64>(0, bytesPerSecond);
+}
+
+void MockServer::addFault(const FaultRule &rule)
+{
+    faults.append(rule);
+}
+
+void MockServer::incomingConnection(qintptr socketDescriptor)
+{
+    auto connection = std::make_shared<Connection>();
+    connection->socket = new QTcpSocket(this);
+    if (!connection->socket->setSocketDescriptor(socketDescriptor)) {
+        connection->socket->deleteLater();
+        return;
+    }
+
+    QTcpSocket *socket = connection->socket;
+    connect(socket, &QTcpSocket::readyRead, socket, [this, connection]() {
+        connection->buffer += connection->socket->readAll();
+        if (!connection->busy) {
+            processBuffer(connection);
+        }
+    });
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+}
+
+void MockServer::processBuffer(const std::shared_ptr<Connection> &connection)
+{
+    const int headerEnd = connection->buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (connection->buffer.size() > kMaxHeaderBytes) {
+            connection->socket->abort();
+        }
+        return;
+    }
+
+    const QList<QByteArray> lines = connection->buffer.left(headerEnd).split('\n');
+    connection->buffer.remove(0, headerEnd + 4); // 只处理 GET，没有请求体
+
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 3) {
+        connection->socket->abort();
+        return;
+    }
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    const QByteArray method = requestLine[0];
+    const QByteArray target = requestLine[1];
+    const bool keepAlive = requestLine[2] == "HTTP/1.1"
+                        && headers.value("connection").toLower() != "close";
+
+    connection->busy = true;
+    const Response response = respond(method, QString::fromUtf8(target), headers);
+    if (latencyMs > 0) {
+        QTimer::singleShot(latencyMs, connection->socket, [this, connection, response, keepAlive]() {
+            send(connection, response, keepAlive);
+        });
+    } else {
+        send(connection, response, keepAlive);
+    }
+}
+
+MockServer::Response MockServer::respond(const QByteArray &method, const QString &target,
+                                         const QHash<QByteArray, QByteArray> &headers)
+{
+    const QUrl url(target);
+    const QString path = QDir::cleanPath(url.path());
+
+    if (path == QLatin1String("/_mock/stats")) {
+        return statsResponse();
+    }
+    requestCounts[path]++;
+
+    Response response;
+    if (method != "GET") {
+        response.status = 405;
+        return response;
+    }
+
+    for (FaultRule &rule : faults) {
+        if (!path.startsWith(rule.pathPrefix)) continue;
+        if (++rule.hits % qMax(1, rule.every) != 0) continue;
+        faultsInjected++;
+        if (rule.status != 0) {
+            // 与真实接口一致：错误状态码附带 JSON 错误体
+            QJsonObject error;
+            error["code"] = -rule.status;
+            error["message"] = QString("mock fault %1").arg(rule.status);
+            response.status = rule.status;
+            response.contentType = contentTypeFor("json");
+            response.body = QJsonDocument(error).toJson(QJsonDocument::Compact);
+            return response;
+        }
+        response.dropAfter = rule.dropAfter;
+        break;
+    }
+
+    // 路径映射到数据目录中的文件，拒绝跳出数据目录
+    QString filePath;
+    if (!path.contains(QLatin1String(".."))) {
+        const QString base = fixtureDir + path;
+        for (const QString &candidate : { base, base + ".json", base + ".txt" }) {
+            if (QFileInfo(candidate).isFile()) {
+                filePath = candidate;
+                break;
+            }
+        }
+    }
+    if (filePath.isEmpty()) {
+        response.status = 404;
+        return response;
+    }
+
+    Response fileResult = fileResponse(filePath, headers.value("host"), headers.value("range"));
+    // 模板替换查询参数，例如视频信息中的 bvid 需与请求一致
+    if (fileResult.contentType.startsWith("application/json") || fileResult.contentType.startsWith("text/")) {
+        static const QRegularExpression placeholder("\\{\\{query:(\\w+)\\}\\}");
+        const QUrlQuery query(url);
+        QString text = QString::fromUtf8(fileResult.body);
+        QRegularExpressionMatchIterator it = placeholder.globalMatch(text);
+        QString result;
+        qsizetype last = 0;
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            result += text.mid(last, match.capturedStart() - last);
+            result += query.queryItemValue(match.captured(1), QUrl::FullyDecoded);
+            last = match.capturedEnd();
+        }
+        result += text.mid(last);
+        fileResult.body = result.toUtf8();
+    }
+    fileResult.dropAfter = response.dropAfter;
+    return fileResult;
+}
+
+MockServer::Response MockServer::fileResponse(const QString &filePath, const QByteArray &host, const QByteArray &range)
+{
+    Response response;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        response.status = 500;
+        return response;
+    }
+    response.contentType = contentTypeFor(QFileInfo(filePath).suffix());
+    response.body = file.readAll();
+
+    const bool text = response.contentType.startsWith("application/json") || response.contentType.startsWith("text/");
+    if (text) {
+        response.body.replace("{{base}}", "http://" + host);
+        return response;
+    }
+
+    response.headers.append({ "Accept-Ranges", "bytes" });
+    if (!range.startsWith("bytes=")) {
+        return response;
+    }
+
+    // 只支持单个区间：bytes=a-b、bytes=a-、bytes=-n
+    const qint64 total = response.body.size();
+    const QList<QByteArray> bounds = range.mid(6).split('-');
+    qint64 start = -1;
+    qint64 end = total - 1;
+    bool ok = bounds.size() == 2;
+    if (ok && bounds[0].isEmpty()) {
+        const qint64 suffix = bounds[1].toLongLong(&ok);
+        start = qMax<qint64>(0, total - suffix);
+    } else if (ok) {
+        start = bounds[0].toLongLong(&ok);
+        if (ok && !bounds[1].isEmpty()) {
+            end = qMin(end, bounds[1].toLongLong(&ok));
+        }
+    }
+    if (!ok || start < 0 || start >= total || end < start) {
+        response.status = 416;
+        response.headers.append({ "Content-Range", "bytes */" + QByteArray::number(total) });
+        response.body.clear();
+        return response;
+    }
+
+    response.status = 206;
+    response.headers.append({ "Content-Range", QString("bytes %1-%2/%3").arg(start).arg(end).arg(total).toLatin1() });
+    response.body = response.body.mid(start, end - start + 1);
+    return response;
+}
+
+MockServer::Response MockServer::statsResponse() const
+{
+    QJsonObject requests;
+    for (auto it = requestCounts.constBegin(); it != requestCounts.constEnd(); ++it) {
+        requests[it.key()] = it.value();
+    }
+    QJsonObject stats;
+    stats["requests"] = requests;
+    stats["bytesSent"] = bytesSent;
+    stats["faultsInjected"] = faultsInjected;
+
+    Response response;
+    response.contentType = contentTypeFor("json");
+    response.body = QJsonDocument(stats).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+void MockServer::send(const std::shared_ptr<Connection> &connection, const Response &response, bool keepAlive)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+    if (!response.contentType.isEmpty()) {
+        head += "Content-Type: " + response.contentType + "\r\n";
+    }
+    // 中断传输时仍声明完整长度，客户端才能识别出传输不完整
+    head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    for (const auto &header : response.headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    head += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    connection->socket->write(head);
+
+    connection->keepAlive = keepAlive;
+    connection->body = response.body;
+    connection->sent = 0;
+    connection->dropAfter = response.dropAfter;
+    sendNextChunk(connection);
+}
+
+void MockServer::sendNextChunk(const std::shared_ptr<Connection> &connection)
+{
+    QTcpSocket *socket = connection->socket;
+    qint64 chunk = connection->body.size() - connection->sent;
+    if (connection->dropAfter >= 0) {
+        chunk = qMin(chunk, connection->dropAfter - connection->sent);
+    }
+    if (bandwidth > 0) {
+        chunk = qMin(chunk, qMax<qint64>(1, bandwidth * kPacingIntervalMs / 1000));
+    }
+    if (chunk > 0) {
+        socket->write(connection->body.constData() + connection->sent, chunk);
+        connection->sent += chunk;
+        bytesSent += chunk;
+    }
+
+    if (connection->dropAfter >= 0 && connection->sent >= connection->dropAfter
+        && connection->sent < connection->body.size()) {
+        // 模拟传输中断：发完已写入的数据后关闭连接
+        socket->disconnectFromHost();
+        return;
+    }
+    if (connection->sent < connection->body.size()) {
+        QTimer::singleShot(kPacingIntervalMs, socket, [this, connection]() { sendNextChunk(connection); });
+        return;
+    }
+
+    connection->body.clear();
+    connection->busy = false;
+    if (!connection->keepAlive) {
+        socket->disconnectFromHost();
+    } else if (!connection->buffer.isEmpty()) {
+        processBuffer(connection);
+    }
+}
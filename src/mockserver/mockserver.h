@@ -0,0 +1,67 @@
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QTcpServer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <memory>
+
+// 故障注入规则：路径以 pathPrefix 开头的请求每 every 次触发一次
+struct FaultRule {
+    QString pathPrefix;
+    int status = 0;         // 非 0 时直接返回该状态码（如 403、412）
+    qint64 dropAfter = -1;  // >= 0 时发送该数量的响应体字节后断开连接
+    int every = 1;
+    int hits = 0;
+};
+
+// 本地模拟接口服务器：从录制的数据目录回放接口响应，音频文件支持 Range，
+// 可注入延迟、带宽限制、错误状态码和传输中断，用于无外网的可复现性能测试。
+//
+// 请求路径映射到数据目录中的文件：/api/search/get -> api/search/get.json（或 .txt、原文件名）。
+// 文本响应中的 {{base}} 替换为服务器自身地址，使音频和封面地址也指向本服务器。
+// GET /_mock/stats 返回各路径请求数、发送字节数和注入的故障数
+class MockServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit MockServer(const QString &fixtureDir, QObject *parent = nullptr);
+
+    void setLatency(int ms);                      // 响应头之前的延迟
+    void setBandwidth(qint64 bytesPerSecond);     // 响应体发送速率上限，0 为不限
+    void addFault(const FaultRule &rule);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    struct Connection;
+    struct Response {
+        int status = 200;
+        QByteArray contentType;
+        QList<QPair<QByteArray, QByteArray>> headers;
+        QByteArray body;
+        qint64 dropAfter = -1;
+    };
+
+    void processBuffer(const std::shared_ptr<Connection> &connection);
+    Response respond(const QByteArray &method, const QString &path,
+                     const QHash<QByteArray, QByteArray> &headers);
+    Response fileResponse(const QString &filePath, const QByteArray &host, const QByteArray &range);
+    Response statsResponse() const;
+    void send(const std::shared_ptr<Connection> &connection, const Response &response, bool keepAlive);
+    void sendNextChunk(const std::shared_ptr<Connection> &connection);
+
+    QString fixtureDir;
+    int latencyMs = 0;
+    qint64 bandwidth = 0;
+    QList<FaultRule> faults;
+
+    QHash<QString, int> requestCounts;
+    qint64 bytesSent = 0;
+    int faultsInjected = 0;
+};
+
+#endif // MOCKSERVER_H
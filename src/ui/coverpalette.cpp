@@ -0,0 +1,90 @@
+#include "coverpalette.h"
+#include <algorithm>
+
+// 提取多个主色调（苹果音乐风格）
+QVector<QColor> CoverPalette::extractColors(const QImage &cover, int colorCount)
+{
+    QVector<QColor> colors;
+    if (cover.isNull()) {
+        colors.append(QColor(51, 51, 51));
+        return colors;
+    }
+    
+    // 缩小图片以加快处理速度
+    QImage image = cover.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    
+    // 使用区域采样法提取不同区域的主色
+    int w = image.width();
+    int h = image.height();
+    
+    // 定义采样区域（左上、右上、中心、左下、右下）
+    struct Region { int x1, y1, x2, y2; };
+    QVector<Region> regions = {
+        {0, 0, w/2, h/2},           // 左上
+        {w/2, 0, w, h/2},           // 右上
+        {w/4, h/4, w*3/4, h*3/4},   // 中心
+        {0, h/2, w/2, h},           // 左下
+        {w/2, h/2, w, h}            // 右下
+    };
+    
+    // 计算每个区域的平均颜色
+    QVector<QColor> regionColors;
+    for (const auto &region : regions) {
+        long r = 0, g = 0, b = 0;
+        int count = 0;
+        
+        for (int y = region.y1; y < region.y2 && y < h; ++y) {
+            for (int x = region.x1; x < region.x2 && x < w; ++x) {
+                QColor c = image.pixelColor(x, y);
+                r += c.red();
+                g += c.green();
+                b += c.blue();
+                count++;
+            }
+        }
+        
+        if (count > 0) {
+            regionColors.append(QColor(r/count, g/count, b/count));
+        }
+    }
+    
+    // 选择最亮的颜色作为主色（用于文字等）
+    std::sort(regionColors.begin(), regionColors.end(), [](const QColor &a, const QColor &b) {
+        return (a.red()*0.299 + a.green()*0.587 + a.blue()*0.114) > 
+               (b.red()*0.299 + b.green()*0.587 + b.blue()*0.114);
+    });
+    
+    // 选择最有代表性的颜色（避免太相似的颜色）
+    for (const QColor &c : regionColors) {
+        bool tooSimilar = false;
+        for (const QColor &existing : colors) {
+            int dr = qAbs(c.red() - existing.red());
+            int dg = qAbs(c.green() - existing.green());
+            int db = qAbs(c.blue() - existing.blue());
+            if (dr + dg + db < 80) { // 颜色差异阈值
+                tooSimilar = true;
+                break;
+            }
+        }
+        if (!tooSimilar) {
+            colors.append(c);
+            if (colors.size() >= colorCount) break;
+        }
+    }
+    
+    // 如果颜色不够，用主色生成变体
+    if (colors.size() < colorCount && !colors.isEmpty()) {
+        QColor base = colors.first();
+        while (colors.size() < colorCount) {
+            QColor variant = base.darker(120 + colors.size() * 30);
+            colors.append(variant);
+        }
+    }
+    
+    // 确保至少返回一个颜色
+    if (colors.isEmpty()) {
+        colors.append(QColor(51, 51, 51));
+    }
+    
+    return colors;
+}
@@ -0,0 +1,15 @@
+#ifndef COVERPALETTE_H
+#define COVERPALETTE_H
+
+#include <QColor>
+#include <QImage>
+#include <QVector>
+
+namespace CoverPalette {
+
+// 从封面中提取 colorCount 种有代表性的颜色（按亮度从高到低），用于动态背景
+QVector<QColor> extractColors(const QImage &cover, int colorCount = 3);
+
+} // namespace CoverPalette
+
+#endif // COVERPALETTE_H
@@ -0,0 +1,77 @@
+#include "crossfadeoverlay.h"
+#include "core/metrics.h"
+#include <QPaintEvent>
+#include <QPainter>
+#include <QVariantAnimation>
+
+CrossfadeOverlay::CrossfadeOverlay(QWidget *parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_NoSystemBackground);
+    hide();
+
+    animation = new QVariantAnimation(this);
+    animation->setStartValue(1.0);
+    animation->setEndValue(0.0);
+    animation->setEasingCurve(QEasingCurve::InOutQuad);
+    connect(animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
+        setOpacity(value.toReal());
+    });
+    connect(animation, &QVariantAnimation::finished, this, &CrossfadeOverlay::finish);
+}
+
+void CrossfadeOverlay::start(const QPixmap &from, int durationMs)
+{
+    animation->stop();
+    snapshot = from;
+    opacity = 1.0;
+    frames = 0;
+    setGeometry(parentWidget()->rect());
+    raise();
+    show();
+    frameTimer.invalidate();
+    elapsedTimer.start();
+    animation->setDuration(durationMs);
+    animation->start();
+}
+
+void CrossfadeOverlay::finish()
+{
+    if (!isVisible()) return;
+    animation->stop();
+    // 实际帧率：过渡期间的绘制次数除以时长，应接近显示器刷新率
+    const qint64 elapsed = elapsedTimer.elapsed();
+    if (frames > 1 && elapsed > 0) {
+        Metrics::observe("color_transition_fps", frames * 1000.0 / elapsed);
+    }
+    hide();
+    snapshot = QPixmap();
+}
+
+bool CrossfadeOverlay::isRunning() const
+{
+    return isVisible();
+}
+
+void CrossfadeOverlay::setOpacity(qreal value)
+{
+    opacity = value;
+    update();
+}
+
+void CrossfadeOverlay::paintEvent(QPaintEvent *event)
+{
+    // 下面的控件局部刷新时也会重绘对应区域，只有整层重绘才算一帧
+    if (event->rect() == rect()) {
+        if (frameTimer.isValid()) {
+            Metrics::observe("color_transition_frame_ms", frameTimer.nsecsElapsed() / 1e6);
+        }
+        frameTimer.start();
+        ++frames;
+    }
+
+    QPainter painter(this);
+    painter.setOpacity(opacity);
+    painter.drawPixmap(rect(), snapshot);
+}
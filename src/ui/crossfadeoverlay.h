@@ -0,0 +1,38 @@
+#ifndef CROSSFADEOVERLAY_H
+#define CROSSFADEOVERLAY_H
+
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QWidget>
+
+class QVariantAnimation;
+
+// 配色切换的过渡层：盖在窗口最上层，把切换前的界面截图从不透明淡出到透明。
+// 新样式表在过渡开始时一次性应用（被截图完全遮住），之后每帧只是按不透明度绘制一张位图，
+// 不再逐帧重建样式表。不拦截鼠标事件；过渡结束后隐藏并释放截图
+class CrossfadeOverlay : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CrossfadeOverlay(QWidget *parent);
+
+    // from 为父控件当前的截图（可以包含进行中的过渡层本身，连续切换时从当前画面继续）
+    void start(const QPixmap &from, int durationMs);
+    void finish(); // 立即结束（例如窗口尺寸变化，截图已对不上）
+    bool isRunning() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    void setOpacity(qreal value);
+
+    QPixmap snapshot;
+    qreal opacity = 0;
+    QVariantAnimation *animation;
+    QElapsedTimer frameTimer;  // 上一帧绘制以来
+    QElapsedTimer elapsedTimer; // 过渡开始以来
+    int frames = 0;
+};
+
+#endif // CROSSFADEOVERLAY_H
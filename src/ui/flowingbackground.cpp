@@ -0,0 +1,113 @@
+#include "flowingbackground.h"
+#include "core/metrics.h"
+#include "core/spectrumanalyzer.h"
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QtMath>
+
+FlowingBackground::FlowingBackground(QWidget *parent)
+    : QWidget(parent)
+{
+    // 初始化默认颜色
+    m_colors = { QColor(80, 60, 140), QColor(60, 80, 120), QColor(40, 60, 100) };
+}
+
+void FlowingBackground::setColors(const QVector<QColor> &colors)
+{
+    m_colors = colors;
+    m_blobs.clear();
+    
+    if (colors.isEmpty()) return;
+    
+    // 为每种颜色创建一个"blob"
+    for (int i = 0; i < colors.size(); ++i) {
+        Blob blob;
+        blob.color = colors[i];
+        blob.x = 0.2 + (i % 3) * 0.3;  // 分散初始位置
+        blob.y = 0.2 + (i / 3) * 0.3;
+        blob.radius = 0.4 + (i % 2) * 0.2;  // 不同大小
+        blob.speedX = 0.0003 + i * 0.0001;  // 不同速度
+        blob.speedY = 0.0002 + i * 0.00015;
+        blob.phase = i * 1.5;  // 相位偏移
+        m_blobs.append(blob);
+    }
+    
+    update();
+}
+
+void FlowingBackground::setTimeOffset(qreal offset)
+{
+    qreal delta = offset - m_timeOffset;
+    if (delta < 0) delta = offset; // 动画循环回到起点
+    m_timeOffset = offset;
+
+    // 累计进度而不是直接用时间，速度变化时位置保持连续
+    qreal speed = 1.0;
+    m_pulse = 1.0;
+    if (m_spectrum && m_spectrum->isRunning()) {
+        const SpectrumAnalyzer::Snapshot snapshot = m_spectrum->snapshot();
+        const qreal bass = (snapshot.bands[0] + snapshot.bands[1]) / 2;
+        speed = 0.6 + snapshot.level * 1.2;
+        m_pulse = 1.0 + bass * 0.15 + snapshot.beat * 0.08;
+    }
+    m_phase += delta * speed;
+    update();
+}
+
+void FlowingBackground::setSpectrumAnalyzer(SpectrumAnalyzer *analyzer)
+{
+    m_spectrum = analyzer;
+}
+
+void FlowingBackground::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    
+    QRectF rect = this->rect();
+    qreal w = rect.width();
+    qreal h = rect.height();
+    
+    // 深色底色
+    painter.fillRect(rect, QColor(20, 20, 25));
+    
+    // 绘制流动的颜色块
+    for (const Blob &blob : m_blobs) {
+        // 使用正弦函数创建平滑的移动轨迹
+        qreal t = m_phase + blob.phase;
+        qreal x = blob.x + qSin(t * blob.speedX * 1000) * 0.3;
+        qreal y = blob.y + qCos(t * blob.speedY * 1000) * 0.3;
+        
+        // 确保在边界内
+        x = qBound(0.1, x, 0.9);
+        y = qBound(0.1, y, 0.9);
+        
+        // 转换为像素坐标
+        qreal cx = x * w;
+        qreal cy = y * h;
+        qreal radius = blob.radius * qMax(w, h) * m_pulse;
+        
+        // 创建径向渐变
+        QRadialGradient gradient(cx, cy, radius);
+        QColor color = blob.color;
+        gradient.setColorAt(0, QColor(color.red(), color.green(), color.blue(), 180));
+        gradient.setColorAt(0.5, QColor(color.red(), color.green(), color.blue(), 80));
+        gradient.setColorAt(1, QColor(color.red(), color.green(), color.blue(), 0));
+        
+        painter.setBrush(gradient);
+        painter.setPen(Qt::NoPen);
+        painter.drawEllipse(QPointF(cx, cy), radius, radius);
+    }
+    
+    // 添加暗色遮罩提升文字可读性
+    QLinearGradient overlay(0, 0, 0, h);
+    overlay.setColorAt(0, QColor(0, 0, 0, 80));
+    overlay.setColorAt(0.5, QColor(0, 0, 0, 40));
+    overlay.setColorAt(1, QColor(0, 0, 0, 100));
+    painter.fillRect(rect, overlay);
+    painter.end();
+    Metrics::observe("ui_paint_ms", paintTimer.nsecsElapsed() / 1e6, { { "widget", "flowing_background" } });
+}
@@ -0,0 +1,45 @@
+#ifndef FLOWINGBACKGROUND_H
+#define FLOWINGBACKGROUND_H
+
+#include <QWidget>
+#include <QColor>
+#include <QVector>
+
+class SpectrumAnalyzer;
+
+// 动态流动背景控件（苹果音乐风格）。
+// 设置频谱分析后，颜色块的移动速度随音乐强度变化，半径随低音和节拍起伏
+class FlowingBackground : public QWidget
+{
+    Q_OBJECT
+    Q_PROPERTY(qreal timeOffset READ timeOffset WRITE setTimeOffset)
+
+public:
+    explicit FlowingBackground(QWidget *parent = nullptr);
+    void setColors(const QVector<QColor> &colors);
+    qreal timeOffset() const { return m_timeOffset; }
+    void setTimeOffset(qreal offset);
+    void setSpectrumAnalyzer(SpectrumAnalyzer *analyzer);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QVector<QColor> m_colors;
+    qreal m_timeOffset = 0;
+    qreal m_phase = 0;  // 按音乐强度加权累计的动画进度
+    qreal m_pulse = 1;  // 半径缩放
+    SpectrumAnalyzer *m_spectrum = nullptr;
+    
+    struct Blob {
+        QColor color;
+        qreal x, y;        // 中心位置 (0-1)
+        qreal radius;      // 半径
+        qreal speedX;      // 移动速度
+        qreal speedY;
+        qreal phase;       // 相位偏移
+    };
+    QVector<Blob> m_blobs;
+};
+
+#endif // FLOWINGBACKGROUND_H
@@ -0,0 +1,142 @@
+#include "perfhud.h"
+#include "core/metrics.h"
+#include <QFontDatabase>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTimer>
+#include <algorithm>
+
+// 刷新间隔
+static const int kRefreshIntervalMs = 500;
+// 列出的请求端点数量（按请求次数）
+static const int kTopEndpoints = 4;
+static const int kPadding = 10;
+
+static QString latencyText(const Metrics::Summary &summary)
+{
+    if (summary.count == 0) return QStringLiteral("-");
+    return QString("p50 %1 ms  p95 %2 ms  (n=%3)")
+        .arg(summary.p50, 0, 'f', 0).arg(summary.p95, 0, 'f', 0).arg(summary.count);
+}
+
+PerfHud::PerfHud(QWidget *parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(kRefreshIntervalMs);
+    connect(refreshTimer, &QTimer::timeout, this, &PerfHud::refresh);
+}
+
+void PerfHud::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    refreshTimer->start();
+}
+
+void PerfHud::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    refreshTimer->stop();
+}
+
+void PerfHud::refresh()
+{
+    Metrics::sampleProcessMemory();
+    lines.clear();
+
+    lines << "首音耗时   " + latencyText(Metrics::histogram("time_to_first_audio_ms"));
+
+    qint64 errors = 0;
+    for (qint64 count : Metrics::counters("http_errors_total")) errors += count;
+    lines << QString("网络请求   %1  错误 %2").arg(latencyText(Metrics::histogram("http_request_ms"))).arg(errors);
+
+    // 请求最多的几个端点
+    const QMap<QString, Metrics::Summary> endpoints = Metrics::histograms("http_request_ms");
+    QList<QPair<QString, Metrics::Summary>> sorted;
+    for (auto it = endpoints.constBegin(); it != endpoints.constEnd(); ++it) {
+        sorted.append({ it.key(), it.value() });
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second.count > b.second.count;
+    });
+    for (int i = 0; i < sorted.size() && i < kTopEndpoints; ++i) {
+        QString label = sorted[i].first;
+        label.remove("host=").remove("endpoint=").remove('"').replace(',', ' ');
+        lines << QString("  %1  p50 %2 ms  (n=%3)").arg(label)
+                     .arg(sorted[i].second.p50, 0, 'f', 0).arg(sorted[i].second.count);
+    }
+
+    const QMap<QString, qint64> cache = Metrics::counters("search_cache_lookups_total");
+    const qint64 exact = cache.value("result=\"exact\"");
+    const qint64 prefix = cache.value("result=\"prefix\"");
+    const qint64 miss = cache.value("result=\"miss\"");
+    const qint64 lookups = exact + prefix + miss;
+    lines << (lookups > 0
+        ? QString("搜索缓存   命中率 %1%  (精确 %2 / 前缀 %3 / 未命中 %4)")
+              .arg(100 * (exact + prefix) / lookups).arg(exact).arg(prefix).arg(miss)
+        : QStringLiteral("搜索缓存   -"));
+
+    qint64 stalls = 0;
+    for (qint64 count : Metrics::counters("playback_stalls_total")) stalls += count;
+    lines << QString("播放卡顿   %1 次  %2").arg(stalls).arg(latencyText(Metrics::histogram("playback_stall_ms")));
+    qint64 underruns = 0;
+    for (qint64 count : Metrics::counters("audio_underruns_total")) underruns += count;
+    lines << QString("输出欠载   %1 次").arg(underruns);
+
+    const Metrics::Summary paint = Metrics::histogram("ui_paint_ms");
+    lines << (paint.count > 0
+        ? QString("界面绘制   p50 %1 ms  p95 %2 ms  max %3 ms")
+              .arg(paint.p50, 0, 'f', 1).arg(paint.p95, 0, 'f', 1).arg(paint.max, 0, 'f', 1)
+        : QStringLiteral("界面绘制   -"));
+
+    // 配色过渡的实际帧率，应接近显示器刷新率
+    const Metrics::Summary transition = Metrics::histogram("color_transition_fps");
+    if (transition.count > 0) {
+        lines << QString("配色过渡   %1 fps  帧间隔 p95 %2 ms")
+                     .arg(transition.p50, 0, 'f', 0)
+                     .arg(Metrics::histogram("color_transition_frame_ms").p95, 0, 'f', 1);
+    }
+
+    // 每次分析的耗时乘以每秒分析次数（约 30 次）即为占用的单核比例
+    const Metrics::Summary spectrum = Metrics::histogram("spectrum_analysis_us");
+    if (spectrum.count > 0) {
+        lines << QString("频谱分析   p95 %1 µs  约 %2% CPU")
+                     .arg(spectrum.p95, 0, 'f', 0)
+                     .arg(spectrum.sum / spectrum.count * 30 / 1e4, 0, 'f', 2);
+    }
+
+    lines << QString("常驻内存   %1 MB").arg(Metrics::gauge("process_resident_bytes") / (1024 * 1024), 0, 'f', 1);
+    lines << QString("音频缓冲   内存 %1 MB  磁盘 %2 MB")
+                 .arg(Metrics::gauge("audio_buffer_memory_bytes") / (1024 * 1024), 0, 'f', 1)
+                 .arg(Metrics::gauge("audio_buffer_spilled_bytes") / (1024 * 1024), 0, 'f', 1);
+
+    const QFontMetrics metrics(font());
+    int width = 0;
+    for (const QString &line : lines) width = qMax(width, metrics.horizontalAdvance(line));
+    resize(width + 2 * kPadding, lines.size() * metrics.lineSpacing() + 2 * kPadding);
+    raise();
+    update();
+}
+
+void PerfHud::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QPainterPath path;
+    path.addRoundedRect(rect(), 8, 8);
+    painter.fillPath(path, QColor(0, 0, 0, 170));
+
+    painter.setPen(QColor(230, 230, 230));
+    const QFontMetrics metrics(font());
+    int y = kPadding + metrics.ascent();
+    for (const QString &line : lines) {
+        painter.drawText(kPadding, y, line);
+        y += metrics.lineSpacing();
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PERFHUD_H
+#define PERFHUD_H
+
+#include <QWidget>
+
+class QTimer;
+
+// 性能浮层：在主窗口左上角显示首音耗时、请求延迟、缓存命中率、卡顿、
+// 绘制耗时和内存占用。仅在显示时定时刷新，不拦截鼠标事件
+class PerfHud : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PerfHud(QWidget *parent = nullptr);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+
+    QTimer *refreshTimer;
+    QStringList lines;
+};
+
+#endif // PERFHUD_H
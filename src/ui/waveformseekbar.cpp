@@ -0,0 +1,229 @@
+#include "waveformseekbar.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPainterPath>
+
+// 播放头宽度；重绘播放头时左右各多留这么宽
+static const int kPlayheadWidth = 2;
+// 没有波形时细条的高度
+static const int kGrooveHeight = 4;
+// 峰值（最小/最大值）的不透明度，均方根部分不打折
+static const qreal kPeakOpacity = 0.45;
+// 未缓冲部分的不透明度
+static const qreal kUnbufferedOpacity = 0.35;
+
+WaveformSeekBar::WaveformSeekBar(QWidget *parent)
+    : QSlider(Qt::Horizontal, parent)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+void WaveformSeekBar::setWaveform(const Waveform &waveform)
+{
+    this->waveform = waveform;
+    layersValid = false;
+    update();
+}
+
+void WaveformSeekBar::setBufferedRanges(const QVector<QPair<qreal, qreal>> &ranges)
+{
+    buffered = ranges;
+    // 下载过程中会频繁调用，只有像素范围变化时才重新渲染
+    if (bufferedSpans() == renderedSpans) return;
+    layersValid = false;
+    update();
+}
+
+void WaveformSeekBar::setColors(const QColor &played, const QColor &remaining)
+{
+    if (played == playedColor && remaining == remainingColor) return;
+    playedColor = played;
+    remainingColor = remaining;
+    layersValid = false;
+    update();
+}
+
+QSize WaveformSeekBar::sizeHint() const
+{
+    return QSize(200, 28);
+}
+
+QSize WaveformSeekBar::minimumSizeHint() const
+{
+    return QSize(60, 20);
+}
+
+int WaveformSeekBar::playheadX() const
+{
+    if (maximum() <= minimum()) return 0;
+    return int(qint64(sliderPosition() - minimum()) * width() / (qint64(maximum()) - minimum()));
+}
+
+int WaveformSeekBar::valueAt(qreal x) const
+{
+    if (width() <= 0) return minimum();
+    const qreal ratio = qBound(0.0, x / width(), 1.0);
+    return minimum() + qRound(ratio * (qint64(maximum()) - minimum()));
+}
+
+QVector<QPair<int, int>> WaveformSeekBar::bufferedSpans() const
+{
+    QVector<QPair<int, int>> spans;
+    spans.reserve(buffered.size());
+    for (const auto &range : buffered) {
+        spans.append({ qRound(range.first * width()), qRound(range.second * width()) });
+    }
+    return spans;
+}
+
+void WaveformSeekBar::renderLayers()
+{
+    renderedSpans = bufferedSpans();
+    renderLayer(playedLayer, playedColor, false);
+    renderLayer(remainingLayer, remainingColor, true);
+    layersValid = true;
+}
+
+void WaveformSeekBar::renderLayer(QPixmap &layer, const QColor &color, bool dimUnbuffered)
+{
+    const qreal dpr = devicePixelRatioF();
+    layer = QPixmap(size() * dpr);
+    layer.setDevicePixelRatio(dpr);
+    layer.fill(Qt::transparent);
+
+    QPainter painter(&layer);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+
+    const int w = width();
+    const qreal mid = height() / 2.0;
+    QColor dim = color;
+    dim.setAlphaF(color.alphaF() * kUnbufferedOpacity);
+    auto isBuffered = [this](int x) {
+        if (renderedSpans.isEmpty()) return true;
+        for (const auto &span : renderedSpans) {
+            if (x >= span.first && x < span.second) return true;
+        }
+        return false;
+    };
+
+    if (waveform.isEmpty()) {
+        const QRectF groove(0, mid - kGrooveHeight / 2.0, w, kGrooveHeight);
+        QPainterPath path;
+        path.addRoundedRect(groove, kGrooveHeight / 2.0, kGrooveHeight / 2.0);
+        if (!dimUnbuffered || renderedSpans.isEmpty()) {
+            painter.fillPath(path, color);
+            return;
+        }
+        painter.fillPath(path, dim);
+        painter.setClipPath(path);
+        for (const auto &span : std::as_const(renderedSpans)) {
+            painter.fillRect(QRectF(span.first, groove.top(), span.second - span.first, groove.height()), color);
+        }
+        return;
+    }
+
+    // 每一像素列合并对应的若干个桶：浅色为峰值范围，实色为均方根
+    const int count = waveform.bucketCount();
+    const qreal amplitude = mid - 1;
+    for (int x = 0; x < w; ++x) {
+        const int begin = int(qint64(x) * count / w);
+        const int end = qMax(begin + 1, int(qint64(x + 1) * count / w));
+        float lo = waveform.minimum[begin];
+        float hi = waveform.maximum[begin];
+        float rms = 0;
+        for (int i = begin; i < end; ++i) {
+            lo = qMin(lo, waveform.minimum[i]);
+            hi = qMax(hi, waveform.maximum[i]);
+            rms = qMax(rms, waveform.rms[i]);
+        }
+        QColor column = (dimUnbuffered && !isBuffered(x)) ? dim : color;
+        const qreal rmsHeight = qMax(1.0, 2 * rms * amplitude);
+        painter.fillRect(QRectF(x, mid - rmsHeight / 2, 1, rmsHeight), column);
+        column.setAlphaF(column.alphaF() * kPeakOpacity);
+        const qreal top = mid - hi * amplitude;
+        const qreal bottom = mid - lo * amplitude;
+        painter.fillRect(QRectF(x, top, 1, qMax(1.0, bottom - top)), column);
+    }
+}
+
+void WaveformSeekBar::paintEvent(QPaintEvent *event)
+{
+    if (!layersValid) renderLayers();
+
+    QPainter painter(this);
+    const qreal dpr = playedLayer.devicePixelRatio();
+    const int x = playheadX();
+    const QRect clip = event->rect();
+    const QRect playedRect = QRect(0, 0, x, height()).intersected(clip);
+    const QRect remainingRect = QRect(x, 0, width() - x, height()).intersected(clip);
+    if (!playedRect.isEmpty()) {
+        painter.drawPixmap(playedRect.topLeft(), playedLayer,
+                           QRectF(QPointF(playedRect.topLeft()) * dpr, QSizeF(playedRect.size()) * dpr));
+    }
+    if (!remainingRect.isEmpty()) {
+        painter.drawPixmap(remainingRect.topLeft(), remainingLayer,
+                           QRectF(QPointF(remainingRect.topLeft()) * dpr, QSizeF(remainingRect.size()) * dpr));
+    }
+    if (maximum() > minimum()) {
+        painter.fillRect(QRect(x - kPlayheadWidth / 2, 0, kPlayheadWidth, height()), playedColor);
+    }
+}
+
+void WaveformSeekBar::resizeEvent(QResizeEvent *event)
+{
+    QSlider::resizeEvent(event);
+    layersValid = false;
+    lastPlayheadX = playheadX();
+}
+
+void WaveformSeekBar::sliderChange(SliderChange change)
+{
+    if (change != SliderValueChange || lastPlayheadX < 0) {
+        // 范围等变化：整条重绘
+        lastPlayheadX = playheadX();
+        QSlider::sliderChange(change);
+        return;
+    }
+
+    // 播放中每秒多次更新位置：只重绘新旧播放头之间的窄条，像素未变化时不重绘
+    const int x = playheadX();
+    if (x == lastPlayheadX) return;
+    const int left = qMin(x, lastPlayheadX) - kPlayheadWidth;
+    const int right = qMax(x, lastPlayheadX) + kPlayheadWidth;
+    update(QRect(left, 0, right - left + 1, height()));
+    lastPlayheadX = x;
+}
+
+void WaveformSeekBar::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton || maximum() <= minimum()) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+    // 点击任意位置直接跳转，并开始拖动
+    setSliderDown(true);
+    setSliderPosition(valueAt(event->position().x()));
+    event->accept();
+}
+
+void WaveformSeekBar::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!isSliderDown()) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    setSliderPosition(valueAt(event->position().x()));
+    event->accept();
+}
+
+void WaveformSeekBar::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton || !isSliderDown()) {
+        QWidget::mouseReleaseEvent(event);
+        return;
+    }
+    setSliderDown(false);
+    event->accept();
+}
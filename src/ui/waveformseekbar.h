@@ -0,0 +1,54 @@
+#ifndef WAVEFORMSEEKBAR_H
+#define WAVEFORMSEEKBAR_H
+
+#include <QSlider>
+#include <QColor>
+#include <QPair>
+#include <QPixmap>
+#include <QVector>
+#include "core/waveform.h"
+
+// 带波形概览的进度条。沿用 QSlider 的数值与信号（sliderMoved 等），只替换绘制和鼠标操作：
+// 波形按已播放、未播放两种颜色预先渲染成位图，播放位置变化时只重绘新旧播放头之间的窄条。
+// 没有波形时画成普通的细条；边下边播时未缓冲的部分颜色更暗
+class WaveformSeekBar : public QSlider
+{
+    Q_OBJECT
+public:
+    explicit WaveformSeekBar(QWidget *parent = nullptr);
+
+    void setWaveform(const Waveform &waveform);
+    // 已缓冲的区间（0~1 的比例）；为空表示整首可用
+    void setBufferedRanges(const QVector<QPair<qreal, qreal>> &ranges);
+    void setColors(const QColor &played, const QColor &remaining);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void sliderChange(SliderChange change) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    int playheadX() const;
+    int valueAt(qreal x) const;
+    void renderLayers(); // 重新生成 playedLayer / remainingLayer
+    void renderLayer(QPixmap &layer, const QColor &color, bool dimUnbuffered);
+    QVector<QPair<int, int>> bufferedSpans() const; // 已缓冲区间对应的像素范围
+
+    Waveform waveform;
+    QVector<QPair<qreal, qreal>> buffered;
+    QVector<QPair<int, int>> renderedSpans; // 渲染位图时的缓冲范围，像素不变时不必重新渲染
+    QColor playedColor = QColor(255, 255, 255);
+    QColor remainingColor = QColor(255, 255, 255, 90);
+    QPixmap playedLayer;
+    QPixmap remainingLayer;
+    bool layersValid = false;
+    int lastPlayheadX = -1;
+};
+
+#endif // WAVEFORMSEEKBAR_H
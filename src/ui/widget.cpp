@@ -1,6 +1,25 @@
 #include "widget.h"
 #include "core/apimanager.h"
 #include "core/playlistmanager.h" // 集成播放列表
+#include "core/songparser.h"
+#include "core/locallibrary.h"
+#include "core/startuptrace.h"
+#include "core/lyricparser.h"
+#include "coverpalette.h"
+#include "flowingbackground.h"
+#include "perfhud.h"
+#include "waveformseekbar.h"
+#include "crossfadeoverlay.h"
+#include "core/metrics.h"
+#include "core/logging.h"
+#include "core/chunkedaudiobuffer.h"
+#include "core/audioengine.h"
+#include "core/trackanalysisservice.h"
+#include "core/spectrumanalyzer.h"
+#include "core/equalizer.h"
+#include "core/audiocache.h"
+#include "core/downloadmanager.h"
+#include "core/cachemaintenance.h"
 #include <QLineEdit>
 #include <QPushButton>
 #include <QListWidget>
@@ -8,9 +27,7 @@
 #include <QSlider>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
-#include <QBuffer>
 #include <QStackedWidget>
-#include <QAudioOutput>
 #include <QAudioDevice>
 #include <QMediaDevices>
 #include <QMessageBox>
@@ -24,7 +41,6 @@
 #include <QFont>
 #include <QMenu>
 #include <QWidgetAction>
-#include <QDebug>
 #include <QComboBox>
 #include <QTimer>
 #include <QPainter>
@@ -37,6 +53,14 @@
 #include <QGraphicsBlurEffect>
 #include <QGraphicsScene>
 #include <QGraphicsPixmapItem>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QFileDialog>
+#include <QDir>
+#include <QDateTime>
+#include <QShortcut>
+#include <QToolTip>
+#include <algorithm>
 
 // --- FloatingIsland 实现 ---
 FloatingIsland::FloatingIsland(QWidget *parent)
@@ -286,9 +310,6 @@ LoadingSpinner::LoadingSpinner(QWidget *parent)
     m_label->setAlignment(Qt::AlignCenter);
     m_label->setGeometry(0, 0, 28, 28);
 
-    m_movie = new QMovie(":/icons/loading.gif");
-    m_movie->setScaledSize(QSize(28, 28));
-    m_label->setMovie(m_movie);
     hide();
 }
 
@@ -299,105 +320,54 @@ QSize LoadingSpinner::sizeHint() const
 
 void LoadingSpinner::start()
 {
+    // GIF 解码开销不小，第一次需要显示时才加载
+    if (!m_movie) {
+        m_movie = new QMovie(":/icons/loading.gif", QByteArray(), this);
+        m_movie->setScaledSize(QSize(28, 28));
+        m_label->setMovie(m_movie);
+    }
     m_movie->start();
     show();
 }
 
 void LoadingSpinner::stop()
 {
-    m_movie->stop();
+    if (m_movie) m_movie->stop();
     hide();
 }
 
-// --- FlowingBackground 实现 ---
-
-FlowingBackground::FlowingBackground(QWidget *parent)
-    : QWidget(parent)
-{
-    // 初始化默认颜色
-    m_colors = { QColor(80, 60, 140), QColor(60, 80, 120), QColor(40, 60, 100) };
-}
+// --- Widget 实现 ---
 
-void FlowingBackground::setColors(const QVector<QColor> &colors)
-{
-    m_colors = colors;
-    m_blobs.clear();
-    
-    if (colors.isEmpty()) return;
-    
-    // 为每种颜色创建一个"blob"
-    for (int i = 0; i < colors.size(); ++i) {
-        Blob blob;
-        blob.color = colors[i];
-        blob.x = 0.2 + (i % 3) * 0.3;  // 分散初始位置
-        blob.y = 0.2 + (i / 3) * 0.3;
-        blob.radius = 0.4 + (i % 2) * 0.2;  // 不同大小
-        blob.speedX = 0.0003 + i * 0.0001;  // 不同速度
-        blob.speedY = 0.0002 + i * 0.00015;
-        blob.phase = i * 1.5;  // 相位偏移
-        m_blobs.append(blob);
+// 边输入边搜索的防抖间隔；本地曲库查询只在内存中进行，间隔可以更短
+static const int kSearchDebounceMs = 250;
+static const int kLocalSearchDebounceMs = 60;
+// 触发边输入边搜索的最少字符数（单个汉字除外）
+static const int kMinIncrementalChars = 2;
+// 保留的延迟样本数，用于计算中位数与P95
+static const int kMaxLatencySamples = 200;
+// 会话中保存的网易云播放地址在此时间内视为有效，超过后启动时重新解析
+static const qint64 kResolvedUrlTtlMs = 15 * 60 * 1000;
+// 距曲目结尾这么久时把下一首交给支持无缝衔接的引擎，留出打开文件和解码的时间
+static const qint64 kGaplessPreloadMs = 10000;
+static const int kCrossfadeChoicesMs[] = { 0, 2000, 5000, 8000, 12000 };
+// 配色切换的淡出时长
+static const int kStyleTransitionMs = 500;
+// 启动后等这么久再做缓存维护，避开启动和首次播放
+static const int kCacheMaintenanceDelayMs = 2 * 60 * 1000;
+
+// 搜索结果的悬停提示：专辑与时长
+static QString songToolTip(const Song &song)
+{
+    QStringList lines;
+    lines << song.name;
+    if (!song.artist.isEmpty()) lines << QString("歌手: %1").arg(song.artist);
+    if (!song.album.isEmpty()) lines << QString("专辑: %1").arg(song.album);
+    if (song.duration > 0) {
+        lines << QString("时长: %1:%2").arg(song.duration / 60, 2, 10, QChar('0')).arg(song.duration % 60, 2, 10, QChar('0'));
     }
-    
-    update();
+    return lines.join('\n');
 }
 
-void FlowingBackground::setTimeOffset(qreal offset)
-{
-    m_timeOffset = offset;
-    update();
-}
-
-void FlowingBackground::paintEvent(QPaintEvent *event)
-{
-    Q_UNUSED(event);
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::SmoothPixmapTransform);
-    
-    QRectF rect = this->rect();
-    qreal w = rect.width();
-    qreal h = rect.height();
-    
-    // 深色底色
-    painter.fillRect(rect, QColor(20, 20, 25));
-    
-    // 绘制流动的颜色块
-    for (const Blob &blob : m_blobs) {
-        // 使用正弦函数创建平滑的移动轨迹
-        qreal t = m_timeOffset + blob.phase;
-        qreal x = blob.x + qSin(t * blob.speedX * 1000) * 0.3;
-        qreal y = blob.y + qCos(t * blob.speedY * 1000) * 0.3;
-        
-        // 确保在边界内
-        x = qBound(0.1, x, 0.9);
-        y = qBound(0.1, y, 0.9);
-        
-        // 转换为像素坐标
-        qreal cx = x * w;
-        qreal cy = y * h;
-        qreal radius = blob.radius * qMax(w, h);
-        
-        // 创建径向渐变
-        QRadialGradient gradient(cx, cy, radius);
-        QColor color = blob.color;
-        gradient.setColorAt(0, QColor(color.red(), color.green(), color.blue(), 180));
-        gradient.setColorAt(0.5, QColor(color.red(), color.green(), color.blue(), 80));
-        gradient.setColorAt(1, QColor(color.red(), color.green(), color.blue(), 0));
-        
-        painter.setBrush(gradient);
-        painter.setPen(Qt::NoPen);
-        painter.drawEllipse(QPointF(cx, cy), radius, radius);
-    }
-    
-    // 添加暗色遮罩提升文字可读性
-    QLinearGradient overlay(0, 0, 0, h);
-    overlay.setColorAt(0, QColor(0, 0, 0, 80));
-    overlay.setColorAt(0.5, QColor(0, 0, 0, 40));
-    overlay.setColorAt(1, QColor(0, 0, 0, 100));
-    painter.fillRect(rect, overlay);
-}
-
-// --- Widget 实现 ---
-
 Widget::Widget(QWidget *parent)
     : QWidget(parent), currentDuration(0)
 {
@@ -408,25 +378,15 @@ Widget::Widget(QWidget *parent)
     // --- 业务逻辑变量初始化 ---
     currentPage = 1;
     currentPlayingSongId = -1;
+    coverRequestedSongId = -1;
     currentSearchSource = SearchSource::NetEase; // 默认网易云音乐
 
+    StartupTrace::begin("Widget: controls");
+
     // --- 动态背景初始化 ---
     currentBackgroundColor = QColor(51, 51, 51);
-    backgroundAnimation = new QPropertyAnimation(this, "widgetBackgroundColor", this);
-    backgroundAnimation->setDuration(800);
-    backgroundAnimation->setEasingCurve(QEasingCurve::InOutQuad);
 
-    // 流动背景控件
-    flowingBackground = new FlowingBackground(this);
-    flowingBackground->lower(); // 放到最底层
-    
-    // 流动动画
-    flowAnimation = new QPropertyAnimation(flowingBackground, "timeOffset", this);
-    flowAnimation->setDuration(20000); // 20秒一个周期
-    flowAnimation->setStartValue(0.0);
-    flowAnimation->setEndValue(100.0);
-    flowAnimation->setLoopCount(-1); // 无限循环
-    flowAnimation->setEasingCurve(QEasingCurve::Linear);
+    // 流动背景、悬浮窗和托盘图标在首次使用时创建，不占用首帧之前的时间
 
     // --- 加载动画初始化 ---
     loadingSpinner = new LoadingSpinner(this);
@@ -452,6 +412,8 @@ Widget::Widget(QWidget *parent)
     searchSourceCombo = new QComboBox;
     searchSourceCombo->addItem("网易云音乐");
     searchSourceCombo->addItem("Bilibili");
+    searchSourceCombo->addItem("本地音乐");
+    searchSourceCombo->addItem("聚合搜索");
     searchSourceCombo->setFixedWidth(90);
     playPauseButton = new QPushButton;
     playPauseButton->setIcon(QIcon(":/icons/play.png"));
@@ -469,7 +431,7 @@ Widget::Widget(QWidget *parent)
     playModeButton->setIcon(QIcon(":/icons/loop-list.png"));
     playModeButton->setIconSize(QSize(20, 20));
     playModeButton->setFixedSize(28, 28);
-    progressSlider = new QSlider(Qt::Horizontal);
+    progressSlider = new WaveformSeekBar;
     timeLabel = new QLabel("00:00 / 00:00");
 
     // --- 分页控件 ---
@@ -605,23 +567,46 @@ Widget::Widget(QWidget *parent)
     setWindowIcon(QIcon(":/logo.png"));
     resize(350, 450);
 
+    StartupTrace::end();
+
     // --- 样式表设置 ---
+    StartupTrace::begin("Widget: stylesheet");
     setWidgetStyle(currentBackgroundColor);
+    StartupTrace::end();
 
     // --- 后端对象初始化 ---
-    mediaPlayer = new QMediaPlayer(this);
-    audioOutput = new QAudioOutput(this);
+    StartupTrace::begin("Widget: media and network backend");
+    audioEngine = AudioEngine::create(AudioEngine::configuredEngine(), this);
+    spectrumAnalyzer = new SpectrumAnalyzer(this);
     mediaDevices = new QMediaDevices(this);
-    mediaPlayer->setAudioOutput(audioOutput);
-    audioOutput->setVolume(0.5);
+    audioEngine->setVolume(0.5);
+    audioEngine->setCrossfadeDuration(QSettings().value("audio/crossfadeMs", 0).toInt());
+    audioEngine->setEqualizerGains(Equalizer::presetGains(QSettings().value("audio/eqPreset").toString()));
     
     // 设置默认音频输出设备
     QAudioDevice defaultDevice = QMediaDevices::defaultAudioOutput();
     if (!defaultDevice.isNull()) {
-        audioOutput->setDevice(defaultDevice);
+        audioEngine->setAudioDevice(defaultDevice);
     }
     
     apiManager = new ApiManager(this);
+    sessionStore = new SessionStore(QString(), this);
+    trackAnalysis = new TrackAnalysisService(this);
+    connect(trackAnalysis, &TrackAnalysisService::waveformReady, this, &Widget::onWaveformReady);
+    connect(trackAnalysis, &TrackAnalysisService::trimPointsReady, this, &Widget::onTrimPointsReady);
+    normalizeLoudness = QSettings().value("audio/normalize", true).toBool();
+    audioCache = new AudioCache(QString(), this);
+    // 离线下载完成的曲目已在本地，顺便分析响度和波形
+    connect(audioCache, &AudioCache::entryAdded, this, [this](const QString &key) {
+        trackAnalysis->analyze(key, QUrl::fromLocalFile(audioCache->filePath(key)));
+    });
+    downloadManager = new DownloadManager(apiManager, audioCache, QString(), this);
+    downloadManager->setBandwidthLimit(qint64(QSettings().value("download/maxKBps", 0).toInt()) * 1024);
+    cacheMaintenance = new CacheMaintenance(audioCache, downloadManager, this);
+    QTimer::singleShot(kCacheMaintenanceDelayMs, cacheMaintenance, &CacheMaintenance::start);
+    StartupTrace::end();
+
+    StartupTrace::begin("Widget: signal connections");
 
     // 初始化播放看门狗定时器（用于检测播放卡住）
     playbackWatchdog = new QTimer(this);
@@ -635,6 +620,10 @@ Widget::Widget(QWidget *parent)
     connect(nextPageButton, &QPushButton::clicked, this, &Widget::onNextPageButtonClicked);
     connect(searchButton, &QPushButton::clicked, this, &Widget::onSearchButtonClicked);
     connect(searchInput, &QLineEdit::returnPressed, this, &Widget::onSearchButtonClicked);
+    searchDebounceTimer = new QTimer(this);
+    searchDebounceTimer->setSingleShot(true);
+    connect(searchDebounceTimer, &QTimer::timeout, this, &Widget::onSearchDebounceTimeout);
+    connect(searchInput, &QLineEdit::textEdited, this, &Widget::onSearchTextEdited);
 
     // 搜索源切换
     connect(searchSourceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -646,36 +635,51 @@ Widget::Widget(QWidget *parent)
     connect(apiManager, &ApiManager::songDetailFinished, this, &Widget::onSongDetailFinished);
     connect(apiManager, &ApiManager::imageDownloaded, this, &Widget::onImageDownloaded);
     connect(apiManager, &ApiManager::songUrlReady, this, &Widget::onSongUrlReady);
+    connect(apiManager, &ApiManager::songUrlPrefetched, this, &Widget::onSongUrlPrefetched);
 
     // Bilibili API信号
     connect(apiManager, &ApiManager::bilibiliSearchFinished, this, &Widget::onBilibiliSearchFinished);
     connect(apiManager, &ApiManager::bilibiliVideoInfoFinished, this, &Widget::onBilibiliVideoInfoFinished);
     connect(apiManager, &ApiManager::bilibiliAudioUrlReady, this, &Widget::onBilibiliAudioUrlReady);
-    connect(apiManager, &ApiManager::bilibiliAudioDataReady, this, &Widget::onBilibiliAudioDataReady);
-    connect(apiManager, &ApiManager::bilibiliAudioFileReady, this, &Widget::onBilibiliAudioFileReady);
+    connect(apiManager, &ApiManager::bilibiliAudioStreamReady, this, &Widget::onBilibiliAudioStreamReady);
+    connect(apiManager, &ApiManager::bilibiliAudioStreamFinished, this, &Widget::onBilibiliAudioStreamFinished);
+    connect(apiManager, &ApiManager::bilibiliAudioUpgradeFailed, this, &Widget::onBilibiliAudioUpgradeFailed);
     connect(apiManager, &ApiManager::bilibiliImageDownloaded, this, &Widget::onBilibiliImageDownloaded);
 
+    connect(apiManager, &ApiManager::bilibiliRateLimited, this, [this](int retryInMs) {
+        rateLimitHintShown = true;
+        searchButton->setToolTip(QString("B站请求受限，%1 秒后自动重试...").arg((retryInMs + 999) / 1000));
+    });
+
     connect(apiManager, &ApiManager::error, this, &Widget::onApiError);
+    connect(apiManager, &ApiManager::searchFailed, this, [this](const QString &errorString) {
+        onSearchFailed(SearchSource::NetEase, errorString);
+    });
+    connect(apiManager, &ApiManager::bilibiliSearchFailed, this, [this](const QString &errorString) {
+        onSearchFailed(SearchSource::Bilibili, errorString);
+    });
     connect(resultList, &QListWidget::itemDoubleClicked, this, &Widget::onResultItemDoubleClicked);
+    resultList->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(resultList, &QListWidget::customContextMenuRequested, this, &Widget::showResultContextMenu);
     connect(playPauseButton, &QPushButton::clicked, this, &Widget::onPlayPauseButtonClicked);
     connect(volumeButton, &QPushButton::clicked, this, &Widget::onVolumeButtonClicked); // 连接音量按钮
     connect(volumeSlider, &QSlider::valueChanged, this, [this](int value) {
-        audioOutput->setVolume(value / 100.0);
+        audioEngine->setVolume(value / 100.0);
         updateVolumeIcon(value);
+        sessionStore->setVolume(value);
+    });
+    connectAudioEngine();
+    // 拖动过程中只移动滑块，松开后才跳转：每次跳转都要从头重新解码
+    connect(progressSlider, &QSlider::sliderReleased, this, [this]() {
+        setPosition(progressSlider->sliderPosition());
     });
-    connect(mediaPlayer, &QMediaPlayer::positionChanged, this, &Widget::updatePosition);
-    connect(mediaPlayer, &QMediaPlayer::durationChanged, this, &Widget::updateDuration);
-    connect(mediaPlayer, &QMediaPlayer::playbackStateChanged, this, &Widget::updateState);
-    connect(mediaPlayer, &QMediaPlayer::mediaStatusChanged, this, &Widget::onMediaStatusChanged); // 监听播放结束
-    connect(mediaPlayer, &QMediaPlayer::errorOccurred, this, &Widget::onMediaPlayerError); // 监听播放错误
-    connect(progressSlider, &QSlider::sliderMoved, this, &Widget::setPosition);
 
     // 监听音频输出设备变化
     connect(mediaDevices, &QMediaDevices::audioOutputsChanged, this, [this]() {
         QAudioDevice newDefault = QMediaDevices::defaultAudioOutput();
-        if (!newDefault.isNull() && audioOutput->device() != newDefault) {
-            audioOutput->setDevice(newDefault);
-            qDebug() << "音频设备已切换到:" << newDefault.description();
+        if (!newDefault.isNull() && audioEngine->audioDevice() != newDefault) {
+            audioEngine->setAudioDevice(newDefault);
+            qCInfo(lcPlayback) << "音频设备已切换到:" << newDefault.description();
         }
     });
 
@@ -683,8 +687,32 @@ Widget::Widget(QWidget *parent)
     connect(prevButton, &QPushButton::clicked, this, &Widget::playPreviousSong);
     connect(nextButton, &QPushButton::clicked, this, &Widget::playNextSong);
     connect(playModeButton, &QPushButton::clicked, this, &Widget::changePlayMode);
+    playModeButton->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(playModeButton, &QPushButton::customContextMenuRequested, this, &Widget::showAudioMenu);
+
+    connect(minimizeButton, &QPushButton::clicked, this, &Widget::onMinimizeButtonClicked);
+
+    // 性能浮层与指标导出
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+P"), this), &QShortcut::activated, this, &Widget::togglePerfHud);
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+E"), this), &QShortcut::activated, this, &Widget::exportMetrics);
+    connect(new QShortcut(QKeySequence("Ctrl+Shift+A"), this), &QShortcut::activated, this, &Widget::switchAudioEngine);
+    StartupTrace::end();
+
+    // 已配置过曲库目录时，启动后在后台预先建立索引
+    if (QSettings().contains("library/folders")) {
+        QTimer::singleShot(3000, this, &Widget::ensureLocalLibrary);
+    }
+
+    // 在窗口首次显示之前恢复，第一帧即可看到上次的队列
+    StartupTrace::begin("Widget: restore session");
+    restoreSession();
+    StartupTrace::end();
+}
+
+void Widget::ensureTrayIcon()
+{
+    if (trayIcon) return;
 
-    // --- 系统托盘初始化 ---
     trayIcon = new QSystemTrayIcon(this);
     trayIcon->setIcon(QIcon(":/logo.png"));
     trayIcon->setToolTip("Melody");
@@ -701,181 +729,601 @@ Widget::Widget(QWidget *parent)
     trayIconMenu->addAction(quitAction);
 
     trayIcon->setContextMenu(trayIconMenu);
-    // 不在这里 show()，而是在 closeEvent 中
-    // trayIcon->show(); 
-
     connect(trayIcon, &QSystemTrayIcon::activated, this, &Widget::onTrayIconActivated);
+}
+
+void Widget::ensureFloatingIsland()
+{
+    if (floatingIsland) return;
 
-    // --- 悬浮灵动岛初始化 ---
     floatingIsland = new FloatingIsland();
     connect(floatingIsland, &FloatingIsland::prevClicked, this, &Widget::playPreviousSong);
     connect(floatingIsland, &FloatingIsland::playPauseClicked, this, &Widget::onPlayPauseButtonClicked);
     connect(floatingIsland, &FloatingIsland::nextClicked, this, &Widget::playNextSong);
     connect(floatingIsland, &FloatingIsland::expandClicked, this, &Widget::onFloatingExpandClicked);
-    connect(minimizeButton, &QPushButton::clicked, this, &Widget::onMinimizeButtonClicked);
+}
+
+void Widget::ensureFlowingBackground()
+{
+    if (flowingBackground) return;
+
+    flowingBackground = new FlowingBackground(this);
+    flowingBackground->setSpectrumAnalyzer(spectrumAnalyzer);
+    flowingBackground->setGeometry(0, 0, width(), height());
+    flowingBackground->lower(); // 放到最底层
+    flowingBackground->show();
+
+    // 流动动画
+    flowAnimation = new QPropertyAnimation(flowingBackground, "timeOffset", this);
+    flowAnimation->setDuration(20000); // 20秒一个周期
+    flowAnimation->setStartValue(0.0);
+    flowAnimation->setEndValue(100.0);
+    flowAnimation->setLoopCount(-1); // 无限循环
+    flowAnimation->setEasingCurve(QEasingCurve::Linear);
+}
+
+bool Widget::event(QEvent *event)
+{
+    if (event->type() != QEvent::Paint) {
+        return QWidget::event(event);
+    }
+
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+    const bool result = QWidget::event(event);
+    Metrics::observe("ui_paint_ms", paintTimer.nsecsElapsed() / 1e6, { { "widget", "main" } });
+    if (!firstPaintDone) {
+        firstPaintDone = true;
+        StartupTrace::firstPaint();
+    }
+    return result;
+}
+
+void Widget::togglePerfHud()
+{
+    if (!perfHud) {
+        perfHud = new PerfHud(this);
+        perfHud->move(12, 12);
+        perfHud->hide();
+    }
+    perfHud->setVisible(!perfHud->isVisible());
+}
+
+void Widget::exportMetrics()
+{
+    const QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/metrics.json";
+    const QString filePath = QFileDialog::getSaveFileName(this, "导出性能指标", defaultPath,
+                                                          "JSON (*.json);;Prometheus 文本 (*.prom *.txt)");
+    if (filePath.isEmpty()) return;
+
+    QString errorMessage;
+    if (!Metrics::exportTo(filePath, &errorMessage)) {
+        QMessageBox::warning(this, "导出失败", errorMessage);
+    }
+}
+
+void Widget::connectAudioEngine()
+{
+    connect(audioEngine, &AudioEngine::positionChanged, this, &Widget::updatePosition);
+    connect(audioEngine, &AudioEngine::durationChanged, this, &Widget::updateDuration);
+    connect(audioEngine, &AudioEngine::playbackStateChanged, this, &Widget::updateState);
+    connect(audioEngine, &AudioEngine::mediaStatusChanged, this, &Widget::onMediaStatusChanged); // 监听播放结束
+    connect(audioEngine, &AudioEngine::errorOccurred, this, &Widget::onMediaPlayerError); // 监听播放错误
+    connect(audioEngine, &AudioEngine::nextSourceStarted, this, &Widget::onGaplessTrackStarted);
+    connect(audioEngine, &AudioEngine::loudnessMeasured, this, &Widget::onLoudnessMeasured);
+    connect(audioEngine, &AudioEngine::waveformMeasured, this, &Widget::onWaveformMeasured);
+    audioEngine->setSpectrumAnalyzer(spectrumAnalyzer);
+}
+
+void Widget::switchAudioEngine()
+{
+    const QStringList engines = AudioEngine::availableEngines();
+    const QString nextName = engines.value((engines.indexOf(audioEngine->name()) + 1) % engines.size());
+    QSettings().setValue("audio/engine", nextName);
+
+    // 新引擎从当前位置接着播放
+    const QUrl source = audioEngine->source();
+    const qint64 position = audioEngine->position();
+    const bool wasPlaying = audioEngine->playbackState() == QMediaPlayer::PlayingState;
+    const QAudioDevice device = audioEngine->audioDevice();
+    const int crossfadeMs = QSettings().value("audio/crossfadeMs", 0).toInt();
+    const float normalization = audioEngine->normalizationGain();
+
+    audioEngine->disconnect(this);
+    audioEngine->setSpectrumAnalyzer(nullptr);
+    audioEngine->stop();
+    audioEngine->deleteLater();
+    gaplessQueued = false;
+
+    audioEngine = AudioEngine::create(nextName, this);
+    audioEngine->setNormalizationGain(normalization);
+    audioEngine->setVolume(volumeSlider->value() / 100.0);
+    audioEngine->setCrossfadeDuration(crossfadeMs);
+    audioEngine->setEqualizerGains(Equalizer::presetGains(QSettings().value("audio/eqPreset").toString()));
+    if (!device.isNull()) {
+        audioEngine->setAudioDevice(device);
+    }
+    connectAudioEngine();
+
+    if (currentAudioBuffer) {
+        audioEngine->setSourceDevice(currentAudioBuffer);
+    } else if (!source.isEmpty()) {
+        audioEngine->setSource(source);
+    }
+    if (currentAudioBuffer || !source.isEmpty()) {
+        pendingSeekPosition = position;
+        if (wasPlaying) audioEngine->play();
+    }
+
+    updateBackgroundActivity(); // 新引擎不一定提供频谱数据
+    qCInfo(lcPlayback) << "Audio engine switched to" << audioEngine->name();
+    QToolTip::showText(mapToGlobal(rect().center()), "播放引擎: " + audioEngine->name(), this);
+}
+
+void Widget::startFirstAudioTimer(const QString &source)
+{
+    firstAudioTimer.start();
+    firstAudioSource = source;
 }
 
 Widget::~Widget()
 {
+    // 播放器随后析构时的状态变化不应覆盖已记录的位置
+    audioEngine->disconnect(this);
+    // 切换过引擎时播放器在频谱分析之后析构，先断开声卡回调
+    spectrumAnalyzer->stop();
+    audioEngine->setSpectrumAnalyzer(nullptr);
+    sessionStore->flush();
+
+    // 设置了 MELODY_METRICS_EXPORT 时退出前写出指标，便于脚本化采集
+    const QString metricsPath = qEnvironmentVariable("MELODY_METRICS_EXPORT");
+    if (!metricsPath.isEmpty()) {
+        Metrics::exportTo(metricsPath);
+    }
+
     if (floatingIsland) {
         delete floatingIsland;
     }
 }
 
+void Widget::restoreSession()
+{
+    SessionState session;
+    if (!sessionStore->load(&session)) return;
+
+    volumeSlider->setValue(session.volume);
+    playlistManager->setPlayMode(static_cast<PlaylistManager::PlayMode>(qBound(0, session.playMode, 2)));
+    updatePlayModeButton();
+    if (session.queue.isEmpty()) return;
+
+    showResultSongs(session.queue);
+    playlistManager->addSongs(session.queue);
+    pageLabel->setText(QString("上次的播放列表 %1 首").arg(session.queue.size()));
+    prevPageButton->setEnabled(false);
+    nextPageButton->setEnabled(false);
+    if (session.currentIndex < 0) return;
+
+    playlistManager->setCurrentIndex(session.currentIndex);
+    sessionStore->setCurrentIndex(session.currentIndex);
+    const Song song = playlistManager->getCurrentSong();
+    songNameLabel->setText(song.name);
+    if (floatingIsland) floatingIsland->setSongInfo(song.name, song.artist, QPixmap());
+
+    restoringSession = true;
+    resumeOnRestore = session.wasPlaying;
+    pendingSeekPosition = session.positionMs > 0 ? session.positionMs : -1;
+    sessionStore->setPosition(session.positionMs, session.wasPlaying);
+    applyNormalization(song);
+    showWaveform(song.source == SearchSource::Local ? QUrl::fromLocalFile(song.filePath) : QUrl());
+
+    if (song.source == SearchSource::Local) {
+        currentLocalFile = song.filePath;
+        audioEngine->setSource(QUrl::fromLocalFile(song.filePath));
+        restoringSession = false;
+        if (resumeOnRestore) audioEngine->play();
+        return;
+    }
+
+    if (song.source == SearchSource::Bilibili) {
+        // 音频需重新下载到临时文件，放到首帧之后
+        currentBvid = song.bvid;
+        if (resumeOnRestore) {
+            QTimer::singleShot(0, this, [this, position = pendingSeekPosition]() {
+                if (!restoringSession) return;
+                playQueuedSong(playlistManager->getCurrentSong());
+                pendingSeekPosition = position;
+            });
+        }
+        return;
+    }
+
+    currentPlayingSongId = song.id;
+    const bool urlFresh = session.resolvedUrl.isValid()
+        && QDateTime::currentMSecsSinceEpoch() - session.resolvedAt < kResolvedUrlTtlMs;
+    if (urlFresh) {
+        // 保存的地址仍在有效期内，直接作为音源；若已失效，播放出错时再重新解析
+        restoredCachedUrl = true;
+        audioEngine->setSource(session.resolvedUrl);
+        if (resumeOnRestore) {
+            restoringSession = false;
+            audioEngine->play();
+            playbackWatchdog->start();
+        }
+    }
+
+    // 歌词、封面与过期地址的重新解析都在首帧之后进行
+    QTimer::singleShot(0, this, [this, song, urlFresh]() {
+        if (currentPlayingSongId != song.id) return;
+        if (!urlFresh) apiManager->getSongUrl(song.id);
+        apiManager->getLyric(song.id);
+        coverRequestedSongId = -1;
+        if (!song.picUrl.isEmpty()) {
+            requestCover(song);
+        } else {
+            apiManager->getSongDetail(song.id);
+        }
+    });
+}
+
 void Widget::onSearchButtonClicked()
 {
-    currentSearchKeywords = searchInput->text();
-    if (!currentSearchKeywords.isEmpty()) {
-        currentPage = 1; // 每次新搜索都重置为第一页
-        mainStackedWidget->setCurrentWidget(resultList);
-        searchButton->setEnabled(false);
-        searchButton->setToolTip("搜索中...");
+    const QString keywords = searchInput->text().trimmed();
+    if (!keywords.isEmpty()) {
+        searchDebounceTimer->stop();
+        incrementalSearch = false;
+        keystrokeTimer.start();
+        runSearch(keywords);
+    }
+}
 
-        // 根据搜索源调用不同的API
-        if (currentSearchSource == SearchSource::NetEase) {
-            apiManager->searchSongs(currentSearchKeywords, 15, (currentPage - 1) * 15);
-        } else {
-            apiManager->searchBilibiliVideos(currentSearchKeywords, currentPage);
+void Widget::onSearchTextEdited()
+{
+    // 从最后一次按键开始计时，防抖结束后再搜索
+    keystrokeTimer.start();
+    const bool local = currentSearchSource == SearchSource::Local && !federatedSearch;
+    searchDebounceTimer->start(local ? kLocalSearchDebounceMs : kSearchDebounceMs);
+}
+
+void Widget::onSearchDebounceTimeout()
+{
+    const QString keywords = searchInput->text().trimmed();
+    if (keywords.isEmpty()) {
+        apiManager->cancelSearches(); // 保留已有结果，只取消进行中的请求
+        return;
+    }
+    if (keywords == currentSearchKeywords) return;
+
+    // 单个字母或数字的结果没有意义，单个汉字可以
+    const QString normalized = SearchMerger::normalize(keywords);
+    if (normalized.size() < kMinIncrementalChars && !normalized.contains(QRegularExpression("\\p{Han}"))) {
+        return;
+    }
+
+    incrementalSearch = true;
+    runSearch(keywords);
+}
+
+void Widget::runSearch(const QString &keywords)
+{
+    currentSearchKeywords = keywords;
+    currentPage = 1; // 每次新搜索都重置为第一页
+    mainStackedWidget->setCurrentWidget(resultList);
+    searchButton->setToolTip("搜索中...");
+
+    if (currentSearchSource == SearchSource::Local && !federatedSearch) {
+        showLocalResults(currentSearchKeywords);
+        return;
+    }
+
+    // 新的搜索会中止尚未返回的旧搜索，无需禁用搜索按钮
+    if (federatedSearch) {
+        searchMerger.reset(currentSearchKeywords);
+        federatedTotalPages = 0;
+    }
+
+    // 先用缓存展示结果：精确命中的来源不再请求网络，前缀命中的作为临时结果
+    QList<SearchSource> sources;
+    if (federatedSearch) {
+        sources << SearchSource::NetEase << SearchSource::Bilibili;
+    } else {
+        sources << currentSearchSource;
+    }
+    for (SearchSource source : sources) {
+        SearchCache::Result cached;
+        const bool hit = searchCache.lookup(source, currentSearchKeywords, &cached);
+        if (hit) {
+            showSourceResults(source, cached.songs, cached.total, !cached.exact);
         }
+        if (!hit || !cached.exact) {
+            requestSource(source);
+        }
+    }
+}
+
+void Widget::requestSearchPage()
+{
+    if (federatedSearch) {
+        // 两个来源并发请求，先返回的先展示
+        searchMerger.reset(currentSearchKeywords);
+        federatedTotalPages = 0;
+        requestSource(SearchSource::NetEase);
+        requestSource(SearchSource::Bilibili);
+    } else {
+        requestSource(currentSearchSource);
+    }
+}
+
+void Widget::requestSource(SearchSource source)
+{
+    // 根据搜索源调用不同的API
+    if (source == SearchSource::NetEase) {
+        apiManager->searchSongs(currentSearchKeywords, 15, (currentPage - 1) * 15);
+    } else if (source == SearchSource::Bilibili) {
+        apiManager->searchBilibiliVideos(currentSearchKeywords, currentPage);
     }
 }
 
 void Widget::onSearchSourceChanged(int index)
 {
-    currentSearchSource = (index == 0) ? SearchSource::NetEase : SearchSource::Bilibili;
-    // 清空当前搜索结果
-    resultList->clear();
-    searchResultSongs.clear();
-    playlistManager->addSongs({}); // 清空播放列表
+    static const SearchSource sources[] = { SearchSource::NetEase, SearchSource::Bilibili, SearchSource::Local };
+    // 聚合搜索的分页与详情补全沿用网易云的流程
+    federatedSearch = (index == 3);
+    currentSearchSource = federatedSearch ? SearchSource::NetEase : sources[qBound(0, index, 2)];
+    apiManager->cancelSearches(); // 旧搜索源的结果不再需要
+    searchDebounceTimer->stop();
+    currentSearchKeywords.clear(); // 同样的关键词在新搜索源下需要重新搜索
+
+    // 保留当前结果和播放列表，正在播放的歌曲不受影响；
+    // 结果属于之前的搜索源，翻页需要重新搜索
+    prevPageButton->setEnabled(false);
+    nextPageButton->setEnabled(false);
 
     // 更新placeholder提示
-    if (currentSearchSource == SearchSource::NetEase) {
+    if (federatedSearch) {
+        searchInput->setPlaceholderText("同时搜索网易云音乐和Bilibili...");
+    } else if (currentSearchSource == SearchSource::NetEase) {
         searchInput->setPlaceholderText("输入歌名或歌手...");
-    } else {
+    } else if (currentSearchSource == SearchSource::Bilibili) {
         searchInput->setPlaceholderText("输入Bilibili视频关键词...");
+    } else {
+        ensureLocalLibrary();
+        searchInput->setPlaceholderText("搜索本地音乐（支持拼音首字母）...");
     }
 }
 
-void Widget::onSearchFinished(const QJsonDocument &json)
+void Widget::ensureLocalLibrary()
 {
+    if (localLibrary) return;
+
+    QSettings settings;
+    QStringList folders = settings.value("library/folders").toStringList();
+    if (folders.isEmpty()) {
+        folders = QStandardPaths::standardLocations(QStandardPaths::MusicLocation);
+    }
+
+    localLibrary = new LocalLibrary(this);
+    connect(localLibrary, &LocalLibrary::scanFinished, this, [this](int trackCount) {
+        qCInfo(lcLibrary) << "Local library ready:" << trackCount << "tracks";
+        if (currentSearchSource == SearchSource::Local) {
+            pageLabel->setText(QString("本地 %1 首").arg(trackCount));
+        }
+    });
+    localLibrary->setFolders(folders);
+}
+
+void Widget::showLocalResults(const QString &keywords)
+{
+    ensureLocalLibrary();
+
+    showResultSongs(localLibrary->search(keywords));
+
     searchButton->setEnabled(true);
     searchButton->setToolTip("搜索");
-    resultList->clear(); // 清空列表
+    pageLabel->setText(QString("找到 %1 首").arg(searchResultSongs.size()));
+    prevPageButton->setEnabled(false);
+    nextPageButton->setEnabled(false);
+    reportSearchLatency("local", true);
+}
 
-    searchResultSongs.clear(); // 清空旧的歌曲数据
+void Widget::addLocalLibraryFolder()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, "添加音乐文件夹");
+    if (dir.isEmpty()) return;
 
-    QJsonObject rootObj = json.object();
+    ensureLocalLibrary();
+    localLibrary->addFolder(dir);
+    QSettings settings;
+    settings.setValue("library/folders", localLibrary->folders());
+}
+
+void Widget::onSearchFinished(const QJsonDocument &json)
+{
     int totalSongCount = 0;
-    if (rootObj.contains("result")) {
-        QJsonObject resultObj = rootObj["result"].toObject();
-        if (resultObj.contains("songCount")) {
-            totalSongCount = resultObj["songCount"].toInt();
-        }
-        if (resultObj.contains("songs")) {
-            QJsonArray songsArray = resultObj["songs"].toArray();
-            if (songsArray.isEmpty() && currentPage == 1) {
-                QMessageBox::information(this, "无结果", "未找到相关歌曲。");
-            }
-            for (const QJsonValue &value : songsArray) {
-                QJsonObject songObj = value.toObject();
-                
-                QString songName = songObj["name"].toString();
-                QString artistName;
-                if (!songObj["artists"].toArray().isEmpty()) {
-                    artistName = songObj["artists"].toArray()[0].toObject()["name"].toString();
-                }
-                qint64 songId = songObj["id"].toVariant().toLongLong();
-
-                QListWidgetItem *item = new QListWidgetItem(QString("%1 - %2").arg(songName, artistName));
-                item->setData(Qt::UserRole, songId);
-                resultList->addItem(item);
-
-                Song song;
-                song.id = songId;
-                song.name = songName;
-                song.artist = artistName;
-                song.source = SearchSource::NetEase;
-                searchResultSongs.append(song);
-            }
-            playlistManager->addSongs(searchResultSongs);
+    QVector<Song> songs = SongParser::parseNetEaseSearch(json, &totalSongCount);
+
+    // 被取代的搜索已在ApiManager中中止，返回的结果一定属于当前关键词
+    if (currentPage == 1) {
+        searchCache.insert(SearchSource::NetEase, currentSearchKeywords, songs, totalSongCount);
+    }
+    showSourceResults(SearchSource::NetEase, songs, totalSongCount, false);
+}
+
+void Widget::onBilibiliSearchFinished(const QJsonDocument &json)
+{
+    int totalResults = 0;
+    QString errorMessage;
+    QVector<Song> songs = SongParser::parseBilibiliSearch(json, &totalResults, &errorMessage);
+    int code = json.object().value("code").toInt();
+    clearRateLimitHint();
+    qCDebug(lcSearch) << "Bilibili search response code:" << code << "results:" << totalResults;
+
+    if (code != 0 && !federatedSearch) {
+        searchButton->setEnabled(true);
+        searchButton->setToolTip("搜索");
+        if (!incrementalSearch) {
+            QMessageBox::warning(this, "搜索失败", errorMessage.isEmpty() ? "Bilibili搜索失败" : errorMessage);
         }
+        return;
     }
 
-    // 更新分页控件状态
-    int totalPages = (totalSongCount > 0) ? (totalSongCount + 14) / 15 : 0;
-    pageLabel->setText(QString("第 %1 / %2 页").arg(totalPages > 0 ? currentPage : 0).arg(totalPages));
-    prevPageButton->setEnabled(currentPage > 1);
-    nextPageButton->setEnabled(currentPage < totalPages);
+    if (code == 0 && currentPage == 1) {
+        searchCache.insert(SearchSource::Bilibili, currentSearchKeywords, songs, totalResults);
+    }
+    showSourceResults(SearchSource::Bilibili, songs, totalResults, false);
 }
 
-void Widget::onBilibiliSearchFinished(const QJsonDocument &json)
+void Widget::clearRateLimitHint()
 {
-    searchButton->setEnabled(true);
-    searchButton->setToolTip("搜索");
+    if (!rateLimitHintShown) return;
+    rateLimitHintShown = false;
+    // 搜索仍在进行（例如聚合搜索的另一来源）时保留“搜索中”
+    searchButton->setToolTip(searchButton->isEnabled() ? "搜索" : "搜索中...");
+}
+
+void Widget::showResultSongs(const QVector<Song> &songs)
+{
+    // 只刷新结果列表；播放列表在用户双击播放时才替换（见 playResultAt），边输入边搜索不影响正在播放的队列
+    searchResultSongs = songs;
     resultList->clear();
-    searchResultSongs.clear();
+    for (int i = 0; i < searchResultSongs.size(); ++i) {
+        const Song &song = searchResultSongs[i];
+        QListWidgetItem *item;
+        if (song.source == SearchSource::Bilibili) {
+            item = new QListWidgetItem(QString("[B站] %1 - %2").arg(song.name, song.artist));
+            item->setData(Qt::UserRole, song.bvid); // 使用bvid作为ID
+            item->setToolTip(songToolTip(song));
+        } else if (song.source == SearchSource::Local) {
+            QString text = song.artist.isEmpty() ? song.name : QString("%1 - %2").arg(song.name, song.artist);
+            item = new QListWidgetItem("[本地] " + text);
+            item->setData(Qt::UserRole, song.filePath);
+            item->setToolTip(songToolTip(song) + "\n" + song.filePath);
+        } else {
+            item = new QListWidgetItem(QString("%1 - %2").arg(song.name, song.artist));
+            item->setData(Qt::UserRole, song.id);
+            item->setToolTip(songToolTip(song));
+        }
+        resultList->addItem(item);
+    }
+}
 
-    QJsonObject rootObj = json.object();
-    int totalResults = 0;
+void Widget::playResultAt(int index)
+{
+    // 结果列表成为新的播放列表，并保存到会话
+    playlistManager->addSongs(searchResultSongs);
+    playlistManager->setCurrentIndex(index);
+    sessionStore->setQueue(searchResultSongs, playlistManager->getCurrentIndex());
+}
 
-    qDebug() << "Bilibili search response code:" << rootObj.value("code").toInt();
-    qDebug() << "Bilibili search response message:" << rootObj.value("message").toString();
+void Widget::showSourceResults(SearchSource source, const QVector<Song> &songs, int total, bool provisional)
+{
+    // 网易云每页15首，Bilibili每页20个
+    const int pageSize = (source == SearchSource::Bilibili) ? 20 : 15;
+    const int totalPages = (total > 0) ? (total + pageSize - 1) / pageSize : 0;
 
-    if (rootObj.value("code").toInt() != 0) {
-        QString message = rootObj.value("message").toString();
-        QMessageBox::warning(this, "搜索失败", message.isEmpty() ? "Bilibili搜索失败" : message);
+    // 搜索结果不含封面，批量预取详情，双击播放时即可直接下载封面
+    if (source == SearchSource::NetEase && !provisional) {
+        QList<qint64> missingDetailIds;
+        for (const Song &song : songs) {
+            if (song.picUrl.isEmpty()) missingDetailIds.append(song.id);
+        }
+        apiManager->getSongDetails(missingDetailIds);
+    }
+
+    if (federatedSearch) {
+        mergeFederatedResults(source, songs, totalPages, provisional);
         return;
     }
 
-    QJsonObject data = rootObj.value("data").toObject();
-    totalResults = data.value("numResults").toInt();
-    qDebug() << "Bilibili search total results:" << totalResults;
+    searchButton->setEnabled(true);
+    searchButton->setToolTip(provisional ? "搜索中..." : "搜索");
+
+    // 边输入边搜索时不弹窗打断输入
+    if (!provisional && !incrementalSearch && songs.isEmpty() && currentPage == 1) {
+        QMessageBox::information(this, "无结果", source == SearchSource::Bilibili ? "未找到相关视频。" : "未找到相关歌曲。");
+    }
+
+    showResultSongs(songs);
 
-    // Bilibili搜索API的响应结构: data.result.video 包含视频列表
-    QJsonObject resultObj = data.value("result").toObject();
-    QJsonArray videosArray = resultObj.value("video").toArray();
-    qDebug() << "Bilibili search videos count:" << videosArray.size();
+    // 更新分页控件状态
+    pageLabel->setText(QString("第 %1 / %2 页").arg(totalPages > 0 ? currentPage : 0).arg(totalPages));
+    prevPageButton->setEnabled(!provisional && currentPage > 1);
+    nextPageButton->setEnabled(!provisional && currentPage < totalPages);
+    reportSearchLatency(provisional ? "cache-prefix" : "network", !provisional);
+}
+
+void Widget::mergeFederatedResults(SearchSource source, const QVector<Song> &songs, int totalPages, bool provisional)
+{
+    searchMerger.addResults(source, songs, provisional);
+    federatedTotalPages = qMax(federatedTotalPages, totalPages);
 
-    if (videosArray.isEmpty() && currentPage == 1) {
-        QMessageBox::information(this, "无结果", "未找到相关视频。");
+    // 第一个来源返回即可展示
+    searchButton->setEnabled(true);
+    searchButton->setToolTip("搜索");
+    showResultSongs(searchMerger.results());
+
+    const bool allAnswered = searchMerger.hasAnswered(SearchSource::NetEase)
+                          && searchMerger.hasAnswered(SearchSource::Bilibili);
+    if (allAnswered && !incrementalSearch && searchResultSongs.isEmpty() && currentPage == 1) {
+        QMessageBox::information(this, "无结果", "未找到相关歌曲。");
     }
 
-    for (const QJsonValue &value : videosArray) {
-        QJsonObject videoObj = value.toObject();
+    pageLabel->setText(QString("第 %1 / %2 页").arg(federatedTotalPages > 0 ? currentPage : 0).arg(federatedTotalPages));
+    prevPageButton->setEnabled(currentPage > 1);
+    nextPageButton->setEnabled(currentPage < federatedTotalPages);
+    reportSearchLatency(provisional ? "cache-prefix" : "network", allAnswered);
+}
 
-        QString bvid = videoObj["bvid"].toString();
-        QString title = videoObj["title"].toString();
-        // 去除HTML标签
-        title.remove(QRegularExpression("<[^>]*>"));
-        QString author = videoObj["author"].toString();
-        QString pic = videoObj["pic"].toString();
-        if (!pic.startsWith("http")) {
-            pic = "https:" + pic;
+void Widget::onSearchFailed(SearchSource source, const QString &errorString)
+{
+    if (!federatedSearch) {
+        if (incrementalSearch) {
+            // 边输入边搜索的失败不弹窗，保留当前结果
+            qCDebug(lcSearch) << "Incremental search failed:" << errorString;
+            searchButton->setEnabled(true);
+            searchButton->setToolTip("搜索");
+        } else {
+            onApiError(errorString);
         }
-        int duration = videoObj["duration"].toString().split(":").first().toInt() * 60 +
-                       videoObj["duration"].toString().split(":").last().toInt();
+        return;
+    }
 
-        QListWidgetItem *item = new QListWidgetItem(QString("[B站] %1 - %2").arg(title, author));
-        item->setData(Qt::UserRole, bvid); // 使用bvid作为ID
-        resultList->addItem(item);
+    // 聚合搜索中单个来源失败时只记录，另一来源的结果照常展示
+    qCWarning(lcSearch) << "Federated search source failed:" << static_cast<int>(source) << errorString;
+    if (searchMerger.hasAnswered(source)) return;
+    const SearchSource other = (source == SearchSource::NetEase) ? SearchSource::Bilibili : SearchSource::NetEase;
+    if (searchMerger.hasAnswered(other) && searchResultSongs.isEmpty()) {
+        searchMerger.addResults(source, {});
+        if (!incrementalSearch) onApiError(errorString);
+        return;
+    }
+    mergeFederatedResults(source, {}, 0);
+}
 
-        Song song;
-        song.bvid = bvid;
-        song.name = title;
-        song.artist = author;
-        song.picUrl = pic;
-        song.duration = duration;
-        song.source = SearchSource::Bilibili;
-        searchResultSongs.append(song);
+void Widget::reportSearchLatency(const QString &origin, bool final)
+{
+    if (!keystrokeTimer.isValid()) return;
+
+    const qint64 latencyMs = keystrokeTimer.elapsed();
+    if (!final) {
+        // 临时结果只记录首次出现的时间，继续等待最终结果
+        qCDebug(lcSearch) << "Search first results:" << latencyMs << "ms via" << origin;
+        return;
     }
+    keystrokeTimer.invalidate();
 
-    playlistManager->addSongs(searchResultSongs);
+    searchLatencySamples.append(latencyMs);
+    if (searchLatencySamples.size() > kMaxLatencySamples) {
+        searchLatencySamples.removeFirst();
+    }
+    QVector<qint64> sorted = searchLatencySamples;
+    std::sort(sorted.begin(), sorted.end());
+    const qint64 median = sorted.at(sorted.size() / 2);
+    const qint64 p95 = sorted.at(qMin<int>(sorted.size() - 1, sorted.size() * 95 / 100));
 
-    // 更新分页控件状态 (Bilibili每页20个结果)
-    int totalPages = (totalResults > 0) ? (totalResults + 19) / 20 : 0;
-    pageLabel->setText(QString("第 %1 / %2 页").arg(totalPages > 0 ? currentPage : 0).arg(totalPages));
-    prevPageButton->setEnabled(currentPage > 1);
-    nextPageButton->setEnabled(currentPage < totalPages);
+    qCDebug(lcSearch) << "Search latency:" << latencyMs << "ms via" << origin
+             << "median" << median << "ms p95" << p95 << "ms over" << sorted.size() << "searches";
+    searchInput->setToolTip(QString("输入到结果: %1 ms（%2）\n中位数 %3 ms，P95 %4 ms")
+                                .arg(latencyMs).arg(origin).arg(median).arg(p95));
 }
 
 void Widget::onVolumeButtonClicked()
@@ -891,12 +1339,15 @@ void Widget::onVolumeButtonClicked()
 
 void Widget::onMinimizeButtonClicked()
 {
+    ensureFloatingIsland();
+    ensureTrayIcon();
+
     // 更新悬浮窗信息
     Song currentSong = playlistManager->getCurrentSong();
     if (!currentSong.name.isEmpty()) {
         floatingIsland->setSongInfo(currentSong.name, currentSong.artist, originalAlbumArt);
     }
-    floatingIsland->setPlaying(mediaPlayer->playbackState() == QMediaPlayer::PlayingState);
+    floatingIsland->setPlaying(audioEngine->playbackState() == QMediaPlayer::PlayingState);
 
     // 定位到屏幕顶部中央
     QScreen *screen = QGuiApplication::primaryScreen();
@@ -916,7 +1367,7 @@ void Widget::onFloatingExpandClicked()
     floatingIsland->hide();
     this->showNormal();
     this->activateWindow();
-    trayIcon->hide();
+    if (trayIcon) trayIcon->hide();
 }
 
 void Widget::onLyricFinished(const QJsonDocument &json)
@@ -925,25 +1376,47 @@ void Widget::onLyricFinished(const QJsonDocument &json)
     QJsonObject rootObj = json.object();
     if (rootObj.contains("lrc")) {
         QString lyricText = rootObj["lrc"].toObject()["lyric"].toString();
-        parseLyrics(lyricText);
+        lyricData = LyricParser::parse(lyricText);
     }
 }
 
 void Widget::onSongDetailFinished(const QJsonDocument &json)
 {
-    QJsonObject rootObj = json.object();
-    if (rootObj.contains("songs")) {
-        QJsonArray songsArray = rootObj["songs"].toArray();
-        if (!songsArray.isEmpty()) {
-            QJsonObject songObj = songsArray[0].toObject();
-            if (songObj.contains("album")) {
-                QString imageUrl = songObj["album"].toObject()["picUrl"].toString() + "?param=800y800";
-                apiManager->downloadImage(QUrl(imageUrl));
+    QVector<Song> details = SongParser::parseSongDetails(json);
+    if (details.isEmpty()) return;
+
+    playlistManager->updateSongDetails(details);
+    if (federatedSearch) {
+        searchMerger.updateSongDetails(details);
+    }
+
+    for (const Song &detail : details) {
+        // 补全搜索结果并刷新列表提示
+        for (int i = 0; i < searchResultSongs.size(); ++i) {
+            Song &song = searchResultSongs[i];
+            if (song.source != SearchSource::NetEase || song.id != detail.id) continue;
+            if (!detail.album.isEmpty()) song.album = detail.album;
+            if (!detail.picUrl.isEmpty()) song.picUrl = detail.picUrl;
+            if (detail.duration > 0) song.duration = detail.duration;
+            if (QListWidgetItem *item = resultList->item(i)) {
+                item->setToolTip(songToolTip(song));
             }
         }
+
+        // 当前播放歌曲的封面此前未知，现在下载
+        if (detail.id == currentPlayingSongId) {
+            requestCover(detail);
+        }
     }
 }
 
+void Widget::requestCover(const Song &song)
+{
+    if (song.picUrl.isEmpty() || coverRequestedSongId == song.id) return;
+    coverRequestedSongId = song.id;
+    apiManager->downloadImage(QUrl(song.picUrl + "?param=800y800"));
+}
+
 void Widget::onImageDownloaded(const QByteArray &data)
 {
     QPixmap pixmap;
@@ -954,18 +1427,31 @@ void Widget::onImageDownloaded(const QByteArray &data)
 
         // 更新悬浮窗封面
         Song currentSong = playlistManager->getCurrentSong();
-        floatingIsland->setSongInfo(currentSong.name, currentSong.artist, originalAlbumArt);
+        if (floatingIsland) floatingIsland->setSongInfo(currentSong.name, currentSong.artist, originalAlbumArt);
 
         // 使用调色板提取和模糊背景（苹果音乐风格）
-        QVector<QColor> palette = extractPaletteColors(pixmap, 3);
+        QVector<QColor> palette = CoverPalette::extractColors(pixmap.toImage(), 3);
         updateBackgroundWithPalette(palette);
     }
 }
 
 void Widget::onSongUrlReady(const QUrl &url)
 {
-    mediaPlayer->setSource(url);
-    mediaPlayer->play();
+    audioEngine->setSource(url);
+    restoredCachedUrl = false;
+    if (currentPlayingSongId != -1) {
+        sessionStore->setResolvedUrl(url);
+        analysisKeys.insert(url, currentAnalysisKey);
+        // 不为分析再下载一遍：波形由能测量的引擎在首次完整播放时生成，或在音频缓存完成后分析缓存文件
+        showWaveform(url);
+    }
+
+    // 恢复会话时只准备好音源，等待用户点击播放
+    if (restoringSession && !resumeOnRestore) {
+        return;
+    }
+    restoringSession = false;
+    audioEngine->play();
 
     // 启动看门狗定时器
     playbackWatchdog->start();
@@ -973,9 +1459,10 @@ void Widget::onSongUrlReady(const QUrl &url)
 
 void Widget::onBilibiliVideoInfoFinished(const QJsonDocument &json)
 {
+    clearRateLimitHint();
     QJsonObject rootObj = json.object();
     if (rootObj.value("code").toInt() != 0) {
-        qDebug() << "获取Bilibili视频信息失败:" << rootObj.value("message").toString();
+        qCWarning(lcBilibili) << "获取Bilibili视频信息失败:" << rootObj.value("message").toString();
         return;
     }
 
@@ -1003,16 +1490,24 @@ void Widget::onBilibiliVideoInfoFinished(const QJsonDocument &json)
             apiManager->downloadBilibiliImage(QUrl(pic));
         }
 
-        // 获取音频URL
-        apiManager->getBilibiliAudioUrl(bvid, cid);
+        applyTrimPoints(TrackAnalysisService::trimKeyFor(bvid, cid));
+
+        // 已离线下载的直接播放本地文件，否则获取音频URL
+        const QString cachedFile = audioCache->filePath(AudioCache::keyFor(currentSong));
+        if (!cachedFile.isEmpty()) {
+            playCachedAudio(cachedFile);
+        } else {
+            apiManager->getBilibiliAudioUrl(bvid, cid);
+        }
     }
 }
 
 void Widget::onBilibiliAudioUrlReady(const QUrl &url)
 {
+    clearRateLimitHint();
     // 方案1：先尝试直接播放
-    mediaPlayer->setSource(url);
-    mediaPlayer->play();
+    audioEngine->setSource(url);
+    audioEngine->play();
 
     // 保存URL，如果播放失败会用到
     currentBilibiliAudioUrl = url;
@@ -1020,53 +1515,84 @@ void Widget::onBilibiliAudioUrlReady(const QUrl &url)
     // 启动看门狗定时器
     playbackWatchdog->start();
 
-    // 注意：加载动画在onMediaPlayerError或onBilibiliAudioFileReady中隐藏
+    // 注意：加载动画在onMediaPlayerError或onBilibiliAudioStreamReady中隐藏
     // 因为直接播放可能失败（403错误）
 }
 
-void Widget::onBilibiliAudioDataReady(const QByteArray &data)
+void Widget::onBilibiliAudioStreamReady(ChunkedAudioBuffer *buffer)
 {
-    // 清理之前的音频缓冲区（如果有）
+    buffer->setParent(this); // 退出时随窗口释放，溢出文件一并删除
+
+    // 高音质版本：等下载完成再切换，避免恢复的播放位置落在未缓冲的范围内
+    if (upgradingBilibiliQuality) {
+        upgradeAudioBuffer = buffer;
+        return;
+    }
+
+    // 隐藏加载动画，显示播放按钮
+    loadingSpinner->stop();
+    playPauseButton->show();
+
     if (currentAudioBuffer) {
-        currentAudioBuffer->close();
         currentAudioBuffer->deleteLater();
-        currentAudioBuffer = nullptr;
     }
+    currentAudioBuffer = buffer;
+    connect(buffer, &ChunkedAudioBuffer::bufferedBytesChanged, this, [this, buffer](qint64 buffered, qint64 total) {
+        if (buffer == currentAudioBuffer) updateBufferedRange(buffered, total);
+    });
+    updateBufferedRange(buffer->bufferedBytes(), buffer->expectedSize());
+
+    // 预缓冲完成即开始播放，其余部分边下边播
+    analysisKeys.insert(QUrl(), currentAnalysisKey);
+    audioEngine->setSourceDevice(buffer);
+    audioEngine->play();
+
+    // 启动看门狗定时器
+    playbackWatchdog->start();
 
-    // 使用 QBuffer 播放下载的音频数据
-    currentAudioBuffer = new QBuffer();
-    currentAudioBuffer->setData(data);
-    currentAudioBuffer->open(QIODevice::ReadOnly);
+    // 预缓冲测得的带宽若足以支撑更高音质，则立即后台下载，完成后切换
+    QUrl betterUrl = apiManager->bilibiliAudioUpgradeUrl();
+    if (!betterUrl.isEmpty()) {
+        upgradingBilibiliQuality = true;
+        apiManager->downloadBilibiliAudioUpgrade(betterUrl);
+    }
+}
 
-    // 设置媒体源为缓冲区
-    mediaPlayer->setSourceDevice(currentAudioBuffer);
-    mediaPlayer->play();
+void Widget::onBilibiliAudioStreamFinished(ChunkedAudioBuffer *buffer)
+{
+    // 高音质版本下载完成：从当前位置无缝切换
+    if (buffer == upgradeAudioBuffer) {
+        upgradeAudioBuffer = nullptr;
+        upgradingBilibiliQuality = false;
+        ChunkedAudioBuffer *previousBuffer = currentAudioBuffer;
+        bool wasPlaying = audioEngine->playbackState() == QMediaPlayer::PlayingState;
+        pendingSeekPosition = audioEngine->position();
+        currentAudioBuffer = buffer;
+        updateBufferedRange(buffer->bufferedBytes(), buffer->expectedSize());
+        audioEngine->setSourceDevice(buffer);
+        if (wasPlaying) {
+            audioEngine->play();
+        }
+        if (previousBuffer) {
+            previousBuffer->deleteLater(); // 原音质可能还在下载，一并停止
+        }
+        analyzeDownloadedAudio(buffer);
+        return;
+    }
+    if (buffer != currentAudioBuffer) return;
 
-    // 启动看门狗定时器
-    playbackWatchdog->start();
+    analyzeDownloadedAudio(buffer);
 }
 
-void Widget::onBilibiliAudioFileReady(const QString &filePath)
+void Widget::onBilibiliAudioUpgradeFailed(const QString &errorString)
 {
-    // 隐藏加载动画，显示播放按钮
-    loadingSpinner->stop();
-    playPauseButton->show();
-
-    // 清理之前的临时文件（如果有）
-    if (!currentTempAudioFile.isEmpty() && QFile::exists(currentTempAudioFile)) {
-        QFile::remove(currentTempAudioFile);
-        qDebug() << "Removed previous temporary audio file:" << currentTempAudioFile;
+    // 当前音质的下载不受影响，继续播放即可，不打扰用户
+    qCWarning(lcNetwork) << "Audio quality upgrade failed:" << errorString;
+    upgradingBilibiliQuality = false;
+    if (upgradeAudioBuffer) {
+        upgradeAudioBuffer->deleteLater();
+        upgradeAudioBuffer = nullptr;
     }
-
-    // 保存当前临时文件路径
-    currentTempAudioFile = filePath;
-
-    // 使用临时文件播放
-    mediaPlayer->setSource(QUrl::fromLocalFile(filePath));
-    mediaPlayer->play();
-
-    // 启动看门狗定时器
-    playbackWatchdog->start();
 }
 
 void Widget::onBilibiliImageDownloaded(const QByteArray &data)
@@ -1079,10 +1605,10 @@ void Widget::onBilibiliImageDownloaded(const QByteArray &data)
 
         // 更新悬浮窗封面
         Song currentSong = playlistManager->getCurrentSong();
-        floatingIsland->setSongInfo(currentSong.name, currentSong.artist, originalAlbumArt);
+        if (floatingIsland) floatingIsland->setSongInfo(currentSong.name, currentSong.artist, originalAlbumArt);
 
         // 使用调色板提取和模糊背景（苹果音乐风格）
-        QVector<QColor> palette = extractPaletteColors(pixmap, 3);
+        QVector<QColor> palette = CoverPalette::extractColors(pixmap.toImage(), 3);
         updateBackgroundWithPalette(palette);
     }
 }
@@ -1091,10 +1617,12 @@ void Widget::onApiError(const QString &errorString)
 {
     // 检查错误是否与获取歌曲URL有关
     if (errorString.contains("mp3") && currentPlayingSongId != -1) {
-        qDebug() << "API URL failed, trying fallback direct link for song ID:" << currentPlayingSongId;
-        QString fallbackUrl = QString("https://music.163.com/song/media/outer/url?id=%1.mp3").arg(currentPlayingSongId);
-        mediaPlayer->setSource(QUrl(fallbackUrl));
-        mediaPlayer->play();
+        qCWarning(lcPlayback) << "API URL failed, trying fallback direct link for song ID:" << currentPlayingSongId;
+        const ApiEndpoints &endpoints = apiManager->apiEndpoints();
+        QUrl fallbackUrl = endpoints.url(endpoints.netease, "/song/media/outer/url");
+        fallbackUrl.setQuery(QString("id=%1.mp3").arg(currentPlayingSongId));
+        audioEngine->setSource(fallbackUrl);
+        audioEngine->play();
         return; // 尝试备用链接，不显示错误弹窗
     }
 
@@ -1105,12 +1633,23 @@ void Widget::onApiError(const QString &errorString)
 
 void Widget::onMediaPlayerError(QMediaPlayer::Error error, const QString &errorString)
 {
+    // 会话中保存的地址已失效：重新解析后从原位置继续
+    if (restoredCachedUrl && currentPlayingSongId != -1) {
+        qCInfo(lcPlayback) << "Restored song URL expired, resolving again:" << errorString;
+        restoredCachedUrl = false;
+        if (pendingSeekPosition < 0) pendingSeekPosition = audioEngine->position();
+        resumeOnRestore = resumeOnRestore || audioEngine->playbackState() == QMediaPlayer::PlayingState;
+        restoringSession = true;
+        apiManager->getSongUrl(currentPlayingSongId);
+        return;
+    }
+
     // 检查是否是访问被拒绝错误（403）
     if (error == QMediaPlayer::ResourceError && !currentBilibiliAudioUrl.isEmpty()) {
-        qDebug() << "Direct playback failed (likely 403), switching to download mode for:" << currentBilibiliAudioUrl.toString();
+        qCInfo(lcPlayback) << "Direct playback failed (likely 403), switching to download mode for:" << currentBilibiliAudioUrl.toString();
 
         // 停止当前播放
-        mediaPlayer->stop();
+        audioEngine->stop();
 
         // 使用备用方案：下载音频文件
         apiManager->downloadBilibiliAudio(currentBilibiliAudioUrl);
@@ -1121,7 +1660,7 @@ void Widget::onMediaPlayerError(QMediaPlayer::Error error, const QString &errorS
         // 其他错误，显示错误信息并隐藏加载动画
         loadingSpinner->stop();
         playPauseButton->show();
-        qDebug() << "Media player error:" << error << errorString;
+        qCWarning(lcPlayback) << "Media player error:" << error << errorString;
     }
 }
 
@@ -1137,37 +1676,48 @@ void Widget::onResultItemDoubleClicked(QListWidgetItem *item)
 
     // 检查点击的歌曲是否就是当前正在播放的歌曲
     bool isSameSong = (clickedSong.source == SearchSource::NetEase && clickedSong.id == currentPlayingSongId) ||
-                      (clickedSong.source == SearchSource::Bilibili && clickedSong.bvid == currentBvid);
+                      (clickedSong.source == SearchSource::Bilibili && clickedSong.bvid == currentBvid) ||
+                      (clickedSong.source == SearchSource::Local && clickedSong.filePath == currentLocalFile);
 
-    if (isSameSong && mediaPlayer->playbackState() != QMediaPlayer::StoppedState) {
-        // 如果是，并且播放器不是停止状态，则只切换回播放界面
+    if (isSameSong && audioEngine->playbackState() != QMediaPlayer::StoppedState) {
+        // 如果是，并且播放器不是停止状态，则只切换回播放界面（播放列表换成当前结果）
+        playResultAt(index);
         songNameLabel->setText(clickedSong.name);
         mainStackedWidget->setCurrentWidget(playerPage);
     } else {
         // 否则，按正常流程播放新歌曲
-        playlistManager->setCurrentIndex(index);
+        playResultAt(index);
 
-        Song currentSong = playlistManager->getCurrentSong();
-        if (currentSong.source == SearchSource::Bilibili) {
-            playBilibiliVideo(currentSong.bvid);
-        } else if (currentSong.id != -1) {
-            playSong(currentSong.id);
-        }
+        playQueuedSong(playlistManager->getCurrentSong());
     }
 }
 
 void Widget::onPlayPauseButtonClicked()
 {
-    if (mediaPlayer->playbackState() == QMediaPlayer::PlayingState) {
-        mediaPlayer->pause();
+    if (audioEngine->playbackState() == QMediaPlayer::PlayingState) {
+        audioEngine->pause();
+    } else if (audioEngine->source().isEmpty() && restoringSession) {
+        // 恢复的歌曲尚无音源：网易云地址正在解析则解析完成后播放，否则重新加载
+        if (currentPlayingSongId != -1) {
+            resumeOnRestore = true;
+            return;
+        }
+        const qint64 position = pendingSeekPosition;
+        playQueuedSong(playlistManager->getCurrentSong());
+        pendingSeekPosition = position;
     } else {
-        mediaPlayer->play();
+        restoringSession = false;
+        audioEngine->play();
     }
 }
 
 void Widget::updatePosition(qint64 position)
 {
-    progressSlider->setValue(position);
+    if (!progressSlider->isSliderDown()) progressSlider->setValue(position);
+    // 恢复的位置尚未应用时不记录加载过程中的 0
+    if (pendingSeekPosition < 0) {
+        sessionStore->setPosition(position, audioEngine->playbackState() == QMediaPlayer::PlayingState);
+    }
     
     // 更新时间显示
     qint64 totalSeconds = position / 1000;
@@ -1186,6 +1736,17 @@ void Widget::updatePosition(qint64 position)
             lyricLabel->setText(it.value());
         }
     }
+
+    // 结尾是长段静音：不等播放器读完，直接切到下一首
+    if (trimEndMs > 0 && position >= trimEndMs && audioEngine->playbackState() == QMediaPlayer::PlayingState) {
+        qCDebug(lcPlayback) << "Skipping trailing silence at" << position << "ms";
+        Metrics::increment("silence_skips_total", { { "edge", "trailing" } });
+        trimEndMs = 0;
+        finishCurrentTrack();
+        return;
+    }
+
+    queueGaplessNext(position);
 }
 
 void Widget::updateDuration(qint64 duration)
@@ -1199,6 +1760,11 @@ void Widget::updateState(QMediaPlayer::PlaybackState state)
     if (state == QMediaPlayer::PlayingState) {
         playPauseButton->setIcon(QIcon(":/icons/pause.png"));
 
+        if (firstAudioTimer.isValid()) {
+            Metrics::observe("time_to_first_audio_ms", firstAudioTimer.elapsed(), { { "source", firstAudioSource } });
+            firstAudioTimer.invalidate();
+        }
+
         if (loadingSpinner->isVisible()) {
             loadingSpinner->stop();
             playPauseButton->show();
@@ -1216,12 +1782,17 @@ void Widget::updateState(QMediaPlayer::PlaybackState state)
     }
 
     // 更新悬浮窗状态
-    floatingIsland->setPlaying(state == QMediaPlayer::PlayingState);
+    if (floatingIsland) floatingIsland->setPlaying(state == QMediaPlayer::PlayingState);
+    updateBackgroundActivity();
+
+    if (pendingSeekPosition < 0) {
+        sessionStore->setPosition(audioEngine->position(), state == QMediaPlayer::PlayingState);
+    }
 }
 
 void Widget::setPosition(int position)
 {
-    mediaPlayer->setPosition(position);
+    audioEngine->setPosition(position);
 }
 
 // --- 新增的私有和槽函数实现 ---
@@ -1229,29 +1800,36 @@ void Widget::setPosition(int position)
 void Widget::cleanupPreviousPlayback()
 {
     // 停止播放器
-    if (mediaPlayer->playbackState() != QMediaPlayer::StoppedState) {
-        mediaPlayer->stop();
+    if (audioEngine->playbackState() != QMediaPlayer::StoppedState) {
+        audioEngine->stop();
     }
 
     // 清理音频缓冲区
+    // 释放缓冲区会同时停止它的下载，溢出到磁盘的临时文件随之删除
     if (currentAudioBuffer) {
-        currentAudioBuffer->close();
         currentAudioBuffer->deleteLater();
         currentAudioBuffer = nullptr;
-        qDebug() << "Cleaned up audio buffer";
+        qCDebug(lcPlayback) << "Cleaned up audio buffer";
     }
-
-    // 清理临时音频文件
-    if (!currentTempAudioFile.isEmpty()) {
-        if (QFile::exists(currentTempAudioFile)) {
-            QFile::remove(currentTempAudioFile);
-            qDebug() << "Removed temporary audio file:" << currentTempAudioFile;
-        }
-        currentTempAudioFile.clear();
+    progressSlider->setBufferedRanges({});
+    if (upgradeAudioBuffer) {
+        upgradeAudioBuffer->deleteLater();
+        upgradeAudioBuffer = nullptr;
     }
 
-    // 重置播放器源
-    mediaPlayer->setSource(QUrl());
+    // 取消上一首仍在进行的音频下载（包括音质升级）
+    apiManager->abortBilibiliAudioDownloads();
+    upgradingBilibiliQuality = false;
+    pendingSeekPosition = -1;
+
+    // 重置播放器源（同时丢弃已排队的无缝衔接曲目）
+    audioEngine->setSource(QUrl());
+    gaplessQueued = false;
+    analysisKeys.clear();
+    currentTrimKey.clear();
+    trimEndMs = 0;
+
+    stallTimer.invalidate();
 
     // 重置看门狗计数器
     stuckCount = 0;
@@ -1261,25 +1839,26 @@ void Widget::cleanupPreviousPlayback()
 void Widget::checkPlaybackHealth()
 {
     // 只在播放状态时检查
-    if (mediaPlayer->playbackState() != QMediaPlayer::PlayingState) {
+    if (audioEngine->playbackState() != QMediaPlayer::PlayingState) {
         return;
     }
 
-    qint64 currentPosition = mediaPlayer->position();
+    qint64 currentPosition = audioEngine->position();
 
     // 如果位置没有变化，可能是卡住了
     if (currentPosition == lastPosition) {
         stuckCount++;
-        qDebug() << "Playback might be stuck, count:" << stuckCount;
+        qCDebug(lcPlayback) << "Playback might be stuck, count:" << stuckCount;
 
         // 连续3次（15秒）位置不变，认为卡住了
         if (stuckCount >= 3) {
-            qDebug() << "Playback stuck detected, attempting recovery...";
+            qCWarning(lcPlayback) << "Playback stuck detected, attempting recovery...";
+            Metrics::increment("playback_stalls_total", { { "reason", "watchdog" } });
 
             // 尝试恢复：暂停后继续播放
-            mediaPlayer->pause();
+            audioEngine->pause();
             QTimer::singleShot(100, [this]() {
-                mediaPlayer->play();
+                audioEngine->play();
             });
 
             stuckCount = 0;
@@ -1299,15 +1878,34 @@ void Widget::playSong(qint64 id)
     // 清理之前的播放资源
     cleanupPreviousPlayback();
 
+    startFirstAudioTimer("netease");
+
+    // 已离线下载的歌曲直接播放本地文件，否则请求播放链接
+    Song song = playlistManager->getCurrentSong();
+    const QString cachedFile = song.id == id ? audioCache->filePath(AudioCache::keyFor(song)) : QString();
+    showNetEaseSong(id);
+    if (!cachedFile.isEmpty()) {
+        playCachedAudio(cachedFile);
+    } else {
+        apiManager->getSongUrl(id);
+    }
+
+    // 切换到播放详情页
+    mainStackedWidget->setCurrentWidget(playerPage);
+}
+
+void Widget::showNetEaseSong(qint64 id)
+{
     currentPlayingSongId = id; // 更新当前播放的歌曲ID
     currentBvid.clear(); // 清除Bilibili BV号
+    currentLocalFile.clear();
 
     // 从播放列表获取当前歌曲信息
     Song currentSong = playlistManager->getCurrentSong();
     if (currentSong.id == id) {
         songNameLabel->setText(currentSong.name);
         // 更新悬浮窗信息
-        floatingIsland->setSongInfo(currentSong.name, currentSong.artist, QPixmap());
+        if (floatingIsland) floatingIsland->setSongInfo(currentSong.name, currentSong.artist, QPixmap());
     } else {
         songNameLabel->setText("加载中...");
     }
@@ -1316,20 +1914,27 @@ void Widget::playSong(qint64 id)
     // 重置UI
     originalAlbumArt = QPixmap();
     albumArtLabel->setPixmap(QPixmap());
-    flowAnimation->stop(); // 停止流动动画
+    if (flowAnimation) flowAnimation->stop(); // 停止流动动画
     currentPalette.clear();
     lyricLabel->setText("歌词加载中...");
     setWidgetStyle(QColor(51, 51, 51));
 
-    // 请求播放链接
-    apiManager->getSongUrl(id);
-
-    // 获取歌词和详情
+    // 获取歌词；封面已由批量详情预取时直接下载，否则与后续歌曲一起批量请求详情
     apiManager->getLyric(id);
-    apiManager->getSongDetail(id);
+    coverRequestedSongId = -1;
+    if (currentSong.id == id && !currentSong.picUrl.isEmpty()) {
+        requestCover(currentSong);
+    } else {
+        apiManager->getSongDetail(id);
+    }
 
-    // 切换到播放详情页
-    mainStackedWidget->setCurrentWidget(playerPage);
+    QList<qint64> upcomingIds;
+    for (const Song &song : playlistManager->upcomingSongs(5)) {
+        if (song.source == SearchSource::NetEase && song.picUrl.isEmpty()) {
+            upcomingIds.append(song.id);
+        }
+    }
+    apiManager->getSongDetails(upcomingIds);
 }
 
 void Widget::playBilibiliVideo(const QString &bvid)
@@ -1339,15 +1944,17 @@ void Widget::playBilibiliVideo(const QString &bvid)
     // 清理之前的播放资源
     cleanupPreviousPlayback();
 
+    startFirstAudioTimer("bilibili");
     currentBvid = bvid; // 更新当前播放的BV号
     currentPlayingSongId = -1; // 清除网易云音乐ID
+    currentLocalFile.clear();
 
     // 从播放列表获取当前歌曲信息
     Song currentSong = playlistManager->getCurrentSong();
     if (currentSong.bvid == bvid) {
         songNameLabel->setText(currentSong.name);
         // 更新悬浮窗信息
-        floatingIsland->setSongInfo(currentSong.name, currentSong.artist, QPixmap());
+        if (floatingIsland) floatingIsland->setSongInfo(currentSong.name, currentSong.artist, QPixmap());
     } else {
         songNameLabel->setText("加载中...");
     }
@@ -1355,7 +1962,7 @@ void Widget::playBilibiliVideo(const QString &bvid)
     // 重置UI
     originalAlbumArt = QPixmap();
     albumArtLabel->setPixmap(QPixmap());
-    flowAnimation->stop(); // 停止流动动画
+    if (flowAnimation) flowAnimation->stop(); // 停止流动动画
     currentPalette.clear();
     lyricLabel->setText("Bilibili视频 - 无歌词");
     setWidgetStyle(QColor(51, 51, 51));
@@ -1374,35 +1981,439 @@ void Widget::playBilibiliVideo(const QString &bvid)
 
 void Widget::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
 {
+    // 切换音源后恢复播放位置
+    if (pendingSeekPosition >= 0 &&
+        (status == QMediaPlayer::LoadedMedia || status == QMediaPlayer::BufferedMedia)) {
+        audioEngine->setPosition(pendingSeekPosition);
+        pendingSeekPosition = -1;
+    }
+
+    // 缓冲不足导致的卡顿：记录次数与持续时间
+    if (status == QMediaPlayer::StalledMedia) {
+        Metrics::increment("playback_stalls_total", { { "reason", "buffering" } });
+        stallTimer.start();
+    } else if (stallTimer.isValid() && status == QMediaPlayer::BufferedMedia) {
+        Metrics::observe("playback_stall_ms", stallTimer.elapsed());
+        stallTimer.invalidate();
+    }
+
     // 当歌曲播放结束时，自动播放下一首
     if (status == QMediaPlayer::EndOfMedia) {
-        currentPlayingSongId = -1; // 播放结束，重置ID
-        currentBvid.clear(); // 清除BV号
-        playNextSong();
+        finishCurrentTrack();
     }
 }
 
+void Widget::finishCurrentTrack()
+{
+    currentPlayingSongId = -1; // 播放结束，重置ID
+    currentBvid.clear(); // 清除BV号
+    currentLocalFile.clear();
+    playNextSong();
+}
+
 void Widget::playNextSong()
 {
     if (playlistManager->isEmpty()) return;
-
-    Song nextSong = playlistManager->getNextSong();
-    if (nextSong.source == SearchSource::Bilibili && !nextSong.bvid.isEmpty()) {
-        playBilibiliVideo(nextSong.bvid);
-    } else if (nextSong.id != -1) {
-        playSong(nextSong.id);
-    }
+    playQueuedSong(playlistManager->getNextSong());
 }
 
 void Widget::playPreviousSong()
 {
     if (playlistManager->isEmpty()) return;
+    playQueuedSong(playlistManager->getPreviousSong());
+}
+
+void Widget::playQueuedSong(const Song &song)
+{
+    restoringSession = false;
+    restoredCachedUrl = false;
+    sessionStore->setCurrentIndex(playlistManager->getCurrentIndex());
+    applyNormalization(song);
+    showWaveform(QUrl());
+    if (song.source == SearchSource::Bilibili && !song.bvid.isEmpty()) {
+        playBilibiliVideo(song.bvid);
+    } else if (song.source == SearchSource::Local && !song.filePath.isEmpty()) {
+        playLocalSong(song);
+    } else if (song.id != -1) {
+        playSong(song.id);
+    }
+}
+
+void Widget::playLocalSong(const Song &song)
+{
+    cleanupPreviousPlayback();
+
+    startFirstAudioTimer("local");
+    showLocalSong(song);
+
+    const QUrl url = QUrl::fromLocalFile(song.filePath);
+    analysisKeys.insert(url, currentAnalysisKey);
+    showWaveform(url);
+    audioEngine->setSource(url);
+    audioEngine->play();
+    playbackWatchdog->start();
+
+    mainStackedWidget->setCurrentWidget(playerPage);
+}
+
+void Widget::showLocalSong(const Song &song)
+{
+    currentPlayingSongId = -1;
+    currentBvid.clear();
+    currentLocalFile = song.filePath;
+
+    songNameLabel->setText(song.name);
+    if (floatingIsland) floatingIsland->setSongInfo(song.name, song.artist, QPixmap());
+
+    // 重置UI
+    originalAlbumArt = QPixmap();
+    albumArtLabel->setPixmap(QPixmap());
+    if (flowAnimation) flowAnimation->stop();
+    currentPalette.clear();
+    lyricData.clear();
+    lyricLabel->setText(song.album.isEmpty() ? "本地音乐" : song.album);
+    setWidgetStyle(QColor(51, 51, 51));
+}
+
+void Widget::queueGaplessNext(qint64 position)
+{
+    if (gaplessQueued || !audioEngine->supportsGapless() || currentDuration <= 0) return;
+    // 交叉淡化在结尾前 crossfade 毫秒就开始混音，提前量相应加长
+    if (currentDuration - position > kGaplessPreloadMs + audioEngine->crossfadeDuration()) return;
+
+    // 只有确定的下一首才能提前接上：随机模式要到切歌时才决定
+    Song next;
+    int nextIndex = -1;
+    const PlaylistManager::PlayMode mode = playlistManager->getPlayMode();
+    const int currentIndex = playlistManager->getCurrentIndex();
+    if (mode == PlaylistManager::LoopOne && currentIndex >= 0) {
+        nextIndex = currentIndex;
+    } else if (mode == PlaylistManager::Sequential && !playlistManager->isEmpty()) {
+        nextIndex = (qMax(currentIndex, 0) + 1) % playlistManager->songs().size();
+    }
+    if (nextIndex >= 0) next = playlistManager->songs().at(nextIndex);
+
+    // Bilibili 音频需要带 Referer 下载，不能直接交给解码器，仍在结束后切换
+    QUrl nextUrl;
+    if (next.source == SearchSource::Local && !next.filePath.isEmpty()) {
+        nextUrl = QUrl::fromLocalFile(next.filePath);
+    } else if (next.source == SearchSource::NetEase && next.id > 0) {
+        if (next.id == currentPlayingSongId) {
+            nextUrl = audioEngine->source();
+        } else if (next.id == prefetchedSongId) {
+            nextUrl = prefetchedUrl;
+        } else if (next.id != prefetchRequestedId) {
+            // 播放地址到达后由 onSongUrlPrefetched 再次调用
+            prefetchRequestedId = next.id;
+            apiManager->prefetchSongUrl(next.id);
+        }
+    }
+    if (nextUrl.isEmpty()) return;
+
+    gaplessQueued = true;
+    gaplessSong = next;
+    gaplessIndex = nextIndex;
+    analysisKeys.insert(nextUrl, TrackAnalysisService::keyFor(next));
+    audioEngine->setNextSource(nextUrl);
+}
+
+void Widget::onSongUrlPrefetched(qint64 songId, const QUrl &url)
+{
+    if (songId != prefetchRequestedId) return;
+    prefetchedSongId = songId;
+    prefetchedUrl = url;
+    queueGaplessNext(audioEngine->position());
+}
+
+void Widget::onGaplessTrackStarted(const QUrl &url)
+{
+    if (!gaplessQueued) return;
+    gaplessQueued = false;
+
+    // 音频已经无缝接上，这里只把播放列表推进到交给引擎的那一首并刷新界面。
+    // 期间播放列表可能被替换，原位置不再是这首歌时按歌曲查找
+    const Song song = gaplessSong;
+    int index = gaplessIndex;
+    const QVector<Song> &queue = playlistManager->songs();
+    if (index < 0 || index >= queue.size()
+        || TrackAnalysisService::keyFor(queue.at(index)) != TrackAnalysisService::keyFor(song)) {
+        index = playlistManager->indexOf(song);
+    }
+    if (index >= 0) {
+        playlistManager->setCurrentIndex(index);
+        sessionStore->setCurrentIndex(index);
+    }
+
+    if (currentAudioBuffer) {
+        currentAudioBuffer->deleteLater();
+        currentAudioBuffer = nullptr;
+    }
+    progressSlider->setBufferedRanges({});
+    currentTrimKey.clear();
+    trimEndMs = 0;
+    stuckCount = 0;
+    lastPosition = 0;
+    applyNormalization(song);
+    showWaveform(url);
+
+    if (song.source == SearchSource::Local) {
+        if (song.filePath != url.toLocalFile()) {
+            qCWarning(lcPlayback) << "Gapless track does not match playlist:" << url << song.filePath;
+        }
+        showLocalSong(song);
+    } else {
+        showNetEaseSong(song.id);
+        sessionStore->setResolvedUrl(url);
+    }
+}
+
+void Widget::showAudioMenu(const QPoint &pos)
+{
+    QMenu menu(this);
+    QAction *normalizeAction = menu.addAction("响度归一化");
+    normalizeAction->setCheckable(true);
+    normalizeAction->setChecked(normalizeLoudness);
+    connect(normalizeAction, &QAction::toggled, this, [this](bool enabled) {
+        normalizeLoudness = enabled;
+        QSettings().setValue("audio/normalize", enabled);
+        applyNormalization(playlistManager->getCurrentSong());
+    });
+    menu.addSeparator();
+
+    QMenu *eqMenu = menu.addMenu(audioEngine->supportsEqualizer() ? "均衡器" : "均衡器（需要 PCM 引擎）");
+    eqMenu->setEnabled(audioEngine->supportsEqualizer());
+    const QString currentPreset = QSettings().value("audio/eqPreset", Equalizer::presetNames().first()).toString();
+    for (const QString &preset : Equalizer::presetNames()) {
+        QAction *action = eqMenu->addAction(preset);
+        action->setCheckable(true);
+        action->setChecked(preset == currentPreset);
+        connect(action, &QAction::triggered, this, [this, preset]() {
+            setEqualizerPreset(preset);
+        });
+    }
+    menu.addSeparator();
+
+    QAction *title = menu.addAction(audioEngine->supportsGapless() ? "交叉淡化" : "交叉淡化（需要 PCM 引擎）");
+    title->setEnabled(false);
+
+    const int current = audioEngine->crossfadeDuration();
+    for (int milliseconds : kCrossfadeChoicesMs) {
+        QAction *action = menu.addAction(milliseconds == 0 ? "关闭" : QString("%1 秒").arg(milliseconds / 1000));
+        action->setCheckable(true);
+        action->setChecked(milliseconds == current);
+        action->setEnabled(audioEngine->supportsGapless());
+        connect(action, &QAction::triggered, this, [this, milliseconds]() {
+            setCrossfadeDuration(milliseconds);
+        });
+    }
+    menu.exec(playModeButton->mapToGlobal(pos));
+}
+
+void Widget::setCrossfadeDuration(int milliseconds)
+{
+    QSettings().setValue("audio/crossfadeMs", milliseconds);
+    audioEngine->setCrossfadeDuration(milliseconds);
+    qCInfo(lcPlayback) << "Crossfade set to" << milliseconds << "ms";
+}
+
+void Widget::setEqualizerPreset(const QString &name)
+{
+    QSettings().setValue("audio/eqPreset", name);
+    audioEngine->setEqualizerGains(Equalizer::presetGains(name));
+    qCInfo(lcPlayback) << "Equalizer preset set to" << name;
+}
+
+void Widget::applyNormalization(const Song &song)
+{
+    currentAnalysisKey = TrackAnalysisService::keyFor(song);
+    audioEngine->setNormalizationGain(normalizeLoudness ? trackAnalysis->normalizationGain(currentAnalysisKey) : 1.0f);
+    if (!normalizeLoudness) return;
+
+    // 已在本地的音频（本地文件、离线缓存）在后台分析，连同接下来的两首。
+    // 其余网络曲目不为分析再下载一遍：PCM 引擎在首次完整播放时测量，B 站音频在下载完成后分析缓冲区快照
+    QVector<Song> candidates = playlistManager->upcomingSongs(2);
+    if (!audioEngine->measuresLoudness()) candidates.prepend(song);
+    for (const Song &candidate : std::as_const(candidates)) {
+        const QString path = candidate.source == SearchSource::Local
+                                 ? candidate.filePath
+                                 : audioCache->filePath(AudioCache::keyFor(candidate));
+        if (!path.isEmpty()) {
+            trackAnalysis->analyze(TrackAnalysisService::keyFor(candidate), QUrl::fromLocalFile(path));
+        }
+    }
+}
+
+void Widget::onLoudnessMeasured(const QUrl &source, double lufs)
+{
+    const QString key = analysisKeys.take(source);
+    if (key.isEmpty()) return;
+    qCDebug(lcPlayback) << "Measured" << key << lufs << "LUFS";
+    // 只写入缓存，当前曲目的音量不在播放中途改变
+    trackAnalysis->recordLoudness(key, lufs);
+}
+
+void Widget::onWaveformMeasured(const QUrl &source, const Waveform &waveform)
+{
+    // 对应关系留给随后的 loudnessMeasured 取走
+    const QString key = analysisKeys.value(source);
+    if (key.isEmpty()) return;
+    trackAnalysis->recordWaveform(key, waveform);
+}
+
+void Widget::showWaveform(const QUrl &source)
+{
+    progressSlider->setWaveform(trackAnalysis->waveform(currentAnalysisKey));
+    if (source.isLocalFile()) trackAnalysis->analyze(currentAnalysisKey, source);
+}
+
+void Widget::onWaveformReady(const QString &key)
+{
+    if (key == currentAnalysisKey) progressSlider->setWaveform(trackAnalysis->waveform(key));
+}
+
+void Widget::applyTrimPoints(const QString &trimKey)
+{
+    currentTrimKey = trimKey;
+    trimEndMs = 0;
+    TrimPoints points;
+    if (!trackAnalysis->trimPoints(trimKey, &points)) return;
+
+    // 恢复会话等已有跳转位置时不覆盖
+    if (points.startMs > 0 && pendingSeekPosition < 0) {
+        qCDebug(lcPlayback) << "Skipping leading silence of" << trimKey << points.startMs << "ms";
+        Metrics::increment("silence_skips_total", { { "edge", "leading" } });
+        pendingSeekPosition = points.startMs;
+    }
+    trimEndMs = points.endMs;
+}
+
+void Widget::onTrimPointsReady(const QString &trimKey, const TrimPoints &points)
+{
+    // 首次播放时开头已经播过，只应用结尾
+    if (trimKey == currentTrimKey) trimEndMs = points.endMs;
+}
+
+void Widget::analyzeDownloadedAudio(ChunkedAudioBuffer *buffer)
+{
+    // 响度、波形和裁剪点都已缓存时 analyzeDownloaded 直接返回；
+    // 界面线程只取快照（共享块的引用），写临时文件和解码都在分析线程中进行
+    trackAnalysis->analyzeDownloaded(currentAnalysisKey, currentTrimKey, buffer->snapshot());
+}
+
+void Widget::playCachedAudio(const QString &filePath)
+{
+    Metrics::increment("audio_cache_hits_total");
+    loadingSpinner->stop();
+    playPauseButton->show();
+
+    const QUrl url = QUrl::fromLocalFile(filePath);
+    analysisKeys.insert(url, currentAnalysisKey);
+    audioEngine->setSource(url);
+    audioEngine->play();
+    playbackWatchdog->start();
+    if (currentPlayingSongId != -1) sessionStore->setResolvedUrl(url);
 
-    Song prevSong = playlistManager->getPreviousSong();
-    if (prevSong.source == SearchSource::Bilibili && !prevSong.bvid.isEmpty()) {
-        playBilibiliVideo(prevSong.bvid);
-    } else if (prevSong.id != -1) {
-        playSong(prevSong.id);
+    // 缓存文件可以直接解码：响度、波形和（B 站音频的）首尾静音在同一次后台分析中完成
+    progressSlider->setWaveform(trackAnalysis->waveform(currentAnalysisKey));
+    trackAnalysis->analyze(currentAnalysisKey, url, currentTrimKey);
+}
+
+void Widget::showResultContextMenu(const QPoint &pos)
+{
+    QMenu menu(this);
+    if (currentSearchSource == SearchSource::Local) {
+        QAction *addFolderAction = menu.addAction("添加音乐文件夹...");
+        connect(addFolderAction, &QAction::triggered, this, &Widget::addLocalLibraryFolder);
+    } else {
+        const int row = resultList->row(resultList->itemAt(pos));
+        if (row >= 0 && row < searchResultSongs.size()) {
+            const Song song = searchResultSongs.at(row);
+            const QString key = AudioCache::keyFor(song);
+            QAction *downloadAction = menu.addAction(audioCache->contains(key) ? "已下载" : "下载");
+            downloadAction->setEnabled(!key.isEmpty() && !audioCache->contains(key) && !downloadManager->contains(key));
+            connect(downloadAction, &QAction::triggered, this, [this, song]() {
+                downloadManager->enqueue({ song });
+            });
+        }
+        QAction *downloadAllAction = menu.addAction("下载全部结果");
+        downloadAllAction->setEnabled(!searchResultSongs.isEmpty());
+        connect(downloadAllAction, &QAction::triggered, this, [this]() {
+            downloadManager->enqueue(searchResultSongs);
+        });
+        QAction *downloadQueueAction = menu.addAction("下载播放列表");
+        downloadQueueAction->setEnabled(!playlistManager->isEmpty());
+        connect(downloadQueueAction, &QAction::triggered, this, [this]() {
+            downloadManager->enqueue(playlistManager->songs());
+        });
+    }
+    menu.addSeparator();
+    addDownloadMenu(&menu);
+    menu.exec(resultList->viewport()->mapToGlobal(pos));
+}
+
+void Widget::addDownloadMenu(QMenu *menu)
+{
+    QMenu *downloads = menu->addMenu("离线下载");
+
+    int active = 0, waiting = 0, paused = 0, failed = 0;
+    qint64 received = 0;
+    for (const DownloadManager::Job &job : downloadManager->jobs()) {
+        switch (job.state) {
+        case DownloadManager::State::Resolving:
+        case DownloadManager::State::Downloading:
+            ++active;
+            received += job.received;
+            break;
+        case DownloadManager::State::Queued: ++waiting; break;
+        case DownloadManager::State::Paused: ++paused; break;
+        case DownloadManager::State::Failed: ++failed; break;
+        case DownloadManager::State::Completed: break;
+        }
+    }
+    QAction *status = downloads->addAction(
+        QString("下载中 %1（%2 MB）· 排队 %3 · 暂停 %4 · 失败 %5")
+            .arg(active).arg(received / (1024 * 1024)).arg(waiting).arg(paused).arg(failed));
+    status->setEnabled(false);
+    QAction *cacheSize = downloads->addAction(
+        QString("已缓存 %1 首，共 %2 MB").arg(audioCache->entries().size()).arg(audioCache->totalBytes() / (1024 * 1024)));
+    cacheSize->setEnabled(false);
+    downloads->addSeparator();
+
+    QAction *pauseAction = downloads->addAction("全部暂停");
+    pauseAction->setEnabled(active + waiting > 0);
+    connect(pauseAction, &QAction::triggered, downloadManager, &DownloadManager::pauseAll);
+    QAction *resumeAction = downloads->addAction(failed > 0 ? "全部继续（重试失败的任务）" : "全部继续");
+    resumeAction->setEnabled(paused + failed > 0);
+    connect(resumeAction, &QAction::triggered, downloadManager, &DownloadManager::resumeAll);
+    downloads->addSeparator();
+
+    QMenu *speedMenu = downloads->addMenu("限速");
+    const int current = QSettings().value("download/maxKBps", 0).toInt();
+    for (int kilobytes : { 0, 256, 1024, 4096 }) {
+        QAction *action = speedMenu->addAction(kilobytes == 0 ? "不限速"
+            : kilobytes < 1024 ? QString("%1 KB/s").arg(kilobytes) : QString("%1 MB/s").arg(kilobytes / 1024));
+        action->setCheckable(true);
+        action->setChecked(kilobytes == current);
+        connect(action, &QAction::triggered, this, [this, kilobytes]() {
+            setDownloadSpeedLimit(kilobytes);
+        });
+    }
+}
+
+void Widget::setDownloadSpeedLimit(int kilobytesPerSecond)
+{
+    QSettings().setValue("download/maxKBps", kilobytesPerSecond);
+    downloadManager->setBandwidthLimit(qint64(kilobytesPerSecond) * 1024);
+    qCInfo(lcNetwork) << "Download speed limit set to" << kilobytesPerSecond << "KB/s";
+}
+
+void Widget::updateBufferedRange(qint64 buffered, qint64 total)
+{
+    // 边下边播的缓冲区从头顺序下载；总长未知或已下载完时不区分
+    if (total <= 0 || buffered >= total) {
+        progressSlider->setBufferedRanges({});
+    } else {
+        progressSlider->setBufferedRanges({ { 0.0, qreal(buffered) / total } });
     }
 }
 
@@ -1412,8 +2423,13 @@ void Widget::changePlayMode()
     int nextModeIndex = (static_cast<int>(currentMode) + 1) % 3;
     PlaylistManager::PlayMode nextMode = static_cast<PlaylistManager::PlayMode>(nextModeIndex);
     playlistManager->setPlayMode(nextMode);
+    sessionStore->setPlayMode(nextMode);
+    updatePlayModeButton();
+}
 
-    switch(nextMode) {
+void Widget::updatePlayModeButton()
+{
+    switch (playlistManager->getPlayMode()) {
         case PlaylistManager::Sequential:
             playModeButton->setIcon(QIcon(":/icons/loop-list.png"));
             playModeButton->setToolTip("顺序播放");
@@ -1444,29 +2460,25 @@ void Widget::updateVolumeIcon(int volume)
 
 void Widget::onPrevPageButtonClicked()
 {
+    if (currentSearchSource == SearchSource::Local) return;
     if (currentPage > 1) {
         currentPage--;
+        incrementalSearch = false;
         searchButton->setEnabled(false);
         searchButton->setToolTip("加载中...");
-        if (currentSearchSource == SearchSource::NetEase) {
-            apiManager->searchSongs(currentSearchKeywords, 15, (currentPage - 1) * 15);
-        } else {
-            apiManager->searchBilibiliVideos(currentSearchKeywords, currentPage);
-        }
+        requestSearchPage();
     }
 }
 
 void Widget::onNextPageButtonClicked()
 {
     // 这里的总页数判断依赖于 onSearchFinished 的结果
+    if (currentSearchSource == SearchSource::Local) return;
     currentPage++;
+    incrementalSearch = false;
     searchButton->setEnabled(false);
     searchButton->setToolTip("加载中...");
-    if (currentSearchSource == SearchSource::NetEase) {
-        apiManager->searchSongs(currentSearchKeywords, 15, (currentPage - 1) * 15);
-    } else {
-        apiManager->searchBilibiliVideos(currentSearchKeywords, currentPage);
-    }
+    requestSearchPage();
 }
 
 void Widget::onMainStackCurrentChanged(int index)
@@ -1476,32 +2488,8 @@ void Widget::onMainStackCurrentChanged(int index)
     backButton->setVisible(index == 1);
 }
 
-void Widget::parseLyrics(const QString &lyricText)
-{
-    QRegularExpression re("\\[(\\d{2}):(\\d{2})\\.(\\d{2,3})\\](.*)");
-    for (const QString &line : lyricText.split('\n')) {
-        QRegularExpressionMatch match = re.match(line);
-        if (match.hasMatch()) {
-            qint64 minutes = match.captured(1).toLongLong();
-            qint64 seconds = match.captured(2).toLongLong();
-            qint64 milliseconds = match.captured(3).toLongLong();
-            if (match.captured(3).length() == 2) { // 兼容xx.xx格式
-                milliseconds *= 10;
-            }
-            qint64 time = minutes * 60 * 1000 + seconds * 1000 + milliseconds;
-            QString text = match.captured(4);
-            lyricData.insert(time, text);
-        }
-    }
-}
-
 // --- 动态背景 ---
 
-QColor Widget::getWidgetBackgroundColor() const
-{
-    return currentBackgroundColor;
-}
-
 QColor Widget::extractDominantColor(const QPixmap &pixmap)
 {
     if (pixmap.isNull()) {
@@ -1512,94 +2500,6 @@ QColor Widget::extractDominantColor(const QPixmap &pixmap)
     return image.pixelColor(0, 0);
 }
 
-// 提取多个主色调（苹果音乐风格）
-QVector<QColor> Widget::extractPaletteColors(const QPixmap &pixmap, int colorCount)
-{
-    QVector<QColor> colors;
-    if (pixmap.isNull()) {
-        colors.append(QColor(51, 51, 51));
-        return colors;
-    }
-    
-    // 缩小图片以加快处理速度
-    QImage image = pixmap.toImage().scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    
-    // 使用区域采样法提取不同区域的主色
-    int w = image.width();
-    int h = image.height();
-    
-    // 定义采样区域（左上、右上、中心、左下、右下）
-    struct Region { int x1, y1, x2, y2; };
-    QVector<Region> regions = {
-        {0, 0, w/2, h/2},           // 左上
-        {w/2, 0, w, h/2},           // 右上
-        {w/4, h/4, w*3/4, h*3/4},   // 中心
-        {0, h/2, w/2, h},           // 左下
-        {w/2, h/2, w, h}            // 右下
-    };
-    
-    // 计算每个区域的平均颜色
-    QVector<QColor> regionColors;
-    for (const auto &region : regions) {
-        long r = 0, g = 0, b = 0;
-        int count = 0;
-        
-        for (int y = region.y1; y < region.y2 && y < h; ++y) {
-            for (int x = region.x1; x < region.x2 && x < w; ++x) {
-                QColor c = image.pixelColor(x, y);
-                r += c.red();
-                g += c.green();
-                b += c.blue();
-                count++;
-            }
-        }
-        
-        if (count > 0) {
-            regionColors.append(QColor(r/count, g/count, b/count));
-        }
-    }
-    
-    // 选择最亮的颜色作为主色（用于文字等）
-    std::sort(regionColors.begin(), regionColors.end(), [](const QColor &a, const QColor &b) {
-        return (a.red()*0.299 + a.green()*0.587 + a.blue()*0.114) > 
-               (b.red()*0.299 + b.green()*0.587 + b.blue()*0.114);
-    });
-    
-    // 选择最有代表性的颜色（避免太相似的颜色）
-    for (const QColor &c : regionColors) {
-        bool tooSimilar = false;
-        for (const QColor &existing : colors) {
-            int dr = qAbs(c.red() - existing.red());
-            int dg = qAbs(c.green() - existing.green());
-            int db = qAbs(c.blue() - existing.blue());
-            if (dr + dg + db < 80) { // 颜色差异阈值
-                tooSimilar = true;
-                break;
-            }
-        }
-        if (!tooSimilar) {
-            colors.append(c);
-            if (colors.size() >= colorCount) break;
-        }
-    }
-    
-    // 如果颜色不够，用主色生成变体
-    if (colors.size() < colorCount && !colors.isEmpty()) {
-        QColor base = colors.first();
-        while (colors.size() < colorCount) {
-            QColor variant = base.darker(120 + colors.size() * 30);
-            colors.append(variant);
-        }
-    }
-    
-    // 确保至少返回一个颜色
-    if (colors.isEmpty()) {
-        colors.append(QColor(51, 51, 51));
-    }
-    
-    return colors;
-}
-
 // 使用调色板更新背景
 void Widget::updateBackgroundWithPalette(const QVector<QColor> &colors)
 {
@@ -1607,17 +2507,19 @@ void Widget::updateBackgroundWithPalette(const QVector<QColor> &colors)
     
     if (colors.isEmpty()) {
         setWidgetStyle(QColor(51, 51, 51));
-        flowAnimation->stop();
+        if (flowAnimation) flowAnimation->stop();
         return;
     }
     
     // 更新流动背景的颜色
+    ensureFlowingBackground();
     flowingBackground->setColors(colors);
     
     // 启动流动动画
     if (flowAnimation->state() != QAbstractAnimation::Running) {
         flowAnimation->start();
     }
+    updateBackgroundActivity();
     
     // 使用调色板设置样式
     setWidgetStyleWithPalette(colors);
@@ -1745,11 +2647,16 @@ void Widget::setWidgetStyle(const QColor &color)
         }
     )").arg(foregroundColor, color.name(), darkerColor);
 
+    // 进度条自绘，不受样式表影响
+    QColor remaining(foregroundColor);
+    remaining.setAlpha(90);
+    progressSlider->setColors(QColor(foregroundColor), remaining);
+
     QString mainWidgetStyle = QString(
         "QWidget#mainWidget { background-color: qlineargradient(x1: 0, y1: 0, x2: 1, y2: 1, stop: 0 %1, stop: 1 %2); }"
     ).arg(color.name(), darkerColor);
     
-    this->setStyleSheet(styleSheet + mainWidgetStyle);
+    commitStyleSheet(styleSheet + mainWidgetStyle);
 }
 
 // 使用调色板设置样式（苹果音乐风格）
@@ -1884,22 +2791,43 @@ void Widget::setWidgetStyleWithPalette(const QVector<QColor> &colors)
         }
     )").arg(foregroundColor, foregroundColorMuted);
 
+    progressSlider->setColors(Qt::white, QColor(255, 255, 255, 90));
+
     // 背景使用半透明以便看到模糊背景
     QString mainWidgetStyle = QString(
         "QWidget#mainWidget { background-color: rgba(0, 0, 0, 0.1); }"
     );
     
-    this->setStyleSheet(styleSheet + mainWidgetStyle);
+    commitStyleSheet(styleSheet + mainWidgetStyle);
 }
 
 void Widget::updateBackgroundColor(const QColor &newColor)
 {
-    if (backgroundAnimation->state() == QAbstractAnimation::Running) {
-        backgroundAnimation->stop();
+    // 过渡由 commitStyleSheet 中的截图淡出完成，样式表只应用一次
+    setWidgetStyle(newColor);
+}
+
+void Widget::commitStyleSheet(const QString &styleSheet)
+{
+    // 换歌时先重置为默认配色，封面到达后再换成封面配色；连续播放同色时不必重新应用
+    if (styleSheet == appliedStyleSheet) {
+        Metrics::increment("stylesheet_updates_total", { { "result", "unchanged" } });
+        return;
+    }
+
+    // 可见时先把当前画面截图盖在最上层，新样式表在截图下面一次性应用，然后截图淡出。
+    // 过渡期间每帧只绘制一张位图，不再逐帧重建样式表、重新 polish 整棵控件树
+    if (firstPaintDone && isVisible() && !isMinimized()) {
+        if (!styleCrossfade) styleCrossfade = new CrossfadeOverlay(this);
+        styleCrossfade->start(grab(), kStyleTransitionMs);
     }
-    backgroundAnimation->setStartValue(currentBackgroundColor);
-    backgroundAnimation->setEndValue(newColor);
-    backgroundAnimation->start();
+
+    QElapsedTimer timer;
+    timer.start();
+    setStyleSheet(styleSheet);
+    appliedStyleSheet = styleSheet;
+    Metrics::increment("stylesheet_updates_total", { { "result", "applied" } });
+    Metrics::observe("stylesheet_apply_ms", timer.nsecsElapsed() / 1e6);
 }
 
 void Widget::closeEvent(QCloseEvent *event)
@@ -1908,6 +2836,7 @@ void Widget::closeEvent(QCloseEvent *event)
     if (this->isVisible()) {
         event->ignore();
         this->hide();
+        ensureTrayIcon();
         trayIcon->show();
         trayIcon->showMessage("Melody", "播放器已最小化到托盘");
     } else {
@@ -1915,13 +2844,54 @@ void Widget::closeEvent(QCloseEvent *event)
     }
 }
 
+void Widget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    updateBackgroundActivity();
+}
+
+void Widget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    updateBackgroundActivity();
+}
+
+void Widget::changeEvent(QEvent *event)
+{
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) {
+        updateBackgroundActivity();
+    }
+}
+
+void Widget::updateBackgroundActivity()
+{
+    const bool visible = isVisible() && !isMinimized();
+    if (flowAnimation) {
+        if (!visible && flowAnimation->state() == QAbstractAnimation::Running) {
+            flowAnimation->pause();
+        } else if (visible && flowAnimation->state() == QAbstractAnimation::Paused) {
+            flowAnimation->resume();
+        }
+    }
+
+    // 不分析时分析线程退出，声卡回调也不再拷贝数据；引擎不输出 PCM 时分析线程只会空转
+    const bool analyze = visible && flowAnimation && flowAnimation->state() == QAbstractAnimation::Running
+        && audioEngine->playbackState() == QMediaPlayer::PlayingState && audioEngine->providesSpectrum();
+    if (analyze) {
+        spectrumAnalyzer->start();
+    } else {
+        spectrumAnalyzer->stop();
+    }
+}
+
 void Widget::onTrayIconActivated(QSystemTrayIcon::ActivationReason reason)
 {
     // 双击托盘图标时显示窗口
     if (reason == QSystemTrayIcon::DoubleClick) {
         this->showNormal();
         this->activateWindow();
-        trayIcon->hide();
+        if (trayIcon) trayIcon->hide();
     }
 }
 
@@ -1929,8 +2899,13 @@ void Widget::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
     
+    // 截图与新尺寸对不上，直接结束配色过渡
+    if (styleCrossfade) styleCrossfade->finish();
+
     // 调整流动背景大小
-    flowingBackground->setGeometry(0, 0, this->width(), this->height());
+    if (flowingBackground) {
+        flowingBackground->setGeometry(0, 0, this->width(), this->height());
+    }
     
     if (!originalAlbumArt.isNull())
     {
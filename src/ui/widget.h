@@ -6,18 +6,34 @@
 #include <QJsonDocument>
 #include <QMediaPlayer>
 #include <QMap>
+#include <QHash>
+#include <QUrl>
 #include <QPropertyAnimation>
 #include <QResizeEvent>
 #include <QCloseEvent>
 #include <QSystemTrayIcon>
 #include <QTimer>
 #include <QMovie>
-#include <QBuffer>
 #include <QFile>
 #include "core/playlistmanager.h" // 引入播放列表管理器
+#include "core/searchmerger.h"
+#include "core/searchcache.h"
+#include "core/sessionstore.h"
+#include <QElapsedTimer>
 
 // 搜索源枚举声明
 enum class SearchSource;
+class ChunkedAudioBuffer;
+class AudioEngine;
+class TrackAnalysisService;
+class SpectrumAnalyzer;
+class WaveformSeekBar;
+class AudioCache;
+class DownloadManager;
+class CacheMaintenance;
+class CrossfadeOverlay;
+struct TrimPoints;
+struct Waveform;
 
 // 自定义加载动画控件
 class LoadingSpinner : public QWidget
@@ -32,40 +48,12 @@ public:
 
 private:
     QLabel *m_label;
-    QMovie *m_movie;
-};
-
-// 动态流动背景控件（苹果音乐风格）
-class FlowingBackground : public QWidget
-{
-    Q_OBJECT
-    Q_PROPERTY(qreal timeOffset READ timeOffset WRITE setTimeOffset)
-
-public:
-    explicit FlowingBackground(QWidget *parent = nullptr);
-    void setColors(const QVector<QColor> &colors);
-    qreal timeOffset() const { return m_timeOffset; }
-    void setTimeOffset(qreal offset);
-
-protected:
-    void paintEvent(QPaintEvent *event) override;
-
-private:
-    QVector<QColor> m_colors;
-    qreal m_timeOffset = 0;
-    
-    struct Blob {
-        QColor color;
-        qreal x, y;        // 中心位置 (0-1)
-        qreal radius;      // 半径
-        qreal speedX;      // 移动速度
-        qreal speedY;
-        qreal phase;       // 相位偏移
-    };
-    QVector<Blob> m_blobs;
+    QMovie *m_movie = nullptr; // 首次显示时创建
 };
 
 // 前置声明
+class FlowingBackground;
+class PerfHud;
 class QLineEdit;
 class QPushButton;
 class QListWidget;
@@ -75,7 +63,6 @@ class QSlider;
 class QHBoxLayout;
 class QVBoxLayout;
 class QStackedWidget;
-class QAudioOutput;
 class QMediaDevices;
 class ApiManager;
 class PlaylistManager;
@@ -83,6 +70,7 @@ class QMenu;
 class QWidgetAction;
 class QAction;
 class QComboBox;
+class LocalLibrary;
 
 // 悬浮灵动岛窗口
 class FloatingIsland : public QWidget
@@ -137,7 +125,6 @@ private:
 class Widget : public QWidget
 {
     Q_OBJECT
-    Q_PROPERTY(QColor widgetBackgroundColor READ getWidgetBackgroundColor WRITE setWidgetStyle)
 
 public:
     Widget(QWidget *parent = nullptr);
@@ -156,8 +143,9 @@ private slots:
     void onBilibiliSearchFinished(const QJsonDocument &json);
     void onBilibiliVideoInfoFinished(const QJsonDocument &json);
     void onBilibiliAudioUrlReady(const QUrl &url);
-    void onBilibiliAudioDataReady(const QByteArray &data);
-    void onBilibiliAudioFileReady(const QString &filePath);
+    void onBilibiliAudioStreamReady(ChunkedAudioBuffer *buffer);
+    void onBilibiliAudioStreamFinished(ChunkedAudioBuffer *buffer);
+    void onBilibiliAudioUpgradeFailed(const QString &errorString);
     void onBilibiliImageDownloaded(const QByteArray &data);
 
     void onApiError(const QString &errorString);
@@ -203,26 +191,82 @@ private slots:
     // 托盘图标
     void onTrayIconActivated(QSystemTrayIcon::ActivationReason reason);
 
-    QColor getWidgetBackgroundColor() const;
-
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    bool event(QEvent *event) override; // 记录首帧绘制时间与绘制耗时
 
 private:
     void playSong(qint64 id); // 播放网易云音乐歌曲
     void playBilibiliVideo(const QString &bvid); // 播放Bilibili视频
-    void parseLyrics(const QString &lyricText);
+    void playLocalSong(const Song &song); // 播放本地曲库文件
+    void playQueuedSong(const Song &song); // 按来源分派播放
+    void onSearchTextEdited();      // 边输入边搜索：按键后重新开始防抖计时
+    void onSearchDebounceTimeout();
+    void runSearch(const QString &keywords); // 先查缓存，未精确命中的来源再请求网络
+    void requestSearchPage(); // 按当前搜索源请求 currentPage 页
+    void requestSource(SearchSource source);
+    void onSearchFailed(SearchSource source, const QString &errorString);
+    void showResultSongs(const QVector<Song> &songs); // 只刷新结果列表，不改变播放列表
+    void playResultAt(int index); // 用当前结果替换播放列表并保存会话
+    void showSourceResults(SearchSource source, const QVector<Song> &songs, int total, bool provisional);
+    void mergeFederatedResults(SearchSource source, const QVector<Song> &songs, int totalPages, bool provisional = false);
+    void reportSearchLatency(const QString &origin, bool final); // 记录从最后一次按键到结果展示的耗时
+    void clearRateLimitHint(); // B 站请求重试成功后撤下搜索按钮上的限流提示
+    void restoreSession(); // 恢复上次的队列、设置与播放位置
+
+    // 非首帧必需的部件在首次使用时创建
+    void ensureTrayIcon();
+    void ensureFloatingIsland();
+    void ensureFlowingBackground();
+    void updateBackgroundActivity(); // 窗口不可见时暂停背景动画；只在可见且播放时做频谱分析
+    void togglePerfHud();   // Ctrl+Shift+P
+    void exportMetrics();   // Ctrl+Shift+E：导出为 JSON 或 Prometheus 文本
+    void switchAudioEngine(); // Ctrl+Shift+A：切换播放引擎并从当前位置继续
+    void connectAudioEngine();
+    void showLocalSong(const Song &song); // 刷新本地歌曲的界面信息
+    void showNetEaseSong(qint64 id);      // 刷新网易云歌曲的界面信息并请求歌词、封面
+    void queueGaplessNext(qint64 position); // 临近结尾时把确定的下一首交给引擎无缝衔接
+    void onGaplessTrackStarted(const QUrl &url);
+    void onSongUrlPrefetched(qint64 songId, const QUrl &url);
+    void showAudioMenu(const QPoint &pos); // 右键播放模式按钮：响度归一化、均衡器与交叉淡化时长
+    void setCrossfadeDuration(int milliseconds);
+    void setEqualizerPreset(const QString &name);
+    void applyNormalization(const Song &song); // 起播时按缓存的响度设置增益，未分析的曲目安排分析
+    void onLoudnessMeasured(const QUrl &source, double lufs);
+    void onWaveformMeasured(const QUrl &source, const Waveform &waveform);
+    void showWaveform(const QUrl &source); // 显示缓存的波形；source 为本地文件且尚未分析时在后台分析
+    void onWaveformReady(const QString &key);
+    void applyTrimPoints(const QString &trimKey); // 起播时按缓存的裁剪点跳过开头静音并记下结尾位置
+    void onTrimPointsReady(const QString &trimKey, const TrimPoints &points);
+    void analyzeDownloadedAudio(ChunkedAudioBuffer *buffer); // 取快照交给后台分析
+    void playCachedAudio(const QString &filePath); // 播放已离线下载的音频，不再请求播放地址
+    void showResultContextMenu(const QPoint &pos);
+    void addDownloadMenu(QMenu *menu); // 离线下载的状态、暂停/继续与限速
+    void setDownloadSpeedLimit(int kilobytesPerSecond);
+    void finishCurrentTrack(); // 播放结束（或到达结尾静音）：切到下一首
+    void updateBufferedRange(qint64 buffered, qint64 total);
+    void startFirstAudioTimer(const QString &source);
+    void updatePlayModeButton();
+    void requestCover(const Song &song); // 下载封面（同一首歌只请求一次）
     void cleanupPreviousPlayback(); // 清理之前的播放资源
 
+    // 本地曲库
+    void ensureLocalLibrary();
+    void showLocalResults(const QString &keywords);
+    void addLocalLibraryFolder();
+
     // 动态背景
     QColor extractDominantColor(const QPixmap &pixmap);
-    QVector<QColor> extractPaletteColors(const QPixmap &pixmap, int colorCount = 3);
     void updateBackgroundColor(const QColor &color);
     void updateBackgroundWithPalette(const QVector<QColor> &colors);
     bool isColorDark(const QColor &color) const;
     void setWidgetStyle(const QColor &color);
     void setWidgetStyleWithPalette(const QVector<QColor> &colors);
+    void commitStyleSheet(const QString &styleSheet); // 样式表有变化时才应用，可见时以截图淡出过渡
 
     // UI 元素
     QLineEdit *searchInput;
@@ -237,7 +281,7 @@ private:
     QPushButton *prevButton;
     QPushButton *nextButton;
     QPushButton *playModeButton; // 新增播放模式按钮
-    QSlider *progressSlider;
+    WaveformSeekBar *progressSlider;
     QLabel *timeLabel;
     QSlider *volumeSlider;
     QPushButton *volumeButton; // 新增音量按钮
@@ -245,7 +289,7 @@ private:
     QWidgetAction *volumeAction; // 用于将Slider放入Menu
     QPushButton *backButton; // 新增返回按钮
     QPushButton *minimizeButton; // 新增缩小按钮
-    FloatingIsland *floatingIsland; // 新增悬浮灵动岛
+    FloatingIsland *floatingIsland = nullptr; // 悬浮灵动岛（首次缩小时创建）
 
     // 播放详情页
     QStackedWidget *mainStackedWidget;
@@ -262,9 +306,8 @@ private:
     // 加载动画
     LoadingSpinner *loadingSpinner;
 
-    // 媒体播放器
-    QMediaPlayer *mediaPlayer;
-    QAudioOutput *audioOutput;
+    // 播放引擎（QMediaPlayer 或 PCM 引擎，Ctrl+Shift+A 切换）
+    AudioEngine *audioEngine;
     QMediaDevices *mediaDevices;
     qint64 currentDuration;
 
@@ -282,29 +325,84 @@ private:
     QString currentSearchKeywords;
     int currentPage;
     qint64 currentPlayingSongId;
+    qint64 coverRequestedSongId; // 已请求封面的歌曲ID
     QString currentBvid; // 当前播放的Bilibili视频BV号
+    QString currentTrimKey; // 当前B站音频的裁剪点缓存键（bvid + cid）
+    qint64 trimEndMs = 0;   // 结尾静音的起点，到达后提前切歌；0 表示不裁剪
+    QString currentLocalFile; // 当前播放的本地文件
+    LocalLibrary *localLibrary = nullptr; // 本地曲库（首次使用时创建）
     QUrl currentBilibiliAudioUrl; // 当前Bilibili音频URL
     SearchSource currentSearchSource; // 当前搜索源
+    bool federatedSearch = false; // 聚合搜索：同时搜索网易云与Bilibili
+    SearchMerger searchMerger; // 聚合搜索结果的去重与排序
+    int federatedTotalPages = 0;
+
+    // 边输入边搜索
+    QTimer *searchDebounceTimer;
+    bool incrementalSearch = false; // 当前搜索由输入触发（不弹窗）
+    bool rateLimitHintShown = false; // 搜索按钮的提示正显示 B 站限流
+    SearchCache searchCache;
+    QElapsedTimer keystrokeTimer; // 最后一次按键（或点击搜索）起计时
+    QVector<qint64> searchLatencySamples;
+
+    // 会话持久化
+    SessionStore *sessionStore;
+    bool restoringSession = false; // 恢复的歌曲尚未由用户重新播放
+    bool resumeOnRestore = false;  // 恢复的歌曲准备好后继续播放
+    bool restoredCachedUrl = false; // 当前音源来自会话中保存的地址，失效时需重新解析
+
+    bool firstPaintDone = false;
+
+    // 性能指标
+    PerfHud *perfHud = nullptr;      // 首次按下快捷键时创建
+    QElapsedTimer firstAudioTimer;   // 从请求播放到开始出声
+    QString firstAudioSource;
+    QElapsedTimer stallTimer;        // 缓冲卡顿持续时间
 
     // 动态背景
-    QPropertyAnimation *backgroundAnimation;
     QColor currentBackgroundColor;
+    QString appliedStyleSheet;
+    CrossfadeOverlay *styleCrossfade = nullptr; // 首次切换配色时创建
     QPixmap originalAlbumArt;
-    FlowingBackground *flowingBackground; // 流动背景控件
-    QPropertyAnimation *flowAnimation; // 流动动画
+    FlowingBackground *flowingBackground = nullptr; // 流动背景控件（首次有封面配色时创建）
+    QPropertyAnimation *flowAnimation = nullptr; // 流动动画
+    SpectrumAnalyzer *spectrumAnalyzer = nullptr; // 驱动流动背景的实时频谱（PCM 引擎）
     QVector<QColor> currentPalette; // 当前调色板
 
     // 系统托盘
-    QSystemTrayIcon *trayIcon;
-    QMenu *trayIconMenu;
-    QAction *showAction;
-    QAction *quitAction;
+    QSystemTrayIcon *trayIcon = nullptr; // 首次最小化到托盘时创建
+    QMenu *trayIconMenu = nullptr;
+    QAction *showAction = nullptr;
+    QAction *quitAction = nullptr;
 
     // 资源管理（修复长时间播放卡住问题）
-    QBuffer *currentAudioBuffer = nullptr; // 当前使用的音频缓冲区
-    QString currentTempAudioFile; // 当前使用的临时音频文件路径
+    ChunkedAudioBuffer *currentAudioBuffer = nullptr; // 当前播放的音频流缓冲区
     QTimer *playbackWatchdog = nullptr; // 播放看门狗定时器
     qint64 lastPosition = 0; // 上次播放位置（用于检测卡住）
     int stuckCount = 0; // 卡住计数器
+
+    // 自适应音质
+    bool upgradingBilibiliQuality = false; // 正在后台下载更高音质版本
+    ChunkedAudioBuffer *upgradeAudioBuffer = nullptr; // 高音质版本，下载完成后切换
+
+    // 无缝衔接（PCM 引擎）
+    bool gaplessQueued = false; // 下一首已交给引擎
+    Song gaplessSong;           // 交给引擎的下一首及其在播放列表中的位置，切换时以此为准
+    int gaplessIndex = -1;
+    qint64 prefetchRequestedId = -1; // 已请求预取播放地址的网易云歌曲
+    qint64 prefetchedSongId = -1;
+    QUrl prefetchedUrl;
+
+    // 响度归一化
+    TrackAnalysisService *trackAnalysis = nullptr;
+    bool normalizeLoudness = true;
+    QString currentAnalysisKey;         // 当前曲目的分析缓存键
+    QHash<QUrl, QString> analysisKeys;  // 交给引擎的音源地址 -> 缓存键（设备音源为空地址）
+    qint64 pendingSeekPosition = -1; // 音源切换后需要恢复的位置
+
+    // 离线下载
+    AudioCache *audioCache = nullptr;
+    DownloadManager *downloadManager = nullptr;
+    CacheMaintenance *cacheMaintenance = nullptr; // 启动一段时间后在后台校验与清理缓存
 };
 #endif // WIDGET_H